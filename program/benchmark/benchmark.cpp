@@ -0,0 +1,2158 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bvh.hpp"
+#include "commandStream.hpp"
+#include "descriptorAllocator.hpp"
+#include "drawQueue.hpp"
+#include "dx.hpp"
+#include "frameScheduler.hpp"
+#include "frustumCulling.hpp"
+#include "jobSystem.hpp"
+#include "logger.hpp"
+#include "mesh.hpp"
+#include "meshFile.hpp"
+#include "meshSimplifier.hpp"
+#include "nullBackend.hpp"
+#include "occlusionCulling.hpp"
+#include "profiler.hpp"
+#include "renderGraph.hpp"
+#include "renderThread.hpp"
+#include "shaderPipeline.hpp"
+#include "softwareBackend.hpp"
+#include "tlsfAllocator.hpp"
+#include "transientAllocator.hpp"
+#include "vertexLayout.hpp"
+
+// Runs the renderer's CPU paths against NullBackend or SoftwareBackend and
+// writes the results as JSON, so two commits can be compared run against run.
+//
+//   benchmark [--backend null|software] [--filter text] [--repetitions n]
+//             [--min-time ms] [--out results.json] [--label text]
+
+namespace
+{
+    struct BenchVertex
+    {
+        float position[3];
+    };
+
+    struct BenchInstance
+    {
+        float offset[4];
+    };
+}
+
+template<>
+struct VertexLayout<BenchVertex>
+{
+    static constexpr std::array attributes = { VertexAttribute{ "POSITION", 0, VertexFormat::Float3, 0 } };
+};
+
+template<>
+struct VertexLayout<BenchInstance>
+{
+    static constexpr std::array attributes = { VertexAttribute{ "TEXCOORD", 0, VertexFormat::Float4, 0 } };
+};
+
+namespace
+{
+    struct Options
+    {
+        std::string backend = "null";
+
+        std::string filter;
+
+        std::uint32_t repetitions = 5;
+
+        std::chrono::milliseconds minTime{ 50 };
+
+        std::filesystem::path output;
+
+        std::string label;
+
+        std::filesystem::path workDirectory = std::filesystem::temp_directory_path() / "program_benchmark";
+    };
+
+    struct Counter
+    {
+        std::string name;
+
+        double value = 0.0;
+    };
+
+    struct Result
+    {
+        std::string name;
+
+        std::uint64_t parameter = 0;
+
+        std::uint64_t iterations = 0;
+
+        // Nanoseconds per operation, one per repetition, sorted
+        std::vector<double> samples;
+
+        std::vector<Counter> counters;
+
+        double median()const { return samples[samples.size() / 2]; }
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    double Seconds(Clock::duration duration)
+    {
+        return std::chrono::duration<double>(duration).count();
+    }
+
+    class Runner
+    {
+    public:
+
+        explicit Runner(const Options& options) : m_options(options) {}
+
+        bool selected(const std::string& name)const
+        {
+            return m_options.filter.empty() || name.find(m_options.filter) != std::string::npos;
+        }
+
+        // body(n) performs n operations. n is doubled until one call takes minTime,
+        // then every repetition runs that many.
+        Result& run(const std::string& name, std::uint64_t parameter, const std::function<void(std::uint64_t)>& body)
+        {
+            std::uint64_t iterations = 1;
+
+            for (;;)
+            {
+                const auto start = Clock::now();
+                body(iterations);
+                const auto elapsed = Clock::now() - start;
+
+                if (m_options.minTime <= elapsed || (1ull << 32) <= iterations)
+                {
+                    break;
+                }
+
+                // Jump close to the target once there is a usable measurement
+                const auto scale = 0.0 < Seconds(elapsed) ? Seconds(m_options.minTime) / Seconds(elapsed) : 16.0;
+                iterations = std::max(iterations * 2, static_cast<std::uint64_t>(static_cast<double>(iterations) * std::min(scale * 1.2, 16.0)));
+            }
+
+            Result result = { .name = name, .parameter = parameter, .iterations = iterations, .samples = {}, .counters = {} };
+
+            for (std::uint32_t i = 0; i < m_options.repetitions; ++i)
+            {
+                const auto start = Clock::now();
+                body(iterations);
+                const auto elapsed = Clock::now() - start;
+
+                result.samples.push_back(Seconds(elapsed) * 1e9 / static_cast<double>(iterations));
+            }
+
+            std::sort(result.samples.begin(), result.samples.end());
+
+            m_results.push_back(std::move(result));
+
+            return m_results.back();
+        }
+
+        void print(const Result& result)const
+        {
+            std::printf("%-28s %10llu %14.1f ns/op  (min %.1f, max %.1f)",
+                result.name.c_str(), static_cast<unsigned long long>(result.parameter),
+                result.median(), result.samples.front(), result.samples.back());
+
+            for (const auto& counter : result.counters)
+            {
+                std::printf("  %s %.4g", counter.name.c_str(), counter.value);
+            }
+
+            std::printf("\n");
+        }
+
+        bool writeJson(const std::filesystem::path& path)const
+        {
+            std::string json = "{\n";
+
+            json += "  \"label\": \"" + escape(m_options.label) + "\",\n";
+            json += "  \"backend\": \"" + escape(m_options.backend) + "\",\n";
+            json += "  \"compiler\": \"" + escape(CompilerName()) + "\",\n";
+            json += "  \"hardwareThreads\": " + std::to_string(std::thread::hardware_concurrency()) + ",\n";
+            json += "  \"results\": [\n";
+
+            for (std::size_t i = 0; i < m_results.size(); ++i)
+            {
+                const auto& result = m_results[i];
+
+                json += "    {\"name\": \"" + escape(result.name) + "\", \"parameter\": " + std::to_string(result.parameter) +
+                    ", \"unit\": \"ns/op\", \"median\": " + number(result.median()) +
+                    ", \"min\": " + number(result.samples.front()) + ", \"max\": " + number(result.samples.back()) +
+                    ", \"iterations\": " + std::to_string(result.iterations) + ", \"counters\": {";
+
+                for (std::size_t c = 0; c < result.counters.size(); ++c)
+                {
+                    json += (c == 0 ? "\"" : ", \"") + escape(result.counters[c].name) + "\": " + number(result.counters[c].value);
+                }
+
+                json += i + 1 < m_results.size() ? "}},\n" : "}}\n";
+            }
+
+            json += "  ]\n}\n";
+
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write(json.data(), static_cast<std::streamsize>(json.size()));
+
+            return file.good();
+        }
+
+    private:
+
+        static std::string CompilerName()
+        {
+#if defined(_MSC_VER)
+            return "MSVC " + std::to_string(_MSC_VER);
+#elif defined(__clang__)
+            return "Clang " __clang_version__;
+#elif defined(__GNUC__)
+            return "GCC " __VERSION__;
+#else
+            return "unknown";
+#endif
+        }
+
+        static std::string escape(const std::string& text)
+        {
+            std::string escaped;
+
+            for (const char c : text)
+            {
+                if (c == '"' || c == '\\')
+                {
+                    escaped += '\\';
+                }
+
+                escaped += c;
+            }
+
+            return escaped;
+        }
+
+        static std::string number(double value)
+        {
+            char text[32];
+            std::snprintf(text, sizeof(text), "%.6g", value);
+            return text;
+        }
+
+        const Options& m_options;
+
+        std::vector<Result> m_results;
+    };
+
+    // Keeps the optimizer from discarding a result
+    template<typename T>
+    void DoNotOptimize(const T& value)
+    {
+#if defined(__GNUC__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile const T* sink;
+        sink = &value;
+#endif
+    }
+
+    // Sums data eight bytes at a time, so every byte is loaded
+    std::uint64_t Checksum(std::span<const std::byte> data)
+    {
+        std::uint64_t sum = 0;
+        std::size_t i = 0;
+
+        for (; i + 8 <= data.size(); i += 8)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, data.data() + i, sizeof(word));
+            sum += word;
+        }
+
+        for (; i < data.size(); ++i)
+        {
+            sum += static_cast<std::uint64_t>(data[i]);
+        }
+
+        return sum;
+    }
+
+    // A strip of triangles; the software backend rasterizes them, so they are kept small
+    void MakeGrid(std::uint32_t vertexCount, std::vector<BenchVertex>& vertices, std::vector<std::uint32_t>& indices)
+    {
+        vertices.resize(vertexCount);
+        indices.clear();
+
+        for (std::uint32_t i = 0; i < vertexCount; ++i)
+        {
+            vertices[i] = { { -1.f + 0.001f * static_cast<float>(i % 2000), -1.f + 0.001f * static_cast<float>(i % 3), 0.f } };
+        }
+
+        for (std::uint32_t i = 0; i + 2 < vertexCount; i += 3)
+        {
+            indices.insert(indices.end(), { i, i + 1, i + 2 });
+        }
+    }
+
+    void BenchMeshInit(Runner& runner)
+    {
+        if (!runner.selected("mesh_init"))
+        {
+            return;
+        }
+
+        for (const std::uint32_t vertexCount : { 64u, 1024u, 16384u, 262144u })
+        {
+            std::vector<BenchVertex> vertices;
+            std::vector<std::uint32_t> indices;
+            MakeGrid(vertexCount, vertices, indices);
+
+            const auto bytes = vertices.size() * sizeof(BenchVertex) + indices.size() * sizeof(std::uint32_t);
+
+            auto& result = runner.run("mesh_init", vertexCount, [&](std::uint64_t n)
+                {
+                    for (std::uint64_t i = 0; i < n; ++i)
+                    {
+                        Mesh mesh;
+                        mesh.init(vertices, indices);
+                        DoNotOptimize(mesh);
+                    }
+                });
+
+            result.counters.push_back({ "MB/s", static_cast<double>(bytes) / result.median() * 1e3 });
+
+            runner.print(result);
+        }
+    }
+
+    void BenchMeshFileLoad(Runner& runner, const Options& options)
+    {
+        if (!runner.selected("mesh_file_load"))
+        {
+            return;
+        }
+
+        for (const std::uint32_t vertexCount : { 16384u, 262144u })
+        {
+            std::vector<BenchVertex> vertices;
+            std::vector<std::uint32_t> indices;
+            MakeGrid(vertexCount, vertices, indices);
+
+            const auto path = options.workDirectory / ("mesh_" + std::to_string(vertexCount) + ".mesh");
+
+            const MeshFileDesc desc =
+            {
+                .vertexData = std::as_bytes(std::span(vertices)),
+                .vertexStride = sizeof(BenchVertex),
+                .indexData = std::as_bytes(std::span(indices)),
+                .indexFormat = IndexFormat::Uint32,
+                .submeshes = {},
+            };
+
+            if (!WriteMeshFile(path, desc))
+            {
+                std::fprintf(stderr, "mesh_file_load: could not write %s\n", path.string().c_str());
+                return;
+            }
+
+            const auto bytes = std::filesystem::file_size(path);
+
+            bool loaded = true;
+
+            std::uint64_t loads = 0;
+
+            std::uint64_t bytesRead = 0;
+
+            std::uint64_t checksum = 0;
+
+            // Map, validate and upload straight from the mapping. The null backend
+            // never reads the data, so every byte is summed as an upload copy would
+            // read it; without that only the header's pages would be faulted in.
+            auto& result = runner.run("mesh_file_load", vertexCount, [&](std::uint64_t n)
+                {
+                    for (std::uint64_t i = 0; i < n; ++i)
+                    {
+                        MappedFile file;
+                        Mesh mesh;
+
+                        const auto view = file.open(path) ? MeshFileView::parse(file.data()) : std::nullopt;
+
+                        loaded = loaded && view && mesh.init(view.value());
+
+                        if (view)
+                        {
+                            checksum += Checksum(view->vertexData()) + Checksum(view->indexData());
+                            bytesRead += view->vertexData().size() + view->indexData().size();
+                        }
+
+                        ++loads;
+                    }
+                });
+
+            DoNotOptimize(checksum);
+
+            // The rate is over what was actually read
+            const double bytesPerLoad = static_cast<double>(bytesRead) / static_cast<double>(std::max<std::uint64_t>(loads, 1));
+
+            result.counters.push_back({ "MB read", bytesPerLoad * 1e-6 });
+            result.counters.push_back({ "MB/s", bytesPerLoad / result.median() * 1e3 });
+            result.counters.push_back({ "file MB", static_cast<double>(bytes) * 1e-6 });
+
+            if (!loaded)
+            {
+                result.counters.push_back({ "failed", 1.0 });
+            }
+
+            runner.print(result);
+        }
+    }
+
+    void BenchShaderPipelineInit(Runner& runner)
+    {
+        if (!runner.selected("shader_pipeline_init"))
+        {
+            return;
+        }
+
+        auto& result = runner.run("shader_pipeline_init", 1, [&](std::uint64_t n)
+            {
+                for (std::uint64_t i = 0; i < n; ++i)
+                {
+                    ShaderPipeline pipeline;
+                    pipeline.init<BenchVertex>(L"shader/vs.hlsl", L"shader/ps.hlsl");
+                    DoNotOptimize(pipeline);
+                }
+            });
+
+        runner.print(result);
+    }
+
+    // Meshes cycled through so consecutive draws do not share buffers
+    constexpr std::uint32_t FrameMeshCount = 64;
+
+    void BenchFrameLoop(Runner& runner)
+    {
+        const bool immediate = runner.selected("frame_loop");
+        const bool batched = runner.selected("frame_loop_batched");
+
+        if (!immediate && !batched)
+        {
+            return;
+        }
+
+        auto& dx = Dx::instance();
+
+        std::vector<BenchVertex> vertices;
+        std::vector<std::uint32_t> indices;
+        MakeGrid(3, vertices, indices);
+
+        std::vector<Mesh> meshes(FrameMeshCount);
+
+        for (auto& mesh : meshes)
+        {
+            mesh.init(vertices, indices);
+        }
+
+        ShaderPipeline pipeline;
+        pipeline.init<BenchVertex>(L"shader/vs.hlsl", L"shader/ps.hlsl");
+
+        ShaderPipeline instancedPipeline;
+        instancedPipeline.init<BenchVertex, BenchInstance>(L"shader/vs.hlsl", L"shader/ps.hlsl");
+
+        for (const std::uint32_t drawCount : { 1u, 100u, 1000u, 10000u, 100000u })
+        {
+            if (immediate)
+            {
+                auto& result = runner.run("frame_loop", drawCount, [&](std::uint64_t n)
+                    {
+                        for (std::uint64_t frame = 0; frame < n; ++frame)
+                        {
+                            dx.frameBegin();
+
+                            dx.setPipeline(pipeline);
+
+                            for (std::uint32_t i = 0; i < drawCount; ++i)
+                            {
+                                dx.draw(meshes[i % FrameMeshCount]);
+                            }
+
+                            dx.frameEnd();
+                        }
+                    });
+
+                result.counters.push_back({ "ns/draw", result.median() / drawCount });
+
+                runner.print(result);
+            }
+
+            if (batched)
+            {
+                auto& result = runner.run("frame_loop_batched", drawCount, [&](std::uint64_t n)
+                    {
+                        for (std::uint64_t frame = 0; frame < n; ++frame)
+                        {
+                            dx.frameBegin();
+
+                            for (std::uint32_t i = 0; i < drawCount; ++i)
+                            {
+                                const BenchInstance instance = { { static_cast<float>(i), 0.f, 0.f, 0.f } };
+
+                                dx.submit(instancedPipeline, meshes[i % FrameMeshCount], instance);
+                            }
+
+                            dx.flushDraws();
+
+                            dx.frameEnd();
+                        }
+                    });
+
+                result.counters.push_back({ "ns/draw", result.median() / drawCount });
+
+                runner.print(result);
+            }
+        }
+    }
+
+    // Every signaled value completes latency after it was signaled, as a GPU
+    // that is never the bottleneck but always that far behind the CPU
+    class LatencyTimeline : public GpuTimeline
+    {
+    public:
+
+        explicit LatencyTimeline(Clock::duration latency) : m_latency(latency) {}
+
+        bool signal(std::uint64_t value) override
+        {
+            m_signals.push_back({ value, Clock::now() + m_latency });
+            return true;
+        }
+
+        std::uint64_t completedValue() override
+        {
+            const auto now = Clock::now();
+
+            while (!m_signals.empty() && m_signals.front().second <= now)
+            {
+                m_completed = m_signals.front().first;
+                m_signals.erase(m_signals.begin());
+            }
+
+            return m_completed;
+        }
+
+        bool wait(std::uint64_t value) override
+        {
+            while (completedValue() < value)
+            {
+                if (m_signals.empty())
+                {
+                    return false;
+                }
+
+                std::this_thread::sleep_until(m_signals.front().second);
+            }
+
+            return true;
+        }
+
+    private:
+
+        Clock::duration m_latency;
+
+        std::vector<std::pair<std::uint64_t, Clock::time_point>> m_signals;
+
+        std::uint64_t m_completed = 0;
+    };
+
+    void BenchFrameScheduler(Runner& runner)
+    {
+        if (!runner.selected("frame_scheduler"))
+        {
+            return;
+        }
+
+        // 200us of CPU work per frame; the GPU lags 300us or 500us behind
+        const auto cpuFrame = std::chrono::microseconds(200);
+
+        for (const auto latency : { std::chrono::microseconds(300), std::chrono::microseconds(500) })
+        {
+            for (std::uint32_t framesInFlight = 2; framesInFlight <= FrameScheduler::MaxFramesInFlight; ++framesInFlight)
+            {
+                LatencyTimeline timeline(latency);
+
+                FrameScheduler scheduler;
+                scheduler.init(&timeline, framesInFlight);
+
+                std::uint64_t frames = 0;
+
+                std::uint64_t waitNs = 0;
+
+                auto& result = runner.run("frame_scheduler", framesInFlight, [&](std::uint64_t n)
+                    {
+                        for (std::uint64_t i = 0; i < n; ++i, ++frames)
+                        {
+                            scheduler.beginFrame();
+
+                            waitNs += scheduler.lastWaitNs();
+
+                            const auto end = Clock::now() + cpuFrame;
+
+                            while (Clock::now() < end)
+                            {
+                            }
+
+                            scheduler.endFrame();
+                        }
+                    });
+
+                scheduler.flush();
+
+                result.counters.push_back({ "gpu latency us", static_cast<double>(latency.count()) });
+                result.counters.push_back({ "us/frame", result.median() * 1e-3 });
+                result.counters.push_back({ "waits/frame", static_cast<double>(scheduler.waitCount()) / std::max<std::uint64_t>(frames, 1) });
+                result.counters.push_back({ "wait us/frame", static_cast<double>(waitNs) * 1e-3 / std::max<std::uint64_t>(frames, 1) });
+
+                runner.print(result);
+            }
+        }
+    }
+
+    void BenchDrawQueue(Runner& runner)
+    {
+        if (!runner.selected("draw_queue"))
+        {
+            return;
+        }
+
+        for (const std::uint32_t itemCount : { 1000u, 100000u })
+        {
+            DrawQueue queue;
+
+            auto& result = runner.run("draw_queue", itemCount, [&](std::uint64_t n)
+                {
+                    for (std::uint64_t i = 0; i < n; ++i)
+                    {
+                        queue.clear();
+
+                        for (std::uint32_t item = 0; item < itemCount; ++item)
+                        {
+                            const BenchInstance instance = { { static_cast<float>(item), 0.f, 0.f, 0.f } };
+
+                            queue.push(1 + item % 8, 1 + item % FrameMeshCount, std::as_bytes(std::span(&instance, 1)));
+                        }
+
+                        queue.build();
+                    }
+                });
+
+            result.counters.push_back({ "ns/item", result.median() / itemCount });
+            result.counters.push_back({ "drawsOut", static_cast<double>(queue.batches().size()) });
+
+            runner.print(result);
+        }
+    }
+
+    class DiscardSink : public CommandSink
+    {
+    public:
+
+        std::uint64_t rootSignatureKey(PipelineHandle pipeline) override { return pipeline.id % 2; }
+
+        void setPipelineState(PipelineHandle) override { ++calls; }
+
+        void setRootSignature(PipelineHandle) override { ++calls; }
+
+        void setTopology(PrimitiveTopology) override { ++calls; }
+
+        void setVertexBuffer(std::uint32_t, const VertexBufferView&) override { ++calls; }
+
+        void setIndexBuffer(const IndexBufferView&) override { ++calls; }
+
+        void setViewport(const Viewport&) override { ++calls; }
+
+        void setScissor(const ScissorRect&) override { ++calls; }
+
+        void setConstantBuffer(std::uint64_t) override { ++calls; }
+
+        void drawIndexed(const DrawIndexedArgs&) override { ++calls; }
+
+        std::uint64_t calls = 0;
+    };
+
+    void BenchCommandStream(Runner& runner)
+    {
+        if (!runner.selected("command_stream"))
+        {
+            return;
+        }
+
+        constexpr std::uint32_t DrawCount = 10000;
+
+        CommandStream stream;
+        CommandStateTracker tracker;
+        DiscardSink sink;
+
+        // Per draw: pipeline, vertex buffer, index buffer and the draw; a quarter of the state repeats
+        const auto record = [&]
+        {
+            stream.clear();
+
+            for (std::uint32_t i = 0; i < DrawCount; ++i)
+            {
+                stream.setPipeline({ 1 + i / 256 });
+                stream.setVertexBuffer(0, { .buffer = { 1 + i % 4 }, .sizeInBytes = 36, .strideInBytes = 12 });
+                stream.setIndexBuffer({ .buffer = { 100 + i / 4 }, .sizeInBytes = 12 });
+                stream.drawIndexed({ .indexCount = 3 });
+            }
+        };
+
+        record();
+
+        const auto commands = stream.commandCount();
+
+        auto& recordResult = runner.run("command_stream_record", commands, [&](std::uint64_t n)
+            {
+                for (std::uint64_t i = 0; i < n; ++i)
+                {
+                    record();
+                }
+            });
+
+        recordResult.counters.push_back({ "ns/command", recordResult.median() / commands });
+
+        runner.print(recordResult);
+
+        auto& replayResult = runner.run("command_stream_replay", commands, [&](std::uint64_t n)
+            {
+                for (std::uint64_t i = 0; i < n; ++i)
+                {
+                    tracker.reset();
+                    tracker.replay(stream, sink);
+                }
+            });
+
+        replayResult.counters.push_back({ "ns/command", replayResult.median() / commands });
+        replayResult.counters.push_back({ "dropped", static_cast<double>(tracker.stats().dropped()) / static_cast<double>(tracker.stats().commands) });
+
+        runner.print(replayResult);
+    }
+
+    void BenchJobSystem(Runner& runner)
+    {
+        if (!runner.selected("job_system"))
+        {
+            return;
+        }
+
+        constexpr std::uint32_t JobCount = 1000;
+
+        const auto hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+        for (std::uint32_t threads = 1; threads <= hardwareThreads; threads *= 2)
+        {
+            // The creating thread owns deque 0, so each system gets a fresh thread
+            std::thread([&runner, threads]
+                {
+                    JobSystem jobs(threads);
+
+                    std::atomic<std::uint64_t> sum = 0;
+
+                    auto& result = runner.run("job_system", threads, [&](std::uint64_t n)
+                        {
+                            std::vector<JobHandle> handles(JobCount);
+
+                            for (std::uint64_t i = 0; i < n; ++i)
+                            {
+                                for (std::uint32_t job = 0; job < JobCount; ++job)
+                                {
+                                    handles[job] = jobs.schedule([&sum, job] { sum.fetch_add(job, std::memory_order_relaxed); });
+                                }
+
+                                for (const auto& handle : handles)
+                                {
+                                    jobs.wait(handle);
+                                }
+                            }
+                        });
+
+                    result.counters.push_back({ "jobs/s", JobCount / result.median() * 1e9 });
+                    result.counters.push_back({ "stolen", static_cast<double>(jobs.stats().stolen) });
+
+                    runner.print(result);
+                }).join();
+        }
+    }
+
+    void BenchLogger(Runner& runner, const Options& options)
+    {
+        if (!runner.selected("logger"))
+        {
+            return;
+        }
+
+        auto& logger = Logger::instance();
+
+        logger.open(options.workDirectory / "benchmark_log.txt");
+
+        constexpr std::uint32_t MessagesPerThread = 20000;
+
+        for (const std::uint32_t threadCount : { 1u, 2u, 4u })
+        {
+            std::vector<double> latencies;
+
+            const auto before = logger.stats();
+
+            // One operation is one DebugLog call; threads log concurrently
+            auto& result = runner.run("logger", threadCount, [&](std::uint64_t n)
+                {
+                    const auto perThread = (n + threadCount - 1) / threadCount;
+
+                    std::vector<std::thread> threads;
+                    std::vector<std::vector<double>> threadLatencies(threadCount);
+
+                    for (std::uint32_t t = 0; t < threadCount; ++t)
+                    {
+                        threads.emplace_back([&, t]
+                            {
+                                auto& samples = threadLatencies[t];
+                                samples.reserve(std::min<std::uint64_t>(perThread, MessagesPerThread));
+
+                                for (std::uint64_t i = 0; i < perThread; ++i)
+                                {
+                                    const auto start = Clock::now();
+
+                                    DebugLog(L"benchmark message " + std::to_wstring(i));
+
+                                    if (i < MessagesPerThread)
+                                    {
+                                        samples.push_back(Seconds(Clock::now() - start) * 1e9);
+                                    }
+                                }
+                            });
+                    }
+
+                    for (auto& thread : threads)
+                    {
+                        thread.join();
+                    }
+
+                    logger.flush();
+
+                    latencies.clear();
+
+                    for (const auto& samples : threadLatencies)
+                    {
+                        latencies.insert(latencies.end(), samples.begin(), samples.end());
+                    }
+                });
+
+            const auto after = logger.stats();
+
+            std::sort(latencies.begin(), latencies.end());
+
+            const auto total = static_cast<double>((after.written - before.written) + (after.dropped - before.dropped));
+
+            result.counters.push_back({ "msgs/s", 1e9 / result.median() });
+            result.counters.push_back({ "p50 ns", latencies[latencies.size() / 2] });
+            result.counters.push_back({ "p99 ns", latencies[latencies.size() * 99 / 100] });
+            result.counters.push_back({ "dropped", 0.0 < total ? static_cast<double>(after.dropped - before.dropped) / total : 0.0 });
+
+            runner.print(result);
+        }
+    }
+
+    void BenchDescriptorAllocator(Runner& runner)
+    {
+        if (!runner.selected("descriptor_allocator"))
+        {
+            return;
+        }
+
+        constexpr std::uint32_t LiveDescriptors = 4096;
+
+        DescriptorAllocator descriptors;
+        descriptors.init(DescriptorAllocator::DefaultCapacity, DescriptorAllocator::DefaultTransientCapacity);
+
+        std::vector<DescriptorHandle> live;
+
+        for (std::uint32_t i = 0; i < LiveDescriptors; ++i)
+        {
+            live.push_back(descriptors.allocate());
+        }
+
+        std::uint64_t frame = 0;
+
+        // One operation frees a persistent descriptor and allocates a replacement; every
+        // 64 operations end a frame, with a frame in flight
+        auto& persistent = runner.run("descriptor_persistent", LiveDescriptors, [&](std::uint64_t n)
+            {
+                for (std::uint64_t i = 0; i < n; ++i)
+                {
+                    auto& slot = live[(i * 2654435761u) % LiveDescriptors];
+
+                    descriptors.free(slot);
+                    slot = descriptors.allocate();
+
+                    if (i % 64 == 63)
+                    {
+                        descriptors.endFrame(++frame);
+                        descriptors.reclaim(frame - 1);
+                    }
+                }
+            });
+
+        runner.print(persistent);
+
+        // One operation is a transient table of 8
+        auto& transient = runner.run("descriptor_transient", 8, [&](std::uint64_t n)
+            {
+                for (std::uint64_t i = 0; i < n; ++i)
+                {
+                    DoNotOptimize(descriptors.allocateTransient(8));
+
+                    if (i % 256 == 255)
+                    {
+                        descriptors.endFrame(++frame);
+                        descriptors.reclaim(frame - 1);
+                    }
+                }
+            });
+
+        transient.counters.push_back({ "failures", static_cast<double>(descriptors.stats().transientFailures) });
+
+        runner.print(transient);
+    }
+
+    void BenchTransientAllocator(Runner& runner)
+    {
+        if (!runner.selected("transient_allocator"))
+        {
+            return;
+        }
+
+        constexpr std::uint64_t DrawsPerFrame = 1024;
+
+        constexpr std::uint64_t FramesInFlight = 2;
+
+        HostTransientPageSource pages;
+
+        TransientAllocator transient;
+        transient.init(&pages, 64 * 1024);
+
+        struct DrawConstants
+        {
+            float world[16];
+        } constants = {};
+
+        std::uint64_t frame = 0;
+
+        // One operation writes one draw's constants; each frame completes one frame after
+        // it is closed, so FramesInFlight frames hold memory at once
+        auto& result = runner.run("transient_allocator", DrawsPerFrame, [&](std::uint64_t n)
+            {
+                for (std::uint64_t i = 0; i < n; ++i)
+                {
+                    constants.world[0] = static_cast<float>(i);
+
+                    DoNotOptimize(transient.write(std::as_bytes(std::span(&constants, 1))));
+
+                    if (i % DrawsPerFrame == DrawsPerFrame - 1)
+                    {
+                        transient.endFrame(++frame);
+
+                        if (FramesInFlight <= frame)
+                        {
+                            transient.reclaim(frame - FramesInFlight + 1);
+                        }
+                    }
+                }
+            });
+
+        const auto stats = transient.stats();
+
+        result.counters.push_back({ "capacity_kb", static_cast<double>(stats.capacity / 1024) });
+        result.counters.push_back({ "grows", static_cast<double>(stats.grows) });
+
+        runner.print(result);
+    }
+
+    void BenchTlsfAllocator(Runner& runner)
+    {
+        if (!runner.selected("tlsf_allocator"))
+        {
+            return;
+        }
+
+        constexpr std::uint64_t Capacity = 256ull * 1024 * 1024;
+
+        constexpr std::uint32_t Samples = 4096;
+
+        // Log-normal buffer sizes: props and characters, then the same with
+        // streamed terrain and architecture chunks in the tail
+        struct Distribution
+        {
+            const char* name;
+
+            double medianKb;
+
+            double sigma;
+        };
+
+        const Distribution distributions[] =
+        {
+            { .name = "tlsf_small_meshes", .medianKb = 24.0, .sigma = 1.0 },
+            { .name = "tlsf_mixed_meshes", .medianKb = 96.0, .sigma = 1.8 },
+        };
+
+        for (const auto& distribution : distributions)
+        {
+            std::mt19937 random(5);
+            std::lognormal_distribution<double> sizeKb(std::log(distribution.medianKb), distribution.sigma);
+
+            std::vector<std::uint64_t> sizes(Samples);
+
+            for (auto& size : sizes)
+            {
+                const double bytes = std::clamp(sizeKb(random) * 1024.0, 256.0, 16.0 * 1024 * 1024);
+
+                size = (static_cast<std::uint64_t>(bytes) + 255) & ~255ull;
+            }
+
+            TlsfAllocator allocator(Capacity);
+
+            std::vector<TlsfAllocation> live;
+            std::uint64_t liveBytes = 0;
+
+            // Start three quarters full, like a streamed scene at steady state
+            for (std::uint32_t i = 0; liveBytes < Capacity / 4 * 3; ++i)
+            {
+                const auto allocation = allocator.allocate(sizes[i % Samples]);
+
+                if (!allocation)
+                {
+                    break;
+                }
+
+                live.push_back(allocation.value());
+                liveBytes += allocation->size;
+            }
+
+            std::uint64_t failures = 0;
+
+            // One operation frees a random live buffer and allocates the next size in its place
+            auto& result = runner.run(distribution.name, static_cast<std::uint64_t>(distribution.medianKb), [&](std::uint64_t n)
+                {
+                    for (std::uint64_t i = 0; i < n; ++i)
+                    {
+                        auto& slot = live[(i * 2654435761u) % live.size()];
+
+                        if (slot.size != 0)
+                        {
+                            allocator.free(slot);
+                        }
+
+                        const auto allocation = allocator.allocate(sizes[i % Samples]);
+
+                        if (allocation)
+                        {
+                            slot = allocation.value();
+                        }
+                        else
+                        {
+                            slot = {};
+                            ++failures;
+                        }
+                    }
+                });
+
+            const auto stats = allocator.stats();
+
+            result.counters.push_back({ "used_pct", 100.0 * static_cast<double>(stats.usedBytes) / static_cast<double>(Capacity) });
+            result.counters.push_back({ "fragmentation", stats.fragmentation() });
+            result.counters.push_back({ "largest_free_mb", static_cast<double>(stats.largestFreeBlock) / (1024.0 * 1024.0) });
+            result.counters.push_back({ "free_blocks", static_cast<double>(stats.freeBlockCount) });
+            result.counters.push_back({ "failures", static_cast<double>(failures) });
+
+            runner.print(result);
+        }
+    }
+
+    // A deferred frame: shadow cascades, G-buffer, SSAO, lighting, a bloom chain,
+    // tonemapping and antialiasing into the back buffer, plus a debug view nothing reads
+    void BuildDeferredFrame(RenderGraph& graph, std::uint32_t width, std::uint32_t height)
+    {
+        using enum ResourceState;
+
+        constexpr std::uint32_t ShadowCascades = 4;
+
+        constexpr std::uint32_t BloomLevels = 5;
+
+        const auto texture = [&](std::uint32_t scale, TextureFormat format)
+        {
+            return TextureDesc{ .width = std::max(width >> scale, 1u), .height = std::max(height >> scale, 1u), .format = format };
+        };
+
+        graph.reset();
+
+        const auto backBuffer = graph.importTexture("BackBuffer", texture(0, TextureFormat::RGBA8Unorm), Present, Present);
+
+        std::vector<RenderResourceHandle> shadows;
+
+        for (std::uint32_t i = 0; i < ShadowCascades; ++i)
+        {
+            shadows.push_back(graph.createTexture("Shadow", { .width = 2048, .height = 2048, .format = TextureFormat::Depth32Float }));
+
+            const auto pass = graph.addPass("ShadowCascade");
+            graph.write(pass, shadows.back(), DepthWrite);
+        }
+
+        const auto depth = graph.createTexture("Depth", texture(0, TextureFormat::Depth32Float));
+        const auto albedo = graph.createTexture("GBufferAlbedo", texture(0, TextureFormat::RGBA8Unorm));
+        const auto normal = graph.createTexture("GBufferNormal", texture(0, TextureFormat::RGBA16Float));
+        const auto material = graph.createTexture("GBufferMaterial", texture(0, TextureFormat::RGBA8Unorm));
+
+        const auto gbuffer = graph.addPass("GBuffer");
+        graph.write(gbuffer, depth, DepthWrite);
+        graph.write(gbuffer, albedo, RenderTarget);
+        graph.write(gbuffer, normal, RenderTarget);
+        graph.write(gbuffer, material, RenderTarget);
+
+        const auto ao = graph.createTexture("AO", texture(1, TextureFormat::R32Float));
+
+        const auto ssao = graph.addPass("SSAO");
+        graph.read(ssao, depth, NonPixelShaderResource);
+        graph.read(ssao, normal, NonPixelShaderResource);
+        graph.write(ssao, ao, UnorderedAccess);
+
+        const auto aoBlur = graph.addPass("AOBlur");
+        graph.read(aoBlur, ao, UnorderedAccess);
+        graph.write(aoBlur, ao, UnorderedAccess);
+
+        const auto hdr = graph.createTexture("HDR", texture(0, TextureFormat::RGBA16Float));
+
+        const auto lighting = graph.addPass("Lighting");
+        graph.read(lighting, depth, PixelShaderResource);
+        graph.read(lighting, albedo, PixelShaderResource);
+        graph.read(lighting, normal, PixelShaderResource);
+        graph.read(lighting, material, PixelShaderResource);
+        graph.read(lighting, ao, PixelShaderResource);
+
+        for (const auto shadow : shadows)
+        {
+            graph.read(lighting, shadow, PixelShaderResource);
+        }
+
+        graph.write(lighting, hdr, RenderTarget);
+
+        const auto debugView = graph.createTexture("DebugView", texture(0, TextureFormat::RGBA8Unorm));
+
+        const auto debug = graph.addPass("DebugView");
+        graph.read(debug, normal, PixelShaderResource);
+        graph.write(debug, debugView, RenderTarget);
+
+        auto bloomSource = hdr;
+
+        std::vector<RenderResourceHandle> bloom;
+
+        for (std::uint32_t i = 1; i <= BloomLevels; ++i)
+        {
+            bloom.push_back(graph.createTexture("BloomDown", texture(i, TextureFormat::R11G11B10Float)));
+
+            const auto pass = graph.addPass("BloomDown");
+            graph.read(pass, bloomSource, PixelShaderResource);
+            graph.write(pass, bloom.back(), RenderTarget);
+
+            bloomSource = bloom.back();
+        }
+
+        for (std::uint32_t i = BloomLevels - 1; 0 < i; --i)
+        {
+            const auto pass = graph.addPass("BloomUp");
+            graph.read(pass, bloom[i], PixelShaderResource);
+            graph.read(pass, bloom[i - 1], RenderTarget);
+            graph.write(pass, bloom[i - 1], RenderTarget);
+        }
+
+        const auto ldr = graph.createTexture("LDR", texture(0, TextureFormat::RGBA8Unorm));
+
+        const auto tonemap = graph.addPass("Tonemap");
+        graph.read(tonemap, hdr, PixelShaderResource);
+        graph.read(tonemap, bloom.front(), PixelShaderResource);
+        graph.write(tonemap, ldr, RenderTarget);
+
+        const auto antialias = graph.addPass("Antialias");
+        graph.read(antialias, ldr, PixelShaderResource);
+        graph.write(antialias, backBuffer, RenderTarget);
+    }
+
+    void BenchRenderGraph(Runner& runner)
+    {
+        if (!runner.selected("render_graph_compile"))
+        {
+            return;
+        }
+
+        RenderGraph graph;
+
+        bool compiled = true;
+
+        // One operation declares and compiles the whole frame, as a renderer that rebuilds it every frame would
+        auto& result = runner.run("render_graph_compile", 1, [&](std::uint64_t n)
+            {
+                for (std::uint64_t i = 0; i < n; ++i)
+                {
+                    BuildDeferredFrame(graph, 1920, 1080);
+
+                    compiled = graph.compile() && compiled;
+                }
+            });
+
+        const auto& stats = graph.stats();
+
+        const auto megabytes = [](std::uint64_t bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); };
+
+        result.counters.push_back({ "passes", static_cast<double>(stats.passes) });
+        result.counters.push_back({ "culled", static_cast<double>(stats.culledPasses) });
+        result.counters.push_back({ "barriers", static_cast<double>(stats.transitions + stats.aliasingBarriers + stats.uavBarriers) });
+        result.counters.push_back({ "split", static_cast<double>(stats.splitTransitions) });
+        result.counters.push_back({ "batches", static_cast<double>(stats.batches) });
+        result.counters.push_back({ "transient_mb", megabytes(stats.transientBytes) });
+        result.counters.push_back({ "heap_mb", megabytes(stats.heapBytes) });
+        result.counters.push_back({ "failed", compiled ? 0.0 : 1.0 });
+
+        runner.print(result);
+    }
+
+    // A camera at the origin looking down +z over instances scattered on a square
+    // field around it; roughly a fifth of them are in view
+    constexpr std::uint32_t CullInstanceCount = 1 << 20;
+
+    void BuildCullScene(InstanceBoundsStore& bounds, Frustum& frustum)
+    {
+        std::mt19937 random(1);
+
+        std::uniform_real_distribution<float> position(-1000.f, 1000.f);
+
+        std::uniform_real_distribution<float> height(0.f, 50.f);
+
+        std::uniform_real_distribution<float> size(0.5f, 8.f);
+
+        bounds.clear();
+        bounds.reserve(CullInstanceCount);
+
+        for (std::uint32_t i = 0; i < CullInstanceCount; ++i)
+        {
+            const float center[3] = { position(random), height(random), position(random) };
+
+            const float extent = size(random);
+
+            Aabb box;
+
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                box.min[axis] = center[axis] - extent;
+                box.max[axis] = center[axis] + extent;
+            }
+
+            bounds.add(MeshBoundsFromBox(box));
+        }
+
+        // Left-handed perspective for row vectors, as XMMatrixPerspectiveFovLH builds it
+        const float fovY = 1.f;
+        const float aspect = 16.f / 9.f;
+        const float nearZ = 0.1f;
+        const float farZ = 1000.f;
+
+        const float yScale = 1.f / std::tan(fovY * 0.5f);
+        const float range = farZ / (farZ - nearZ);
+
+        const float viewProjection[16] =
+        {
+            yScale / aspect, 0.f, 0.f, 0.f,
+            0.f, yScale, 0.f, 0.f,
+            0.f, 0.f, range, 1.f,
+            0.f, -10.f * yScale, -range * nearZ, 0.f,
+        };
+
+        frustum = MakeFrustum(viewProjection);
+    }
+
+    void BenchFrustumCulling(Runner& runner)
+    {
+        if (!runner.selected("frustum_cull"))
+        {
+            return;
+        }
+
+        InstanceBoundsStore bounds;
+
+        Frustum frustum;
+
+        BuildCullScene(bounds, frustum);
+
+        std::vector<std::uint32_t> visible(CullInstanceCount);
+
+        std::uint32_t visibleCount = 0;
+
+        const auto report = [&](Result& result, std::uint32_t threads)
+        {
+            result.counters.push_back({ "inst/ms/core", CullInstanceCount / (result.median() * 1e-6) / threads });
+            result.counters.push_back({ "visible %", 100.0 * visibleCount / CullInstanceCount });
+
+            runner.print(result);
+        };
+
+        // One operation culls every instance
+        auto& scalar = runner.run("frustum_cull_scalar", 1, [&](std::uint64_t n)
+            {
+                for (std::uint64_t i = 0; i < n; ++i)
+                {
+                    visibleCount = CullInstancesScalar(frustum, bounds, 0, bounds.size(), visible.data());
+                }
+            });
+
+        report(scalar, 1);
+
+        auto& simd = runner.run("frustum_cull_simd", 1, [&](std::uint64_t n)
+            {
+                for (std::uint64_t i = 0; i < n; ++i)
+                {
+                    visibleCount = CullInstances(frustum, bounds, 0, bounds.size(), visible.data());
+                }
+            });
+
+        report(simd, 1);
+
+        const auto hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+        for (std::uint32_t threads = 1; threads <= hardwareThreads; threads *= 2)
+        {
+            std::thread([&, threads]
+                {
+                    JobSystem jobs(threads);
+
+                    FrustumCuller culler;
+
+                    auto& result = runner.run("frustum_cull_parallel", threads, [&](std::uint64_t n)
+                        {
+                            for (std::uint64_t i = 0; i < n; ++i)
+                            {
+                                visibleCount = static_cast<std::uint32_t>(culler.cull(jobs, frustum, bounds).size());
+                            }
+                        });
+
+                    report(result, threads);
+                }).join();
+        }
+    }
+
+    // The culling scene as boxes, so the BVH and the flat culler see the same instances
+    std::vector<Aabb> CullSceneBoxes(const InstanceBoundsStore& bounds)
+    {
+        std::vector<Aabb> boxes(bounds.size());
+
+        for (std::uint32_t i = 0; i < bounds.size(); ++i)
+        {
+            const float center[3] = { bounds.centerX()[i], bounds.centerY()[i], bounds.centerZ()[i] };
+            const float extent[3] = { bounds.extentX()[i], bounds.extentY()[i], bounds.extentZ()[i] };
+
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                boxes[i].min[axis] = center[axis] - extent[axis];
+                boxes[i].max[axis] = center[axis] + extent[axis];
+            }
+        }
+
+        return boxes;
+    }
+
+    void BenchBvh(Runner& runner)
+    {
+        if (!runner.selected("bvh"))
+        {
+            return;
+        }
+
+        InstanceBoundsStore bounds;
+
+        Frustum frustum;
+
+        BuildCullScene(bounds, frustum);
+
+        const auto boxes = CullSceneBoxes(bounds);
+
+        Bvh bvh;
+
+        const auto hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+        // One operation builds the whole tree
+        for (std::uint32_t threads = 1; threads <= hardwareThreads; threads *= 2)
+        {
+            std::thread([&, threads]
+                {
+                    JobSystem jobs(threads);
+
+                    auto& result = runner.run("bvh_build", threads, [&](std::uint64_t n)
+                        {
+                            for (std::uint64_t i = 0; i < n; ++i)
+                            {
+                                bvh.build(&jobs, boxes);
+                            }
+                        });
+
+                    result.counters.push_back({ "Minst/s", CullInstanceCount / (result.median() * 1e-9) * 1e-6 });
+                    result.counters.push_back({ "nodes", static_cast<double>(bvh.stats().nodes) });
+                    result.counters.push_back({ "depth", static_cast<double>(bvh.stats().depth) });
+                    result.counters.push_back({ "sah", bvh.stats().sahCost });
+
+                    runner.print(result);
+                }).join();
+        }
+
+        // Every instance drifts a little; separately, the twentieth along one edge moves to the opposite one
+        std::vector<Aabb> drifted = boxes;
+
+        std::vector<Aabb> teleported = boxes;
+
+        std::mt19937 random(2);
+
+        std::uniform_real_distribution<float> drift(-1.f, 1.f);
+
+        for (std::uint32_t i = 0; i < CullInstanceCount; ++i)
+        {
+            const float offset[3] = { drift(random), 0.f, drift(random) };
+
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                drifted[i].min[axis] += offset[axis];
+                drifted[i].max[axis] += offset[axis];
+            }
+        }
+
+        for (auto& box : teleported)
+        {
+            if (900.f < box.min[0])
+            {
+                box.min[0] -= 1900.f;
+                box.max[0] -= 1900.f;
+            }
+        }
+
+        auto& refit = runner.run("bvh_refit", 1, [&](std::uint64_t n)
+            {
+                for (std::uint64_t i = 0; i < n; ++i)
+                {
+                    bvh.refit(i % 2 ? boxes : drifted);
+                }
+            });
+
+        refit.counters.push_back({ "Minst/s", CullInstanceCount / (refit.median() * 1e-9) * 1e-6 });
+        refit.counters.push_back({ "sah", bvh.stats().sahCost });
+
+        runner.print(refit);
+
+        JobSystem jobs(hardwareThreads);
+
+        bvh.build(&jobs, boxes);
+
+        bvh.refit(teleported);
+
+        const float degradedCost = bvh.stats().sahCost;
+
+        // Alternating between the two sets makes every operation rebuild what moved
+        auto& rebuild = runner.run("bvh_refit_rebuild", 1, [&](std::uint64_t n)
+            {
+                for (std::uint64_t i = 0; i < n; ++i)
+                {
+                    bvh.refitAndRebuild(&jobs, i % 2 ? boxes : teleported);
+                }
+            });
+
+        bvh.build(&jobs, boxes);
+
+        const auto rebuilt = bvh.refitAndRebuild(&jobs, teleported);
+
+        rebuild.counters.push_back({ "rebuilt %", 100.0 * rebuilt / CullInstanceCount });
+        rebuild.counters.push_back({ "refit only sah", degradedCost });
+        rebuild.counters.push_back({ "sah", bvh.stats().sahCost });
+
+        runner.print(rebuild);
+
+        bvh.build(&jobs, boxes);
+
+        std::vector<std::uint32_t> instances;
+
+        instances.reserve(CullInstanceCount);
+
+        // Same frustum and instances as frustum_cull, for comparison
+        auto& frustumQuery = runner.run("bvh_frustum_query", 1, [&](std::uint64_t n)
+            {
+                for (std::uint64_t i = 0; i < n; ++i)
+                {
+                    instances.clear();
+                    bvh.queryFrustum(frustum, instances);
+                }
+            });
+
+        frustumQuery.counters.push_back({ "inst/ms/core", CullInstanceCount / (frustumQuery.median() * 1e-6) });
+        frustumQuery.counters.push_back({ "visible %", 100.0 * instances.size() / CullInstanceCount });
+
+        runner.print(frustumQuery);
+
+        constexpr std::uint32_t QueryCount = 1024;
+
+        std::vector<Aabb> queryBoxes(QueryCount);
+
+        std::vector<std::array<float, 6>> rays(QueryCount);
+
+        std::uniform_real_distribution<float> position(-1000.f, 1000.f);
+
+        std::uniform_real_distribution<float> direction(-1.f, 1.f);
+
+        for (std::uint32_t i = 0; i < QueryCount; ++i)
+        {
+            const float center[3] = { position(random), 25.f, position(random) };
+
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                queryBoxes[i].min[axis] = center[axis] - 20.f;
+                queryBoxes[i].max[axis] = center[axis] + 20.f;
+            }
+
+            // From head height across the field, slightly downwards
+            rays[i] = { center[0], 25.f, center[2], direction(random), -0.05f, direction(random) };
+        }
+
+        // One operation is one query of each
+        auto& boxQuery = runner.run("bvh_box_query", QueryCount, [&](std::uint64_t n)
+            {
+                for (std::uint64_t i = 0; i < n; ++i)
+                {
+                    instances.clear();
+                    bvh.queryBox(queryBoxes[i % QueryCount], instances);
+                }
+            });
+
+        instances.clear();
+
+        for (const auto& box : queryBoxes)
+        {
+            bvh.queryBox(box, instances);
+        }
+
+        boxQuery.counters.push_back({ "found/query", static_cast<double>(instances.size()) / QueryCount });
+
+        runner.print(boxQuery);
+
+        const auto cast = [&](const std::array<float, 6>& ray)
+        {
+            const float origin[3] = { ray[0], ray[1], ray[2] };
+            const float rayDirection[3] = { ray[3], ray[4], ray[5] };
+
+            return bvh.raycast(origin, rayDirection, 2000.f);
+        };
+
+        auto& raycast = runner.run("bvh_raycast", QueryCount, [&](std::uint64_t n)
+            {
+                for (std::uint64_t i = 0; i < n; ++i)
+                {
+                    cast(rays[i % QueryCount]);
+                }
+            });
+
+        const auto hits = std::count_if(rays.begin(), rays.end(), [&](const auto& ray) { return cast(ray).has_value(); });
+
+        raycast.counters.push_back({ "hit %", 100.0 * hits / QueryCount });
+
+        runner.print(raycast);
+    }
+
+    // A maze of rooms, 24 by 24 of them 20 units across, walled on every side but
+    // for a doorway, with small props scattered everywhere and the camera standing
+    // in a room near one corner looking across the rest
+    struct OcclusionScene
+    {
+        OccluderMesh wall;
+
+        std::vector<Occluder> occluders;
+
+        InstanceBoundsStore bounds;
+
+        float viewProjection[16] = {};
+    };
+
+    void BuildOcclusionScene(OcclusionScene& scene)
+    {
+        constexpr int Rooms = 24;
+        constexpr float RoomSize = 20.f;
+        constexpr float WallHeight = 8.f;
+
+        // A unit cube scaled into every wall segment
+        const float corners[8][3] =
+        {
+            { 0.f, 0.f, 0.f }, { 1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, { 1.f, 1.f, 0.f },
+            { 0.f, 0.f, 1.f }, { 1.f, 0.f, 1.f }, { 0.f, 1.f, 1.f }, { 1.f, 1.f, 1.f },
+        };
+
+        const std::uint16_t indices[36] =
+        {
+            0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 4, 1, 5, 4,
+            2, 6, 3, 3, 6, 7, 0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5,
+        };
+
+        scene.wall.init(std::as_bytes(std::span(corners)), sizeof(corners[0]), std::as_bytes(std::span(indices)), IndexFormat::Uint16);
+
+        const auto addWall = [&](float x, float z, float sizeX, float sizeZ)
+        {
+            Occluder occluder = { .mesh = &scene.wall };
+
+            occluder.world[0] = sizeX;
+            occluder.world[5] = WallHeight;
+            occluder.world[10] = sizeZ;
+            occluder.world[12] = x;
+            occluder.world[14] = z;
+
+            scene.occluders.push_back(occluder);
+        };
+
+        // Each room edge is two segments either side of a 4 unit doorway
+        constexpr float Thickness = 0.5f;
+        constexpr float Segment = (RoomSize - 4.f) * 0.5f;
+
+        for (int i = 0; i <= Rooms; ++i)
+        {
+            for (int j = 0; j < Rooms; ++j)
+            {
+                const float along = j * RoomSize;
+                const float across = i * RoomSize;
+
+                addWall(along, across, Segment, Thickness);
+                addWall(along + RoomSize - Segment, across, Segment, Thickness);
+
+                addWall(across, along, Thickness, Segment);
+                addWall(across, along + RoomSize - Segment, Thickness, Segment);
+            }
+        }
+
+        std::mt19937 random(3);
+
+        std::uniform_real_distribution<float> position(0.f, Rooms * RoomSize);
+
+        std::uniform_real_distribution<float> size(0.25f, 1.f);
+
+        scene.bounds.clear();
+
+        for (std::uint32_t i = 0; i < 1 << 17; ++i)
+        {
+            const float center[3] = { position(random), size(random), position(random) };
+
+            const float extent = size(random);
+
+            Aabb box;
+
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                box.min[axis] = center[axis] - extent;
+                box.max[axis] = center[axis] + extent;
+            }
+
+            scene.bounds.add(MeshBoundsFromBox(box));
+        }
+
+        // Perspective as in BuildCullScene behind a view that only moves the camera
+        const float camera[3] = { 1.5f * RoomSize, 2.f, 0.5f * RoomSize };
+
+        const float fovY = 1.f;
+        const float aspect = 16.f / 9.f;
+        const float nearZ = 0.1f;
+        const float farZ = Rooms * RoomSize * 1.5f;
+
+        const float yScale = 1.f / std::tan(fovY * 0.5f);
+        const float range = farZ / (farZ - nearZ);
+
+        const float projection[16] =
+        {
+            yScale / aspect, 0.f, 0.f, 0.f,
+            0.f, yScale, 0.f, 0.f,
+            0.f, 0.f, range, 1.f,
+            0.f, 0.f, -range * nearZ, 0.f,
+        };
+
+        std::copy(std::begin(projection), std::end(projection), scene.viewProjection);
+
+        // Translating first only changes the last row: -camera times the projection, plus its own
+        for (int c = 0; c < 4; ++c)
+        {
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                scene.viewProjection[12 + c] -= camera[axis] * projection[axis * 4 + c];
+            }
+        }
+    }
+
+    void BenchOcclusionCulling(Runner& runner)
+    {
+        if (!runner.selected("occlusion_cull"))
+        {
+            return;
+        }
+
+        OcclusionScene scene;
+
+        BuildOcclusionScene(scene);
+
+        const auto frustum = MakeFrustum(scene.viewProjection);
+
+        const auto hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+        // One operation is a frame: frustum cull, rasterize the walls, test what survived
+        for (std::uint32_t threads = 1; threads <= hardwareThreads; threads *= 2)
+        {
+            std::thread([&, threads]
+                {
+                    JobSystem jobs(threads);
+
+                    FrustumCuller frustumCuller;
+
+                    OcclusionCuller occlusionCuller;
+
+                    std::uint32_t inFrustum = 0;
+
+                    std::uint32_t visible = 0;
+
+                    auto& result = runner.run("occlusion_cull", threads, [&](std::uint64_t n)
+                        {
+                            for (std::uint64_t i = 0; i < n; ++i)
+                            {
+                                const auto candidates = frustumCuller.cull(jobs, frustum, scene.bounds);
+
+                                occlusionCuller.render(jobs, scene.viewProjection, scene.occluders);
+
+                                inFrustum = static_cast<std::uint32_t>(candidates.size());
+                                visible = static_cast<std::uint32_t>(occlusionCuller.cull(jobs, scene.bounds, candidates).size());
+                            }
+                        });
+
+                    const auto& stats = occlusionCuller.stats();
+
+                    result.counters.push_back({ "ms/frame", result.median() * 1e-6 });
+                    result.counters.push_back({ "raster ms", stats.renderNs * 1e-6 });
+                    result.counters.push_back({ "test ms", stats.testNs * 1e-6 });
+                    result.counters.push_back({ "occluder tris", static_cast<double>(stats.rasterizedTriangles) });
+                    result.counters.push_back({ "in frustum", static_cast<double>(inFrustum) });
+                    result.counters.push_back({ "occluded %", 100.0 * (inFrustum - visible) / std::max(inFrustum, 1u) });
+
+                    runner.print(result);
+                }).join();
+        }
+    }
+
+    // Latitude-longitude unit sphere; the seam column is duplicated as it would be for texture coordinates
+    void MakeSphere(std::uint32_t segments, std::vector<BenchVertex>& vertices, std::vector<std::uint32_t>& indices)
+    {
+        const std::uint32_t rings = segments / 2;
+
+        vertices.clear();
+        indices.clear();
+
+        for (std::uint32_t ring = 0; ring <= rings; ++ring)
+        {
+            for (std::uint32_t segment = 0; segment <= segments; ++segment)
+            {
+                const float theta = 3.14159265f * static_cast<float>(ring) / static_cast<float>(rings);
+                const float phi = 6.28318531f * static_cast<float>(segment) / static_cast<float>(segments);
+
+                vertices.push_back({ { std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) } });
+            }
+        }
+
+        for (std::uint32_t ring = 0; ring < rings; ++ring)
+        {
+            for (std::uint32_t segment = 0; segment < segments; ++segment)
+            {
+                const std::uint32_t a = ring * (segments + 1) + segment;
+                const std::uint32_t b = a + segments + 1;
+
+                indices.insert(indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+            }
+        }
+    }
+
+    // Spheres with their triangles shuffled, as an exporter that knows nothing
+    // of caches might leave them; the optimizer passes run in initOptimized's order
+    void BenchMeshOptimizer(Runner& runner)
+    {
+        if (!runner.selected("mesh_optimize"))
+        {
+            return;
+        }
+
+        std::vector<BenchVertex> vertices;
+        std::vector<std::uint32_t> indices;
+
+        for (const std::uint32_t segments : { 64u, 256u })
+        {
+            MakeSphere(segments, vertices, indices);
+
+            const auto vertexData = reinterpret_cast<const std::uint8_t*>(vertices.data());
+            const auto vertexCount = static_cast<std::uint32_t>(vertices.size());
+            const auto triangles = static_cast<std::uint32_t>(indices.size() / 3);
+
+            std::vector<std::uint32_t> order(triangles);
+            std::iota(order.begin(), order.end(), 0u);
+            std::shuffle(order.begin(), order.end(), std::mt19937(8));
+
+            std::vector<std::uint32_t> shuffled;
+            shuffled.reserve(indices.size());
+
+            for (const auto t : order)
+            {
+                shuffled.insert(shuffled.end(), { indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2] });
+            }
+
+            const auto before = AnalyzeVertexCache(shuffled, vertexCount);
+
+            std::vector<std::uint32_t> cached;
+
+            auto& cache = runner.run("mesh_optimize_cache", triangles, [&](std::uint64_t n)
+                {
+                    for (std::uint64_t i = 0; i < n; ++i)
+                    {
+                        cached = OptimizeVertexCache(shuffled, vertexCount);
+                    }
+                });
+
+            const auto after = AnalyzeVertexCache(cached, vertexCount);
+
+            cache.counters.push_back({ "Mtri/s", triangles / cache.median() * 1e3 });
+            cache.counters.push_back({ "acmr before", before.acmr });
+            cache.counters.push_back({ "acmr after", after.acmr });
+            cache.counters.push_back({ "atvr before", before.atvr });
+            cache.counters.push_back({ "atvr after", after.atvr });
+
+            runner.print(cache);
+
+            std::vector<std::uint32_t> sorted;
+
+            auto& overdraw = runner.run("mesh_optimize_overdraw", triangles, [&](std::uint64_t n)
+                {
+                    for (std::uint64_t i = 0; i < n; ++i)
+                    {
+                        sorted = OptimizeOverdraw(cached, vertexData, sizeof(BenchVertex), {}, MeshOptimizeSettings{}.minClusterTriangles);
+                    }
+                });
+
+            // Clusters move as a whole, so the cache order inside them survives
+            const auto clustered = AnalyzeVertexCache(sorted, vertexCount);
+
+            overdraw.counters.push_back({ "Mtri/s", triangles / overdraw.median() * 1e3 });
+            overdraw.counters.push_back({ "acmr after", clustered.acmr });
+            overdraw.counters.push_back({ "atvr after", clustered.atvr });
+
+            runner.print(overdraw);
+
+            std::uint32_t fetchedVertices = 0;
+
+            auto& fetch = runner.run("mesh_optimize_fetch", triangles, [&](std::uint64_t n)
+                {
+                    for (std::uint64_t i = 0; i < n; ++i)
+                    {
+                        DoNotOptimize(OptimizeVertexFetchRemap(sorted, vertexCount, fetchedVertices));
+                    }
+                });
+
+            fetch.counters.push_back({ "Mtri/s", triangles / fetch.median() * 1e3 });
+            fetch.counters.push_back({ "vertices", static_cast<double>(fetchedVertices) });
+
+            runner.print(fetch);
+        }
+    }
+
+    void BenchMeshLod(Runner& runner)
+    {
+        const MeshLodSettings settings = { .maxLevels = MaxMeshLods };
+
+        std::vector<BenchVertex> vertices;
+        std::vector<std::uint32_t> indices;
+
+        for (const std::uint32_t segments : { 64u, 256u })
+        {
+            MakeSphere(segments, vertices, indices);
+
+            const auto vertexData = reinterpret_cast<const std::uint8_t*>(vertices.data());
+            const auto vertexCount = static_cast<std::uint32_t>(vertices.size());
+            const auto triangles = static_cast<std::uint32_t>(indices.size() / 3);
+
+            // Halving the triangle count in one go, without an error limit
+            if (runner.selected("mesh_simplify"))
+            {
+                float error = 0.f;
+
+                std::size_t simplified = 0;
+
+                auto& result = runner.run("mesh_simplify", triangles, [&](std::uint64_t n)
+                    {
+                        for (std::uint64_t i = 0; i < n; ++i)
+                        {
+                            const auto lod = SimplifyMesh(indices, vertexData, sizeof(BenchVertex), vertexCount, {}, triangles / 2 * 3, 1.f, &error);
+
+                            simplified = lod.size() / 3;
+                        }
+                    });
+
+                result.counters.push_back({ "Mtri/s", triangles / result.median() * 1e3 });
+                result.counters.push_back({ "tris out", static_cast<double>(simplified) });
+                result.counters.push_back({ "error", error });
+
+                runner.print(result);
+            }
+
+            if (runner.selected("mesh_lod_chain"))
+            {
+                MeshLodChain chain;
+
+                auto& result = runner.run("mesh_lod_chain", triangles, [&](std::uint64_t n)
+                    {
+                        for (std::uint64_t i = 0; i < n; ++i)
+                        {
+                            chain = BuildLodChain(indices, vertexData, sizeof(BenchVertex), vertexCount, {}, settings);
+                        }
+                    });
+
+                result.counters.push_back({ "ms", result.median() * 1e-6 });
+                result.counters.push_back({ "levels", static_cast<double>(chain.levels.size()) });
+                result.counters.push_back({ "last tris", static_cast<double>(chain.levels.back().indexCount / 3) });
+
+                // Errors are in units of the sphere's radius
+                for (std::size_t level = 1; level < chain.levels.size(); ++level)
+                {
+                    result.counters.push_back({ "err" + std::to_string(level), chain.levels[level].error });
+                }
+
+                runner.print(result);
+            }
+        }
+
+        if (!runner.selected("mesh_lod_select"))
+        {
+            return;
+        }
+
+        const auto chain = BuildLodChain(indices, reinterpret_cast<const std::uint8_t*>(vertices.data()), sizeof(BenchVertex),
+            static_cast<std::uint32_t>(vertices.size()), {}, settings);
+
+        // 60 degree vertical field of view at 720 lines, one pixel of error allowed
+        float projection[16] = {};
+        projection[5] = 1.f / std::tan(0.5236f);
+
+        const float projectionScale = LodProjectionScale(projection, 720.f);
+
+        std::mt19937 random(7);
+        std::uniform_real_distribution<float> distance(1.f, 200.f);
+
+        std::vector<float> distances(100000);
+
+        for (auto& d : distances)
+        {
+            d = distance(random);
+        }
+
+        std::uint64_t drawn = 0;
+
+        auto& result = runner.run("mesh_lod_select", static_cast<std::uint32_t>(distances.size()), [&](std::uint64_t n)
+            {
+                for (std::uint64_t i = 0; i < n; ++i)
+                {
+                    drawn = 0;
+
+                    for (const auto d : distances)
+                    {
+                        drawn += chain.levels[SelectLod(chain.levels, d, projectionScale, 1.f)].indexCount / 3;
+                    }
+                }
+            });
+
+        const double fullDetail = static_cast<double>(distances.size()) * (chain.levels.front().indexCount / 3);
+
+        result.counters.push_back({ "ns/instance", result.median() / distances.size() });
+        result.counters.push_back({ "tris vs lod0 %", 100.0 * drawn / fullDetail });
+
+        runner.print(result);
+    }
+
+    void BenchEventHandoff(Runner& runner)
+    {
+        if (!runner.selected("event_handoff"))
+        {
+            return;
+        }
+
+        RenderThreadStats stats;
+
+        // One operation is one event from this thread, standing in for the window
+        // thread, to a render thread whose frames do nothing
+        auto& result = runner.run("event_handoff", WindowEventQueue::capacity(), [&](std::uint64_t n)
+            {
+                WindowEventQueue events;
+                RenderThread renderThread(events, 1280, 720);
+
+                renderThread.start({ .init = {}, .frame = [] { return true; }, .resize = {}, .input = {}, .shutdown = {}, .exited = {} });
+
+                const auto post = [&](const WindowEvent& event)
+                {
+                    while (!events.push(event))
+                    {
+                        std::this_thread::yield();
+                    }
+                };
+
+                for (std::uint64_t i = 0; i < n; ++i)
+                {
+                    post({ .type = WindowEventType::MouseMove, .x = static_cast<std::int32_t>(i), .timestamp = Profiler::Now() });
+                }
+
+                post({ .type = WindowEventType::Quit, .timestamp = Profiler::Now() });
+
+                renderThread.join();
+
+                stats = renderThread.stats();
+            });
+
+        result.counters.push_back({ "mean latency ns", static_cast<double>(stats.totalEventLatencyNs) / static_cast<double>(stats.events) });
+        result.counters.push_back({ "max latency ns", static_cast<double>(stats.maxEventLatencyNs) });
+
+        runner.print(result);
+    }
+
+    bool ParseOptions(int argc, char** argv, Options& options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string argument = argv[i];
+            const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+            if (argument == "--backend" && value)
+            {
+                options.backend = value;
+            }
+            else if (argument == "--filter" && value)
+            {
+                options.filter = value;
+            }
+            else if (argument == "--repetitions" && value)
+            {
+                options.repetitions = std::max(1, std::atoi(value));
+            }
+            else if (argument == "--min-time" && value)
+            {
+                options.minTime = std::chrono::milliseconds(std::max(1, std::atoi(value)));
+            }
+            else if (argument == "--out" && value)
+            {
+                options.output = value;
+            }
+            else if (argument == "--label" && value)
+            {
+                options.label = value;
+            }
+            else
+            {
+                return false;
+            }
+
+            ++i;
+        }
+
+        return options.backend == "null" || options.backend == "software";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+
+    if (!ParseOptions(argc, argv, options))
+    {
+        std::fprintf(stderr, "usage: benchmark [--backend null|software] [--filter text] [--repetitions n] [--min-time ms] [--out file] [--label text]\n");
+        return 2;
+    }
+
+    std::filesystem::create_directories(options.workDirectory);
+
+    // Keeps ErrorLog output from the runs out of the working directory
+    Logger::instance().open(options.workDirectory / "log.txt");
+
+    std::unique_ptr<RenderBackend> backend;
+
+    if (options.backend == "software")
+    {
+        backend = std::make_unique<SoftwareBackend>();
+    }
+    else
+    {
+        backend = std::make_unique<NullBackend>();
+    }
+
+    const BackendDesc desc =
+    {
+        .width = 1280,
+        .height = 720,
+        .cacheDirectory = (options.workDirectory / "shader_cache").wstring(),
+    };
+
+    if (!Dx::instance().init(std::move(backend), desc))
+    {
+        std::fprintf(stderr, "backend init failed\n");
+        return 1;
+    }
+
+    Runner runner(options);
+
+    BenchMeshInit(runner);
+    BenchMeshFileLoad(runner, options);
+    BenchShaderPipelineInit(runner);
+    BenchFrameLoop(runner);
+    BenchFrameScheduler(runner);
+    BenchDrawQueue(runner);
+    BenchCommandStream(runner);
+    BenchJobSystem(runner);
+    BenchLogger(runner, options);
+    BenchEventHandoff(runner);
+    BenchDescriptorAllocator(runner);
+    BenchTransientAllocator(runner);
+    BenchTlsfAllocator(runner);
+    BenchRenderGraph(runner);
+    BenchFrustumCulling(runner);
+    BenchBvh(runner);
+    BenchOcclusionCulling(runner);
+    BenchMeshOptimizer(runner);
+    BenchMeshLod(runner);
+
+    Dx::instance().waitIdle();
+
+    if (!options.output.empty() && !runner.writeJson(options.output))
+    {
+        std::fprintf(stderr, "could not write %s\n", options.output.string().c_str());
+        return 1;
+    }
+
+    return 0;
+}
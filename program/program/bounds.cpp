@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "bounds.hpp"
+#include "vertexQuantization.hpp"
+
+bool ReadVertexPosition(const std::byte* vertex, VertexFormat format, float (&position)[3])
+{
+    switch (format)
+    {
+    case VertexFormat::Float3:
+    case VertexFormat::Float4:
+        std::memcpy(position, vertex, sizeof(position));
+        return true;
+
+    case VertexFormat::Half4:
+    {
+        std::uint16_t half[3];
+        std::memcpy(half, vertex, sizeof(half));
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            position[axis] = HalfToFloat(half[axis]);
+        }
+
+        return true;
+    }
+
+    default:
+        return false;
+    }
+}
+
+MeshBounds ComputeMeshBounds(std::span<const std::byte> vertexData, std::uint32_t vertexStride, PositionAttribute position)
+{
+    if (vertexStride == 0 || vertexStride < position.offset + std::min(VertexFormatSize(position.format), 12u))
+    {
+        return {};
+    }
+
+    const std::size_t vertexCount = vertexData.size() / vertexStride;
+
+    float point[3];
+
+    if (vertexCount == 0 || !ReadVertexPosition(vertexData.data() + position.offset, position.format, point))
+    {
+        return {};
+    }
+
+    Aabb box;
+
+    std::fill(std::begin(box.min), std::end(box.min), std::numeric_limits<float>::max());
+    std::fill(std::begin(box.max), std::end(box.max), std::numeric_limits<float>::lowest());
+
+    for (std::size_t i = 0; i < vertexCount; ++i)
+    {
+        ReadVertexPosition(vertexData.data() + i * vertexStride + position.offset, position.format, point);
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            box.min[axis] = std::min(box.min[axis], point[axis]);
+            box.max[axis] = std::max(box.max[axis], point[axis]);
+        }
+    }
+
+    MeshBounds bounds = { .box = box, .sphere = {} };
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        bounds.sphere.center[axis] = (box.min[axis] + box.max[axis]) * 0.5f;
+    }
+
+    // Second pass for the farthest vertex; never larger than half the box diagonal
+    float radiusSquared = 0.f;
+
+    for (std::size_t i = 0; i < vertexCount; ++i)
+    {
+        ReadVertexPosition(vertexData.data() + i * vertexStride + position.offset, position.format, point);
+
+        float distanceSquared = 0.f;
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            const float d = point[axis] - bounds.sphere.center[axis];
+            distanceSquared += d * d;
+        }
+
+        radiusSquared = std::max(radiusSquared, distanceSquared);
+    }
+
+    bounds.sphere.radius = std::sqrt(radiusSquared);
+
+    return bounds;
+}
+
+MeshBounds MeshBoundsFromBox(const Aabb& box)
+{
+    MeshBounds bounds = { .box = box, .sphere = {} };
+
+    float radiusSquared = 0.f;
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const float extent = (box.max[axis] - box.min[axis]) * 0.5f;
+
+        bounds.sphere.center[axis] = box.min[axis] + extent;
+
+        radiusSquared += extent * extent;
+    }
+
+    bounds.sphere.radius = std::sqrt(radiusSquared);
+
+    return bounds;
+}
+
+MeshBounds TransformBounds(const MeshBounds& bounds, const float* matrix)
+{
+    MeshBounds result;
+
+    // Start from the translation and add each axis' contribution at whichever end is smaller
+    for (int column = 0; column < 3; ++column)
+    {
+        result.box.min[column] = matrix[12 + column];
+        result.box.max[column] = matrix[12 + column];
+
+        float center = matrix[12 + column];
+
+        for (int row = 0; row < 3; ++row)
+        {
+            const float m = matrix[row * 4 + column];
+
+            const float a = m * bounds.box.min[row];
+            const float b = m * bounds.box.max[row];
+
+            result.box.min[column] += std::min(a, b);
+            result.box.max[column] += std::max(a, b);
+
+            center += m * bounds.sphere.center[row];
+        }
+
+        result.sphere.center[column] = center;
+    }
+
+    float scaleSquared = 0.f;
+
+    for (int row = 0; row < 3; ++row)
+    {
+        const float* axis = matrix + row * 4;
+
+        scaleSquared = std::max(scaleSquared, axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    }
+
+    result.sphere.radius = bounds.sphere.radius * std::sqrt(scaleSquared);
+
+    return result;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "renderBackend.hpp"
+
+struct Aabb
+{
+    float min[3] = { 0.f, 0.f, 0.f };
+
+    float max[3] = { 0.f, 0.f, 0.f };
+};
+
+struct BoundingSphere
+{
+    float center[3] = { 0.f, 0.f, 0.f };
+
+    float radius = 0.f;
+};
+
+// Both, since each is tighter for different shapes; culling tests against the smaller
+struct MeshBounds
+{
+    Aabb box;
+
+    BoundingSphere sphere;
+};
+
+// Where the position sits in a vertex; Float3, Float4 and Half4 are understood
+struct PositionAttribute
+{
+    std::uint32_t offset = 0;
+
+    VertexFormat format = VertexFormat::Float3;
+};
+
+// False for formats other than those PositionAttribute understands
+bool ReadVertexPosition(const std::byte* vertex, VertexFormat format, float (&position)[3]);
+
+// Box over every vertex and a sphere around the box center that reaches the
+// farthest vertex. Empty data or an unknown position format gives zero bounds.
+MeshBounds ComputeMeshBounds(std::span<const std::byte> vertexData, std::uint32_t vertexStride, PositionAttribute position = {});
+
+// Sphere around the box, for when only the box is known
+MeshBounds MeshBoundsFromBox(const Aabb& box);
+
+// matrix is 4x4 row-major for row vectors, translation in the last row, as in
+// DirectXMath's XMFLOAT4X4. The box stays tight (Arvo); the sphere is scaled by
+// the largest axis scale.
+MeshBounds TransformBounds(const MeshBounds& bounds, const float* matrix);
@@ -0,0 +1,1078 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+#include "bvh.hpp"
+#include "jobSystem.hpp"
+#include "logger.hpp"
+
+namespace
+{
+    constexpr std::uint32_t MaxBins = 64;
+
+    // Nodes this large bin their instances in parallel chunks of this size
+    constexpr std::uint32_t BinChunkSize = 16384;
+
+    constexpr std::uint32_t InvalidNode = 0xffffffff;
+
+    // Depth first traversals push one sibling per level
+    constexpr std::size_t TraversalStackSize = 128;
+
+    Aabb EmptyBox()
+    {
+        Aabb box;
+
+        std::fill(std::begin(box.min), std::end(box.min), std::numeric_limits<float>::max());
+        std::fill(std::begin(box.max), std::end(box.max), std::numeric_limits<float>::lowest());
+
+        return box;
+    }
+
+    void Grow(Aabb& box, const Aabb& other)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            box.min[axis] = std::min(box.min[axis], other.min[axis]);
+            box.max[axis] = std::max(box.max[axis], other.max[axis]);
+        }
+    }
+
+    void Grow(Aabb& box, const float* point)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            box.min[axis] = std::min(box.min[axis], point[axis]);
+            box.max[axis] = std::max(box.max[axis], point[axis]);
+        }
+    }
+
+    float SurfaceArea(const float* min, const float* max)
+    {
+        const float x = std::max(max[0] - min[0], 0.f);
+        const float y = std::max(max[1] - min[1], 0.f);
+        const float z = std::max(max[2] - min[2], 0.f);
+
+        return 2.f * (x * y + y * z + z * x);
+    }
+
+    float SurfaceArea(const Aabb& box)
+    {
+        return SurfaceArea(box.min, box.max);
+    }
+
+    float SurfaceArea(const BvhNode& node)
+    {
+        return SurfaceArea(node.min, node.max);
+    }
+
+    void SetBox(BvhNode& node, const Aabb& box)
+    {
+        std::copy(std::begin(box.min), std::end(box.min), node.min);
+        std::copy(std::begin(box.max), std::end(box.max), node.max);
+    }
+
+    Aabb NodeBox(const BvhNode& node)
+    {
+        Aabb box;
+
+        std::copy(std::begin(node.min), std::end(node.min), box.min);
+        std::copy(std::begin(node.max), std::end(node.max), box.max);
+
+        return box;
+    }
+
+    // Instance counts and boxes per bin, for all three axes
+    struct BinSet
+    {
+        std::array<std::array<Aabb, MaxBins>, 3> boxes;
+
+        std::array<std::array<std::uint32_t, MaxBins>, 3> counts = {};
+
+        void reset(std::uint32_t binCount)
+        {
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                std::fill_n(boxes[axis].begin(), binCount, EmptyBox());
+                std::fill_n(counts[axis].begin(), binCount, 0u);
+            }
+        }
+
+        void merge(const BinSet& other, std::uint32_t binCount)
+        {
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                for (std::uint32_t bin = 0; bin < binCount; ++bin)
+                {
+                    Grow(boxes[axis][bin], other.boxes[axis][bin]);
+                    counts[axis][bin] += other.counts[axis][bin];
+                }
+            }
+        }
+    };
+
+    float Centroid(const Aabb& box, int axis)
+    {
+        return (box.min[axis] + box.max[axis]) * 0.5f;
+    }
+
+    // Instances are built from a copy of their boxes that moves with them as
+    // ranges are partitioned, so every pass over a node reads memory in order
+    struct BuildPrimitive
+    {
+        Aabb box;
+
+        std::uint32_t index = 0;
+    };
+
+    // Built in any order by concurrent jobs, flattened depth first afterwards
+    struct BuildNode
+    {
+        Aabb box;
+
+        std::uint32_t left = 0;
+
+        std::uint32_t right = 0;
+
+        std::uint32_t first = 0;
+
+        std::uint32_t count = 0;
+    };
+
+    // Box of the instances and box of their centroids
+    struct RangeBounds
+    {
+        Aabb box = EmptyBox();
+
+        Aabb centroids = EmptyBox();
+    };
+
+    // Maps centroids to bins, per axis; axes without extent have scale 0
+    struct Binning
+    {
+        float min[3] = {};
+
+        float scale[3] = {};
+
+        std::uint32_t binCount = 0;
+
+        std::uint32_t bin(const Aabb& box, int axis)const
+        {
+            const auto bin = static_cast<std::uint32_t>((Centroid(box, axis) - min[axis]) * scale[axis]);
+
+            return std::min(bin, binCount - 1);
+        }
+    };
+
+    struct SplitChoice
+    {
+        RangeBounds range;
+
+        Binning binning;
+
+        // -1 when no axis has two non-empty sides
+        int axis = -1;
+
+        // Instances in lower bins go left
+        std::uint32_t bin = 0;
+
+        float cost = std::numeric_limits<float>::max();
+    };
+
+    void AccumulateBounds(RangeBounds& range, const BuildPrimitive* primitives, std::uint32_t begin, std::uint32_t end)
+    {
+        for (auto i = begin; i < end; ++i)
+        {
+            const auto& box = primitives[i].box;
+
+            const float centroid[3] = { Centroid(box, 0), Centroid(box, 1), Centroid(box, 2) };
+
+            Grow(range.box, box);
+            Grow(range.centroids, centroid);
+        }
+    }
+
+    void AccumulateBins(BinSet& bins, const Binning& binning, const BuildPrimitive* primitives, std::uint32_t begin, std::uint32_t end)
+    {
+        bins.reset(binning.binCount);
+
+        for (auto i = begin; i < end; ++i)
+        {
+            const auto& box = primitives[i].box;
+
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                const auto bin = binning.bin(box, axis);
+
+                Grow(bins.boxes[axis][bin], box);
+                ++bins.counts[axis][bin];
+            }
+        }
+    }
+
+    // Bins the centroids along every axis and sweeps for the split with the lowest
+    // SAH cost. Ranges of several chunks are binned per chunk on the job system.
+    SplitChoice FindSplit(JobSystem* jobs, const BuildPrimitive* primitives, std::uint32_t count, const BvhBuildSettings& settings)
+    {
+        SplitChoice choice;
+
+        const auto chunkCount = (count + BinChunkSize - 1) / BinChunkSize;
+
+        const auto chunkEnd = [count](std::uint32_t chunk) { return std::min((chunk + 1) * BinChunkSize, count); };
+
+        const bool parallel = jobs && 1 < chunkCount;
+
+        if (parallel)
+        {
+            std::vector<RangeBounds> chunks(chunkCount);
+
+            jobs->parallelFor(chunkCount, 1, [&](std::uint32_t begin, std::uint32_t end)
+                {
+                    for (auto chunk = begin; chunk < end; ++chunk)
+                    {
+                        AccumulateBounds(chunks[chunk], primitives, chunk * BinChunkSize, chunkEnd(chunk));
+                    }
+                });
+
+            for (const auto& chunk : chunks)
+            {
+                Grow(choice.range.box, chunk.box);
+                Grow(choice.range.centroids, chunk.centroids);
+            }
+        }
+        else
+        {
+            AccumulateBounds(choice.range, primitives, 0, count);
+        }
+
+        if (count < 2)
+        {
+            return choice;
+        }
+
+        auto& binning = choice.binning;
+
+        // Small nodes get no more bins than instances; more could not find a better split
+        binning.binCount = std::min(settings.binCount, count);
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            const float extent = choice.range.centroids.max[axis] - choice.range.centroids.min[axis];
+
+            binning.min[axis] = choice.range.centroids.min[axis];
+            binning.scale[axis] = 0.f < extent ? binning.binCount * (1.f - 1e-5f) / extent : 0.f;
+        }
+
+        BinSet bins;
+
+        if (parallel)
+        {
+            std::vector<BinSet> chunks(chunkCount);
+
+            jobs->parallelFor(chunkCount, 1, [&](std::uint32_t begin, std::uint32_t end)
+                {
+                    for (auto chunk = begin; chunk < end; ++chunk)
+                    {
+                        AccumulateBins(chunks[chunk], binning, primitives, chunk * BinChunkSize, chunkEnd(chunk));
+                    }
+                });
+
+            bins = chunks[0];
+
+            for (std::uint32_t chunk = 1; chunk < chunkCount; ++chunk)
+            {
+                bins.merge(chunks[chunk], binning.binCount);
+            }
+        }
+        else
+        {
+            AccumulateBins(bins, binning, primitives, 0, count);
+        }
+
+        const float parentArea = std::max(SurfaceArea(choice.range.box), std::numeric_limits<float>::min());
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (binning.scale[axis] == 0.f)
+            {
+                continue;
+            }
+
+            // Area and count right of each split, then sweep from the left
+            std::array<float, MaxBins> rightArea;
+            std::array<std::uint32_t, MaxBins> rightCount;
+
+            Aabb box = EmptyBox();
+
+            std::uint32_t total = 0;
+
+            for (auto bin = binning.binCount - 1; 0 < bin; --bin)
+            {
+                Grow(box, bins.boxes[axis][bin]);
+                total += bins.counts[axis][bin];
+
+                rightArea[bin] = SurfaceArea(box);
+                rightCount[bin] = total;
+            }
+
+            box = EmptyBox();
+            total = 0;
+
+            for (std::uint32_t split = 1; split < binning.binCount; ++split)
+            {
+                Grow(box, bins.boxes[axis][split - 1]);
+                total += bins.counts[axis][split - 1];
+
+                if (total == 0 || rightCount[split] == 0)
+                {
+                    continue;
+                }
+
+                const float cost = settings.traversalCost + settings.intersectionCost *
+                    (SurfaceArea(box) * total + rightArea[split] * rightCount[split]) / parentArea;
+
+                if (cost < choice.cost)
+                {
+                    choice.cost = cost;
+                    choice.axis = axis;
+                    choice.bin = split;
+                }
+            }
+        }
+
+        return choice;
+    }
+
+    enum class Containment
+    {
+        Outside,
+        Intersecting,
+        Inside,
+    };
+
+    Containment Classify(const Frustum& frustum, const float* min, const float* max)
+    {
+        auto result = Containment::Inside;
+
+        for (const auto& plane : frustum.planes)
+        {
+            float distance = plane[3];
+            float radius = 0.f;
+
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                distance += plane[axis] * (min[axis] + max[axis]) * 0.5f;
+                radius += std::fabs(plane[axis]) * (max[axis] - min[axis]) * 0.5f;
+            }
+
+            if (distance + radius < 0.f)
+            {
+                return Containment::Outside;
+            }
+
+            if (distance - radius < 0.f)
+            {
+                result = Containment::Intersecting;
+            }
+        }
+
+        return result;
+    }
+
+    bool Overlaps(const Aabb& box, const float* min, const float* max)
+    {
+        return box.min[0] <= max[0] && min[0] <= box.max[0] &&
+            box.min[1] <= max[1] && min[1] <= box.max[1] &&
+            box.min[2] <= max[2] && min[2] <= box.max[2];
+    }
+
+    bool Contains(const Aabb& box, const float* min, const float* max)
+    {
+        return box.min[0] <= min[0] && max[0] <= box.max[0] &&
+            box.min[1] <= min[1] && max[1] <= box.max[1] &&
+            box.min[2] <= min[2] && max[2] <= box.max[2];
+    }
+
+    // Slab test; the entry distance, or infinity on a miss
+    float RayEntry(const float* origin, const float* inverseDirection, const float* min, const float* max, float maxDistance)
+    {
+        float near = 0.f;
+        float far = maxDistance;
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float t0 = (min[axis] - origin[axis]) * inverseDirection[axis];
+            float t1 = (max[axis] - origin[axis]) * inverseDirection[axis];
+
+            if (t1 < t0)
+            {
+                std::swap(t0, t1);
+            }
+
+            near = std::max(near, t0);
+            far = std::min(far, t1);
+        }
+
+        return near <= far ? near : std::numeric_limits<float>::infinity();
+    }
+}
+
+struct Bvh::BuildContext
+{
+    JobSystem* jobs = nullptr;
+
+    std::vector<BuildPrimitive> primitives;
+
+    std::vector<BuildNode> nodes;
+
+    std::atomic<std::uint32_t> nodeCount = 0;
+};
+
+bool Bvh::build(JobSystem* jobs, std::span<const Aabb> bounds, const BvhBuildSettings& settings)
+{
+    m_settings = settings;
+    m_settings.binCount = std::clamp(settings.binCount, 2u, MaxBins);
+    m_settings.maxLeafSize = std::max(settings.maxLeafSize, 1u);
+
+    const auto count = static_cast<std::uint32_t>(bounds.size());
+
+    m_nodes.clear();
+    m_primitives.clear();
+    m_boxes.clear();
+    m_builtArea.clear();
+
+    if (count == 0)
+    {
+        updateStats();
+        return true;
+    }
+
+    BuildContext context = { .jobs = jobs, .primitives = {}, .nodes = {} };
+
+    context.primitives.resize(count);
+
+    // A binary tree with at least one instance per leaf has fewer than twice as many nodes
+    context.nodes.resize(std::size_t(count) * 2);
+
+    const auto gather = [&](std::uint32_t begin, std::uint32_t end)
+    {
+        for (auto i = begin; i < end; ++i)
+        {
+            context.primitives[i] = { .box = bounds[i], .index = i };
+        }
+    };
+
+    if (jobs)
+    {
+        jobs->parallelFor(count, BinChunkSize, gather);
+    }
+    else
+    {
+        gather(0, count);
+    }
+
+    const auto root = buildRange(context, 0, count, 0);
+
+    m_nodes.reserve(context.nodeCount.load());
+
+    flatten(context, root, m_nodes);
+
+    m_builtArea.resize(m_nodes.size());
+
+    for (std::size_t i = 0; i < m_nodes.size(); ++i)
+    {
+        m_builtArea[i] = SurfaceArea(m_nodes[i]);
+    }
+
+    m_primitives.resize(count);
+    m_boxes.resize(count);
+
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        m_primitives[i] = context.primitives[i].index;
+        m_boxes[i] = context.primitives[i].box;
+    }
+
+    ++m_stats.fullRebuilds;
+
+    updateStats();
+
+    m_stats.builtSahCost = m_stats.sahCost;
+
+    return true;
+}
+
+std::uint32_t Bvh::buildRange(BuildContext& context, std::uint32_t first, std::uint32_t count, std::uint32_t depth)
+{
+    const auto index = context.nodeCount.fetch_add(1, std::memory_order_relaxed);
+
+    auto* primitives = context.primitives.data() + first;
+
+    // Found before recursing so the bins are off the stack while the children build
+    const auto split = FindSplit(context.jobs, primitives, count, m_settings);
+
+    context.nodes[index] = { .box = split.range.box, .first = first, .count = count };
+
+    if (count == 1)
+    {
+        return index;
+    }
+
+    const float leafCost = m_settings.intersectionCost * count;
+
+    if (count <= m_settings.maxLeafSize && (split.axis < 0 || leafCost <= split.cost))
+    {
+        return index;
+    }
+
+    std::uint32_t leftCount = 0;
+
+    if (0 <= split.axis && depth < MaxDepth)
+    {
+        const auto middle = std::partition(primitives, primitives + count,
+            [&](const BuildPrimitive& primitive) { return split.binning.bin(primitive.box, split.axis) < split.bin; });
+
+        leftCount = static_cast<std::uint32_t>(middle - primitives);
+    }
+
+    // Too deep, or every centroid in one place: halve at the object median instead
+    if (leftCount == 0 || leftCount == count)
+    {
+        const auto& centroids = split.range.centroids;
+
+        int axis = 0;
+
+        for (int a = 1; a < 3; ++a)
+        {
+            if (centroids.max[axis] - centroids.min[axis] < centroids.max[a] - centroids.min[a])
+            {
+                axis = a;
+            }
+        }
+
+        leftCount = count / 2;
+
+        std::nth_element(primitives, primitives + leftCount, primitives + count,
+            [&](const BuildPrimitive& a, const BuildPrimitive& b) { return Centroid(a.box, axis) < Centroid(b.box, axis); });
+    }
+
+    std::uint32_t left = 0;
+
+    std::uint32_t right = 0;
+
+    if (context.jobs && m_settings.parallelThreshold <= count)
+    {
+        const auto job = context.jobs->schedule([&] { left = buildRange(context, first, leftCount, depth + 1); });
+
+        right = buildRange(context, first + leftCount, count - leftCount, depth + 1);
+
+        context.jobs->wait(job);
+    }
+    else
+    {
+        left = buildRange(context, first, leftCount, depth + 1);
+        right = buildRange(context, first + leftCount, count - leftCount, depth + 1);
+    }
+
+    auto& node = context.nodes[index];
+
+    node.left = left;
+    node.right = right;
+    node.count = 0;
+
+    return index;
+}
+
+void Bvh::flatten(const BuildContext& context, std::uint32_t root, std::vector<BvhNode>& nodes)const
+{
+    struct Entry
+    {
+        std::uint32_t node = 0;
+
+        // Flat index of the parent whose right child this is, or InvalidNode
+        std::uint32_t parent = InvalidNode;
+    };
+
+    std::vector<Entry> stack = { { .node = root } };
+
+    while (!stack.empty())
+    {
+        const auto entry = stack.back();
+        stack.pop_back();
+
+        const auto flatIndex = static_cast<std::uint32_t>(nodes.size());
+
+        if (entry.parent != InvalidNode)
+        {
+            nodes[entry.parent].offset = flatIndex;
+        }
+
+        const auto& source = context.nodes[entry.node];
+
+        BvhNode node;
+
+        SetBox(node, source.box);
+
+        if (source.count != 0)
+        {
+            node.offset = source.first;
+            node.count = source.count;
+        }
+
+        nodes.push_back(node);
+
+        if (source.count == 0)
+        {
+            // The left child is popped next and lands right after this node
+            stack.push_back({ .node = source.right, .parent = flatIndex });
+            stack.push_back({ .node = source.left });
+        }
+    }
+}
+
+void Bvh::refit(std::span<const Aabb> bounds)
+{
+    if (bounds.size() != m_primitives.size())
+    {
+        ErrorLog(L"BVH の再適合でインスタンス数が変わっています");
+        return;
+    }
+
+    for (std::size_t i = 0; i < m_primitives.size(); ++i)
+    {
+        m_boxes[i] = bounds[m_primitives[i]];
+    }
+
+    // Children always come after their parent, so one backwards pass sees them first
+    for (auto i = m_nodes.size(); 0 < i--;)
+    {
+        auto& node = m_nodes[i];
+
+        Aabb box = EmptyBox();
+
+        if (node.isLeaf())
+        {
+            for (std::uint32_t k = 0; k < node.count; ++k)
+            {
+                Grow(box, m_boxes[node.offset + k]);
+            }
+        }
+        else
+        {
+            box = NodeBox(m_nodes[i + 1]);
+            Grow(box, NodeBox(m_nodes[node.offset]));
+        }
+
+        SetBox(node, box);
+    }
+
+    ++m_stats.refits;
+
+    updateStats();
+}
+
+std::uint32_t Bvh::refitAndRebuild(JobSystem* jobs, std::span<const Aabb> bounds, float growthThreshold)
+{
+    refit(bounds);
+
+    if (m_nodes.empty() || bounds.size() != m_primitives.size())
+    {
+        return 0;
+    }
+
+    if (growthThreshold * m_builtArea[0] < SurfaceArea(m_nodes[0]))
+    {
+        build(jobs, bounds, m_settings);
+
+        return static_cast<std::uint32_t>(m_primitives.size());
+    }
+
+    // The highest subtrees that grew past the threshold; their descendants go with them
+    struct Selected
+    {
+        std::uint32_t node = 0;
+
+        std::uint32_t depth = 0;
+    };
+
+    std::vector<Selected> selected;
+
+    std::vector<Selected> stack = { { .node = 0 } };
+
+    while (!stack.empty())
+    {
+        const auto entry = stack.back();
+        stack.pop_back();
+
+        const auto& node = m_nodes[entry.node];
+
+        if (node.isLeaf())
+        {
+            continue;
+        }
+
+        if (growthThreshold * m_builtArea[entry.node] < SurfaceArea(node))
+        {
+            selected.push_back(entry);
+            continue;
+        }
+
+        stack.push_back({ .node = node.offset, .depth = entry.depth + 1 });
+        stack.push_back({ .node = entry.node + 1, .depth = entry.depth + 1 });
+    }
+
+    if (selected.empty())
+    {
+        return 0;
+    }
+
+    BuildContext context = { .jobs = jobs, .primitives = {}, .nodes = {} };
+
+    // Indexed like m_primitives; only the selected ranges are filled
+    context.primitives.resize(m_primitives.size());
+
+    std::vector<std::uint32_t> newRoots(m_nodes.size(), InvalidNode);
+
+    std::uint32_t rebuilt = 0;
+
+    for (const auto& entry : selected)
+    {
+        rebuilt += primitiveRange(entry.node).second;
+    }
+
+    context.nodes.resize(std::size_t(rebuilt) * 2);
+
+    for (const auto& entry : selected)
+    {
+        const auto [first, count] = primitiveRange(entry.node);
+
+        for (auto i = first; i < first + count; ++i)
+        {
+            context.primitives[i] = { .box = bounds[m_primitives[i]], .index = m_primitives[i] };
+        }
+
+        newRoots[entry.node] = buildRange(context, first, count, entry.depth);
+
+        for (auto i = first; i < first + count; ++i)
+        {
+            m_primitives[i] = context.primitives[i].index;
+        }
+    }
+
+    // Copy the kept nodes depth first and splice the rebuilt subtrees in
+    std::vector<BvhNode> nodes;
+    nodes.reserve(m_nodes.size());
+
+    std::vector<float> builtArea;
+    builtArea.reserve(m_nodes.size());
+
+    struct Entry
+    {
+        std::uint32_t node = 0;
+
+        std::uint32_t parent = InvalidNode;
+    };
+
+    std::vector<Entry> copyStack = { { .node = 0 } };
+
+    while (!copyStack.empty())
+    {
+        const auto entry = copyStack.back();
+        copyStack.pop_back();
+
+        const auto flatIndex = static_cast<std::uint32_t>(nodes.size());
+
+        if (entry.parent != InvalidNode)
+        {
+            nodes[entry.parent].offset = flatIndex;
+        }
+
+        if (newRoots[entry.node] != InvalidNode)
+        {
+            flatten(context, newRoots[entry.node], nodes);
+
+            for (auto i = flatIndex; i < nodes.size(); ++i)
+            {
+                builtArea.push_back(SurfaceArea(nodes[i]));
+            }
+
+            continue;
+        }
+
+        const auto& node = m_nodes[entry.node];
+
+        nodes.push_back(node);
+        builtArea.push_back(m_builtArea[entry.node]);
+
+        if (!node.isLeaf())
+        {
+            copyStack.push_back({ .node = node.offset, .parent = flatIndex });
+            copyStack.push_back({ .node = entry.node + 1 });
+        }
+    }
+
+    m_nodes = std::move(nodes);
+    m_builtArea = std::move(builtArea);
+
+    for (std::size_t i = 0; i < m_primitives.size(); ++i)
+    {
+        m_boxes[i] = bounds[m_primitives[i]];
+    }
+
+    ++m_stats.partialRebuilds;
+    m_stats.rebuiltInstances += rebuilt;
+
+    updateStats();
+
+    m_stats.builtSahCost = m_stats.sahCost;
+
+    return rebuilt;
+}
+
+std::pair<std::uint32_t, std::uint32_t> Bvh::primitiveRange(std::uint32_t node)const
+{
+    auto leftmost = node;
+
+    while (!m_nodes[leftmost].isLeaf())
+    {
+        ++leftmost;
+    }
+
+    auto rightmost = node;
+
+    while (!m_nodes[rightmost].isLeaf())
+    {
+        rightmost = m_nodes[rightmost].offset;
+    }
+
+    const auto first = m_nodes[leftmost].offset;
+
+    return { first, m_nodes[rightmost].offset + m_nodes[rightmost].count - first };
+}
+
+void Bvh::updateStats()
+{
+    m_stats.nodes = static_cast<std::uint32_t>(m_nodes.size());
+    m_stats.leaves = 0;
+    m_stats.depth = 0;
+    m_stats.sahCost = 0.f;
+
+    if (m_nodes.empty())
+    {
+        return;
+    }
+
+    const float rootArea = std::max(SurfaceArea(m_nodes[0]), std::numeric_limits<float>::min());
+
+    double cost = 0.0;
+
+    // Children come after their parent, so depths fill in with one forward pass
+    std::vector<std::uint32_t> depths(m_nodes.size(), 1);
+
+    for (std::size_t i = 0; i < m_nodes.size(); ++i)
+    {
+        const auto& node = m_nodes[i];
+
+        const float area = SurfaceArea(node) / rootArea;
+
+        if (node.isLeaf())
+        {
+            ++m_stats.leaves;
+
+            m_stats.depth = std::max(m_stats.depth, depths[i]);
+
+            cost += area * m_settings.intersectionCost * node.count;
+        }
+        else
+        {
+            depths[i + 1] = depths[i] + 1;
+            depths[node.offset] = depths[i] + 1;
+
+            cost += area * m_settings.traversalCost;
+        }
+    }
+
+    m_stats.sahCost = static_cast<float>(cost);
+}
+
+void Bvh::queryFrustum(const Frustum& frustum, std::vector<std::uint32_t>& instances)const
+{
+    if (m_nodes.empty())
+    {
+        return;
+    }
+
+    std::array<std::uint32_t, TraversalStackSize> stack;
+
+    std::size_t top = 0;
+
+    stack[top++] = 0;
+
+    while (0 < top)
+    {
+        const auto index = stack[--top];
+
+        const auto& node = m_nodes[index];
+
+        const auto containment = Classify(frustum, node.min, node.max);
+
+        if (containment == Containment::Outside)
+        {
+            continue;
+        }
+
+        if (containment == Containment::Inside)
+        {
+            const auto [first, count] = primitiveRange(index);
+
+            instances.insert(instances.end(), m_primitives.begin() + first, m_primitives.begin() + first + count);
+            continue;
+        }
+
+        if (node.isLeaf())
+        {
+            for (auto i = node.offset; i < node.offset + node.count; ++i)
+            {
+                if (Classify(frustum, m_boxes[i].min, m_boxes[i].max) != Containment::Outside)
+                {
+                    instances.push_back(m_primitives[i]);
+                }
+            }
+
+            continue;
+        }
+
+        stack[top++] = node.offset;
+        stack[top++] = index + 1;
+    }
+}
+
+void Bvh::queryBox(const Aabb& box, std::vector<std::uint32_t>& instances)const
+{
+    if (m_nodes.empty())
+    {
+        return;
+    }
+
+    std::array<std::uint32_t, TraversalStackSize> stack;
+
+    std::size_t top = 0;
+
+    stack[top++] = 0;
+
+    while (0 < top)
+    {
+        const auto index = stack[--top];
+
+        const auto& node = m_nodes[index];
+
+        if (!Overlaps(box, node.min, node.max))
+        {
+            continue;
+        }
+
+        if (Contains(box, node.min, node.max))
+        {
+            const auto [first, count] = primitiveRange(index);
+
+            instances.insert(instances.end(), m_primitives.begin() + first, m_primitives.begin() + first + count);
+            continue;
+        }
+
+        if (node.isLeaf())
+        {
+            for (auto i = node.offset; i < node.offset + node.count; ++i)
+            {
+                if (Overlaps(box, m_boxes[i].min, m_boxes[i].max))
+                {
+                    instances.push_back(m_primitives[i]);
+                }
+            }
+
+            continue;
+        }
+
+        stack[top++] = node.offset;
+        stack[top++] = index + 1;
+    }
+}
+
+std::optional<BvhRayHit> Bvh::raycast(const float (&origin)[3], const float (&direction)[3], float maxDistance)const
+{
+    if (m_nodes.empty())
+    {
+        return std::nullopt;
+    }
+
+    // A huge finite value instead of infinity keeps 0 * inverse out of NaN
+    float inverseDirection[3];
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        inverseDirection[axis] = direction[axis] != 0.f ? 1.f / direction[axis] : std::copysign(1e30f, direction[axis]);
+    }
+
+    std::optional<BvhRayHit> hit;
+
+    float closest = maxDistance;
+
+    std::array<std::uint32_t, TraversalStackSize> stack;
+
+    std::size_t top = 0;
+
+    if (std::isinf(RayEntry(origin, inverseDirection, m_nodes[0].min, m_nodes[0].max, closest)))
+    {
+        return std::nullopt;
+    }
+
+    stack[top++] = 0;
+
+    while (0 < top)
+    {
+        const auto index = stack[--top];
+
+        const auto& node = m_nodes[index];
+
+        if (node.isLeaf())
+        {
+            for (auto i = node.offset; i < node.offset + node.count; ++i)
+            {
+                const float distance = RayEntry(origin, inverseDirection, m_boxes[i].min, m_boxes[i].max, closest);
+
+                if (!std::isinf(distance))
+                {
+                    closest = distance;
+                    hit = BvhRayHit{ .instance = m_primitives[i], .distance = distance };
+                }
+            }
+
+            continue;
+        }
+
+        // Nearer child on top of the stack so it shrinks closest before the other is tried
+        auto near = index + 1;
+        auto far = node.offset;
+
+        float nearDistance = RayEntry(origin, inverseDirection, m_nodes[near].min, m_nodes[near].max, closest);
+        float farDistance = RayEntry(origin, inverseDirection, m_nodes[far].min, m_nodes[far].max, closest);
+
+        if (farDistance < nearDistance)
+        {
+            std::swap(near, far);
+            std::swap(nearDistance, farDistance);
+        }
+
+        if (!std::isinf(farDistance))
+        {
+            stack[top++] = far;
+        }
+
+        if (!std::isinf(nearDistance))
+        {
+            stack[top++] = near;
+        }
+    }
+
+    return hit;
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "bounds.hpp"
+#include "frustumCulling.hpp"
+
+class JobSystem;
+
+// 32 bytes, two to a cache line. Nodes are stored depth first, so an interior
+// node's left child is the next node and offset holds the right child; a leaf
+// holds count instances from offset in Bvh::primitives().
+struct BvhNode
+{
+    float min[3] = { 0.f, 0.f, 0.f };
+
+    std::uint32_t offset = 0;
+
+    float max[3] = { 0.f, 0.f, 0.f };
+
+    std::uint32_t count = 0;
+
+    bool isLeaf()const { return count != 0; }
+};
+
+struct BvhBuildSettings
+{
+    // Leaves get smaller only while SAH says splitting pays
+    std::uint32_t maxLeafSize = 4;
+
+    std::uint32_t binCount = 16;
+
+    // Relative cost of visiting a node and of testing one instance
+    float traversalCost = 1.f;
+
+    float intersectionCost = 1.f;
+
+    // Nodes with at least this many instances build their children as separate jobs
+    std::uint32_t parallelThreshold = 4096;
+};
+
+struct BvhStats
+{
+    std::uint32_t nodes = 0;
+
+    std::uint32_t leaves = 0;
+
+    std::uint32_t depth = 0;
+
+    // Expected cost of a query relative to testing the root box, lower is better
+    float sahCost = 0.f;
+
+    // sahCost right after the last full or partial build
+    float builtSahCost = 0.f;
+
+    std::uint64_t refits = 0;
+
+    std::uint64_t partialRebuilds = 0;
+
+    std::uint64_t fullRebuilds = 0;
+
+    // Instances under rebuilt subtrees, over all partial rebuilds
+    std::uint64_t rebuiltInstances = 0;
+};
+
+struct BvhRayHit
+{
+    std::uint32_t instance = 0;
+
+    float distance = 0.f;
+};
+
+// Bounding volume hierarchy over instance boxes for culling, picking and range
+// queries. build() is top-down binned SAH; large nodes bin and recurse on the
+// job system. Moving instances are handled by refit(), which keeps the
+// topology, and refitAndRebuild() additionally rebuilds the subtrees whose
+// boxes grew the most since they were built. Queries are thread-safe against
+// each other, not against build or refit.
+class Bvh
+{
+public:
+
+    // Deeper than this, splits fall back to the object median
+    static constexpr std::uint32_t MaxDepth = 64;
+
+    Bvh() = default;
+
+    // jobs may be null to build on the calling thread
+    bool build(JobSystem* jobs, std::span<const Aabb> bounds, const BvhBuildSettings& settings = {});
+
+    // bounds holds the same instances as the last build, moved
+    void refit(std::span<const Aabb> bounds);
+
+    // Refits, then rebuilds every subtree whose surface area grew by more than
+    // growthThreshold times since it was built; the whole tree when the root did.
+    // Returns the number of instances under rebuilt subtrees.
+    std::uint32_t refitAndRebuild(JobSystem* jobs, std::span<const Aabb> bounds, float growthThreshold = 2.f);
+
+    // Appends the instances whose boxes intersect frustum; subtrees fully inside are taken without tests
+    void queryFrustum(const Frustum& frustum, std::vector<std::uint32_t>& instances)const;
+
+    // Appends the instances whose boxes overlap box
+    void queryBox(const Aabb& box, std::vector<std::uint32_t>& instances)const;
+
+    // Nearest instance box the ray enters within maxDistance; direction need not be normalized,
+    // distance is in units of its length
+    std::optional<BvhRayHit> raycast(const float (&origin)[3], const float (&direction)[3], float maxDistance)const;
+
+    std::span<const BvhNode> nodes()const { return m_nodes; }
+
+    // Instance indices in leaf order
+    std::span<const std::uint32_t> primitives()const { return m_primitives; }
+
+    const BvhStats& stats()const { return m_stats; }
+
+private:
+
+    struct BuildContext;
+
+    // Returns the index of the subtree's root in context.nodes
+    std::uint32_t buildRange(BuildContext& context, std::uint32_t first, std::uint32_t count, std::uint32_t depth);
+
+    // Appends the subtree at root in depth-first order to nodes
+    void flatten(const BuildContext& context, std::uint32_t root, std::vector<BvhNode>& nodes)const;
+
+    void updateStats();
+
+    // Instances under the subtree at node, as a range of m_primitives
+    std::pair<std::uint32_t, std::uint32_t> primitiveRange(std::uint32_t node)const;
+
+    BvhBuildSettings m_settings;
+
+    std::vector<BvhNode> m_nodes;
+
+    std::vector<std::uint32_t> m_primitives;
+
+    // Instance boxes in m_primitives order, so leaves read them sequentially
+    std::vector<Aabb> m_boxes;
+
+    // Surface area of every node when it was built, by node index
+    std::vector<float> m_builtArea;
+
+    BvhStats m_stats;
+};
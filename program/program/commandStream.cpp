@@ -0,0 +1,219 @@
+#include "commandStream.hpp"
+
+namespace
+{
+    struct VertexBufferCommand
+    {
+        std::uint32_t slot = 0;
+
+        VertexBufferView view;
+    };
+
+    template<typename T>
+    T Read(const std::byte*& cursor)
+    {
+        T value;
+        std::memcpy(&value, cursor, sizeof(T));
+        cursor += sizeof(T);
+        return value;
+    }
+
+    // Rebuilds full draws for backends that only understand setPipeline and draw
+    class BackendCommandSink : public CommandSink
+    {
+    public:
+
+        explicit BackendCommandSink(RenderBackend& backend) : m_backend(backend) {}
+
+        std::uint64_t rootSignatureKey(PipelineHandle pipeline) override { return pipeline.id; }
+
+        void setPipelineState(PipelineHandle pipeline) override { m_backend.setPipeline(pipeline); }
+
+        void setRootSignature(PipelineHandle) override {}
+
+        void setTopology(PrimitiveTopology) override {}
+
+        void setVertexBuffer(std::uint32_t slot, const VertexBufferView& view) override
+        {
+            (slot == 0 ? m_desc.vertexBuffer : m_desc.instanceBuffer) = view;
+        }
+
+        void setIndexBuffer(const IndexBufferView& view) override { m_desc.indexBuffer = view; }
+
+        void setViewport(const Viewport& viewport) override { m_backend.setViewport(viewport); }
+
+        void setScissor(const ScissorRect& scissor) override { m_backend.setScissor(scissor); }
+
+        void setConstantBuffer(std::uint64_t) override {}
+
+        void drawIndexed(const DrawIndexedArgs& args) override
+        {
+            m_desc.indexCount = args.indexCount;
+            m_desc.instanceCount = args.instanceCount;
+            m_desc.startIndex = args.startIndex;
+            m_desc.baseVertex = args.baseVertex;
+            m_desc.startInstance = args.startInstance;
+
+            m_backend.draw(m_desc);
+        }
+
+    private:
+
+        RenderBackend& m_backend;
+
+        DrawIndexedDesc m_desc;
+    };
+}
+
+void CommandStream::setVertexBuffer(std::uint32_t slot, const VertexBufferView& view)
+{
+    write(CommandType::SetVertexBuffer, VertexBufferCommand{ .slot = slot, .view = view });
+}
+
+void CommandStateTracker::reset()
+{
+    m_pipeline.reset();
+    m_rootSignature.reset();
+    m_topology.reset();
+
+    for (auto& vertexBuffer : m_vertexBuffers)
+    {
+        vertexBuffer.reset();
+    }
+
+    m_indexBuffer.reset();
+    m_viewport.reset();
+    m_scissor.reset();
+    m_constantBuffer.reset();
+}
+
+template<typename T>
+bool CommandStateTracker::changed(std::optional<T>& bound, const T& value, StateCounter& counter)
+{
+    if (bound && bound.value() == value)
+    {
+        ++counter.dropped;
+        return false;
+    }
+
+    bound = value;
+    ++counter.issued;
+
+    return true;
+}
+
+void CommandStateTracker::replay(const CommandStream& commands, CommandSink& sink)
+{
+    const std::byte* cursor = commands.data().data();
+
+    for (std::uint32_t i = 0; i < commands.commandCount(); ++i)
+    {
+        switch (Read<CommandType>(cursor))
+        {
+        case CommandType::SetPipeline:
+        {
+            const auto pipeline = Read<PipelineHandle>(cursor);
+
+            if (changed(m_pipeline, pipeline, m_stats.pipelineState))
+            {
+                // A PSO change does not imply a new root signature
+                if (changed(m_rootSignature, sink.rootSignatureKey(pipeline), m_stats.rootSignature))
+                {
+                    sink.setRootSignature(pipeline);
+
+                    m_constantBuffer.reset();
+                }
+
+                sink.setPipelineState(pipeline);
+            }
+
+            break;
+        }
+        case CommandType::SetTopology:
+        {
+            const auto topology = Read<PrimitiveTopology>(cursor);
+
+            if (changed(m_topology, topology, m_stats.topology))
+            {
+                sink.setTopology(topology);
+            }
+
+            break;
+        }
+        case CommandType::SetVertexBuffer:
+        {
+            const auto command = Read<VertexBufferCommand>(cursor);
+
+            if (command.slot < CommandStream::VertexBufferSlots && changed(m_vertexBuffers[command.slot], command.view, m_stats.vertexBuffer))
+            {
+                sink.setVertexBuffer(command.slot, command.view);
+            }
+
+            break;
+        }
+        case CommandType::SetIndexBuffer:
+        {
+            const auto view = Read<IndexBufferView>(cursor);
+
+            if (changed(m_indexBuffer, view, m_stats.indexBuffer))
+            {
+                sink.setIndexBuffer(view);
+            }
+
+            break;
+        }
+        case CommandType::SetViewport:
+        {
+            const auto viewport = Read<Viewport>(cursor);
+
+            if (changed(m_viewport, viewport, m_stats.viewport))
+            {
+                sink.setViewport(viewport);
+            }
+
+            break;
+        }
+        case CommandType::SetScissor:
+        {
+            const auto scissor = Read<ScissorRect>(cursor);
+
+            if (changed(m_scissor, scissor, m_stats.scissor))
+            {
+                sink.setScissor(scissor);
+            }
+
+            break;
+        }
+        case CommandType::SetConstantBuffer:
+        {
+            const auto gpuAddress = Read<std::uint64_t>(cursor);
+
+            if (changed(m_constantBuffer, gpuAddress, m_stats.constantBuffer))
+            {
+                sink.setConstantBuffer(gpuAddress);
+            }
+
+            break;
+        }
+        case CommandType::DrawIndexed:
+        {
+            sink.drawIndexed(Read<DrawIndexedArgs>(cursor));
+
+            ++m_stats.draws;
+
+            break;
+        }
+        }
+    }
+
+    m_stats.commands += commands.commandCount();
+}
+
+void RenderBackend::execute(const CommandStream& commands, CommandStateTracker& tracker)
+{
+    BackendCommandSink sink(*this);
+
+    // The sink starts with nothing bound, so neither may the tracker
+    tracker.reset();
+    tracker.replay(commands, sink);
+}
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "renderBackend.hpp"
+
+enum class CommandType : std::uint32_t
+{
+    SetPipeline,
+    SetTopology,
+    SetVertexBuffer,
+    SetIndexBuffer,
+    SetViewport,
+    SetScissor,
+    SetConstantBuffer,
+    DrawIndexed,
+};
+
+struct DrawIndexedArgs
+{
+    std::uint32_t indexCount = 0;
+
+    std::uint32_t instanceCount = 1;
+
+    std::uint32_t startIndex = 0;
+
+    std::int32_t baseVertex = 0;
+
+    std::uint32_t startInstance = 0;
+};
+
+// Frame commands as plain bytes: a 4-byte CommandType followed by the command's
+// POD payload. Recording is a couple of stores; nothing reaches the backend
+// until the stream is replayed.
+class CommandStream
+{
+public:
+
+    static constexpr std::uint32_t VertexBufferSlots = 2;
+
+    CommandStream() = default;
+
+    void clear() { m_data.clear(); m_commandCount = 0; }
+
+    void setPipeline(PipelineHandle pipeline) { write(CommandType::SetPipeline, pipeline); }
+
+    void setTopology(PrimitiveTopology topology) { write(CommandType::SetTopology, topology); }
+
+    void setVertexBuffer(std::uint32_t slot, const VertexBufferView& view);
+
+    void setIndexBuffer(const IndexBufferView& view) { write(CommandType::SetIndexBuffer, view); }
+
+    void setViewport(const Viewport& viewport) { write(CommandType::SetViewport, viewport); }
+
+    void setScissor(const ScissorRect& scissor) { write(CommandType::SetScissor, scissor); }
+
+    // GPU address of constants for b1, usually from allocateTransient
+    void setConstantBuffer(std::uint64_t gpuAddress) { write(CommandType::SetConstantBuffer, gpuAddress); }
+
+    void drawIndexed(const DrawIndexedArgs& args) { write(CommandType::DrawIndexed, args); }
+
+    std::span<const std::byte> data()const { return m_data; }
+
+    std::uint32_t commandCount()const { return m_commandCount; }
+
+    bool empty()const { return m_commandCount == 0; }
+
+private:
+
+    template<typename T>
+    void write(CommandType type, const T& payload);
+
+    std::vector<std::byte> m_data;
+
+    std::uint32_t m_commandCount = 0;
+};
+
+// Receives only the state changes that survived the tracker
+class CommandSink
+{
+public:
+
+    virtual ~CommandSink() = default;
+
+    // Pipelines that share a root signature return the same key
+    virtual std::uint64_t rootSignatureKey(PipelineHandle pipeline) = 0;
+
+    virtual void setPipelineState(PipelineHandle pipeline) = 0;
+
+    virtual void setRootSignature(PipelineHandle pipeline) = 0;
+
+    virtual void setTopology(PrimitiveTopology topology) = 0;
+
+    virtual void setVertexBuffer(std::uint32_t slot, const VertexBufferView& view) = 0;
+
+    virtual void setIndexBuffer(const IndexBufferView& view) = 0;
+
+    virtual void setViewport(const Viewport& viewport) = 0;
+
+    virtual void setScissor(const ScissorRect& scissor) = 0;
+
+    virtual void setConstantBuffer(std::uint64_t gpuAddress) = 0;
+
+    virtual void drawIndexed(const DrawIndexedArgs& args) = 0;
+};
+
+struct StateCounter
+{
+    std::uint64_t issued = 0;
+
+    std::uint64_t dropped = 0;
+};
+
+struct CommandReplayStats
+{
+    std::uint64_t commands = 0;
+
+    std::uint64_t draws = 0;
+
+    StateCounter pipelineState;
+
+    StateCounter rootSignature;
+
+    StateCounter topology;
+
+    StateCounter vertexBuffer;
+
+    StateCounter indexBuffer;
+
+    StateCounter viewport;
+
+    StateCounter scissor;
+
+    StateCounter constantBuffer;
+
+    std::uint64_t dropped()const
+    {
+        return pipelineState.dropped + rootSignature.dropped + topology.dropped + vertexBuffer.dropped +
+            indexBuffer.dropped + viewport.dropped + scissor.dropped + constantBuffer.dropped;
+    }
+};
+
+// Remembers what the sink has bound and forwards only changes. reset() forgets
+// everything, which backends do whenever they start a new command list.
+class CommandStateTracker
+{
+public:
+
+    CommandStateTracker() = default;
+
+    void reset();
+
+    void replay(const CommandStream& commands, CommandSink& sink);
+
+    const CommandReplayStats& stats()const { return m_stats; }
+
+    void resetStats() { m_stats = {}; }
+
+private:
+
+    template<typename T>
+    bool changed(std::optional<T>& bound, const T& value, StateCounter& counter);
+
+    std::optional<PipelineHandle> m_pipeline;
+
+    std::optional<std::uint64_t> m_rootSignature;
+
+    std::optional<PrimitiveTopology> m_topology;
+
+    std::optional<VertexBufferView> m_vertexBuffers[CommandStream::VertexBufferSlots];
+
+    std::optional<IndexBufferView> m_indexBuffer;
+
+    std::optional<Viewport> m_viewport;
+
+    std::optional<ScissorRect> m_scissor;
+
+    // Forgotten with every root signature change, which clears root arguments
+    std::optional<std::uint64_t> m_constantBuffer;
+
+    CommandReplayStats m_stats;
+};
+
+template<typename T>
+inline void CommandStream::write(CommandType type, const T& payload)
+{
+    static_assert(std::is_trivially_copyable_v<T> && sizeof(T) % 4 == 0, "Command payloads are 4-byte POD");
+
+    const auto offset = m_data.size();
+
+    m_data.resize(offset + sizeof(CommandType) + sizeof(T));
+
+    std::memcpy(m_data.data() + offset, &type, sizeof(CommandType));
+    std::memcpy(m_data.data() + offset + sizeof(CommandType), &payload, sizeof(T));
+
+    ++m_commandCount;
+}
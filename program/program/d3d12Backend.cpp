@@ -0,0 +1,2194 @@
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <functional>
+#include <span>
+#include <string>
+#include <optional>
+#include <utility>
+
+#include <comdef.h>
+#include <d3d12.h>
+#include <dxgi1_6.h>
+#include <DirectXMath.h>
+
+#include <d3dcompiler.h>
+
+#include "logger.hpp"
+#include "commandStream.hpp"
+#include "d3d12Backend.hpp"
+#include "jobSystem.hpp"
+#include "profiler.hpp"
+#include "shaderCache.hpp"
+
+namespace
+{
+    void EnableDebugLayer()
+    {
+        ID3D12Debug* debugLayer = nullptr;
+
+        auto result = D3D12GetDebugInterface(IID_PPV_ARGS(&debugLayer));
+
+        debugLayer->EnableDebugLayer();
+
+        debugLayer->Release();
+    }
+
+    DXGI_FORMAT ToDXGIFormat(VertexFormat format)
+    {
+        switch (format)
+        {
+        case VertexFormat::Float2: return DXGI_FORMAT_R32G32_FLOAT;
+        case VertexFormat::Float3: return DXGI_FORMAT_R32G32B32_FLOAT;
+        case VertexFormat::Float4: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+        case VertexFormat::Half2: return DXGI_FORMAT_R16G16_FLOAT;
+        case VertexFormat::Half4: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+        case VertexFormat::Snorm16x2: return DXGI_FORMAT_R16G16_SNORM;
+        case VertexFormat::Unorm16x2: return DXGI_FORMAT_R16G16_UNORM;
+        }
+
+        return DXGI_FORMAT_UNKNOWN;
+    }
+
+    D3D12_RESOURCE_STATES ToD3D12States(ResourceState state)
+    {
+        constexpr std::pair<ResourceState, D3D12_RESOURCE_STATES> States[] =
+        {
+            { ResourceState::RenderTarget, D3D12_RESOURCE_STATE_RENDER_TARGET },
+            { ResourceState::DepthWrite, D3D12_RESOURCE_STATE_DEPTH_WRITE },
+            { ResourceState::DepthRead, D3D12_RESOURCE_STATE_DEPTH_READ },
+            { ResourceState::PixelShaderResource, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE },
+            { ResourceState::NonPixelShaderResource, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE },
+            { ResourceState::UnorderedAccess, D3D12_RESOURCE_STATE_UNORDERED_ACCESS },
+            { ResourceState::CopySource, D3D12_RESOURCE_STATE_COPY_SOURCE },
+            { ResourceState::CopyDest, D3D12_RESOURCE_STATE_COPY_DEST },
+        };
+
+        // Present is COMMON, zero
+        D3D12_RESOURCE_STATES result = D3D12_RESOURCE_STATE_PRESENT;
+
+        for (const auto& [flag, native] : States)
+        {
+            if ((state & flag) == flag)
+            {
+                result |= native;
+            }
+        }
+
+        return result;
+    }
+
+    DXGI_FORMAT ToDXGIFormat(IndexFormat format)
+    {
+        return format == IndexFormat::Uint16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+    }
+
+    DXGI_FORMAT ToDXGIFormat(TextureFormat format)
+    {
+        switch (format)
+        {
+        case TextureFormat::RGBA8Unorm: return DXGI_FORMAT_R8G8B8A8_UNORM;
+        case TextureFormat::RGBA16Float: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+        case TextureFormat::RGBA32Float: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+        case TextureFormat::RG16Float: return DXGI_FORMAT_R16G16_FLOAT;
+        case TextureFormat::R11G11B10Float: return DXGI_FORMAT_R11G11B10_FLOAT;
+        case TextureFormat::R32Float: return DXGI_FORMAT_R32_FLOAT;
+        case TextureFormat::Depth32Float: return DXGI_FORMAT_D32_FLOAT;
+        case TextureFormat::Depth24Stencil8: return DXGI_FORMAT_D24_UNORM_S8_UINT;
+        }
+
+        return DXGI_FORMAT_UNKNOWN;
+    }
+
+    // Flags for every state the graph uses the texture in
+    D3D12_RESOURCE_DESC ToD3D12TextureDesc(const TextureDesc& desc, ResourceState usage)
+    {
+        D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE;
+
+        if ((usage & ResourceState::RenderTarget) == ResourceState::RenderTarget)
+        {
+            flags |= D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+        }
+
+        if ((usage & (ResourceState::DepthWrite | ResourceState::DepthRead)) != ResourceState::Undefined)
+        {
+            flags |= D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+        }
+
+        if ((usage & ResourceState::UnorderedAccess) == ResourceState::UnorderedAccess)
+        {
+            flags |= D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+        }
+
+        return
+        {
+            .Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D,
+            .Alignment = 0,
+            .Width = desc.width,
+            .Height = desc.height,
+            .DepthOrArraySize = 1,
+            .MipLevels = static_cast<UINT16>(desc.mipLevels),
+            .Format = ToDXGIFormat(desc.format),
+            .SampleDesc = {.Count = desc.sampleCount },
+            .Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN,
+            .Flags = flags,
+        };
+    }
+
+    D3D12_PRIMITIVE_TOPOLOGY ToD3DTopology(PrimitiveTopology topology)
+    {
+        return topology == PrimitiveTopology::TriangleStrip ? D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP : D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+    }
+
+    template<typename T>
+    std::uint64_t HashValue(const T& value, std::uint64_t seed)
+    {
+        return HashBytes(std::as_bytes(std::span(&value, 1)), seed);
+    }
+
+    std::uint64_t HashBytecode(const D3D12_SHADER_BYTECODE& bytecode, std::uint64_t seed)
+    {
+        return HashBytes({ static_cast<const std::byte*>(bytecode.pShaderBytecode), bytecode.BytecodeLength }, HashValue(bytecode.BytecodeLength, seed));
+    }
+
+    // Cheap key over what the caller asked for, so repeated requests return the same handle
+    std::uint64_t HashPipelineDesc(const PipelineDesc& desc)
+    {
+        std::uint64_t key = HashBytes(std::as_bytes(std::span(desc.vertexShaderPath)));
+        key = HashBytes(std::as_bytes(std::span(desc.pixelShaderPath)), HashValue(desc.vertexShaderPath.size(), key));
+        key = HashValue(desc.pixelShaderPath.size(), key);
+
+        for (const auto& element : desc.inputLayout)
+        {
+            key = HashString(element.semanticName, key);
+            key = HashValue(element.semanticIndex, key);
+            key = HashValue(element.format, key);
+            key = HashValue(element.offset, key);
+            key = HashValue(element.inputSlot, key);
+            key = HashValue(element.inputRate, key);
+        }
+
+        for (const auto& define : desc.defines)
+        {
+            key = HashString(define.name, key);
+            key = HashString(define.value, key);
+        }
+
+        return key;
+    }
+
+    // Everything that reaches the driver except the root signature pointer, which is
+    // replaced by the hash of its serialized blob
+    std::uint64_t HashPipelineStateDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, std::uint64_t rootSignatureKey)
+    {
+        std::uint64_t key = rootSignatureKey;
+
+        for (const auto* stage : { &desc.VS, &desc.PS, &desc.DS, &desc.HS, &desc.GS })
+        {
+            key = HashBytecode(*stage, key);
+        }
+
+        for (UINT i = 0; i < desc.InputLayout.NumElements; ++i)
+        {
+            const auto& element = desc.InputLayout.pInputElementDescs[i];
+
+            key = HashString(element.SemanticName, key);
+            key = HashValue(element.SemanticIndex, key);
+            key = HashValue(element.Format, key);
+            key = HashValue(element.InputSlot, key);
+            key = HashValue(element.AlignedByteOffset, key);
+            key = HashValue(element.InputSlotClass, key);
+            key = HashValue(element.InstanceDataStepRate, key);
+        }
+
+        key = HashValue(desc.StreamOutput.NumEntries, key);
+        key = HashValue(desc.BlendState, key);
+        key = HashValue(desc.SampleMask, key);
+        key = HashValue(desc.RasterizerState, key);
+        key = HashValue(desc.DepthStencilState, key);
+        key = HashValue(desc.IBStripCutValue, key);
+        key = HashValue(desc.PrimitiveTopologyType, key);
+        key = HashValue(desc.NumRenderTargets, key);
+        key = HashValue(desc.RTVFormats, key);
+        key = HashValue(desc.DSVFormat, key);
+        key = HashValue(desc.SampleDesc, key);
+        key = HashValue(desc.NodeMask, key);
+        key = HashValue(desc.Flags, key);
+
+        return key;
+    }
+
+    UINT ShaderCompileFlags(ShaderProfile profile)
+    {
+        return profile == ShaderProfile::Debug
+            ? D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION
+            : D3DCOMPILE_OPTIMIZATION_LEVEL3;
+    }
+
+    std::optional<std::vector<std::byte>> CompileShader(const ShaderCompileDesc& desc)
+    {
+        std::vector<D3D_SHADER_MACRO> macros;
+
+        for (const auto& define : desc.defines)
+        {
+            macros.push_back({ define.name.c_str(), define.value.c_str() });
+        }
+
+        macros.push_back({ nullptr, nullptr });
+
+        ID3DBlob* blob = nullptr;
+        ID3DBlob* errorBlob = nullptr;
+
+        const HRESULT shaderResult = D3DCompileFromFile(
+            desc.sourcePath.c_str(), macros.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE,
+            desc.entryPoint.c_str(), desc.target.c_str(), desc.flags, 0, &blob, &errorBlob);
+
+        if (FAILED(shaderResult))
+        {
+            if (shaderResult == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND))
+            {
+                ErrorLog(L"ERROR_FILE_NOT_FOUND");
+            }
+            else if (errorBlob)
+            {
+                const std::string message(static_cast<const char*>(errorBlob->GetBufferPointer()), errorBlob->GetBufferSize());
+                ErrorLog(std::wstring(message.begin(), message.end()));
+            }
+            else
+            {
+                ErrorLog(ErrorMessage(shaderResult));
+            }
+
+            if (errorBlob)
+            {
+                errorBlob->Release();
+            }
+
+            return std::nullopt;
+        }
+
+        const auto* bytes = static_cast<const std::byte*>(blob->GetBufferPointer());
+        std::vector<std::byte> bytecode(bytes, bytes + blob->GetBufferSize());
+
+        blob->Release();
+
+        return bytecode;
+    }
+
+    class D3D12Timeline : public GpuTimeline
+    {
+    public:
+
+        D3D12Timeline(ID3D12CommandQueue* queue, ID3D12Fence* fence, HANDLE fenceEvent)
+            : m_queue(queue)
+            , m_fence(fence)
+            , m_fenceEvent(fenceEvent)
+        {}
+
+        bool signal(std::uint64_t value) override
+        {
+            return SUCCEEDED(m_queue->Signal(m_fence, value));
+        }
+
+        std::uint64_t completedValue() override
+        {
+            return m_fence->GetCompletedValue();
+        }
+
+        bool wait(std::uint64_t value) override
+        {
+            if (FAILED(m_fence->SetEventOnCompletion(value, m_fenceEvent)))
+            {
+                return false;
+            }
+
+            return WaitForSingleObject(m_fenceEvent, INFINITE) == WAIT_OBJECT_0;
+        }
+
+    private:
+
+        ID3D12CommandQueue* m_queue = nullptr;
+
+        ID3D12Fence* m_fence = nullptr;
+
+        HANDLE m_fenceEvent = nullptr;
+    };
+
+    class D3D12CopyQueue : public CopyQueue
+    {
+    public:
+
+        D3D12CopyQueue(ID3D12Device* device, ID3D12CommandQueue* queue, ID3D12Fence* fence, HANDLE fenceEvent,
+            ID3D12Resource* stagingBuffer, std::function<ID3D12Resource*(std::uint32_t)> resolveDestination)
+            : m_device(device)
+            , m_timeline(queue, fence, fenceEvent)
+            , m_queue(queue)
+            , m_fence(fence)
+            , m_stagingBuffer(stagingBuffer)
+            , m_resolveDestination(std::move(resolveDestination))
+        {}
+
+        bool submitCopies(const std::vector<CopyRegion>& regions) override
+        {
+            const auto allocatorIndex = acquireAllocator();
+            if (!allocatorIndex)
+            {
+                return false;
+            }
+
+            auto allocator = m_allocators[allocatorIndex.value()].allocator;
+
+            if (!m_commandList)
+            {
+                Check(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, allocator, nullptr, IID_PPV_ARGS(&m_commandList)));
+            }
+            else
+            {
+                Check(m_commandList->Reset(allocator, nullptr));
+            }
+
+            // DEFAULT heap buffers start in COMMON and are promoted to COPY_DEST implicitly
+            for (const auto& region : regions)
+            {
+                m_commandList->CopyBufferRegion(m_resolveDestination(region.destination), region.destinationOffset,
+                    m_stagingBuffer, region.stagingOffset, region.size);
+            }
+
+            Check(m_commandList->Close());
+
+            ID3D12CommandList* commandLists[] = { m_commandList };
+
+            m_queue->ExecuteCommandLists(1, commandLists);
+
+            m_submittedAllocator = allocatorIndex.value();
+
+            return true;
+        }
+
+        bool signal(std::uint64_t value) override
+        {
+            m_allocators[m_submittedAllocator].fenceValue = value;
+
+            return m_timeline.signal(value);
+        }
+
+        std::uint64_t completedValue() override
+        {
+            return m_timeline.completedValue();
+        }
+
+        bool wait(std::uint64_t value) override
+        {
+            return m_timeline.wait(value);
+        }
+
+    private:
+
+        struct AllocatorSlot
+        {
+            ID3D12CommandAllocator* allocator = nullptr;
+
+            std::uint64_t fenceValue = 0;
+        };
+
+        std::optional<std::size_t> acquireAllocator()
+        {
+            const std::uint64_t completed = m_fence->GetCompletedValue();
+
+            for (std::size_t i = 0; i < m_allocators.size(); ++i)
+            {
+                if (m_allocators[i].fenceValue <= completed)
+                {
+                    CheckOpt(m_allocators[i].allocator->Reset());
+                    return i;
+                }
+            }
+
+            AllocatorSlot slot;
+            CheckOpt(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&slot.allocator)));
+
+            m_allocators.push_back(slot);
+
+            return m_allocators.size() - 1;
+        }
+
+        ID3D12Device* m_device = nullptr;
+
+        D3D12Timeline m_timeline;
+
+        ID3D12CommandQueue* m_queue = nullptr;
+
+        ID3D12Fence* m_fence = nullptr;
+
+        ID3D12Resource* m_stagingBuffer = nullptr;
+
+        std::function<ID3D12Resource*(std::uint32_t)> m_resolveDestination;
+
+        ID3D12GraphicsCommandList* m_commandList = nullptr;
+
+        std::vector<AllocatorSlot> m_allocators;
+
+        std::size_t m_submittedAllocator = 0;
+    };
+
+    // Committed buffers in an UPLOAD heap, mapped for their whole life
+    class D3D12TransientPageSource : public TransientPageSource
+    {
+    public:
+
+        explicit D3D12TransientPageSource(ID3D12Device* device) : m_device(device) {}
+
+        std::optional<TransientPage> createPage(std::uint64_t size) override
+        {
+            const D3D12_HEAP_PROPERTIES prop =
+            {
+                .Type = D3D12_HEAP_TYPE_UPLOAD,
+                .CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
+                .MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN,
+                .CreationNodeMask = 1,
+                .VisibleNodeMask = 1,
+            };
+
+            const D3D12_RESOURCE_DESC desc =
+            {
+                .Dimension = D3D12_RESOURCE_DIMENSION_BUFFER,
+                .Alignment = 0,
+                .Width = size,
+                .Height = 1,
+                .DepthOrArraySize = 1,
+                .MipLevels = 1,
+                .Format = DXGI_FORMAT_UNKNOWN,
+                .SampleDesc = {.Count = 1, .Quality = 0 },
+                .Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
+                .Flags = D3D12_RESOURCE_FLAG_NONE,
+            };
+
+            ID3D12Resource* resource = nullptr;
+
+            CheckOpt(m_device->CreateCommittedResource(&prop, D3D12_HEAP_FLAG_NONE, &desc,
+                D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&resource)));
+
+            // Never read back, so an empty read range
+            const D3D12_RANGE readRange = { 0, 0 };
+            void* memory = nullptr;
+
+            if (FAILED(resource->Map(0, &readRange, &memory)))
+            {
+                resource->Release();
+                return std::nullopt;
+            }
+
+            return TransientPage
+            {
+                .cpuAddress = static_cast<std::byte*>(memory),
+                .gpuAddress = resource->GetGPUVirtualAddress(),
+                .size = size,
+                .native = resource,
+            };
+        }
+
+        void releasePage(const TransientPage& page) override
+        {
+            auto resource = static_cast<ID3D12Resource*>(page.native);
+
+            resource->Unmap(0, nullptr);
+            resource->Release();
+        }
+
+    private:
+
+        ID3D12Device* m_device = nullptr;
+    };
+}
+
+bool D3D12Backend::init(const BackendDesc& desc)
+{
+    EnableDebugLayer();
+
+    const HWND hwnd = static_cast<HWND>(desc.nativeWindow);
+    const int width = desc.width;
+    const int height = desc.height;
+    const std::uint32_t framesInFlight = desc.framesInFlight;
+
+    if (framesInFlight < 2 || FrameScheduler::MaxFramesInFlight < framesInFlight)
+    {
+        ErrorLog(L"framesInFlight は 2 または 3 を指定してください");
+        return false;
+    }
+
+    m_backBufferCount = framesInFlight;
+
+    const D3D_FEATURE_LEVEL levels[] =
+    {
+        D3D_FEATURE_LEVEL_12_1,
+        D3D_FEATURE_LEVEL_12_0,
+    };
+
+    std::optional<D3D_FEATURE_LEVEL> featureLevel;
+
+    for (auto level : levels)
+    {
+        if (D3D12CreateDevice(nullptr, D3D_FEATURE_LEVEL_12_1, IID_PPV_ARGS(&m_device)) == S_OK)
+        {
+            featureLevel = level;
+            break;
+        }
+    }
+
+    if (!featureLevel)
+    {
+        ErrorLog(L"初期化に失敗しました");
+        return false;
+    }
+
+    m_shaderProfile = desc.shaderProfile;
+
+    // Without a cache every start compiles from source, which still works
+    initPipelineLibrary(desc.cacheDirectory);
+
+    if (!initDescriptorHeap() || !createBindlessRootSignature())
+    {
+        ErrorLog(L"ディスクリプタヒープの初期化に失敗しました");
+        return false;
+    }
+
+    m_transientPageSource = std::make_unique<D3D12TransientPageSource>(m_device);
+
+    if (!m_transientMemory.init(m_transientPageSource.get()))
+    {
+        return false;
+    }
+
+    m_pipelineCompiler = std::make_unique<PipelineCompiler>();
+
+    for (std::uint32_t i = 0; i < framesInFlight; ++i)
+    {
+        Check(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_commandAllocators[i])));
+    }
+
+    const D3D12_COMMAND_QUEUE_DESC commandQueueDesc =
+    {
+        .Type = D3D12_COMMAND_LIST_TYPE_DIRECT,
+        .Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL,
+        .Flags = D3D12_COMMAND_QUEUE_FLAG_NONE,
+        .NodeMask = 0,
+    };
+
+    Check(m_device->CreateCommandQueue(&commandQueueDesc, IID_PPV_ARGS(&m_commandQueue)));
+
+    Check(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
+
+    m_fenceEvent = CreateEvent(nullptr, false, false, nullptr);
+
+    if (!m_fenceEvent)
+    {
+        ErrorLog(L"フェンスイベントの作成に失敗しました");
+        return false;
+    }
+
+    m_timeline = std::make_unique<D3D12Timeline>(m_commandQueue, m_fence, m_fenceEvent);
+
+    if (!m_frameScheduler.init(m_timeline.get(), framesInFlight))
+    {
+        ErrorLog(L"フレームスケジューラの初期化に失敗しました");
+        return false;
+    }
+
+    const D3D12_COMMAND_QUEUE_DESC copyQueueDesc =
+    {
+        .Type = D3D12_COMMAND_LIST_TYPE_COPY,
+        .Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL,
+        .Flags = D3D12_COMMAND_QUEUE_FLAG_NONE,
+        .NodeMask = 0,
+    };
+
+    Check(m_device->CreateCommandQueue(&copyQueueDesc, IID_PPV_ARGS(&m_copyQueue)));
+
+    Check(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_copyFence)));
+
+    m_copyFenceEvent = CreateEvent(nullptr, false, false, nullptr);
+
+    if (!m_copyFenceEvent)
+    {
+        ErrorLog(L"フェンスイベントの作成に失敗しました");
+        return false;
+    }
+
+    {
+        const D3D12_HEAP_PROPERTIES prop =
+        {
+            .Type = D3D12_HEAP_TYPE_UPLOAD,
+            .CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
+            .MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN,
+        };
+
+        const D3D12_RESOURCE_DESC stagingDesc =
+        {
+            .Dimension = D3D12_RESOURCE_DIMENSION_BUFFER,
+            .Width = StagingBufferSize,
+            .Height = 1,
+            .DepthOrArraySize = 1,
+            .MipLevels = 1,
+            .Format = DXGI_FORMAT_UNKNOWN,
+            .SampleDesc = {.Count = 1},
+            .Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
+            .Flags = D3D12_RESOURCE_FLAG_NONE,
+        };
+
+        Check(m_device->CreateCommittedResource(&prop, D3D12_HEAP_FLAG_NONE, &stagingDesc,
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_stagingBuffer)));
+    }
+
+    std::uint8_t* stagingMemory = nullptr;
+    Check(m_stagingBuffer->Map(0, nullptr, reinterpret_cast<void**>(&stagingMemory)));
+
+    m_copyTimeline = std::make_unique<D3D12CopyQueue>(m_device, m_copyQueue, m_copyFence, m_copyFenceEvent, m_stagingBuffer,
+        [this](std::uint32_t page) { return m_bufferPages[page]->resource; });
+
+    if (!m_uploadManager.init(m_copyTimeline.get(), stagingMemory, StagingBufferSize))
+    {
+        ErrorLog(L"アップロードマネージャの初期化に失敗しました");
+        return false;
+    }
+
+    const DXGI_SWAP_CHAIN_DESC1 swapchainDesc =
+    {
+        .Width = static_cast<unsigned>(width),
+        .Height = static_cast<unsigned>(height),
+        .Format = DXGI_FORMAT_R8G8B8A8_UNORM,
+        .Stereo = false,
+        .SampleDesc = {.Count = 1, .Quality = 0},
+        .BufferUsage = DXGI_USAGE_BACK_BUFFER,
+        .BufferCount = m_backBufferCount,
+        .Scaling = DXGI_SCALING_STRETCH,
+        .SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD,
+        .AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED,
+        .Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH,
+    };
+
+    Check(CreateDXGIFactory2(DXGI_CREATE_FACTORY_DEBUG, IID_PPV_ARGS(&m_dxgiFactory)));
+
+    Check(m_dxgiFactory->CreateSwapChainForHwnd(m_commandQueue, hwnd, &swapchainDesc, nullptr, nullptr, reinterpret_cast<IDXGISwapChain1**>(&m_swapChain)));
+
+    m_backBufferHD =
+    {
+        .Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV,
+        .NumDescriptors = m_backBufferCount,
+        .Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE,
+        .NodeMask = 0,
+    };
+
+    Check(m_device->CreateDescriptorHeap(&m_backBufferHD, IID_PPV_ARGS(&m_backBufferHeaps)));
+
+    if (!createBackBufferViews())
+    {
+        return false;
+    }
+
+    Check(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocators[0], nullptr, IID_PPV_ARGS(&m_commandList)));
+
+    Check(m_commandList->Close());
+
+    setWindowSize(width, height);
+
+    if (!buildFrameGraph(width, height))
+    {
+        return false;
+    }
+
+#ifdef ENABLE_PROFILER
+    // The frame still renders without GPU timings
+    if (!initGpuProfiler())
+    {
+        ErrorLog(L"GPU タイムスタンプの初期化に失敗しました");
+    }
+#endif
+
+    return true;
+}
+
+bool D3D12Backend::frameBegin()
+{
+    ProfileScope("D3D12Backend::frameBegin");
+
+    std::optional<std::uint32_t> contextIndex;
+
+    {
+        ProfileScope("Wait for frame context");
+
+        contextIndex = m_frameScheduler.beginFrame();
+    }
+
+    if (!contextIndex)
+    {
+        ErrorLog(L"GPU の完了待ちに失敗しました");
+        return false;
+    }
+
+#ifdef ENABLE_PROFILER
+    collectGpuScopes(contextIndex.value());
+#endif
+
+    auto commandAllocator = m_commandAllocators[contextIndex.value()];
+
+    Check(commandAllocator->Reset());
+
+    Check(m_commandList->Reset(commandAllocator, nullptr));
+
+    m_contextIndex = contextIndex.value();
+    m_currentList = m_commandList;
+    m_usedRecordingLists = 0;
+    m_submitLists.clear();
+    m_boundPipeline = {};
+    m_boundConstantBuffer = 0;
+
+    retireBuffers();
+
+    m_descriptors.reclaim(m_timeline->completedValue());
+
+    m_transientMemory.reclaim(m_timeline->completedValue());
+
+    m_backBufferIndex = m_swapChain->GetCurrentBackBufferIndex();
+
+    auto rtvHeap = m_backBufferHeaps->GetCPUDescriptorHandleForHeapStart();
+    rtvHeap.ptr += m_backBufferIndex * m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+
+    m_currentRtv = rtvHeap;
+
+    // Everything Dx records between frameBegin and frameEnd is the graph's one pass
+    recordBarriers(m_commandList, m_frameGraph.barriers(0));
+
+    m_commandList->ClearRenderTargetView(rtvHeap, m_clearColor.data(), 0, nullptr);
+
+    setRenderTargetState(m_commandList);
+
+    beginGpuScope("Frame");
+
+    return true;
+}
+
+bool D3D12Backend::frameEnd()
+{
+    ProfileScope("D3D12Backend::frameEnd");
+
+    endGpuScope();
+
+#ifdef ENABLE_PROFILER
+    resolveGpuScopes();
+#endif
+
+    recordBarriers(m_currentList, m_frameGraph.barriers(m_frameGraph.livePassCount()));
+
+    Check(m_currentList->Close());
+
+    m_submitLists.push_back(m_currentList);
+
+    if (!m_uploadManager.flush())
+    {
+        ErrorLog(L"アップロードの送信に失敗しました");
+        return false;
+    }
+
+    // GPU-side wait: draws of this frame may read buffers still being copied
+    if (0 < m_uploadManager.submittedValue())
+    {
+        Check(m_commandQueue->Wait(m_copyFence, m_uploadManager.submittedValue()));
+    }
+
+    m_commandQueue->ExecuteCommandLists(static_cast<UINT>(m_submitLists.size()), m_submitLists.data());
+
+    {
+        ProfileScope("Present");
+
+        Check(m_swapChain->Present(1, 0));
+    }
+
+    if (!m_frameScheduler.endFrame())
+    {
+        ErrorLog(L"フェンスのシグナルに失敗しました");
+        return false;
+    }
+
+    m_descriptors.endFrame(m_frameScheduler.submittedValue());
+
+    m_transientMemory.endFrame(m_frameScheduler.submittedValue());
+
+    return true;
+}
+
+bool D3D12Backend::waitIdle()
+{
+    if (!m_uploadManager.flush() || !m_uploadManager.wait(m_uploadManager.submittedValue()) || !m_frameScheduler.flush())
+    {
+        return false;
+    }
+
+    retireBuffers();
+
+    m_descriptors.reclaim(m_timeline->completedValue());
+
+    m_transientMemory.reclaim(m_timeline->completedValue());
+
+    m_pipelineCompiler->waitAll();
+
+    savePipelineLibrary();
+
+    return true;
+}
+
+bool D3D12Backend::resize(int width, int height)
+{
+    if (width <= 0 || height <= 0)
+    {
+        ErrorLog(L"画面サイズが不正です");
+        return false;
+    }
+
+    // ResizeBuffers fails while any back buffer is referenced, including by queued frames
+    if (!m_frameScheduler.flush())
+    {
+        ErrorLog(L"GPU の完了待ちに失敗しました");
+        return false;
+    }
+
+    for (unsigned i = 0; i < m_backBufferCount; ++i)
+    {
+        m_backBuffers[i]->Release();
+        m_backBuffers[i] = nullptr;
+    }
+
+    Check(m_swapChain->ResizeBuffers(m_backBufferCount, static_cast<UINT>(width), static_cast<UINT>(height),
+        DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH));
+
+    if (!createBackBufferViews())
+    {
+        return false;
+    }
+
+    setWindowSize(width, height);
+
+    return buildFrameGraph(width, height);
+}
+
+bool D3D12Backend::createBackBufferViews()
+{
+    D3D12_CPU_DESCRIPTOR_HANDLE handle = m_backBufferHeaps->GetCPUDescriptorHandleForHeapStart();
+
+    for (unsigned i = 0; i < m_backBufferCount; ++i)
+    {
+        Check(m_swapChain->GetBuffer(i, IID_PPV_ARGS(&m_backBuffers[i])));
+
+        m_device->CreateRenderTargetView(m_backBuffers[i], nullptr, handle);
+
+        handle.ptr += m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+    }
+
+    return true;
+}
+
+bool D3D12Backend::buildFrameGraph(int width, int height)
+{
+    // Callers wait for the GPU first, nothing still reads the old textures
+    releaseGraphTextures();
+
+    m_frameGraph.reset();
+
+    const TextureDesc backBufferDesc =
+    {
+        .width = static_cast<std::uint32_t>(width),
+        .height = static_cast<std::uint32_t>(height),
+        .format = TextureFormat::RGBA8Unorm,
+    };
+
+    m_backBufferResource = m_frameGraph.importTexture("BackBuffer", backBufferDesc, ResourceState::Present, ResourceState::Present);
+
+    const auto mainPass = m_frameGraph.addPass("Main");
+
+    m_frameGraph.write(mainPass, m_backBufferResource, ResourceState::RenderTarget);
+
+    // Placed textures follow the device's sizes and alignments, not the estimate
+    const auto footprint = [&](const TextureDesc& desc, ResourceState usage) -> MemoryFootprint
+    {
+        const auto textureDesc = ToD3D12TextureDesc(desc, usage);
+        const auto info = m_device->GetResourceAllocationInfo(0, 1, &textureDesc);
+
+        return { .size = info.SizeInBytes, .alignment = info.Alignment };
+    };
+
+    if (!m_frameGraph.compile(footprint))
+    {
+        ErrorLog(L"レンダーグラフのコンパイルに失敗しました");
+        return false;
+    }
+
+    return createGraphTextures();
+}
+
+bool D3D12Backend::createGraphTextures()
+{
+    const auto heapBytes = m_frameGraph.stats().heapBytes;
+
+    if (heapBytes == 0)
+    {
+        return true;
+    }
+
+    // Render targets, depth buffers and other textures in one heap needs resource heap tier 2
+    const D3D12_HEAP_DESC heapDesc =
+    {
+        .SizeInBytes = heapBytes,
+        .Properties =
+        {
+            .Type = D3D12_HEAP_TYPE_DEFAULT,
+            .CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
+            .MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN,
+        },
+        .Alignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT,
+        .Flags = D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES,
+    };
+
+    Check(m_device->CreateHeap(&heapDesc, IID_PPV_ARGS(&m_graphHeap)));
+
+    m_graphTextures.assign(m_frameGraph.resourceCount(), nullptr);
+
+    for (std::uint32_t id = 1; id <= m_frameGraph.resourceCount(); ++id)
+    {
+        const auto placement = m_frameGraph.placement({ id });
+
+        if (!placement)
+        {
+            continue;
+        }
+
+        // Textures sharing memory start out undefined; the first pass clears or discards them
+        const auto desc = ToD3D12TextureDesc(m_frameGraph.desc({ id }), placement->usage);
+
+        Check(m_device->CreatePlacedResource(m_graphHeap, placement->offset, &desc,
+            ToD3D12States(placement->initialState), nullptr, IID_PPV_ARGS(&m_graphTextures[id - 1])));
+    }
+
+    return true;
+}
+
+void D3D12Backend::releaseGraphTextures()
+{
+    for (auto& texture : m_graphTextures)
+    {
+        if (texture)
+        {
+            texture->Release();
+        }
+    }
+
+    m_graphTextures.clear();
+
+    if (m_graphHeap)
+    {
+        m_graphHeap->Release();
+        m_graphHeap = nullptr;
+    }
+}
+
+ID3D12Resource* D3D12Backend::graphResource(RenderResourceHandle resource)const
+{
+    if (resource == m_backBufferResource)
+    {
+        return m_backBuffers[m_backBufferIndex];
+    }
+
+    return resource && resource.id <= m_graphTextures.size() ? m_graphTextures[resource.id - 1] : nullptr;
+}
+
+void D3D12Backend::recordBarriers(ID3D12GraphicsCommandList* commandList, std::span<const RenderBarrier> barriers)const
+{
+    if (barriers.empty())
+    {
+        return;
+    }
+
+    std::vector<D3D12_RESOURCE_BARRIER> descs(barriers.size());
+
+    for (std::size_t i = 0; i < barriers.size(); ++i)
+    {
+        const auto& barrier = barriers[i];
+
+        auto& desc = descs[i];
+
+        switch (barrier.type)
+        {
+        case BarrierType::Transition:
+            desc.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+            desc.Flags = barrier.split == BarrierSplit::Begin ? D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY :
+                barrier.split == BarrierSplit::End ? D3D12_RESOURCE_BARRIER_FLAG_END_ONLY : D3D12_RESOURCE_BARRIER_FLAG_NONE;
+            desc.Transition.pResource = graphResource(barrier.resource);
+            desc.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+            desc.Transition.StateBefore = ToD3D12States(barrier.before);
+            desc.Transition.StateAfter = ToD3D12States(barrier.after);
+            break;
+
+        case BarrierType::Aliasing:
+            desc.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+            desc.Aliasing.pResourceBefore = barrier.aliasBefore ? graphResource(barrier.aliasBefore) : nullptr;
+            desc.Aliasing.pResourceAfter = graphResource(barrier.resource);
+            break;
+
+        case BarrierType::UnorderedAccess:
+            desc.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+            desc.UAV.pResource = graphResource(barrier.resource);
+            break;
+        }
+    }
+
+    // The whole batch in one call
+    commandList->ResourceBarrier(static_cast<UINT>(descs.size()), descs.data());
+}
+
+void D3D12Backend::setWindowSize(int width, int height)
+{
+    m_windowViewport.Width = static_cast<float>(width);
+    m_windowViewport.Height = static_cast<float>(height);
+    m_windowViewport.TopLeftX = 0;
+    m_windowViewport.TopLeftY = 0;
+    m_windowViewport.MaxDepth = 1.f;
+    m_windowViewport.MinDepth = 0.f;
+
+    m_scissorRect.top = 0;
+    m_scissorRect.left = 0;
+    m_scissorRect.right = width;
+    m_scissorRect.bottom = height;
+}
+
+std::optional<BufferHandle> D3D12Backend::createBuffer(BufferUsage usage, const void* data, std::size_t sizeInBytes)
+{
+    std::optional<TlsfAllocation> allocation;
+    std::uint32_t pageIndex = 0;
+
+    for (; pageIndex < m_bufferPages.size(); ++pageIndex)
+    {
+        if (m_bufferPages[pageIndex] && (allocation = m_bufferPages[pageIndex]->allocator.allocate(sizeInBytes)))
+        {
+            break;
+        }
+    }
+
+    if (!allocation)
+    {
+        const auto page = createBufferPage(std::max<std::uint64_t>(BufferPageSize, sizeInBytes));
+        if (!page)
+        {
+            return std::nullopt;
+        }
+
+        pageIndex = page.value();
+        allocation = m_bufferPages[pageIndex]->allocator.allocate(sizeInBytes);
+
+        if (!allocation)
+        {
+            return std::nullopt;
+        }
+    }
+
+    if (!m_uploadManager.enqueue(data, sizeInBytes, pageIndex, allocation->offset))
+    {
+        ErrorLog(L"アップロードに失敗しました");
+        m_bufferPages[pageIndex]->allocator.free(allocation.value());
+        return std::nullopt;
+    }
+
+    const BufferRecord record = { .page = pageIndex, .allocation = allocation.value() };
+
+    if (!m_freeBufferIds.empty())
+    {
+        const std::uint32_t id = m_freeBufferIds.back();
+        m_freeBufferIds.pop_back();
+
+        m_buffers[id - 1] = record;
+
+        return BufferHandle{ id };
+    }
+
+    m_buffers.push_back(record);
+
+    return BufferHandle{ static_cast<std::uint32_t>(m_buffers.size()) };
+}
+
+void D3D12Backend::releaseBuffer(BufferHandle buffer)
+{
+    if (!buffer || m_buffers.size() < buffer.id || m_buffers[buffer.id - 1].released)
+    {
+        ErrorLog(L"解放済みまたは無効なバッファです");
+        return;
+    }
+
+    m_buffers[buffer.id - 1].released = true;
+
+    // Frames already submitted, and the one being recorded, may still read it
+    m_pendingReleases.push_back({ .buffer = buffer, .fenceValue = m_frameScheduler.submittedValue() + 1 });
+}
+
+DescriptorHandle D3D12Backend::createBufferView(BufferHandle buffer, std::uint32_t offset, std::uint32_t sizeInBytes)
+{
+    if (offset % 4 != 0 || sizeInBytes % 4 != 0 || sizeInBytes == 0)
+    {
+        ErrorLog(L"バッファビューの範囲が不正です");
+        return {};
+    }
+
+    if (!buffer || m_buffers.size() < buffer.id || m_buffers[buffer.id - 1].released)
+    {
+        ErrorLog(L"解放済みまたは無効なバッファのビューです");
+        return {};
+    }
+
+    const auto& record = m_buffers[buffer.id - 1];
+
+    if (record.allocation.size < static_cast<std::uint64_t>(offset) + sizeInBytes)
+    {
+        ErrorLog(L"バッファビューの範囲が不正です");
+        return {};
+    }
+
+    const auto view = m_descriptors.allocate();
+
+    if (!view)
+    {
+        return {};
+    }
+
+    D3D12_SHADER_RESOURCE_VIEW_DESC viewDesc = {};
+    viewDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+    viewDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+    viewDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    viewDesc.Buffer.FirstElement = (record.allocation.offset + offset) / 4;
+    viewDesc.Buffer.NumElements = sizeInBytes / 4;
+    viewDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_RAW;
+
+    m_device->CreateShaderResourceView(m_bufferPages[record.page]->resource, &viewDesc, cpuDescriptor(view.index));
+
+    return view;
+}
+
+void D3D12Backend::releaseView(DescriptorHandle view)
+{
+    m_descriptors.free(view);
+}
+
+std::optional<TransientAllocation> D3D12Backend::allocateTransient(std::uint64_t sizeInBytes, std::uint64_t alignment)
+{
+    return m_transientMemory.allocate(sizeInBytes, alignment);
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE D3D12Backend::cpuDescriptor(std::uint32_t index)const
+{
+    auto handle = m_descriptorHeap->GetCPUDescriptorHandleForHeapStart();
+    handle.ptr += static_cast<SIZE_T>(index) * m_descriptorSize;
+    return handle;
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE D3D12Backend::gpuDescriptor(std::uint32_t index)const
+{
+    auto handle = m_descriptorHeap->GetGPUDescriptorHandleForHeapStart();
+    handle.ptr += static_cast<UINT64>(index) * m_descriptorSize;
+    return handle;
+}
+
+std::vector<TlsfStats> D3D12Backend::bufferPageStats()const
+{
+    std::vector<TlsfStats> stats;
+
+    for (const auto& page : m_bufferPages)
+    {
+        if (page)
+        {
+            stats.push_back(page->allocator.stats());
+        }
+    }
+
+    return stats;
+}
+
+std::optional<std::uint32_t> D3D12Backend::createBufferPage(std::uint64_t sizeInBytes)
+{
+    const std::uint64_t alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    sizeInBytes = (sizeInBytes + alignment - 1) & ~(alignment - 1);
+
+    const D3D12_HEAP_DESC heapDesc =
+    {
+        .SizeInBytes = sizeInBytes,
+        .Properties =
+        {
+            .Type = D3D12_HEAP_TYPE_DEFAULT,
+            .CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
+            .MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN,
+        },
+        .Alignment = alignment,
+        .Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS,
+    };
+
+    const D3D12_RESOURCE_DESC desc =
+    {
+        .Dimension = D3D12_RESOURCE_DIMENSION_BUFFER,
+        //.Alignment
+        .Width = sizeInBytes,
+        .Height = 1,
+        .DepthOrArraySize = 1,
+        .MipLevels = 1,
+        .Format = DXGI_FORMAT_UNKNOWN,
+        .SampleDesc = {.Count = 1},
+        .Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
+        .Flags = D3D12_RESOURCE_FLAG_NONE,
+    };
+
+    auto page = std::make_unique<BufferPage>();
+
+    CheckOpt(m_device->CreateHeap(&heapDesc, IID_PPV_ARGS(&page->heap)));
+
+    CheckOpt(m_device->CreatePlacedResource(page->heap, 0, &desc,
+        D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&page->resource)));
+
+    page->address = page->resource->GetGPUVirtualAddress();
+    page->allocator.reset(sizeInBytes);
+
+    m_bufferPages.push_back(std::move(page));
+
+    return static_cast<std::uint32_t>(m_bufferPages.size() - 1);
+}
+
+void D3D12Backend::retireBuffers()
+{
+    const std::uint64_t completedValue = m_timeline->completedValue();
+
+    std::erase_if(m_pendingReleases, [&](const PendingRelease& pending)
+        {
+            if (completedValue < pending.fenceValue)
+            {
+                return false;
+            }
+
+            const auto& record = m_buffers[pending.buffer.id - 1];
+            auto& page = m_bufferPages[record.page];
+
+            page->allocator.free(record.allocation);
+
+            // Oversized pages made for a single buffer are returned as soon as they empty
+            if (page->allocator.empty() && BufferPageSize < page->allocator.capacity())
+            {
+                page->resource->Release();
+                page->heap->Release();
+                page.reset();
+            }
+
+            m_freeBufferIds.push_back(pending.buffer.id);
+
+            return true;
+        });
+}
+
+std::optional<std::vector<std::byte>> D3D12Backend::loadShader(const std::wstring& path, const char* entryPoint,
+    const char* target, const std::vector<ShaderDefine>& defines)
+{
+    const ShaderCompileDesc compileDesc =
+    {
+        .sourcePath = path,
+        .entryPoint = entryPoint,
+        .target = target,
+        .defines = defines,
+        .flags = ShaderCompileFlags(m_shaderProfile),
+        .compilerVersion = D3D_COMPILER_VERSION,
+    };
+
+    const auto key = ComputeShaderKey(compileDesc);
+
+    if (!key)
+    {
+        ErrorLog(L"ERROR_FILE_NOT_FOUND");
+        return std::nullopt;
+    }
+
+    if (auto cached = m_shaderCache.loadBytecode(key.value()))
+    {
+        return cached;
+    }
+
+    auto bytecode = CompileShader(compileDesc);
+
+    if (bytecode)
+    {
+        m_shaderCache.storeBytecode(key.value(), bytecode.value());
+    }
+
+    return bytecode;
+}
+
+void D3D12Backend::initPipelineLibrary(const std::filesystem::path& cacheDirectory)
+{
+    if (!m_shaderCache.init(cacheDirectory))
+    {
+        return;
+    }
+
+    ID3D12Device1* device1 = nullptr;
+
+    if (FAILED(m_device->QueryInterface(IID_PPV_ARGS(&device1))))
+    {
+        return;
+    }
+
+    // The library reads from this memory for as long as it lives
+    if (auto serialized = m_shaderCache.loadBlob("pipelines"))
+    {
+        m_pipelineLibraryData = std::move(serialized.value());
+
+        // Fails after a driver or adapter change; the stale library is simply rebuilt
+        if (FAILED(device1->CreatePipelineLibrary(m_pipelineLibraryData.data(), m_pipelineLibraryData.size(), IID_PPV_ARGS(&m_pipelineLibrary))))
+        {
+            m_pipelineLibraryData.clear();
+            m_pipelineLibrary = nullptr;
+        }
+    }
+
+    if (!m_pipelineLibrary && FAILED(device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&m_pipelineLibrary))))
+    {
+        m_pipelineLibrary = nullptr;
+    }
+
+    device1->Release();
+}
+
+bool D3D12Backend::initDescriptorHeap()
+{
+    if (!m_descriptors.init(DescriptorAllocator::DefaultCapacity, DescriptorAllocator::DefaultTransientCapacity))
+    {
+        return false;
+    }
+
+    const D3D12_DESCRIPTOR_HEAP_DESC heapDesc =
+    {
+        .Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+        .NumDescriptors = m_descriptors.capacity(),
+        .Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE,
+        .NodeMask = 0,
+    };
+
+    Check(m_device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&m_descriptorHeap)));
+
+    m_descriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+    // Slot 0: reads through a default DescriptorHandle return zero instead of faulting
+    D3D12_SHADER_RESOURCE_VIEW_DESC nullDesc = {};
+    nullDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+    nullDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+    nullDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    nullDesc.Buffer.NumElements = 1;
+    nullDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_RAW;
+
+    m_device->CreateShaderResourceView(nullptr, &nullDesc, cpuDescriptor(0));
+
+    return true;
+}
+
+bool D3D12Backend::createBindlessRootSignature()
+{
+    D3D12_FEATURE_DATA_ROOT_SIGNATURE feature = { .HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1 };
+
+    if (FAILED(m_device->CheckFeatureSupport(D3D12_FEATURE_ROOT_SIGNATURE, &feature, sizeof(feature))) ||
+        feature.HighestVersion < D3D_ROOT_SIGNATURE_VERSION_1_1)
+    {
+        ErrorLog(L"ルートシグネチャ 1.1 に対応していません");
+        return false;
+    }
+
+    // The whole heap is visible through each range, so a descriptor's index is the
+    // same in every array. Descriptors may change while no in-flight draw reads them.
+    const D3D12_DESCRIPTOR_RANGE1 ranges[] =
+    {
+        // Texture2D bindlessTextures[] : register(t0, space1)
+        {
+            .RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV,
+            .NumDescriptors = UINT_MAX,
+            .BaseShaderRegister = 0,
+            .RegisterSpace = 1,
+            .Flags = D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE,
+            .OffsetInDescriptorsFromTableStart = 0,
+        },
+        // ByteAddressBuffer bindlessBuffers[] : register(t0, space2)
+        {
+            .RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV,
+            .NumDescriptors = UINT_MAX,
+            .BaseShaderRegister = 0,
+            .RegisterSpace = 2,
+            .Flags = D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE,
+            .OffsetInDescriptorsFromTableStart = 0,
+        },
+    };
+
+    D3D12_ROOT_PARAMETER1 parameters[RootParameterCount] = {};
+
+    // cbuffer DrawConstants : register(b0); descriptor indices and small per-draw values
+    parameters[DrawConstantsParameter].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+    parameters[DrawConstantsParameter].Constants.ShaderRegister = 0;
+    parameters[DrawConstantsParameter].Constants.Num32BitValues = DrawConstantCount;
+
+    // cbuffer Constants : register(b1); per-draw data from the transient ring
+    parameters[ConstantBufferParameter].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+    parameters[ConstantBufferParameter].Descriptor.ShaderRegister = 1;
+    parameters[ConstantBufferParameter].Descriptor.Flags = D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE;
+
+    parameters[DescriptorTableParameter].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+    parameters[DescriptorTableParameter].DescriptorTable.NumDescriptorRanges = static_cast<UINT>(std::size(ranges));
+    parameters[DescriptorTableParameter].DescriptorTable.pDescriptorRanges = ranges;
+
+    for (auto& parameter : parameters)
+    {
+        parameter.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+    }
+
+    const D3D12_STATIC_SAMPLER_DESC samplers[] =
+    {
+        // SamplerState linearWrap : register(s0)
+        {
+            .Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR,
+            .AddressU = D3D12_TEXTURE_ADDRESS_MODE_WRAP,
+            .AddressV = D3D12_TEXTURE_ADDRESS_MODE_WRAP,
+            .AddressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP,
+            .MaxAnisotropy = 1,
+            .ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER,
+            .MaxLOD = D3D12_FLOAT32_MAX,
+            .ShaderRegister = 0,
+            .ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL,
+        },
+        // SamplerState pointClamp : register(s1)
+        {
+            .Filter = D3D12_FILTER_MIN_MAG_MIP_POINT,
+            .AddressU = D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+            .AddressV = D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+            .AddressW = D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+            .MaxAnisotropy = 1,
+            .ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER,
+            .MaxLOD = D3D12_FLOAT32_MAX,
+            .ShaderRegister = 1,
+            .ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL,
+        },
+    };
+
+    D3D12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDesc = {};
+    rootSignatureDesc.Version = D3D_ROOT_SIGNATURE_VERSION_1_1;
+    rootSignatureDesc.Desc_1_1.NumParameters = RootParameterCount;
+    rootSignatureDesc.Desc_1_1.pParameters = parameters;
+    rootSignatureDesc.Desc_1_1.NumStaticSamplers = static_cast<UINT>(std::size(samplers));
+    rootSignatureDesc.Desc_1_1.pStaticSamplers = samplers;
+    rootSignatureDesc.Desc_1_1.Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
+
+    ID3DBlob* rootSigBlob = nullptr;
+    ID3DBlob* errorBlob = nullptr;
+
+    if (FAILED(D3D12SerializeVersionedRootSignature(&rootSignatureDesc, &rootSigBlob, &errorBlob)))
+    {
+        if (errorBlob)
+        {
+            const std::string message(static_cast<const char*>(errorBlob->GetBufferPointer()), errorBlob->GetBufferSize());
+            ErrorLog(std::wstring(message.begin(), message.end()));
+            errorBlob->Release();
+        }
+
+        return false;
+    }
+
+    const std::span rootSignatureData(static_cast<const std::byte*>(rootSigBlob->GetBufferPointer()), rootSigBlob->GetBufferSize());
+
+    m_rootSignatureKey = HashBytes(rootSignatureData);
+
+    const auto result = m_device->CreateRootSignature(0, rootSignatureData.data(), rootSignatureData.size(), IID_PPV_ARGS(&m_rootSignature));
+
+    rootSigBlob->Release();
+
+    Check(result);
+
+    return true;
+}
+
+void D3D12Backend::setRootArguments(ID3D12GraphicsCommandList* commandList)const
+{
+    commandList->SetGraphicsRootDescriptorTable(DescriptorTableParameter, gpuDescriptor(0));
+
+    if (m_boundConstantBuffer != 0)
+    {
+        commandList->SetGraphicsRootConstantBufferView(ConstantBufferParameter, m_boundConstantBuffer);
+    }
+}
+
+bool D3D12Backend::loadLibraryPipeline(const std::wstring& name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, ID3D12PipelineState*& pipelineState)
+{
+    std::lock_guard lock(m_pipelineLibraryMutex);
+
+    return m_pipelineLibrary && SUCCEEDED(m_pipelineLibrary->LoadGraphicsPipeline(name.c_str(), &desc, IID_PPV_ARGS(&pipelineState)));
+}
+
+void D3D12Backend::savePipelineLibrary()
+{
+    std::lock_guard lock(m_pipelineLibraryMutex);
+
+    if (!m_pipelineLibrary || !m_pipelineLibraryDirty)
+    {
+        return;
+    }
+
+    std::vector<std::byte> serialized(m_pipelineLibrary->GetSerializedSize());
+
+    if (SUCCEEDED(m_pipelineLibrary->Serialize(serialized.data(), serialized.size())) &&
+        m_shaderCache.storeBlob("pipelines", serialized))
+    {
+        m_pipelineLibraryDirty = false;
+    }
+}
+
+std::optional<PipelineHandle> D3D12Backend::createPipeline(const PipelineDesc& desc)
+{
+    const auto pipeline = createPipelineAsync(desc);
+
+    if (m_pipelineCompiler->wait(pipeline) != PipelineStatus::Ready)
+    {
+        return std::nullopt;
+    }
+
+    return pipeline;
+}
+
+PipelineHandle D3D12Backend::createPipelineAsync(const PipelineDesc& desc)
+{
+    auto object = std::make_unique<PipelineObject>();
+
+    const auto pipeline = m_pipelineCompiler->request(HashPipelineDesc(desc),
+        [this, desc, target = object.get()] { return buildPipeline(desc, *target); });
+
+    // The build only writes into the object, and the render thread reads it once the status is Ready
+    if (m_pipelines.size() < pipeline.id)
+    {
+        m_pipelines.push_back(std::move(object));
+    }
+
+    return pipeline;
+}
+
+PipelineStatus D3D12Backend::pipelineStatus(PipelineHandle pipeline)
+{
+    return m_pipelineCompiler->status(pipeline);
+}
+
+bool D3D12Backend::buildPipeline(const PipelineDesc& desc, PipelineObject& pipeline)
+{
+    const auto vsBytecode = loadShader(desc.vertexShaderPath, "VS", "vs_5_1", desc.defines);
+
+    if (!vsBytecode)
+    {
+        return false;
+    }
+
+    const auto psBytecode = loadShader(desc.pixelShaderPath, "PS", "ps_5_1", desc.defines);
+
+    if (!psBytecode)
+    {
+        return false;
+    }
+
+    std::vector<D3D12_INPUT_ELEMENT_DESC> inputLayout;
+
+    for (const auto& element : desc.inputLayout)
+    {
+        inputLayout.push_back(
+            {
+                element.semanticName.c_str(), element.semanticIndex, ToDXGIFormat(element.format), element.inputSlot,
+                element.offset,
+                element.inputRate == InputRate::PerInstance ? D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA : D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,
+                element.inputRate == InputRate::PerInstance ? 1u : 0u
+            });
+    }
+
+    // Every pipeline shares the bindless layout, so switching pipelines never rebinds root arguments
+    pipeline.rootSignature = m_rootSignature;
+
+    const std::uint64_t rootSignatureKey = m_rootSignatureKey;
+
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC pipelineDesc = {};
+
+    pipelineDesc.pRootSignature = pipeline.rootSignature;
+    pipelineDesc.VS.pShaderBytecode = vsBytecode->data();
+    pipelineDesc.VS.BytecodeLength = vsBytecode->size();
+    pipelineDesc.PS.pShaderBytecode = psBytecode->data();
+    pipelineDesc.PS.BytecodeLength = psBytecode->size();
+
+    pipelineDesc.SampleMask = D3D12_DEFAULT_SAMPLE_MASK;
+
+    pipelineDesc.RasterizerState.MultisampleEnable = false;
+    pipelineDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+    pipelineDesc.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
+    pipelineDesc.RasterizerState.DepthClipEnable = true;
+
+    pipelineDesc.BlendState.AlphaToCoverageEnable = false;
+    pipelineDesc.BlendState.IndependentBlendEnable = false;
+
+    D3D12_RENDER_TARGET_BLEND_DESC blendDesc = {};
+
+    blendDesc.BlendEnable = false;
+    blendDesc.LogicOpEnable = false;
+    blendDesc.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+
+    pipelineDesc.BlendState.RenderTarget[0] = blendDesc;
+
+
+    pipelineDesc.InputLayout.pInputElementDescs = inputLayout.data();
+    pipelineDesc.InputLayout.NumElements = static_cast<UINT>(inputLayout.size());
+
+    pipelineDesc.IBStripCutValue = D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_DISABLED;
+    pipelineDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+
+    pipelineDesc.NumRenderTargets = 1;
+    pipelineDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+
+    pipelineDesc.SampleDesc.Count = 1;
+    pipelineDesc.SampleDesc.Quality = 0;
+
+    // Different PipelineDescs can still end up with identical bytecode and state
+    const std::uint64_t pipelineKey = HashPipelineStateDesc(pipelineDesc, rootSignatureKey);
+
+    pipeline.pipelineState = findShared(m_pipelineStates, pipelineKey);
+
+    if (pipeline.pipelineState)
+    {
+        return true;
+    }
+
+    const std::wstring pipelineName = std::to_wstring(pipelineKey);
+
+    ID3D12PipelineState* pipelineState = nullptr;
+
+    // A library hit skips driver compilation; a miss compiles and records it for the next start.
+    // Loads of the same name from several threads must not overlap, so library calls are serialized.
+    if (!loadLibraryPipeline(pipelineName, pipelineDesc, pipelineState))
+    {
+        Check(m_device->CreateGraphicsPipelineState(&pipelineDesc, IID_PPV_ARGS(&pipelineState)));
+
+        std::lock_guard lock(m_pipelineLibraryMutex);
+
+        if (m_pipelineLibrary && SUCCEEDED(m_pipelineLibrary->StorePipeline(pipelineName.c_str(), pipelineState)))
+        {
+            m_pipelineLibraryDirty = true;
+        }
+    }
+
+    pipeline.pipelineState = publishShared(m_pipelineStates, pipelineKey, pipelineState);
+
+    return true;
+}
+
+template<typename T>
+T* D3D12Backend::findShared(const std::unordered_map<std::uint64_t, T*>& objects, std::uint64_t key)
+{
+    std::lock_guard lock(m_sharedObjectMutex);
+
+    const auto found = objects.find(key);
+
+    return found != objects.end() ? found->second : nullptr;
+}
+
+template<typename T>
+T* D3D12Backend::publishShared(std::unordered_map<std::uint64_t, T*>& objects, std::uint64_t key, T* object)
+{
+    std::lock_guard lock(m_sharedObjectMutex);
+
+    // Another worker may have built the same object meanwhile; keep the first one
+    const auto [found, inserted] = objects.emplace(key, object);
+
+    if (!inserted)
+    {
+        object->Release();
+    }
+
+    return found->second;
+}
+
+void D3D12Backend::setPipeline(PipelineHandle pipeline)
+{
+    if (recordSetPipeline(m_currentList, pipeline))
+    {
+        m_boundPipeline = pipeline;
+    }
+}
+
+void D3D12Backend::draw(const DrawIndexedDesc& desc)
+{
+    recordDraw(m_currentList, desc);
+}
+
+// Translates the changes that survive the tracker one-to-one into list calls
+class D3D12Backend::ListCommandSink : public CommandSink
+{
+public:
+
+    ListCommandSink(D3D12Backend& backend, ID3D12GraphicsCommandList* commandList)
+        : m_backend(backend)
+        , m_commandList(commandList)
+    {}
+
+    std::uint64_t rootSignatureKey(PipelineHandle pipeline) override
+    {
+        if (m_backend.m_pipelineCompiler->status(pipeline) != PipelineStatus::Ready)
+        {
+            return 0;
+        }
+
+        return reinterpret_cast<std::uintptr_t>(m_backend.m_pipelines[pipeline.id - 1]->rootSignature);
+    }
+
+    void setPipelineState(PipelineHandle pipeline) override
+    {
+        if (m_backend.m_pipelineCompiler->status(pipeline) != PipelineStatus::Ready)
+        {
+            return;
+        }
+
+        m_commandList->SetPipelineState(m_backend.m_pipelines[pipeline.id - 1]->pipelineState);
+
+        m_backend.m_boundPipeline = pipeline;
+    }
+
+    void setRootSignature(PipelineHandle pipeline) override
+    {
+        if (m_backend.m_pipelineCompiler->status(pipeline) != PipelineStatus::Ready)
+        {
+            return;
+        }
+
+        m_commandList->SetGraphicsRootSignature(m_backend.m_pipelines[pipeline.id - 1]->rootSignature);
+
+        m_backend.setRootArguments(m_commandList);
+    }
+
+    void setTopology(PrimitiveTopology topology) override
+    {
+        m_commandList->IASetPrimitiveTopology(ToD3DTopology(topology));
+    }
+
+    void setVertexBuffer(std::uint32_t slot, const VertexBufferView& view) override
+    {
+        const D3D12_VERTEX_BUFFER_VIEW vbView =
+        {
+            .BufferLocation = m_backend.bufferAddress(view),
+            .SizeInBytes = view.sizeInBytes,
+            .StrideInBytes = view.strideInBytes,
+        };
+
+        m_commandList->IASetVertexBuffers(slot, 1, &vbView);
+    }
+
+    void setIndexBuffer(const IndexBufferView& view) override
+    {
+        const D3D12_INDEX_BUFFER_VIEW ibView =
+        {
+            .BufferLocation = m_backend.bufferAddress(view.buffer) + view.offset,
+            .SizeInBytes = view.sizeInBytes,
+            .Format = ToDXGIFormat(view.format),
+        };
+
+        m_commandList->IASetIndexBuffer(&ibView);
+    }
+
+    void setViewport(const Viewport& viewport) override
+    {
+        const D3D12_VIEWPORT d3dViewport =
+        {
+            .TopLeftX = viewport.x,
+            .TopLeftY = viewport.y,
+            .Width = viewport.width,
+            .Height = viewport.height,
+            .MinDepth = viewport.minDepth,
+            .MaxDepth = viewport.maxDepth,
+        };
+
+        m_commandList->RSSetViewports(1, &d3dViewport);
+    }
+
+    void setScissor(const ScissorRect& scissor) override
+    {
+        const D3D12_RECT rect =
+        {
+            .left = scissor.left,
+            .top = scissor.top,
+            .right = scissor.right,
+            .bottom = scissor.bottom,
+        };
+
+        m_commandList->RSSetScissorRects(1, &rect);
+    }
+
+    void setConstantBuffer(std::uint64_t gpuAddress) override
+    {
+        m_commandList->SetGraphicsRootConstantBufferView(ConstantBufferParameter, gpuAddress);
+
+        m_backend.m_boundConstantBuffer = gpuAddress;
+    }
+
+    void drawIndexed(const DrawIndexedArgs& args) override
+    {
+        m_commandList->DrawIndexedInstanced(args.indexCount, args.instanceCount, args.startIndex, args.baseVertex, args.startInstance);
+    }
+
+private:
+
+    D3D12Backend& m_backend;
+
+    ID3D12GraphicsCommandList* m_commandList = nullptr;
+};
+
+void D3D12Backend::execute(const CommandStream& commands, CommandStateTracker& tracker)
+{
+    ListCommandSink sink(*this, m_currentList);
+
+    // Whatever the list had bound before is unknown to the tracker
+    tracker.reset();
+    tracker.replay(commands, sink);
+}
+
+void D3D12Backend::beginGpuScope(const char* name)
+{
+#ifdef ENABLE_PROFILER
+    auto& scopes = m_gpuScopes[m_contextIndex];
+    auto& queryCount = m_gpuQueryCounts[m_contextIndex];
+
+    // Both timestamps are reserved now so the end always has a slot
+    if (!m_timestampHeap || MaxGpuQueries < queryCount + 2)
+    {
+        m_openGpuScopes.push_back(~0u);
+        return;
+    }
+
+    m_openGpuScopes.push_back(static_cast<std::uint32_t>(scopes.size()));
+
+    scopes.push_back({ .name = name, .beginQuery = queryCount, .endQuery = queryCount + 1 });
+
+    m_currentList->EndQuery(m_timestampHeap, D3D12_QUERY_TYPE_TIMESTAMP, m_contextIndex * MaxGpuQueries + queryCount);
+
+    queryCount += 2;
+#endif
+}
+
+void D3D12Backend::endGpuScope()
+{
+#ifdef ENABLE_PROFILER
+    if (m_openGpuScopes.empty())
+    {
+        return;
+    }
+
+    const auto scope = m_openGpuScopes.back();
+    m_openGpuScopes.pop_back();
+
+    if (scope != ~0u)
+    {
+        m_currentList->EndQuery(m_timestampHeap, D3D12_QUERY_TYPE_TIMESTAMP, m_contextIndex * MaxGpuQueries + m_gpuScopes[m_contextIndex][scope].endQuery);
+    }
+#endif
+}
+
+#ifdef ENABLE_PROFILER
+bool D3D12Backend::initGpuProfiler()
+{
+    const D3D12_QUERY_HEAP_DESC heapDesc =
+    {
+        .Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP,
+        .Count = MaxGpuQueries * FrameScheduler::MaxFramesInFlight,
+    };
+
+    Check(m_device->CreateQueryHeap(&heapDesc, IID_PPV_ARGS(&m_timestampHeap)));
+
+    const D3D12_HEAP_PROPERTIES prop =
+    {
+        .Type = D3D12_HEAP_TYPE_READBACK,
+        .CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
+        .MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN,
+    };
+
+    const D3D12_RESOURCE_DESC readbackDesc =
+    {
+        .Dimension = D3D12_RESOURCE_DIMENSION_BUFFER,
+        .Width = sizeof(std::uint64_t) * heapDesc.Count,
+        .Height = 1,
+        .DepthOrArraySize = 1,
+        .MipLevels = 1,
+        .Format = DXGI_FORMAT_UNKNOWN,
+        .SampleDesc = {.Count = 1},
+        .Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
+        .Flags = D3D12_RESOURCE_FLAG_NONE,
+    };
+
+    Check(m_device->CreateCommittedResource(&prop, D3D12_HEAP_FLAG_NONE, &readbackDesc,
+        D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&m_timestampReadback)));
+
+    Check(m_commandQueue->GetTimestampFrequency(&m_timestampFrequency));
+
+    return true;
+}
+
+void D3D12Backend::resolveGpuScopes()
+{
+    const auto queryCount = m_gpuQueryCounts[m_contextIndex];
+
+    if (queryCount == 0)
+    {
+        return;
+    }
+
+    const auto first = m_contextIndex * MaxGpuQueries;
+
+    m_currentList->ResolveQueryData(m_timestampHeap, D3D12_QUERY_TYPE_TIMESTAMP, first, queryCount,
+        m_timestampReadback, sizeof(std::uint64_t) * first);
+}
+
+void D3D12Backend::collectGpuScopes(std::uint32_t contextIndex)
+{
+    auto& scopes = m_gpuScopes[contextIndex];
+    auto& queryCount = m_gpuQueryCounts[contextIndex];
+
+    m_openGpuScopes.clear();
+
+    if (scopes.empty() || m_timestampFrequency == 0)
+    {
+        scopes.clear();
+        queryCount = 0;
+        return;
+    }
+
+    // GPU ticks to the Profiler clock through a GPU/QPC pair taken now; steady_clock counts QPC
+    std::uint64_t gpuCalibration = 0;
+    std::uint64_t cpuCalibration = 0;
+    LARGE_INTEGER qpcFrequency = {};
+
+    const bool calibrated = SUCCEEDED(m_commandQueue->GetClockCalibration(&gpuCalibration, &cpuCalibration)) &&
+        QueryPerformanceFrequency(&qpcFrequency);
+
+    const D3D12_RANGE readRange =
+    {
+        .Begin = sizeof(std::uint64_t) * contextIndex * MaxGpuQueries,
+        .End = sizeof(std::uint64_t) * (contextIndex * MaxGpuQueries + queryCount),
+    };
+
+    std::uint8_t* mapped = nullptr;
+
+    if (calibrated && SUCCEEDED(m_timestampReadback->Map(0, &readRange, reinterpret_cast<void**>(&mapped))))
+    {
+        const auto* timestamps = reinterpret_cast<const std::uint64_t*>(mapped + readRange.Begin);
+
+        const auto cpuBase = static_cast<double>(cpuCalibration) * 1e9 / static_cast<double>(qpcFrequency.QuadPart);
+        const auto toCpu = [&](std::uint64_t gpu)
+        {
+            const auto delta = static_cast<double>(static_cast<std::int64_t>(gpu - gpuCalibration)) * 1e9 / static_cast<double>(m_timestampFrequency);
+            return static_cast<std::uint64_t>(cpuBase + delta);
+        };
+
+        for (const auto& scope : scopes)
+        {
+            Profiler::instance().recordGpu(scope.name, toCpu(timestamps[scope.beginQuery]), toCpu(timestamps[scope.endQuery]));
+        }
+
+        const D3D12_RANGE writtenRange = {};
+        m_timestampReadback->Unmap(0, &writtenRange);
+    }
+
+    scopes.clear();
+    queryCount = 0;
+}
+#endif
+
+class D3D12Backend::RecordingContext : public CommandContext
+{
+public:
+
+    RecordingContext(const D3D12Backend& backend, ID3D12GraphicsCommandList* commandList)
+        : m_backend(backend)
+        , m_commandList(commandList)
+    {}
+
+    void setPipeline(PipelineHandle pipeline) override
+    {
+        m_backend.recordSetPipeline(m_commandList, pipeline);
+    }
+
+    void draw(const DrawIndexedDesc& desc) override
+    {
+        m_backend.recordDraw(m_commandList, desc);
+    }
+
+private:
+
+    const D3D12Backend& m_backend;
+
+    ID3D12GraphicsCommandList* m_commandList = nullptr;
+};
+
+bool D3D12Backend::recordParallel(JobSystem& jobs, std::uint32_t contextCount, const RecordFunc& record)
+{
+    if (contextCount == 0)
+    {
+        return true;
+    }
+
+    // Close what was recorded so far so the worker lists execute right after it
+    Check(m_currentList->Close());
+
+    m_submitLists.push_back(m_currentList);
+
+    std::vector<ID3D12GraphicsCommandList*> lists(contextCount + 1);
+
+    for (auto& list : lists)
+    {
+        const auto acquired = acquireRecordingList();
+
+        if (!acquired)
+        {
+            ErrorLog(L"コマンドリストの作成に失敗しました");
+            return false;
+        }
+
+        list = acquired.value();
+
+        setRenderTargetState(list);
+    }
+
+    jobs.parallelFor(contextCount, 1, [&](std::uint32_t begin, std::uint32_t end)
+        {
+            for (std::uint32_t i = begin; i < end; ++i)
+            {
+                RecordingContext context(*this, lists[i]);
+
+                record(context, i);
+            }
+        });
+
+    for (std::uint32_t i = 0; i < contextCount; ++i)
+    {
+        Check(lists[i]->Close());
+
+        m_submitLists.push_back(lists[i]);
+    }
+
+    // The last list continues the frame on this thread with the same pipeline and
+    // constant buffer bound. The next execute resets its tracker, so Dx does not rebind them.
+    m_currentList = lists.back();
+
+    if (m_boundPipeline)
+    {
+        recordSetPipeline(m_currentList, m_boundPipeline);
+    }
+
+    return true;
+}
+
+std::optional<ID3D12GraphicsCommandList*> D3D12Backend::acquireRecordingList()
+{
+    if (m_usedRecordingLists == m_recordingLists.size())
+    {
+        RecordingList recordingList;
+
+        for (std::uint32_t i = 0; i < m_frameScheduler.framesInFlight(); ++i)
+        {
+            CheckOpt(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&recordingList.allocators[i])));
+        }
+
+        CheckOpt(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, recordingList.allocators[0], nullptr, IID_PPV_ARGS(&recordingList.commandList)));
+
+        CheckOpt(recordingList.commandList->Close());
+
+        m_recordingLists.push_back(recordingList);
+    }
+
+    const auto& recordingList = m_recordingLists[m_usedRecordingLists++];
+
+    // Each list is used once per frame, so its allocator for this context is free to reset
+    auto* allocator = recordingList.allocators[m_contextIndex];
+
+    CheckOpt(allocator->Reset());
+
+    CheckOpt(recordingList.commandList->Reset(allocator, nullptr));
+
+    return recordingList.commandList;
+}
+
+void D3D12Backend::setRenderTargetState(ID3D12GraphicsCommandList* commandList)const
+{
+    commandList->SetDescriptorHeaps(1, &m_descriptorHeap);
+
+    commandList->OMSetRenderTargets(1, &m_currentRtv, true, nullptr);
+
+    commandList->RSSetViewports(1, &m_windowViewport);
+
+    commandList->RSSetScissorRects(1, &m_scissorRect);
+
+    commandList->IASetPrimitiveTopology(m_primitiveTOpology);
+}
+
+bool D3D12Backend::recordSetPipeline(ID3D12GraphicsCommandList* commandList, PipelineHandle pipeline)const
+{
+    if (m_pipelineCompiler->status(pipeline) != PipelineStatus::Ready)
+    {
+        return false;
+    }
+
+    const auto& object = *m_pipelines[pipeline.id - 1];
+
+    commandList->SetPipelineState(object.pipelineState);
+
+    commandList->SetGraphicsRootSignature(object.rootSignature);
+
+    setRootArguments(commandList);
+
+    return true;
+}
+
+void D3D12Backend::recordDraw(ID3D12GraphicsCommandList* commandList, const DrawIndexedDesc& desc)const
+{
+    D3D12_VERTEX_BUFFER_VIEW vbViews[2] =
+    {
+        {
+            .BufferLocation = bufferAddress(desc.vertexBuffer),
+            .SizeInBytes = desc.vertexBuffer.sizeInBytes,
+            .StrideInBytes = desc.vertexBuffer.strideInBytes,
+        },
+    };
+
+    const bool instanced = static_cast<bool>(desc.instanceBuffer);
+
+    if (instanced)
+    {
+        vbViews[1] =
+        {
+            .BufferLocation = bufferAddress(desc.instanceBuffer),
+            .SizeInBytes = desc.instanceBuffer.sizeInBytes,
+            .StrideInBytes = desc.instanceBuffer.strideInBytes,
+        };
+    }
+
+    const D3D12_INDEX_BUFFER_VIEW ibView =
+    {
+        .BufferLocation = bufferAddress(desc.indexBuffer.buffer) + desc.indexBuffer.offset,
+        .SizeInBytes = desc.indexBuffer.sizeInBytes,
+        .Format = ToDXGIFormat(desc.indexBuffer.format),
+    };
+
+    commandList->IASetVertexBuffers(0, instanced ? 2 : 1, vbViews);
+
+    commandList->IASetIndexBuffer(&ibView);
+
+    commandList->DrawIndexedInstanced(desc.indexCount, desc.instanceCount, desc.startIndex, desc.baseVertex, desc.startInstance);
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS D3D12Backend::bufferAddress(BufferHandle buffer)const
+{
+    const auto& record = m_buffers[buffer.id - 1];
+
+    return m_bufferPages[record.page]->address + record.allocation.offset;
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS D3D12Backend::bufferAddress(const VertexBufferView& view)const
+{
+    return (view.gpuAddress != 0 ? view.gpuAddress : bufferAddress(view.buffer)) + view.offset;
+}
@@ -0,0 +1,382 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include <Windows.h>
+#include <d3d12.h>
+#include <dxgi1_6.h>
+
+#include "descriptorAllocator.hpp"
+#include "frameScheduler.hpp"
+#include "pipelineCompiler.hpp"
+#include "renderBackend.hpp"
+#include "renderGraph.hpp"
+#include "shaderCache.hpp"
+#include "tlsfAllocator.hpp"
+#include "transientAllocator.hpp"
+#include "uploadManager.hpp"
+
+class D3D12Backend : public RenderBackend
+{
+public:
+
+    static constexpr std::uint64_t BufferPageSize = 64ull * 1024 * 1024;
+
+    static constexpr std::uint64_t StagingBufferSize = 32ull * 1024 * 1024;
+
+    D3D12Backend() = default;
+
+    bool init(const BackendDesc& desc) override;
+
+    bool frameBegin() override;
+
+    std::uint64_t frameWaitNs()const override { return m_frameScheduler.lastWaitNs(); }
+
+    bool frameEnd() override;
+
+    bool waitIdle() override;
+
+    bool resize(int width, int height) override;
+
+    std::optional<BufferHandle> createBuffer(BufferUsage usage, const void* data, std::size_t sizeInBytes) override;
+
+    void releaseBuffer(BufferHandle buffer) override;
+
+    DescriptorHandle createBufferView(BufferHandle buffer, std::uint32_t offset, std::uint32_t sizeInBytes) override;
+
+    void releaseView(DescriptorHandle view) override;
+
+    std::optional<TransientAllocation> allocateTransient(std::uint64_t sizeInBytes, std::uint64_t alignment = ConstantBufferAlignment) override;
+
+    std::optional<PipelineHandle> createPipeline(const PipelineDesc& desc) override;
+
+    PipelineHandle createPipelineAsync(const PipelineDesc& desc) override;
+
+    PipelineStatus pipelineStatus(PipelineHandle pipeline) override;
+
+    void setPipeline(PipelineHandle pipeline) override;
+
+    PipelineHandle boundPipeline()const override { return m_boundPipeline; }
+
+    void draw(const DrawIndexedDesc& desc) override;
+
+    void execute(const CommandStream& commands, CommandStateTracker& tracker) override;
+
+    void beginGpuScope(const char* name) override;
+
+    void endGpuScope() override;
+
+    bool recordParallel(JobSystem& jobs, std::uint32_t contextCount, const RecordFunc& record) override;
+
+    ID3D12Device* device() { return m_device; }
+
+    std::vector<TlsfStats> bufferPageStats()const;
+
+    const UploadStats& uploadStats()const { return m_uploadManager.stats(); }
+
+    ShaderCacheStats shaderCacheStats()const { return m_shaderCache.stats(); }
+
+    PipelineCompilerStats pipelineCompilerStats()const { return m_pipelineCompiler->stats(); }
+
+    // Persistent slots for views made outside the backend, and transient ranges
+    // for tables written during the frame; fill them through cpuDescriptor
+    DescriptorAllocator& descriptors() { return m_descriptors; }
+
+    TransientAllocatorStats transientStats()const { return m_transientMemory.stats(); }
+
+    D3D12_CPU_DESCRIPTOR_HANDLE cpuDescriptor(std::uint32_t index)const;
+
+    D3D12_GPU_DESCRIPTOR_HANDLE gpuDescriptor(std::uint32_t index)const;
+
+private:
+
+    // Layout of the root signature every pipeline shares
+    enum RootParameter : UINT
+    {
+        DrawConstantsParameter,
+        ConstantBufferParameter,
+        DescriptorTableParameter,
+        RootParameterCount,
+    };
+
+    static constexpr UINT DrawConstantCount = 16;
+
+    struct PipelineObject
+    {
+        ID3D12PipelineState* pipelineState = nullptr;
+
+        ID3D12RootSignature* rootSignature = nullptr;
+    };
+
+    // One large placed buffer in a DEFAULT heap; vertex and index data of many
+    // meshes are packed into it and filled through the copy queue
+    struct BufferPage
+    {
+        ID3D12Heap* heap = nullptr;
+
+        ID3D12Resource* resource = nullptr;
+
+        D3D12_GPU_VIRTUAL_ADDRESS address = 0;
+
+        TlsfAllocator allocator;
+    };
+
+    struct BufferRecord
+    {
+        std::uint32_t page = 0;
+
+        TlsfAllocation allocation;
+
+        // Set by releaseBuffer, so views of a dead id are refused until it is reused
+        bool released = false;
+    };
+
+    class RecordingContext;
+
+    class ListCommandSink;
+
+    // A direct command list with one allocator per frame context, handed to a worker
+    struct RecordingList
+    {
+        std::array<ID3D12CommandAllocator*, FrameScheduler::MaxFramesInFlight> allocators = {};
+
+        ID3D12GraphicsCommandList* commandList = nullptr;
+    };
+
+    struct PendingRelease
+    {
+        BufferHandle buffer;
+
+        std::uint64_t fenceValue = 0;
+    };
+
+    std::optional<std::uint32_t> createBufferPage(std::uint64_t sizeInBytes);
+
+    void retireBuffers();
+
+    D3D12_GPU_VIRTUAL_ADDRESS bufferAddress(BufferHandle buffer)const;
+
+    D3D12_GPU_VIRTUAL_ADDRESS bufferAddress(const VertexBufferView& view)const;
+
+    std::optional<ID3D12GraphicsCommandList*> acquireRecordingList();
+
+    void setRenderTargetState(ID3D12GraphicsCommandList* commandList)const;
+
+    bool createBackBufferViews();
+
+    bool initDescriptorHeap();
+
+    bool createBindlessRootSignature();
+
+    // After every SetGraphicsRootSignature
+    void setRootArguments(ID3D12GraphicsCommandList* commandList)const;
+
+    void setWindowSize(int width, int height);
+
+    // The frame's passes and the barriers between them, rebuilt when the back buffer changes
+    bool buildFrameGraph(int width, int height);
+
+    // Transients are placed resources in one heap, at the offsets the graph chose
+    bool createGraphTextures();
+
+    void releaseGraphTextures();
+
+    // Imported textures and the transients of live passes; null for anything else
+    ID3D12Resource* graphResource(RenderResourceHandle resource)const;
+
+    // One ResourceBarrier call per batch
+    void recordBarriers(ID3D12GraphicsCommandList* commandList, std::span<const RenderBarrier> barriers)const;
+
+    // Safe to call from recording workers; they only read backend state
+    bool recordSetPipeline(ID3D12GraphicsCommandList* commandList, PipelineHandle pipeline)const;
+
+    void recordDraw(ID3D12GraphicsCommandList* commandList, const DrawIndexedDesc& desc)const;
+
+    // Bytecode comes from the shader cache when the key matches, otherwise it is compiled and stored
+    std::optional<std::vector<std::byte>> loadShader(const std::wstring& path, const char* entryPoint,
+        const char* target, const std::vector<ShaderDefine>& defines);
+
+    // Runs on a PipelineCompiler worker
+    bool buildPipeline(const PipelineDesc& desc, PipelineObject& pipeline);
+
+    template<typename T>
+    T* findShared(const std::unordered_map<std::uint64_t, T*>& objects, std::uint64_t key);
+
+    template<typename T>
+    T* publishShared(std::unordered_map<std::uint64_t, T*>& objects, std::uint64_t key, T* object);
+
+    void initPipelineLibrary(const std::filesystem::path& cacheDirectory);
+
+    bool loadLibraryPipeline(const std::wstring& name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, ID3D12PipelineState*& pipelineState);
+
+    void savePipelineLibrary();
+
+#ifdef ENABLE_PROFILER
+    bool initGpuProfiler();
+
+    // Resolves this frame's timestamps into its readback range; call before the list closes
+    void resolveGpuScopes();
+
+    // Hands the scopes of a context whose frame the GPU has finished to the Profiler
+    void collectGpuScopes(std::uint32_t contextIndex);
+#endif
+
+    ID3D12Device* m_device = nullptr;
+
+    IDXGISwapChain4* m_swapChain = nullptr;
+
+    std::array<ID3D12CommandAllocator*, FrameScheduler::MaxFramesInFlight> m_commandAllocators = {};
+
+    ID3D12GraphicsCommandList* m_commandList = nullptr;
+
+    // The list setPipeline and draw record into; recordParallel moves it on to a fresh list
+    ID3D12GraphicsCommandList* m_currentList = nullptr;
+
+    std::vector<RecordingList> m_recordingLists;
+
+    std::size_t m_usedRecordingLists = 0;
+
+    // This frame's lists in execution order
+    std::vector<ID3D12CommandList*> m_submitLists;
+
+    std::uint32_t m_contextIndex = 0;
+
+    PipelineHandle m_boundPipeline;
+
+    // Last b1 address on the current list, carried over to the lists recordParallel starts
+    std::uint64_t m_boundConstantBuffer = 0;
+
+    D3D12_CPU_DESCRIPTOR_HANDLE m_currentRtv = {};
+
+    ID3D12CommandQueue* m_commandQueue = nullptr;
+
+    ID3D12Fence* m_fence = nullptr;
+
+    HANDLE m_fenceEvent = nullptr;
+
+    std::unique_ptr<GpuTimeline> m_timeline;
+
+    FrameScheduler m_frameScheduler;
+
+    ID3D12CommandQueue* m_copyQueue = nullptr;
+
+    ID3D12Fence* m_copyFence = nullptr;
+
+    HANDLE m_copyFenceEvent = nullptr;
+
+    ID3D12Resource* m_stagingBuffer = nullptr;
+
+#ifdef ENABLE_PROFILER
+    static constexpr std::uint32_t MaxGpuQueries = 512;
+
+    struct GpuScope
+    {
+        const char* name = nullptr;
+
+        std::uint32_t beginQuery = 0;
+
+        std::uint32_t endQuery = 0;
+    };
+
+    ID3D12QueryHeap* m_timestampHeap = nullptr;
+
+    // MaxGpuQueries timestamps per frame context
+    ID3D12Resource* m_timestampReadback = nullptr;
+
+    std::uint64_t m_timestampFrequency = 0;
+
+    std::array<std::vector<GpuScope>, FrameScheduler::MaxFramesInFlight> m_gpuScopes;
+
+    std::array<std::uint32_t, FrameScheduler::MaxFramesInFlight> m_gpuQueryCounts = {};
+
+    // Scopes begun but not yet ended, as indices into this frame's m_gpuScopes
+    std::vector<std::uint32_t> m_openGpuScopes;
+#endif
+
+    std::unique_ptr<CopyQueue> m_copyTimeline;
+
+    UploadManager m_uploadManager;
+
+    IDXGIFactory6* m_dxgiFactory = nullptr;
+
+    std::array<ID3D12Resource*, FrameScheduler::MaxFramesInFlight> m_backBuffers = {};
+
+    std::uint32_t m_backBufferCount = 2;
+
+    D3D12_DESCRIPTOR_HEAP_DESC  m_backBufferHD = {};
+
+    ID3D12DescriptorHeap* m_backBufferHeaps = nullptr;
+
+    std::uint32_t m_backBufferIndex = 0;
+
+    RenderGraph m_frameGraph;
+
+    RenderResourceHandle m_backBufferResource;
+
+    ID3D12Heap* m_graphHeap = nullptr;
+
+    // Indexed by resource handle - 1, null for imported and culled textures
+    std::vector<ID3D12Resource*> m_graphTextures;
+
+    std::array<float, 4> m_clearColor = { 0.f,0.f,0.f,1.f };
+
+    D3D12_VIEWPORT m_windowViewport = {};
+
+    D3D12_RECT m_scissorRect = {};
+
+    D3D12_PRIMITIVE_TOPOLOGY m_primitiveTOpology = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+
+    std::vector<std::unique_ptr<BufferPage>> m_bufferPages;
+
+    std::vector<BufferRecord> m_buffers;
+
+    std::vector<std::uint32_t> m_freeBufferIds;
+
+    std::vector<PendingRelease> m_pendingReleases;
+
+    std::vector<std::unique_ptr<PipelineObject>> m_pipelines;
+
+    ID3D12DescriptorHeap* m_descriptorHeap = nullptr;
+
+    UINT m_descriptorSize = 0;
+
+    DescriptorAllocator m_descriptors;
+
+    std::unique_ptr<TransientPageSource> m_transientPageSource;
+
+    // Per-draw constants and other data written once per frame
+    TransientAllocator m_transientMemory;
+
+    ID3D12RootSignature* m_rootSignature = nullptr;
+
+    // Hash of the serialized root signature, part of every PSO key
+    std::uint64_t m_rootSignatureKey = 0;
+
+    // PSOs keyed by their full description, shared between pipelines
+    std::unordered_map<std::uint64_t, ID3D12PipelineState*> m_pipelineStates;
+
+    std::mutex m_sharedObjectMutex;
+
+    ShaderProfile m_shaderProfile = ShaderProfile::Debug;
+
+    ShaderCache m_shaderCache;
+
+    ID3D12PipelineLibrary* m_pipelineLibrary = nullptr;
+
+    std::vector<std::byte> m_pipelineLibraryData;
+
+    std::mutex m_pipelineLibraryMutex;
+
+    bool m_pipelineLibraryDirty = false;
+
+    // Declared last so its workers stop before anything they use is destroyed
+    std::unique_ptr<PipelineCompiler> m_pipelineCompiler;
+};
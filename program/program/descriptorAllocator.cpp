@@ -0,0 +1,130 @@
+#include <algorithm>
+
+#include "descriptorAllocator.hpp"
+#include "logger.hpp"
+
+bool DescriptorAllocator::init(std::uint32_t capacity, std::uint32_t transientCapacity)
+{
+    if (capacity <= transientCapacity + 1)
+    {
+        ErrorLog(L"ディスクリプタヒープのサイズが不正です");
+        return false;
+    }
+
+    m_capacity = capacity;
+    m_transientBase = capacity - transientCapacity;
+
+    m_freeIndices.resize(m_transientBase - 1);
+
+    // Popped from the back, so the lowest index goes out first
+    for (std::uint32_t i = 0; i < m_freeIndices.size(); ++i)
+    {
+        m_freeIndices[i] = m_transientBase - 1 - i;
+    }
+
+    m_allocated.assign(m_transientBase, false);
+    m_persistentUsed = 0;
+    m_persistentPeak = 0;
+
+    m_openFrees.clear();
+    m_pendingFrees.clear();
+
+    m_transient.reset(transientCapacity);
+    m_transientFailures = 0;
+
+    return true;
+}
+
+DescriptorHandle DescriptorAllocator::allocate()
+{
+    if (m_freeIndices.empty())
+    {
+        ErrorLog(L"ディスクリプタヒープに空きがありません");
+        return {};
+    }
+
+    const auto index = m_freeIndices.back();
+    m_freeIndices.pop_back();
+
+    m_allocated[index] = true;
+
+    ++m_persistentUsed;
+    m_persistentPeak = std::max(m_persistentPeak, m_persistentUsed);
+
+    return { index };
+}
+
+void DescriptorAllocator::free(DescriptorHandle handle)
+{
+    if (!handle)
+    {
+        return;
+    }
+
+    if (m_transientBase <= handle.index || !m_allocated[handle.index])
+    {
+        ErrorLog(L"確保されていないディスクリプタが解放されました");
+        return;
+    }
+
+    m_allocated[handle.index] = false;
+
+    --m_persistentUsed;
+
+    m_openFrees.push_back(handle.index);
+}
+
+std::optional<DescriptorRange> DescriptorAllocator::allocateTransient(std::uint32_t count)
+{
+    if (count == 0)
+    {
+        return DescriptorRange{ .first = m_transientBase, .count = 0 };
+    }
+
+    const auto offset = m_transient.allocate(count, 1);
+
+    if (!offset)
+    {
+        ++m_transientFailures;
+        return std::nullopt;
+    }
+
+    return DescriptorRange{ .first = m_transientBase + static_cast<std::uint32_t>(offset.value()), .count = count };
+}
+
+void DescriptorAllocator::endFrame(std::uint64_t fenceValue)
+{
+    m_transient.close(fenceValue);
+
+    for (const auto index : m_openFrees)
+    {
+        m_pendingFrees.push_back({ .fenceValue = fenceValue, .index = index });
+    }
+
+    m_openFrees.clear();
+}
+
+void DescriptorAllocator::reclaim(std::uint64_t completedValue)
+{
+    m_transient.reclaim(completedValue);
+
+    while (!m_pendingFrees.empty() && m_pendingFrees.front().fenceValue <= completedValue)
+    {
+        m_freeIndices.push_back(m_pendingFrees.front().index);
+        m_pendingFrees.pop_front();
+    }
+}
+
+DescriptorAllocatorStats DescriptorAllocator::stats()const
+{
+    return
+    {
+        .persistentCapacity = m_transientBase == 0 ? 0 : m_transientBase - 1,
+        .persistentUsed = m_persistentUsed,
+        .persistentPeak = m_persistentPeak,
+        .pendingFrees = static_cast<std::uint32_t>(m_openFrees.size() + m_pendingFrees.size()),
+        .transientCapacity = m_capacity - m_transientBase,
+        .transientUsed = static_cast<std::uint32_t>(m_transient.usedBytes()),
+        .transientFailures = m_transientFailures,
+    };
+}
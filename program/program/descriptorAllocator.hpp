@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <vector>
+
+#include "renderBackend.hpp"
+#include "uploadManager.hpp"
+
+// Contiguous transient descriptors, for tables written every frame
+struct DescriptorRange
+{
+    std::uint32_t first = 0;
+
+    std::uint32_t count = 0;
+};
+
+struct DescriptorAllocatorStats
+{
+    std::uint32_t persistentCapacity = 0;
+
+    std::uint32_t persistentUsed = 0;
+
+    std::uint32_t persistentPeak = 0;
+
+    // Freed but possibly still read by a frame in flight
+    std::uint32_t pendingFrees = 0;
+
+    std::uint32_t transientCapacity = 0;
+
+    std::uint32_t transientUsed = 0;
+
+    std::uint64_t transientFailures = 0;
+};
+
+// Hands out slots of one shader-visible CBV/SRV/UAV heap. The heap is split in
+// three: the null descriptor at 0, persistent descriptors from a free list,
+// and a ring of transient descriptors at the end that is given back frame by
+// frame as the GPU finishes. Only indices are managed, so the D3D12 heap is
+// owned by the backend and this runs anywhere. Not thread-safe; the thread
+// that ends frames owns it.
+class DescriptorAllocator
+{
+public:
+
+    static constexpr std::uint32_t DefaultCapacity = 1 << 16;
+
+    static constexpr std::uint32_t DefaultTransientCapacity = 1 << 14;
+
+    DescriptorAllocator() = default;
+
+    // capacity counts the null descriptor; transientCapacity is carved off the end
+    bool init(std::uint32_t capacity, std::uint32_t transientCapacity);
+
+    // Lives until free; invalid when the persistent part is full
+    DescriptorHandle allocate();
+
+    // The slot is reused only once the frame the call belongs to has completed
+    void free(DescriptorHandle handle);
+
+    // Valid until the current frame completes on the GPU
+    std::optional<DescriptorRange> allocateTransient(std::uint32_t count);
+
+    // Closes the current frame with the fence value that marks its completion
+    void endFrame(std::uint64_t fenceValue);
+
+    // Recycles transient ranges and frees of every frame up to completedValue
+    void reclaim(std::uint64_t completedValue);
+
+    std::uint32_t capacity()const { return m_capacity; }
+
+    DescriptorAllocatorStats stats()const;
+
+private:
+
+    struct PendingFree
+    {
+        std::uint64_t fenceValue = 0;
+
+        std::uint32_t index = 0;
+    };
+
+    std::uint32_t m_capacity = 0;
+
+    std::uint32_t m_transientBase = 0;
+
+    // Most recently freed last, so reuse favours slots that are still in cache
+    std::vector<std::uint32_t> m_freeIndices;
+
+    // Catches double frees and frees of slots never handed out
+    std::vector<bool> m_allocated;
+
+    std::uint32_t m_persistentUsed = 0;
+
+    std::uint32_t m_persistentPeak = 0;
+
+    // Freed during the current frame
+    std::vector<std::uint32_t> m_openFrees;
+
+    std::deque<PendingFree> m_pendingFrees;
+
+    // Offsets relative to m_transientBase
+    UploadRing m_transient;
+
+    std::uint64_t m_transientFailures = 0;
+};
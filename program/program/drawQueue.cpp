@@ -0,0 +1,147 @@
+#include <array>
+#include <cstring>
+
+#include "drawQueue.hpp"
+
+void RadixSort(std::span<std::uint64_t> keys, std::span<std::uint32_t> values,
+    std::vector<std::uint64_t>& keyScratch, std::vector<std::uint32_t>& valueScratch)
+{
+    const std::size_t count = keys.size();
+
+    if (count < 2)
+    {
+        return;
+    }
+
+    constexpr std::size_t Passes = 8;
+
+    // All histograms in one read of the keys
+    std::array<std::array<std::uint32_t, 256>, Passes> histograms = {};
+
+    for (const auto key : keys)
+    {
+        for (std::size_t pass = 0; pass < Passes; ++pass)
+        {
+            ++histograms[pass][(key >> (pass * 8)) & 0xff];
+        }
+    }
+
+    keyScratch.resize(count);
+    valueScratch.resize(count);
+
+    std::uint64_t* sourceKeys = keys.data();
+    std::uint32_t* sourceValues = values.data();
+    std::uint64_t* targetKeys = keyScratch.data();
+    std::uint32_t* targetValues = valueScratch.data();
+
+    for (std::size_t pass = 0; pass < Passes; ++pass)
+    {
+        auto& histogram = histograms[pass];
+        const auto shift = pass * 8;
+
+        if (histogram[(sourceKeys[0] >> shift) & 0xff] == count)
+        {
+            continue;
+        }
+
+        std::uint32_t offset = 0;
+
+        for (auto& bucket : histogram)
+        {
+            const auto size = bucket;
+            bucket = offset;
+            offset += size;
+        }
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const auto destination = histogram[(sourceKeys[i] >> shift) & 0xff]++;
+
+            targetKeys[destination] = sourceKeys[i];
+            targetValues[destination] = sourceValues[i];
+        }
+
+        std::swap(sourceKeys, targetKeys);
+        std::swap(sourceValues, targetValues);
+    }
+
+    // An odd number of passes leaves the result in the scratch buffers
+    if (sourceKeys != keys.data())
+    {
+        std::memcpy(keys.data(), sourceKeys, count * sizeof(std::uint64_t));
+        std::memcpy(values.data(), sourceValues, count * sizeof(std::uint32_t));
+    }
+}
+
+void DrawQueue::clear()
+{
+    m_items.clear();
+    m_instances.clear();
+    m_batches.clear();
+    m_sortedInstances.clear();
+}
+
+void DrawQueue::push(std::uint32_t pipeline, std::uint32_t mesh, std::span<const std::byte> instanceData)
+{
+    m_items.push_back(
+        {
+            .pipeline = pipeline,
+            .mesh = mesh,
+            .instanceOffset = static_cast<std::uint32_t>(m_instances.size()),
+            .instanceSize = static_cast<std::uint32_t>(instanceData.size()),
+        });
+
+    m_instances.insert(m_instances.end(), instanceData.begin(), instanceData.end());
+}
+
+void DrawQueue::build()
+{
+    const auto count = static_cast<std::uint32_t>(m_items.size());
+
+    m_keys.resize(count);
+    m_order.resize(count);
+
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        m_keys[i] = static_cast<std::uint64_t>(m_items[i].pipeline) << 32 | m_items[i].mesh;
+        m_order[i] = i;
+    }
+
+    RadixSort(m_keys, m_order, m_keyScratch, m_orderScratch);
+
+    m_batches.clear();
+    m_sortedInstances.clear();
+
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        const auto& item = m_items[m_order[i]];
+
+        const bool merge = !m_batches.empty() && 0 < i && m_keys[i - 1] == m_keys[i] &&
+            m_batches.back().instanceStride == item.instanceSize;
+
+        if (!merge)
+        {
+            const auto aligned = (m_sortedInstances.size() + InstanceAlignment - 1) / InstanceAlignment * InstanceAlignment;
+
+            m_sortedInstances.resize(aligned);
+
+            m_batches.push_back(
+                {
+                    .pipeline = item.pipeline,
+                    .mesh = item.mesh,
+                    .firstItem = m_order[i],
+                    .instanceCount = 0,
+                    .instanceStride = item.instanceSize,
+                    .instanceOffset = aligned,
+                });
+        }
+
+        ++m_batches.back().instanceCount;
+
+        const auto* instance = m_instances.data() + item.instanceOffset;
+        m_sortedInstances.insert(m_sortedInstances.end(), instance, instance + item.instanceSize);
+    }
+
+    m_stats.itemsIn += count;
+    m_stats.drawsOut += m_batches.size();
+}
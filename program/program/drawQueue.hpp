@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Sorts keys ascending and applies the same permutation to values. LSD radix,
+// 8 bits per pass; passes where every key has the same byte are skipped, so
+// keys that only use their low bits cost proportionally less. Stable.
+void RadixSort(std::span<std::uint64_t> keys, std::span<std::uint32_t> values,
+    std::vector<std::uint64_t>& keyScratch, std::vector<std::uint32_t>& valueScratch);
+
+struct DrawBatch
+{
+    std::uint32_t pipeline = 0;
+
+    std::uint32_t mesh = 0;
+
+    // Submission index of the first item, to look up whatever the caller keeps per item
+    std::uint32_t firstItem = 0;
+
+    std::uint32_t instanceCount = 0;
+
+    std::uint32_t instanceStride = 0;
+
+    // Byte offset of this batch's instances in instanceData()
+    std::uint64_t instanceOffset = 0;
+};
+
+struct DrawQueueStats
+{
+    std::uint64_t itemsIn = 0;
+
+    std::uint64_t drawsOut = 0;
+};
+
+// Collects (pipeline, mesh, instance data) items for one frame. build() sorts
+// them by a 64-bit key of pipeline then mesh and merges runs with the same
+// pipeline, mesh and instance size into one instanced batch. Within a batch,
+// instances keep their submission order.
+class DrawQueue
+{
+public:
+
+    // Batches start at this alignment inside the packed instance data
+    static constexpr std::uint64_t InstanceAlignment = 16;
+
+    DrawQueue() = default;
+
+    void clear();
+
+    void push(std::uint32_t pipeline, std::uint32_t mesh, std::span<const std::byte> instanceData = {});
+
+    void build();
+
+    std::span<const DrawBatch> batches()const { return m_batches; }
+
+    // Instances of every batch, packed in batch order
+    std::span<const std::byte> instanceData()const { return m_sortedInstances; }
+
+    std::uint32_t size()const { return static_cast<std::uint32_t>(m_items.size()); }
+
+    const DrawQueueStats& stats()const { return m_stats; }
+
+private:
+
+    struct Item
+    {
+        std::uint32_t pipeline = 0;
+
+        std::uint32_t mesh = 0;
+
+        std::uint32_t instanceOffset = 0;
+
+        std::uint32_t instanceSize = 0;
+    };
+
+    std::vector<Item> m_items;
+
+    std::vector<std::byte> m_instances;
+
+    std::vector<std::uint64_t> m_keys;
+
+    std::vector<std::uint32_t> m_order;
+
+    std::vector<std::uint64_t> m_keyScratch;
+
+    std::vector<std::uint32_t> m_orderScratch;
+
+    std::vector<DrawBatch> m_batches;
+
+    std::vector<std::byte> m_sortedInstances;
+
+    DrawQueueStats m_stats;
+};
@@ -1,222 +1,427 @@
-#include <string>
-#include <optional>
-
-#include <comdef.h>
-#include <d3d12.h>
-#include <dxgi1_6.h>
-#include <DirectXMath.h>
-
-#include <d3dcompiler.h>
+#include <algorithm>
+#include <cstring>
 
 #include "logger.hpp"
 #include "dx.hpp"
 #include "mesh.hpp"
+#include "profiler.hpp"
+#include "renderStats.hpp"
 #include "shaderPipeline.hpp"
 
-namespace
+#ifdef _WIN32
+#include "d3d12Backend.hpp"
+
+bool Dx::init(HWND hwnd, int width, int height, std::uint32_t framesInFlight)
 {
-    void EnableDebugLayer()
+    const BackendDesc desc =
     {
-        ID3D12Debug* debugLayer = nullptr;
-
-        auto result = D3D12GetDebugInterface(IID_PPV_ARGS(&debugLayer));
+        .nativeWindow = hwnd,
+        .width = width,
+        .height = height,
+        .framesInFlight = framesInFlight,
+    };
 
-        debugLayer->EnableDebugLayer();
+    return init(std::make_unique<D3D12Backend>(), desc);
+}
+#endif
 
-        debugLayer->Release();
+bool Dx::init(std::unique_ptr<RenderBackend> backend, const BackendDesc& desc)
+{
+    if (!backend)
+    {
+        ErrorLog(L"バックエンドが指定されていません");
+        return false;
     }
+
+    m_backend = std::move(backend);
+
+    // Created here so the thread running the frame owns the scheduler's first deque
+    m_jobs = std::make_unique<JobSystem>();
+
+    return m_backend->init(desc);
 }
 
-bool Dx::init(HWND hwnd, int width, int height)
+bool Dx::frameBegin()
 {
-    EnableDebugLayer();
+    ProfileScope("Dx::frameBegin");
 
-    const D3D_FEATURE_LEVEL levels[] =
-    {
-        D3D_FEATURE_LEVEL_12_1,
-        D3D_FEATURE_LEVEL_12_0,
-    };
+    const bool result = m_backend->frameBegin();
+
+    // Only the fence wait itself, not the rest of the backend's frame setup
+    RenderStats::instance().add(RenderCounter::FenceWaitNs, m_backend->frameWaitNs());
+
+    return result;
+}
+
+bool Dx::frameEnd()
+{
+    ProfileScope("Dx::frameEnd");
+
+    submitCommands();
 
-    std::optional<D3D_FEATURE_LEVEL> featureLevel;
+    const bool result = m_backend->frameEnd();
 
-    for (auto level : levels)
+    const auto now = std::chrono::steady_clock::now();
+
+    if (m_lastFrameEnd != std::chrono::steady_clock::time_point{})
     {
-        if (D3D12CreateDevice(nullptr, D3D_FEATURE_LEVEL_12_1, IID_PPV_ARGS(&m_device)) == S_OK)
-        {
-            featureLevel = level;
-            break;
-        }
+        RenderStats::instance().endFrame(std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_lastFrameEnd).count());
     }
 
-    if (!featureLevel)
+    m_lastFrameEnd = now;
+
+    return result;
+}
+
+bool Dx::waitIdle()
+{
+    return m_backend->waitIdle();
+}
+
+bool Dx::resize(int width, int height)
+{
+    ProfileScope("Dx::resize");
+
+    return m_backend->resize(width, height);
+}
+
+bool Dx::setConstants(std::span<const std::byte> data)
+{
+    const auto allocation = m_backend->allocateTransient(data.size(), ConstantBufferAlignment);
+
+    if (!allocation)
     {
-        ErrorLog(L"初期化に失敗しました");
         return false;
     }
 
-    Check(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_commandAllocator)));
+    std::memcpy(allocation->cpuAddress, data.data(), data.size());
 
-    const D3D12_COMMAND_QUEUE_DESC commandQueueDesc =
-    {
-        .Type = D3D12_COMMAND_LIST_TYPE_DIRECT,
-        .Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL,
-        .Flags = D3D12_COMMAND_QUEUE_FLAG_NONE,
-        .NodeMask = 0,
-    };
+    m_commands.setConstantBuffer(allocation->gpuAddress);
 
-    Check(m_device->CreateCommandQueue(&commandQueueDesc, IID_PPV_ARGS(&m_commandQueue)));
-
-    const DXGI_SWAP_CHAIN_DESC1 swapchainDesc =
-    {
-        .Width = static_cast<unsigned>(width),
-        .Height = static_cast<unsigned>(height),
-        .Format = DXGI_FORMAT_R8G8B8A8_UNORM,
-        .Stereo = false,
-        .SampleDesc = {.Count = 1, .Quality = 0},
-        .BufferUsage = DXGI_USAGE_BACK_BUFFER,
-        .BufferCount = static_cast<unsigned>(m_backBuffers.size()),
-        .Scaling = DXGI_SCALING_STRETCH,
-        .SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD,
-        .AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED,
-        .Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH,
-    };
+    RenderStats::instance().add(RenderCounter::BytesUploaded, data.size());
 
-    Check(CreateDXGIFactory2(DXGI_CREATE_FACTORY_DEBUG, IID_PPV_ARGS(&m_dxgiFactory)));
+    return true;
+}
 
-    Check(m_dxgiFactory->CreateSwapChainForHwnd(m_commandQueue, hwnd, &swapchainDesc, nullptr, nullptr, reinterpret_cast<IDXGISwapChain1**>(&m_swapChain)));
+bool Dx::setPipeline(const ShaderPipeline& pipeline, const ShaderPipeline* fallback)
+{
+    const ShaderPipeline* bound = &pipeline;
 
-    m_backBufferHD =
+    if (m_backend->pipelineStatus(pipeline.handle()) != PipelineStatus::Ready)
     {
-        .Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV,
-        .NumDescriptors = 2,
-        .Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE,
-        .NodeMask = 0,
-    };
+        const bool fallbackReady = fallback && m_backend->pipelineStatus(fallback->handle()) == PipelineStatus::Ready;
 
-    Check(m_device->CreateDescriptorHeap(&m_backBufferHD, IID_PPV_ARGS(&m_backBufferHeaps)));
+        bound = fallbackReady ? fallback : nullptr;
+    }
 
-    D3D12_CPU_DESCRIPTOR_HANDLE handle = m_backBufferHeaps->GetCPUDescriptorHandleForHeapStart();
+    m_skipDraws = !bound;
 
-    for (unsigned i = 0; i < static_cast<unsigned>(m_backBuffers.size()); ++i)
+    if (bound)
     {
-        Check(m_swapChain->GetBuffer(i, IID_PPV_ARGS(&m_backBuffers[i])));
+        m_commands.setPipeline(bound->handle());
 
-        m_device->CreateRenderTargetView(m_backBuffers[i], nullptr, handle);
-
-        handle.ptr += m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+        m_currentLayoutId = bound->layoutId();
+        m_layoutMismatchReported = false;
     }
 
-    Check(m_commandAllocator->Reset());
+    return bound == &pipeline;
+}
+
+void Dx::draw(const Mesh& mesh, std::uint32_t lod)
+{
+    if (m_skipDraws)
+    {
+        return;
+    }
 
-    Check(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocator, nullptr, IID_PPV_ARGS(&m_commandList)));
+    if (!LayoutsMatch(m_currentLayoutId, mesh.layoutId()))
+    {
+        ReportLayoutMismatch(m_layoutMismatchReported);
+        return;
+    }
 
-    m_windowViewport.Width = width;
-    m_windowViewport.Height = height;
-    m_windowViewport.TopLeftX = 0;
-    m_windowViewport.TopLeftY = 0;
-    m_windowViewport.MaxDepth = 1.f;
-    m_windowViewport.MinDepth = 0.f;
+    const auto& level = mesh.lod(lod);
 
-    m_scissorRect.top = 0;
-    m_scissorRect.left = 0;
-    m_scissorRect.right = width;
-    m_scissorRect.bottom = height;
+    const DrawIndexedDesc desc =
+    {
+        .vertexBuffer = mesh.vertexBuffer(),
+        .indexBuffer = mesh.indexBuffer(),
+        .instanceBuffer = {},
+        .indexCount = level.indexCount,
+        .startIndex = level.indexOffset,
+    };
 
-    return true;
+    recordDraw(desc);
 }
 
-bool Dx::frameBegin()
+bool Dx::drawParallel(std::span<const DrawItem> items, std::uint32_t contextCount)
 {
-    auto currentBackBuffer = m_swapChain->GetCurrentBackBufferIndex();
+    if (items.empty())
+    {
+        return true;
+    }
 
-    auto rtvHeap = m_backBufferHeaps->GetCPUDescriptorHandleForHeapStart();
-    rtvHeap.ptr += currentBackBuffer * m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+    ProfileScope("Dx::drawParallel");
 
-    m_backBufferBD.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-    m_backBufferBD.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-    m_backBufferBD.Transition.pResource = m_backBuffers[currentBackBuffer];
-    m_backBufferBD.Transition.Subresource = 0;
+    // The parallel lists execute after whatever was recorded before them
+    submitCommands();
 
+    if (contextCount == 0)
     {
-        m_backBufferBD.Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
-        m_backBufferBD.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
+        contextCount = m_jobs->threadCount();
+    }
 
-        m_commandList->ResourceBarrier(1, &m_backBufferBD);
+    contextCount = std::min(contextCount, static_cast<std::uint32_t>(items.size()));
 
-        m_commandList->OMSetRenderTargets(1, &rtvHeap, true, nullptr);
-    }
+    const auto itemsPerContext = (static_cast<std::uint32_t>(items.size()) + contextCount - 1) / contextCount;
+
+    GpuProfileScope(*m_backend, "drawParallel");
 
-    m_commandList->ClearRenderTargetView(rtvHeap, m_clearColor.data(), 0, nullptr);
+    return m_backend->recordParallel(*m_jobs, contextCount, [&](CommandContext& context, std::uint32_t index)
+        {
+            ProfileScope("Record command list");
 
+            const auto begin = index * itemsPerContext;
+            const auto end = std::min(begin + itemsPerContext, static_cast<std::uint32_t>(items.size()));
 
-    m_commandList->RSSetViewports(1, &m_windowViewport);
+            const ShaderPipeline* bound = nullptr;
 
-    m_commandList->RSSetScissorRects(1, &m_scissorRect);
+            bool layoutMismatchReported = false;
 
-    m_commandList->IASetPrimitiveTopology(m_primitiveTOpology);
+            // Counted locally so workers do not share the counters' cache line per draw
+            std::uint64_t draws = 0;
+            std::uint64_t pipelineSwitches = 0;
 
-    return true;
+            for (std::uint32_t i = begin; i < end; ++i)
+            {
+                const auto& item = items[i];
+
+                if (item.pipeline != bound)
+                {
+                    if (m_backend->pipelineStatus(item.pipeline->handle()) != PipelineStatus::Ready)
+                    {
+                        continue;
+                    }
+
+                    context.setPipeline(item.pipeline->handle());
+
+                    bound = item.pipeline;
+                    layoutMismatchReported = false;
+
+                    ++pipelineSwitches;
+                }
+
+                if (!LayoutsMatch(bound->layoutId(), item.mesh->layoutId()))
+                {
+                    ReportLayoutMismatch(layoutMismatchReported);
+                    continue;
+                }
+
+                const auto& level = item.mesh->lod(item.lod);
+
+                const DrawIndexedDesc desc =
+                {
+                    .vertexBuffer = item.mesh->vertexBuffer(),
+                    .indexBuffer = item.mesh->indexBuffer(),
+                    .instanceBuffer = {},
+                    .indexCount = level.indexCount,
+                    .startIndex = level.indexOffset,
+                };
+
+                context.draw(desc);
+
+                ++draws;
+            }
+
+            auto& stats = RenderStats::instance();
+            stats.add(RenderCounter::DrawCalls, draws);
+            stats.add(RenderCounter::PipelineSwitches, pipelineSwitches);
+        });
 }
 
-bool Dx::frameEnd()
+void Dx::submit(const ShaderPipeline& pipeline, const Mesh& mesh, std::span<const std::byte> instanceData, std::uint32_t lod)
 {
-    {
-        m_backBufferBD.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
-        m_backBufferBD.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
+    static_assert(MaxMeshLods <= 8 && MaxMeshIds <= 1u << 29, "the mesh key is the mesh id above 3 bits of level");
 
-        m_commandList->ResourceBarrier(1, &m_backBufferBD);
-    }
+    lod = std::min(lod, mesh.lodCount() - 1);
 
-    m_commandList->Close();
+    m_drawQueue.push(pipeline.handle().id, mesh.id() << 3 | lod, instanceData);
 
-    ID3D12CommandList* commandLists[] = { m_commandList };
+    m_queuedItems.push_back({ .pipeline = &pipeline, .mesh = &mesh, .lod = lod });
+}
 
-    m_commandQueue->ExecuteCommandLists(1, commandLists);
+bool Dx::flushDraws()
+{
+    ProfileScope("Dx::flushDraws");
 
-    {
-        ID3D12Fence* fence = nullptr;
-        std::uint64_t fenceVal = 0;
+    m_drawQueue.build();
 
-        Check(m_device->CreateFence(fenceVal, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)));
+    const auto instanceData = m_drawQueue.instanceData();
 
-        Check(m_commandQueue->Signal(fence, ++fenceVal));
+    // Read in place from this frame's transient memory; only backends without it get a buffer
+    VertexBufferView instances;
 
-        while (fence->GetCompletedValue() != fenceVal)
+    if (!instanceData.empty())
+    {
+        if (const auto allocation = m_backend->allocateTransient(instanceData.size()))
         {
-            auto eventHandle = CreateEvent(nullptr, false, false, nullptr);
+            std::memcpy(allocation->cpuAddress, instanceData.data(), instanceData.size());
 
-            Check(fence->SetEventOnCompletion(fenceVal, eventHandle));
+            instances.gpuAddress = allocation->gpuAddress;
+        }
+        else
+        {
+            // Commands still waiting may read the instance buffer that is about to be released
+            submitCommands();
 
-            if (eventHandle)
+            if (m_instanceBuffer)
             {
-                WaitForSingleObject(eventHandle, INFINITE);
+                m_backend->releaseBuffer(m_instanceBuffer);
+                m_instanceBuffer = {};
+            }
+
+            const auto buffer = m_backend->createBuffer(BufferUsage::Vertex, instanceData.data(), instanceData.size());
 
-                CloseHandle(eventHandle);
+            if (!buffer)
+            {
+                ErrorLog(L"インスタンスバッファの作成に失敗しました");
+                m_drawQueue.clear();
+                m_queuedItems.clear();
+                return false;
             }
+
+            m_instanceBuffer = buffer.value();
+            instances.buffer = m_instanceBuffer;
         }
+
+        RenderStats::instance().add(RenderCounter::BytesUploaded, instanceData.size());
     }
 
-    Check(m_commandAllocator->Reset());
+    const ShaderPipeline* bound = nullptr;
+
+    // Batches arrive grouped by pipeline, so each pipeline is bound once
+    for (const auto& batch : m_drawQueue.batches())
+    {
+        const auto& item = m_queuedItems[batch.firstItem];
+
+        if (item.pipeline != bound)
+        {
+            if (!setPipeline(*item.pipeline))
+            {
+                continue;
+            }
+
+            bound = item.pipeline;
+        }
+
+        if (!LayoutsMatch(m_currentLayoutId, item.mesh->layoutId()))
+        {
+            ReportLayoutMismatch(m_layoutMismatchReported);
+            continue;
+        }
+
+        const auto& level = item.mesh->lod(item.lod);
 
-    Check(m_commandList->Reset(m_commandAllocator, nullptr));
+        DrawIndexedDesc desc =
+        {
+            .vertexBuffer = item.mesh->vertexBuffer(),
+            .indexBuffer = item.mesh->indexBuffer(),
+            .instanceBuffer = {},
+            .indexCount = level.indexCount,
+            .instanceCount = batch.instanceCount,
+            .startIndex = level.indexOffset,
+        };
+
+        if (0 < batch.instanceStride)
+        {
+            desc.instanceBuffer =
+            {
+                .buffer = instances.buffer,
+                .gpuAddress = instances.gpuAddress,
+                .offset = static_cast<std::uint32_t>(batch.instanceOffset),
+                .sizeInBytes = batch.instanceCount * batch.instanceStride,
+                .strideInBytes = batch.instanceStride,
+            };
+        }
 
-    m_swapChain->Present(1, 0);
+        recordDraw(desc);
+    }
+
+    m_drawQueue.clear();
+    m_queuedItems.clear();
 
     return true;
 }
 
-void Dx::setPipeline(const ShaderPipeline& pipeline)
+std::span<const std::uint32_t> Dx::cull(const Frustum& frustum, const InstanceBoundsStore& bounds)
+{
+    ProfileScope("Dx::cull");
+
+    return m_culler.cull(*m_jobs, frustum, bounds);
+}
+
+void Dx::renderOccluders(const float* viewProjection, std::span<const Occluder> occluders)
+{
+    ProfileScope("Dx::renderOccluders");
+
+    m_occlusionCuller.render(*m_jobs, viewProjection, occluders);
+}
+
+std::span<const std::uint32_t> Dx::cullOccluded(const InstanceBoundsStore& bounds, std::span<const std::uint32_t> candidates)
+{
+    ProfileScope("Dx::cullOccluded");
+
+    return m_occlusionCuller.cull(*m_jobs, bounds, candidates);
+}
+
+void Dx::recordDraw(const DrawIndexedDesc& desc)
 {
-    m_commandList->SetPipelineState(pipeline.m_pipelineState);
+    m_commands.setVertexBuffer(0, desc.vertexBuffer);
+
+    if (desc.instanceBuffer)
+    {
+        m_commands.setVertexBuffer(1, desc.instanceBuffer);
+    }
+
+    m_commands.setIndexBuffer(desc.indexBuffer);
 
-    m_commandList->SetGraphicsRootSignature(pipeline.m_rootSignature);
+    m_commands.drawIndexed(
+        {
+            .indexCount = desc.indexCount,
+            .instanceCount = desc.instanceCount,
+            .startIndex = desc.startIndex,
+            .baseVertex = desc.baseVertex,
+            .startInstance = desc.startInstance,
+        });
 }
 
-void Dx::draw(const Mesh& mesh)
+void Dx::submitCommands()
 {
-    m_commandList->IASetVertexBuffers(0, 1, &mesh.m_vbView);
+    if (m_commands.empty())
+    {
+        return;
+    }
+
+    ProfileScope("Dx::submitCommands");
 
-    m_commandList->IASetIndexBuffer(&mesh.m_ibView);
+    const auto before = m_stateTracker.stats();
 
-    m_commandList->DrawIndexedInstanced(mesh.m_indicesCount, 1, 0, 0, 0);
+    m_backend->execute(m_commands, m_stateTracker);
+
+    const auto& after = m_stateTracker.stats();
+
+    auto& stats = RenderStats::instance();
+    stats.add(RenderCounter::DrawCalls, after.draws - before.draws);
+    stats.add(RenderCounter::PipelineSwitches, after.pipelineState.issued - before.pipelineState.issued);
+
+    m_commands.clear();
+}
+
+void Dx::ReportLayoutMismatch(bool& reported)
+{
+    if (!reported)
+    {
+        ErrorLog(L"メッシュの頂点レイアウトがパイプラインと一致しません");
+        reported = true;
+    }
 }
@@ -1,16 +1,35 @@
 #pragma once
 
-#include <array>
-#include <optional>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <span>
 
+#ifdef _WIN32
 #include <Windows.h>
-#include <d3d12.h>
-#include <dxgi1_6.h>
+#endif
+
+#include "commandStream.hpp"
+#include "drawQueue.hpp"
+#include "frustumCulling.hpp"
+#include "jobSystem.hpp"
+#include "occlusionCulling.hpp"
+#include "renderBackend.hpp"
 
 class Mesh;
 
 class ShaderPipeline;
 
+struct DrawItem
+{
+    const ShaderPipeline* pipeline = nullptr;
+
+    const Mesh* mesh = nullptr;
+
+    // Mesh level of detail, see SelectLod
+    std::uint32_t lod = 0;
+};
+
 class Dx
 {
 public:
@@ -21,47 +40,132 @@ public:
         return i;
     }
 
-    bool init(HWND hwnd, int width, int height);
+#ifdef _WIN32
+    bool init(HWND hwnd, int width, int height, std::uint32_t framesInFlight = 2);
+#endif
+
+    bool init(std::unique_ptr<RenderBackend> backend, const BackendDesc& desc);
 
     bool frameBegin();
 
     bool frameEnd();
 
-    ID3D12Device* device() { return m_device; }
+    bool waitIdle();
+
+    // Call between frameEnd and frameBegin; stalls until the GPU is idle
+    bool resize(int width, int height);
+
+    RenderBackend& backend() { return *m_backend; }
+
+    // While pipeline is still compiling the fallback is bound instead, or, without a
+    // ready fallback, draws are skipped until the next setPipeline. Returns true when
+    // pipeline itself was bound.
+    bool setPipeline(const ShaderPipeline& pipeline, const ShaderPipeline* fallback = nullptr);
+
+    // lod past the mesh's last level draws the last
+    void draw(const Mesh& mesh, std::uint32_t lod = 0);
+
+    void setViewport(const Viewport& viewport) { m_commands.setViewport(viewport); }
+
+    void setScissor(const ScissorRect& scissor) { m_commands.setScissor(scissor); }
+
+    // Copies data into this frame's transient memory and binds it as cbuffer b1 for
+    // the draws that follow. False when the backend has no transient memory.
+    bool setConstants(std::span<const std::byte> data);
+
+    template<typename ConstantsType>
+    bool setConstants(const ConstantsType& constants)
+    {
+        return setConstants(std::as_bytes(std::span(&constants, 1)));
+    }
+
+    // Splits items into contiguous runs recorded on the job system, one command
+    // list each (0 picks one per thread). Items whose pipeline is not ready are skipped.
+    bool drawParallel(std::span<const DrawItem> items, std::uint32_t contextCount = 0);
+
+    JobSystem& jobs() { return *m_jobs; }
+
+    // Queued until flushDraws, which sorts by pipeline and mesh and turns each run of the
+    // same pair into one instanced draw fed from a per-frame instance buffer. Every
+    // level of detail of a mesh is a batch of its own.
+    void submit(const ShaderPipeline& pipeline, const Mesh& mesh, std::span<const std::byte> instanceData = {}, std::uint32_t lod = 0);
+
+    template<typename InstanceType>
+    void submit(const ShaderPipeline& pipeline, const Mesh& mesh, const InstanceType& instance, std::uint32_t lod = 0)
+    {
+        submit(pipeline, mesh, std::as_bytes(std::span(&instance, 1)), lod);
+    }
+
+    bool flushDraws();
+
+    // Indices of the instances in bounds that intersect frustum, ascending, culled
+    // on the job system; valid until the next call
+    std::span<const std::uint32_t> cull(const Frustum& frustum, const InstanceBoundsStore& bounds);
+
+    const CullStats& cullStats()const { return m_culler.stats(); }
 
-    void setPipeline(const ShaderPipeline& pipeline);
+    // Rasterizes occluders as seen through viewProjection into the occlusion
+    // buffer on the job system; once per frame, before cullOccluded
+    void renderOccluders(const float* viewProjection, std::span<const Occluder> occluders);
 
-    void draw(const Mesh& mesh);
+    // The candidates, usually what cull returned, whose boxes are not hidden
+    // behind the occluders; in their original order, valid until the next call
+    std::span<const std::uint32_t> cullOccluded(const InstanceBoundsStore& bounds, std::span<const std::uint32_t> candidates);
+
+    const OcclusionStats& occlusionStats()const { return m_occlusionCuller.stats(); }
+
+    const DrawQueueStats& drawQueueStats()const { return m_drawQueue.stats(); }
+
+    const CommandReplayStats& commandStats()const { return m_stateTracker.stats(); }
 
 private:
 
     Dx() = default;
 
-    ID3D12Device* m_device = nullptr;
+    // Layouts are only known when both sides were built from a VertexLayout. One
+    // compare, so it runs in every build; a mismatch skips the draw.
+    static bool LayoutsMatch(std::uint64_t pipelineLayoutId, std::uint64_t meshLayoutId)
+    {
+        return pipelineLayoutId == 0 || meshLayoutId == 0 || pipelineLayoutId == meshLayoutId;
+    }
+
+    // Logs the first mismatch after each pipeline bind instead of every skipped draw
+    static void ReportLayoutMismatch(bool& reported);
+
+    void recordDraw(const DrawIndexedDesc& desc);
+
+    // Hands everything recorded so far to the backend
+    void submitCommands();
 
-    IDXGISwapChain4* m_swapChain = nullptr;
+    std::unique_ptr<RenderBackend> m_backend;
 
-    ID3D12CommandAllocator* m_commandAllocator = nullptr;
+    std::unique_ptr<JobSystem> m_jobs;
 
-    ID3D12GraphicsCommandList* m_commandList = nullptr;
+    std::uint64_t m_currentLayoutId = 0;
 
-    ID3D12CommandQueue* m_commandQueue = nullptr;
+    bool m_layoutMismatchReported = false;
 
-    IDXGIFactory6* m_dxgiFactory = nullptr;
+    bool m_skipDraws = false;
 
-    std::array<ID3D12Resource*, 2> m_backBuffers;
+    // setPipeline and draws land here; the backend sees them at frameEnd, or earlier
+    // when something else has to run after them
+    CommandStream m_commands;
 
-    D3D12_DESCRIPTOR_HEAP_DESC  m_backBufferHD = {};
+    CommandStateTracker m_stateTracker;
 
-    D3D12_RESOURCE_BARRIER      m_backBufferBD = {};
+    // Frame time runs from one frameEnd to the next
+    std::chrono::steady_clock::time_point m_lastFrameEnd;
 
-    ID3D12DescriptorHeap* m_backBufferHeaps = nullptr;
+    DrawQueue m_drawQueue;
 
-    std::array<float, 4> m_clearColor = { 0.f,0.f,0.f,1.f };
+    // What each queued item refers to, by submission index
+    std::vector<DrawItem> m_queuedItems;
 
-    D3D12_VIEWPORT m_windowViewport = {};
+    // Only for backends without transient memory. Released when the next flush replaces
+    // it; the backend keeps it alive until the GPU is done.
+    BufferHandle m_instanceBuffer;
 
-    D3D12_RECT m_scissorRect = {};
+    FrustumCuller m_culler;
 
-    D3D12_PRIMITIVE_TOPOLOGY m_primitiveTOpology = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+    OcclusionCuller m_occlusionCuller;
 };
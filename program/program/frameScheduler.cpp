@@ -0,0 +1,72 @@
+#include <chrono>
+
+#include "frameScheduler.hpp"
+
+bool FrameScheduler::init(GpuTimeline* timeline, std::uint32_t framesInFlight)
+{
+    if (!timeline || framesInFlight < 2 || MaxFramesInFlight < framesInFlight)
+    {
+        return false;
+    }
+
+    m_timeline = timeline;
+    m_framesInFlight = framesInFlight;
+    m_contextIndex = 0;
+    m_contextFenceValues.fill(0);
+    m_lastSignaled = m_timeline->completedValue();
+    m_waitCount = 0;
+    m_lastWaitNs = 0;
+
+    return true;
+}
+
+std::optional<std::uint32_t> FrameScheduler::beginFrame()
+{
+    const std::uint64_t pending = m_contextFenceValues[m_contextIndex];
+
+    m_lastWaitNs = 0;
+
+    if (m_timeline->completedValue() < pending)
+    {
+        ++m_waitCount;
+
+        const auto waitStart = std::chrono::steady_clock::now();
+
+        const bool waited = m_timeline->wait(pending);
+
+        m_lastWaitNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - waitStart).count();
+
+        if (!waited)
+        {
+            return std::nullopt;
+        }
+    }
+
+    return m_contextIndex;
+}
+
+bool FrameScheduler::endFrame()
+{
+    const std::uint64_t value = m_lastSignaled + 1;
+
+    if (!m_timeline->signal(value))
+    {
+        return false;
+    }
+
+    m_lastSignaled = value;
+    m_contextFenceValues[m_contextIndex] = value;
+    m_contextIndex = (m_contextIndex + 1) % m_framesInFlight;
+
+    return true;
+}
+
+bool FrameScheduler::flush()
+{
+    if (m_timeline->completedValue() < m_lastSignaled)
+    {
+        return m_timeline->wait(m_lastSignaled);
+    }
+
+    return true;
+}
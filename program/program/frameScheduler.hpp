@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+class GpuTimeline
+{
+public:
+
+    virtual ~GpuTimeline() = default;
+
+    virtual bool signal(std::uint64_t value) = 0;
+
+    virtual std::uint64_t completedValue() = 0;
+
+    virtual bool wait(std::uint64_t value) = 0;
+};
+
+// Tracks which frame context the GPU may still be reading from.
+// Waits only when the context about to be reused has not retired yet.
+class FrameScheduler
+{
+public:
+
+    static constexpr std::uint32_t MaxFramesInFlight = 3;
+
+    FrameScheduler() = default;
+
+    bool init(GpuTimeline* timeline, std::uint32_t framesInFlight);
+
+    std::optional<std::uint32_t> beginFrame();
+
+    bool endFrame();
+
+    bool flush();
+
+    std::uint32_t framesInFlight()const { return m_framesInFlight; }
+
+    std::uint32_t contextIndex()const { return m_contextIndex; }
+
+    std::uint64_t submittedValue()const { return m_lastSignaled; }
+
+    std::uint64_t waitCount()const { return m_waitCount; }
+
+    // Time the last beginFrame spent blocked on the GPU, 0 when it did not wait
+    std::uint64_t lastWaitNs()const { return m_lastWaitNs; }
+
+private:
+
+    GpuTimeline* m_timeline = nullptr;
+
+    std::uint32_t m_framesInFlight = 2;
+
+    std::uint32_t m_contextIndex = 0;
+
+    std::array<std::uint64_t, MaxFramesInFlight> m_contextFenceValues = {};
+
+    std::uint64_t m_lastSignaled = 0;
+
+    std::uint64_t m_waitCount = 0;
+
+    std::uint64_t m_lastWaitNs = 0;
+};
@@ -0,0 +1,326 @@
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define FRUSTUM_CULLING_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FRUSTUM_CULLING_SSE2
+#endif
+
+#include "frustumCulling.hpp"
+#include "jobSystem.hpp"
+
+namespace
+{
+    // Planes with |normal| precomputed, laid out for broadcasting
+    struct PlaneSet
+    {
+        float nx[6];
+
+        float ny[6];
+
+        float nz[6];
+
+        float d[6];
+
+        float ax[6];
+
+        float ay[6];
+
+        float az[6];
+    };
+
+    PlaneSet MakePlaneSet(const Frustum& frustum)
+    {
+        PlaneSet set;
+
+        for (int i = 0; i < 6; ++i)
+        {
+            set.nx[i] = frustum.planes[i][0];
+            set.ny[i] = frustum.planes[i][1];
+            set.nz[i] = frustum.planes[i][2];
+            set.d[i] = frustum.planes[i][3];
+
+            set.ax[i] = std::fabs(set.nx[i]);
+            set.ay[i] = std::fabs(set.ny[i]);
+            set.az[i] = std::fabs(set.nz[i]);
+        }
+
+        return set;
+    }
+
+    bool IsVisible(const PlaneSet& planes, const InstanceBoundsStore& bounds, std::uint32_t i)
+    {
+        const float cx = bounds.centerX()[i];
+        const float cy = bounds.centerY()[i];
+        const float cz = bounds.centerZ()[i];
+
+        for (int p = 0; p < 6; ++p)
+        {
+            // Summed in the same order as the SIMD lanes so both agree exactly
+            const float distance = planes.nx[p] * cx + planes.d[p] + planes.ny[p] * cy + planes.nz[p] * cz;
+
+            // The box's extent along the normal, or the sphere's if that is smaller
+            const float boxRadius = planes.ax[p] * bounds.extentX()[i] + planes.ay[p] * bounds.extentY()[i] + planes.az[p] * bounds.extentZ()[i];
+
+            if (distance + std::min(boxRadius, bounds.radius()[i]) < 0.f)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    std::uint32_t CullRangeScalar(const PlaneSet& planes, const InstanceBoundsStore& bounds,
+        std::uint32_t begin, std::uint32_t end, std::uint32_t* visible)
+    {
+        std::uint32_t count = 0;
+
+        for (auto i = begin; i < end; ++i)
+        {
+            visible[count] = i;
+            count += IsVisible(planes, bounds, i) ? 1 : 0;
+        }
+
+        return count;
+    }
+
+    // Stores every lane's index and advances only past the visible ones, so there is no branch per instance
+    std::uint32_t Compact(std::uint32_t mask, std::uint32_t base, std::uint32_t lanes, std::uint32_t* visible)
+    {
+        std::uint32_t count = 0;
+
+        for (std::uint32_t lane = 0; lane < lanes; ++lane)
+        {
+            visible[count] = base + lane;
+            count += (mask >> lane) & 1;
+        }
+
+        return count;
+    }
+}
+
+Frustum MakeFrustum(const float* m)
+{
+    // Gribb-Hartmann: with row vectors, clip = p * M, so the planes come from M's columns
+    const auto column = [m](int c, float (&out)[4])
+    {
+        for (int row = 0; row < 4; ++row)
+        {
+            out[row] = m[row * 4 + c];
+        }
+    };
+
+    float c0[4], c1[4], c2[4], c3[4];
+    column(0, c0);
+    column(1, c1);
+    column(2, c2);
+    column(3, c3);
+
+    Frustum frustum;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        frustum.planes[0][i] = c3[i] + c0[i];
+        frustum.planes[1][i] = c3[i] - c0[i];
+        frustum.planes[2][i] = c3[i] + c1[i];
+        frustum.planes[3][i] = c3[i] - c1[i];
+        frustum.planes[4][i] = c2[i];
+        frustum.planes[5][i] = c3[i] - c2[i];
+    }
+
+    for (auto& plane : frustum.planes)
+    {
+        const float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+
+        if (0.f < length)
+        {
+            for (auto& value : plane)
+            {
+                value /= length;
+            }
+        }
+    }
+
+    return frustum;
+}
+
+void InstanceBoundsStore::reserve(std::uint32_t count)
+{
+    for (auto* values : { &m_centerX, &m_centerY, &m_centerZ, &m_extentX, &m_extentY, &m_extentZ, &m_radius })
+    {
+        values->reserve(count);
+    }
+}
+
+void InstanceBoundsStore::clear()
+{
+    for (auto* values : { &m_centerX, &m_centerY, &m_centerZ, &m_extentX, &m_extentY, &m_extentZ, &m_radius })
+    {
+        values->clear();
+    }
+}
+
+std::uint32_t InstanceBoundsStore::add(const MeshBounds& bounds)
+{
+    const auto index = size();
+
+    for (auto* values : { &m_centerX, &m_centerY, &m_centerZ, &m_extentX, &m_extentY, &m_extentZ, &m_radius })
+    {
+        values->push_back(0.f);
+    }
+
+    set(index, bounds);
+
+    return index;
+}
+
+void InstanceBoundsStore::set(std::uint32_t index, const MeshBounds& bounds)
+{
+    float center[3];
+
+    float offsetSquared = 0.f;
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        center[axis] = (bounds.box.min[axis] + bounds.box.max[axis]) * 0.5f;
+
+        const float offset = bounds.sphere.center[axis] - center[axis];
+        offsetSquared += offset * offset;
+    }
+
+    m_centerX[index] = center[0];
+    m_centerY[index] = center[1];
+    m_centerZ[index] = center[2];
+
+    m_extentX[index] = (bounds.box.max[0] - bounds.box.min[0]) * 0.5f;
+    m_extentY[index] = (bounds.box.max[1] - bounds.box.min[1]) * 0.5f;
+    m_extentZ[index] = (bounds.box.max[2] - bounds.box.min[2]) * 0.5f;
+
+    // Mesh spheres are centered on the box already; others grow to contain their own sphere
+    m_radius[index] = bounds.sphere.radius + std::sqrt(offsetSquared);
+}
+
+std::uint32_t CullInstancesScalar(const Frustum& frustum, const InstanceBoundsStore& bounds,
+    std::uint32_t begin, std::uint32_t end, std::uint32_t* visible)
+{
+    return CullRangeScalar(MakePlaneSet(frustum), bounds, begin, end, visible);
+}
+
+std::uint32_t CullInstances(const Frustum& frustum, const InstanceBoundsStore& bounds,
+    std::uint32_t begin, std::uint32_t end, std::uint32_t* visible)
+{
+    const auto planes = MakePlaneSet(frustum);
+
+    std::uint32_t count = 0;
+
+    auto i = begin;
+
+#if defined(FRUSTUM_CULLING_AVX2)
+    for (; i + 8 <= end; i += 8)
+    {
+        const __m256 cx = _mm256_loadu_ps(bounds.centerX() + i);
+        const __m256 cy = _mm256_loadu_ps(bounds.centerY() + i);
+        const __m256 cz = _mm256_loadu_ps(bounds.centerZ() + i);
+        const __m256 ex = _mm256_loadu_ps(bounds.extentX() + i);
+        const __m256 ey = _mm256_loadu_ps(bounds.extentY() + i);
+        const __m256 ez = _mm256_loadu_ps(bounds.extentZ() + i);
+        const __m256 radius = _mm256_loadu_ps(bounds.radius() + i);
+
+        __m256 outside = _mm256_setzero_ps();
+
+        for (int p = 0; p < 6; ++p)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes.nx[p]), cx), _mm256_set1_ps(planes.d[p]));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(planes.ny[p]), cy));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(planes.nz[p]), cz));
+
+            __m256 boxRadius = _mm256_mul_ps(_mm256_set1_ps(planes.ax[p]), ex);
+            boxRadius = _mm256_add_ps(boxRadius, _mm256_mul_ps(_mm256_set1_ps(planes.ay[p]), ey));
+            boxRadius = _mm256_add_ps(boxRadius, _mm256_mul_ps(_mm256_set1_ps(planes.az[p]), ez));
+
+            const __m256 reach = _mm256_add_ps(distance, _mm256_min_ps(boxRadius, radius));
+
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(reach, _mm256_setzero_ps(), _CMP_LT_OQ));
+        }
+
+        const auto mask = static_cast<std::uint32_t>(~_mm256_movemask_ps(outside)) & 0xff;
+
+        count += Compact(mask, i, 8, visible + count);
+    }
+#elif defined(FRUSTUM_CULLING_SSE2)
+    for (; i + 4 <= end; i += 4)
+    {
+        const __m128 cx = _mm_loadu_ps(bounds.centerX() + i);
+        const __m128 cy = _mm_loadu_ps(bounds.centerY() + i);
+        const __m128 cz = _mm_loadu_ps(bounds.centerZ() + i);
+        const __m128 ex = _mm_loadu_ps(bounds.extentX() + i);
+        const __m128 ey = _mm_loadu_ps(bounds.extentY() + i);
+        const __m128 ez = _mm_loadu_ps(bounds.extentZ() + i);
+        const __m128 radius = _mm_loadu_ps(bounds.radius() + i);
+
+        __m128 outside = _mm_setzero_ps();
+
+        for (int p = 0; p < 6; ++p)
+        {
+            __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes.nx[p]), cx), _mm_set1_ps(planes.d[p]));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(planes.ny[p]), cy));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(planes.nz[p]), cz));
+
+            __m128 boxRadius = _mm_mul_ps(_mm_set1_ps(planes.ax[p]), ex);
+            boxRadius = _mm_add_ps(boxRadius, _mm_mul_ps(_mm_set1_ps(planes.ay[p]), ey));
+            boxRadius = _mm_add_ps(boxRadius, _mm_mul_ps(_mm_set1_ps(planes.az[p]), ez));
+
+            const __m128 reach = _mm_add_ps(distance, _mm_min_ps(boxRadius, radius));
+
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(reach, _mm_setzero_ps()));
+        }
+
+        const auto mask = static_cast<std::uint32_t>(~_mm_movemask_ps(outside)) & 0xf;
+
+        count += Compact(mask, i, 4, visible + count);
+    }
+#endif
+
+    return count + CullRangeScalar(planes, bounds, i, end, visible + count);
+}
+
+std::span<const std::uint32_t> FrustumCuller::cull(JobSystem& jobs, const Frustum& frustum, const InstanceBoundsStore& bounds)
+{
+    const auto instanceCount = bounds.size();
+
+    const auto chunkCount = (instanceCount + ChunkSize - 1) / ChunkSize;
+
+    // Every chunk writes at its own offset, then the survivors slide down
+    m_visible.resize(instanceCount);
+    m_chunkCounts.assign(chunkCount, 0);
+
+    jobs.parallelFor(chunkCount, 1, [&](std::uint32_t begin, std::uint32_t end)
+        {
+            for (auto chunk = begin; chunk < end; ++chunk)
+            {
+                const auto first = chunk * ChunkSize;
+                const auto last = std::min(first + ChunkSize, instanceCount);
+
+                m_chunkCounts[chunk] = CullInstances(frustum, bounds, first, last, m_visible.data() + first);
+            }
+        });
+
+    std::uint32_t visibleCount = 0;
+
+    for (std::uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+    {
+        const auto first = m_visible.begin() + chunk * ChunkSize;
+
+        std::copy(first, first + m_chunkCounts[chunk], m_visible.begin() + visibleCount);
+
+        visibleCount += m_chunkCounts[chunk];
+    }
+
+    m_stats = { .instances = instanceCount, .visible = visibleCount, .chunks = chunkCount };
+
+    return std::span(m_visible).first(visibleCount);
+}
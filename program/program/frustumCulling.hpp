@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "bounds.hpp"
+
+class JobSystem;
+
+// Planes point inwards: dot(normal, p) + d >= 0 inside
+struct Frustum
+{
+    float planes[6][4] = {};
+};
+
+// viewProjection is 4x4 row-major for row vectors with D3D clip space (z in
+// [0, w]), as DirectXMath's XMFLOAT4X4 holds it. Planes are normalized.
+Frustum MakeFrustum(const float* viewProjection);
+
+// World-space bounds of many instances, one array per component so the culling
+// kernel loads eight instances at a time. Each instance is a box given by
+// center and half extents plus a sphere radius around the same center.
+class InstanceBoundsStore
+{
+public:
+
+    InstanceBoundsStore() = default;
+
+    void reserve(std::uint32_t count);
+
+    void clear();
+
+    // Returns the instance index; bounds are in world space, see TransformBounds
+    std::uint32_t add(const MeshBounds& bounds);
+
+    void set(std::uint32_t index, const MeshBounds& bounds);
+
+    std::uint32_t size()const { return static_cast<std::uint32_t>(m_centerX.size()); }
+
+    const float* centerX()const { return m_centerX.data(); }
+
+    const float* centerY()const { return m_centerY.data(); }
+
+    const float* centerZ()const { return m_centerZ.data(); }
+
+    const float* extentX()const { return m_extentX.data(); }
+
+    const float* extentY()const { return m_extentY.data(); }
+
+    const float* extentZ()const { return m_extentZ.data(); }
+
+    const float* radius()const { return m_radius.data(); }
+
+private:
+
+    std::vector<float> m_centerX;
+
+    std::vector<float> m_centerY;
+
+    std::vector<float> m_centerZ;
+
+    std::vector<float> m_extentX;
+
+    std::vector<float> m_extentY;
+
+    std::vector<float> m_extentZ;
+
+    std::vector<float> m_radius;
+};
+
+// Writes the indices of the instances in [begin, end) that may be inside the
+// frustum to visible, ascending, and returns how many; visible needs room for
+// end - begin. Eight at a time with AVX2, four with SSE2, scalar otherwise.
+std::uint32_t CullInstances(const Frustum& frustum, const InstanceBoundsStore& bounds,
+    std::uint32_t begin, std::uint32_t end, std::uint32_t* visible);
+
+// One instance at a time; the reference CullInstances must agree with
+std::uint32_t CullInstancesScalar(const Frustum& frustum, const InstanceBoundsStore& bounds,
+    std::uint32_t begin, std::uint32_t end, std::uint32_t* visible);
+
+struct CullStats
+{
+    std::uint32_t instances = 0;
+
+    std::uint32_t visible = 0;
+
+    std::uint32_t chunks = 0;
+};
+
+// Culls in chunks spread over the job system and packs the survivors into one
+// ascending list, so the result does not depend on the thread count
+class FrustumCuller
+{
+public:
+
+    static constexpr std::uint32_t ChunkSize = 4096;
+
+    FrustumCuller() = default;
+
+    // Valid until the next call
+    std::span<const std::uint32_t> cull(JobSystem& jobs, const Frustum& frustum, const InstanceBoundsStore& bounds);
+
+    const CullStats& stats()const { return m_stats; }
+
+private:
+
+    std::vector<std::uint32_t> m_visible;
+
+    std::vector<std::uint32_t> m_chunkCounts;
+
+    CullStats m_stats;
+};
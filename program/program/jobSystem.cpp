@@ -0,0 +1,427 @@
+#include <algorithm>
+#include <bit>
+#include <utility>
+
+#include "jobSystem.hpp"
+#include "profiler.hpp"
+
+struct Job
+{
+    std::function<void()> func;
+
+    // One for the handle returned by schedule, one per queue or dependency list holding it
+    std::atomic<std::uint32_t> references = 1;
+
+    // Unfinished dependencies, plus one released once scheduling is complete
+    std::atomic<std::int32_t> pending = 1;
+
+    std::atomic<bool> done = false;
+
+    std::mutex mutex;
+
+    std::vector<Job*> dependents;
+};
+
+namespace
+{
+    constexpr std::uint32_t NoDeque = ~0u;
+
+    struct ThreadDeque
+    {
+        const JobSystem* system = nullptr;
+
+        std::uint32_t index = NoDeque;
+    };
+
+    // The systems this thread owns a deque of, newest last. Usually one, but a
+    // second system created on a thread must not take the first one's deque.
+    thread_local std::vector<ThreadDeque> t_deques;
+
+    void AddReference(Job* job)
+    {
+        job->references.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Release(Job* job)
+    {
+        if (job->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            delete job;
+        }
+    }
+}
+
+JobHandle::JobHandle(const JobHandle& other)
+    : m_job(other.m_job)
+{
+    if (m_job)
+    {
+        AddReference(m_job);
+    }
+}
+
+JobHandle::JobHandle(JobHandle&& other) noexcept
+    : m_job(std::exchange(other.m_job, nullptr))
+{}
+
+JobHandle& JobHandle::operator=(JobHandle other) noexcept
+{
+    std::swap(m_job, other.m_job);
+    return *this;
+}
+
+JobHandle::~JobHandle()
+{
+    if (m_job)
+    {
+        Release(m_job);
+    }
+}
+
+bool JobHandle::done()const
+{
+    return !m_job || m_job->done.load(std::memory_order_acquire);
+}
+
+WorkStealingDeque::WorkStealingDeque(std::uint32_t capacity)
+    : m_buffer(std::bit_ceil(capacity))
+    , m_mask(static_cast<std::int64_t>(m_buffer.size()) - 1)
+{}
+
+bool WorkStealingDeque::push(Job* job)
+{
+    const auto bottom = m_bottom.load(std::memory_order_relaxed);
+    const auto top = m_top.load(std::memory_order_acquire);
+
+    if (m_mask < bottom - top)
+    {
+        return false;
+    }
+
+    m_buffer[bottom & m_mask].store(job, std::memory_order_relaxed);
+    m_bottom.store(bottom + 1, std::memory_order_release);
+
+    return true;
+}
+
+Job* WorkStealingDeque::pop()
+{
+    const auto bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+
+    m_bottom.store(bottom, std::memory_order_seq_cst);
+
+    auto top = m_top.load(std::memory_order_seq_cst);
+
+    if (bottom < top)
+    {
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* job = m_buffer[bottom & m_mask].load(std::memory_order_relaxed);
+
+    // Last element: race the thieves for it
+    if (top == bottom)
+    {
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            job = nullptr;
+        }
+
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    return job;
+}
+
+Job* WorkStealingDeque::steal()
+{
+    auto top = m_top.load(std::memory_order_seq_cst);
+    const auto bottom = m_bottom.load(std::memory_order_seq_cst);
+
+    if (bottom <= top)
+    {
+        return nullptr;
+    }
+
+    Job* job = m_buffer[top & m_mask].load(std::memory_order_relaxed);
+
+    if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+        return nullptr;
+    }
+
+    return job;
+}
+
+JobSystem::JobSystem(std::uint32_t threadCount)
+{
+    const std::uint32_t workerCount = 1 < threadCount ? threadCount - 1 : 0;
+
+    for (std::uint32_t i = 0; i <= workerCount; ++i)
+    {
+        m_deques.push_back(std::make_unique<WorkStealingDeque>(DequeCapacity));
+    }
+
+    t_deques.push_back({ .system = this, .index = 0 });
+
+    for (std::uint32_t i = 0; i < workerCount; ++i)
+    {
+        m_workers.emplace_back([this, i] { workerLoop(i + 1); });
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard lock(m_sleepMutex);
+        m_stop = true;
+    }
+
+    m_wake.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+
+    std::erase_if(t_deques, [this](const ThreadDeque& deque) { return deque.system == this; });
+}
+
+JobHandle JobSystem::schedule(std::function<void()> func, std::span<const JobHandle> dependencies)
+{
+    auto* job = new Job;
+    job->func = std::move(func);
+
+    for (const auto& dependency : dependencies)
+    {
+        Job* parent = dependency.m_job;
+
+        if (!parent)
+        {
+            continue;
+        }
+
+        std::lock_guard lock(parent->mutex);
+
+        if (!parent->done.load(std::memory_order_relaxed))
+        {
+            AddReference(job);
+            job->pending.fetch_add(1, std::memory_order_relaxed);
+            parent->dependents.push_back(job);
+        }
+    }
+
+    JobHandle handle(job);
+
+    if (job->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        AddReference(job);
+        enqueue(job);
+    }
+
+    return handle;
+}
+
+void JobSystem::wait(const JobHandle& job)
+{
+    const std::uint32_t index = currentIndex();
+
+    while (!job.done())
+    {
+        if (Job* next = findJob(index))
+        {
+            execute(next);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::parallelFor(std::uint32_t count, std::uint32_t grainSize, const std::function<void(std::uint32_t, std::uint32_t)>& func)
+{
+    grainSize = std::max(grainSize, 1u);
+
+    if (count <= grainSize || m_workers.empty())
+    {
+        if (0 < count)
+        {
+            func(0, count);
+        }
+
+        return;
+    }
+
+    std::vector<JobHandle> ranges;
+    ranges.reserve((count + grainSize - 1) / grainSize);
+
+    // The last range runs on this thread, the rest are up for stealing
+    std::uint32_t begin = 0;
+
+    for (; begin + grainSize < count; begin += grainSize)
+    {
+        ranges.push_back(schedule([&func, begin, grainSize] { func(begin, begin + grainSize); }));
+    }
+
+    func(begin, count);
+
+    for (auto it = ranges.rbegin(); it != ranges.rend(); ++it)
+    {
+        wait(*it);
+    }
+}
+
+JobSystemStats JobSystem::stats()const
+{
+    return
+    {
+        .executed = m_executed.load(std::memory_order_relaxed),
+        .stolen = m_stolen.load(std::memory_order_relaxed),
+        .shared = m_shared.load(std::memory_order_relaxed),
+    };
+}
+
+void JobSystem::workerLoop(std::uint32_t index)
+{
+    t_deques.push_back({ .system = this, .index = index });
+
+    ProfileThreadName("Job worker " + std::to_string(index));
+
+    while (!m_stop.load(std::memory_order_relaxed))
+    {
+        if (Job* job = findJob(index))
+        {
+            execute(job);
+            continue;
+        }
+
+        std::unique_lock lock(m_sleepMutex);
+
+        ++m_sleepers;
+        m_wake.wait(lock, [this] { return m_stop.load(std::memory_order_relaxed) || 0 < m_queuedJobs.load(); });
+        --m_sleepers;
+    }
+}
+
+void JobSystem::enqueue(Job* job)
+{
+    m_queuedJobs.fetch_add(1);
+
+    const std::uint32_t index = currentIndex();
+
+    if (index == NoDeque || !m_deques[index]->push(job))
+    {
+        std::lock_guard lock(m_sharedMutex);
+        m_sharedJobs.push_back(job);
+        m_sharedCount.fetch_add(1, std::memory_order_release);
+        m_shared.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Taking the lock orders this against a worker that is checking m_queuedJobs before sleeping
+    if (0 < m_sleepers.load())
+    {
+        std::lock_guard lock(m_sleepMutex);
+        m_wake.notify_one();
+    }
+}
+
+Job* JobSystem::findJob(std::uint32_t index)
+{
+    const auto take = [this](Job* job)
+    {
+        if (job)
+        {
+            m_queuedJobs.fetch_sub(1);
+        }
+
+        return job;
+    };
+
+    if (index != NoDeque)
+    {
+        if (Job* job = m_deques[index]->pop())
+        {
+            return take(job);
+        }
+    }
+
+    // Checked without the lock first so idle workers do not contend on it
+    if (0 < m_sharedCount.load(std::memory_order_acquire))
+    {
+        std::lock_guard lock(m_sharedMutex);
+
+        if (!m_sharedJobs.empty())
+        {
+            Job* job = m_sharedJobs.front();
+            m_sharedJobs.pop_front();
+            m_sharedCount.fetch_sub(1, std::memory_order_relaxed);
+            return take(job);
+        }
+    }
+
+    const auto dequeCount = static_cast<std::uint32_t>(m_deques.size());
+    const std::uint32_t start = index == NoDeque ? 0 : index + 1;
+
+    for (std::uint32_t i = 0; i < dequeCount; ++i)
+    {
+        const std::uint32_t victim = (start + i) % dequeCount;
+
+        if (victim == index)
+        {
+            continue;
+        }
+
+        if (Job* job = m_deques[victim]->steal())
+        {
+            m_stolen.fetch_add(1, std::memory_order_relaxed);
+            return take(job);
+        }
+    }
+
+    return nullptr;
+}
+
+void JobSystem::execute(Job* job)
+{
+    job->func();
+
+    std::vector<Job*> dependents;
+
+    {
+        std::lock_guard lock(job->mutex);
+        job->done.store(true, std::memory_order_release);
+        dependents.swap(job->dependents);
+    }
+
+    for (Job* dependent : dependents)
+    {
+        // The dependency list's reference becomes the queue's reference
+        if (dependent->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            enqueue(dependent);
+        }
+        else
+        {
+            Release(dependent);
+        }
+    }
+
+    m_executed.fetch_add(1, std::memory_order_relaxed);
+
+    Release(job);
+}
+
+std::uint32_t JobSystem::currentIndex()const
+{
+    for (auto deque = t_deques.rbegin(); deque != t_deques.rend(); ++deque)
+    {
+        if (deque->system == this)
+        {
+            return deque->index;
+        }
+    }
+
+    return NoDeque;
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+
+struct Job;
+
+class JobHandle
+{
+public:
+
+    JobHandle() = default;
+
+    JobHandle(const JobHandle& other);
+
+    JobHandle(JobHandle&& other) noexcept;
+
+    JobHandle& operator=(JobHandle other) noexcept;
+
+    ~JobHandle();
+
+    explicit operator bool()const { return m_job != nullptr; }
+
+    bool done()const;
+
+private:
+
+    friend class JobSystem;
+
+    explicit JobHandle(Job* job) : m_job(job) {}
+
+    Job* m_job = nullptr;
+};
+
+struct JobSystemStats
+{
+    std::uint64_t executed = 0;
+
+    std::uint64_t stolen = 0;
+
+    // Scheduled from a thread without a deque of this system, or onto a full one
+    std::uint64_t shared = 0;
+};
+
+// Chase-Lev deque: the owning thread pushes and pops at the bottom, every
+// other thread steals from the top. Capacity is fixed; push fails when full.
+class WorkStealingDeque
+{
+public:
+
+    explicit WorkStealingDeque(std::uint32_t capacity);
+
+    bool push(Job* job);
+
+    Job* pop();
+
+    Job* steal();
+
+private:
+
+    std::vector<std::atomic<Job*>> m_buffer;
+
+    std::int64_t m_mask = 0;
+
+    alignas(64) std::atomic<std::int64_t> m_top = 0;
+
+    alignas(64) std::atomic<std::int64_t> m_bottom = 0;
+};
+
+// Work-stealing scheduler. The thread that creates the system owns deque 0
+// and every worker owns one more; jobs scheduled from any other thread go
+// through a shared queue. Waiting threads run other jobs instead of blocking.
+// A thread may create several systems; each must be destroyed on the thread
+// that created it.
+class JobSystem
+{
+public:
+
+    static constexpr std::uint32_t DequeCapacity = 4096;
+
+    explicit JobSystem(std::uint32_t threadCount = std::thread::hardware_concurrency());
+
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // func runs once every dependency has finished
+    JobHandle schedule(std::function<void()> func, std::span<const JobHandle> dependencies = {});
+
+    void wait(const JobHandle& job);
+
+    // Splits [0, count) into ranges of at most grainSize and returns when all ran
+    void parallelFor(std::uint32_t count, std::uint32_t grainSize, const std::function<void(std::uint32_t begin, std::uint32_t end)>& func);
+
+    std::uint32_t threadCount()const { return static_cast<std::uint32_t>(m_workers.size()) + 1; }
+
+    JobSystemStats stats()const;
+
+private:
+
+    void workerLoop(std::uint32_t index);
+
+    void enqueue(Job* job);
+
+    Job* findJob(std::uint32_t index);
+
+    void execute(Job* job);
+
+    std::uint32_t currentIndex()const;
+
+    std::vector<std::unique_ptr<WorkStealingDeque>> m_deques;
+
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_sharedMutex;
+
+    std::deque<Job*> m_sharedJobs;
+
+    std::atomic<std::uint32_t> m_sharedCount = 0;
+
+    std::mutex m_sleepMutex;
+
+    std::condition_variable m_wake;
+
+    std::atomic<std::int64_t> m_queuedJobs = 0;
+
+    std::atomic<std::uint32_t> m_sleepers = 0;
+
+    std::atomic<std::uint64_t> m_executed = 0;
+
+    std::atomic<std::uint64_t> m_stolen = 0;
+
+    std::atomic<std::uint64_t> m_shared = 0;
+
+    std::atomic<bool> m_stop = false;
+};
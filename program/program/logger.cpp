@@ -0,0 +1,510 @@
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+
+#include "logger.hpp"
+
+namespace
+{
+    constexpr char BinaryMagic[4] = { 'B', 'L', 'O', 'G' };
+
+    constexpr std::uint32_t BinaryVersion = 1;
+
+    enum class RecordType : std::uint8_t
+    {
+        Site = 1,
+        Message = 2,
+    };
+
+    std::atomic<std::uint32_t> s_nextThreadId = 0;
+
+    std::uint32_t CurrentThreadId()
+    {
+        thread_local const std::uint32_t id = s_nextThreadId.fetch_add(1, std::memory_order_relaxed);
+        return id;
+    }
+
+    std::string_view FileName(std::string_view path)
+    {
+        const auto separator = path.find_last_of("\\/");
+        return separator == std::string_view::npos ? path : path.substr(separator + 1);
+    }
+
+    const char* LevelTag(LogLevel level)
+    {
+        return level == LogLevel::Error ? "[ERROR] |> " : "[LOG]   |> ";
+    }
+
+    void AppendUtf8(std::string& output, std::wstring_view text)
+    {
+        for (std::size_t i = 0; i < text.size(); ++i)
+        {
+            auto code = static_cast<std::uint32_t>(text[i]);
+
+            // UTF-16 surrogate pairs, where wchar_t is 16 bits
+            if (0xd800 <= code && code < 0xdc00 && i + 1 < text.size())
+            {
+                const auto low = static_cast<std::uint32_t>(text[i + 1]);
+
+                if (0xdc00 <= low && low < 0xe000)
+                {
+                    code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                    ++i;
+                }
+            }
+
+            if (code < 0x80)
+            {
+                output += static_cast<char>(code);
+            }
+            else if (code < 0x800)
+            {
+                output += static_cast<char>(0xc0 | code >> 6);
+                output += static_cast<char>(0x80 | (code & 0x3f));
+            }
+            else if (code < 0x10000)
+            {
+                output += static_cast<char>(0xe0 | code >> 12);
+                output += static_cast<char>(0x80 | (code >> 6 & 0x3f));
+                output += static_cast<char>(0x80 | (code & 0x3f));
+            }
+            else
+            {
+                output += static_cast<char>(0xf0 | code >> 18);
+                output += static_cast<char>(0x80 | (code >> 12 & 0x3f));
+                output += static_cast<char>(0x80 | (code >> 6 & 0x3f));
+                output += static_cast<char>(0x80 | (code & 0x3f));
+            }
+        }
+    }
+
+    // One entry in the format Log() has always written: continuation lines are indented under the tag
+    void AppendLine(std::string& output, LogLevel level, std::string_view fileName, std::uint32_t line, std::string_view message)
+    {
+        output += LevelTag(level);
+        output += fileName;
+        output += '(';
+        output += std::to_string(line);
+        output += ") : ";
+
+        for (const char c : message)
+        {
+            output += c;
+
+            if (c == '\n')
+            {
+                output += "        |> ";
+            }
+        }
+
+        output += '\n';
+    }
+
+    template<typename T>
+    void Append(std::string& output, const T& value)
+    {
+        output.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    bool Read(std::string_view& input, T& value)
+    {
+        if (input.size() < sizeof(T))
+        {
+            return false;
+        }
+
+        std::memcpy(&value, input.data(), sizeof(T));
+        input.remove_prefix(sizeof(T));
+
+        return true;
+    }
+}
+
+Logger::Logger()
+    : m_slots(SlotCount)
+    , m_startTime(std::chrono::steady_clock::now())
+{
+    static_assert((SlotCount & (SlotCount - 1)) == 0, "SlotCount must be a power of two");
+
+    for (std::uint32_t i = 0; i < SlotCount; ++i)
+    {
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    m_writer = std::thread([this] { writerLoop(); });
+}
+
+Logger::~Logger()
+{
+    m_stop.store(true);
+
+    m_wakeSignal.fetch_add(1);
+    m_wakeSignal.notify_one();
+
+    m_writer.join();
+}
+
+bool Logger::open(const std::filesystem::path& path, LogFormat format)
+{
+    flush();
+
+    std::lock_guard lock(m_fileMutex);
+
+    m_file.close();
+    m_file.open(path, std::ios::binary | std::ios::trunc);
+
+    m_format = format;
+    m_siteIds.clear();
+
+    if (format == LogFormat::Binary)
+    {
+        m_file.write(BinaryMagic, sizeof(BinaryMagic));
+        m_file.write(reinterpret_cast<const char*>(&BinaryVersion), sizeof(BinaryVersion));
+    }
+
+    return m_file.good();
+}
+
+void Logger::write(const LogSite& site, std::wstring_view message)
+{
+    auto position = m_enqueuePosition.load(std::memory_order_relaxed);
+
+    Slot* slot = nullptr;
+
+    // Bounded MPMC ring: a slot is free for position when its sequence equals position
+    for (;;)
+    {
+        slot = &m_slots[position & (SlotCount - 1)];
+
+        const auto difference = static_cast<std::int64_t>(slot->sequence.load(std::memory_order_acquire) - position);
+
+        if (difference == 0)
+        {
+            if (m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (difference < 0)
+        {
+            if (site.level != LogLevel::Error)
+            {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            m_wakeSignal.fetch_add(1);
+            m_wakeSignal.notify_one();
+
+            std::this_thread::yield();
+
+            position = m_enqueuePosition.load(std::memory_order_relaxed);
+        }
+        else
+        {
+            position = m_enqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->site = site;
+    slot->timestamp = now();
+    slot->threadId = CurrentThreadId();
+    slot->length = static_cast<std::uint32_t>(message.size());
+
+    if (message.size() <= InlineLength)
+    {
+        message.copy(slot->text.data(), message.size());
+    }
+    else
+    {
+        slot->spill = new wchar_t[message.size()];
+        message.copy(slot->spill, message.size());
+
+        m_spilled.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // seq_cst pairs with the writer announcing that it sleeps: one of the two sees the other
+    slot->sequence.store(position + 1);
+
+    if (m_writerSleeping.load())
+    {
+        m_wakeSignal.fetch_add(1);
+        m_wakeSignal.notify_one();
+    }
+}
+
+void Logger::flush()
+{
+    const auto target = m_enqueuePosition.load();
+
+    m_wakeSignal.fetch_add(1);
+    m_wakeSignal.notify_one();
+
+    for (auto written = m_writtenPosition.load(); written < target; written = m_writtenPosition.load())
+    {
+        m_writtenPosition.wait(written);
+    }
+}
+
+LoggerStats Logger::stats()const
+{
+    return
+    {
+        .written = m_writtenPosition.load(std::memory_order_relaxed),
+        .dropped = m_dropped.load(std::memory_order_relaxed),
+        .spilled = m_spilled.load(std::memory_order_relaxed),
+    };
+}
+
+void Logger::writerLoop()
+{
+    for (;;)
+    {
+        {
+            std::lock_guard lock(m_fileMutex);
+
+            const auto taken = drain();
+
+            // A pass that took nothing may still have reported drops
+            if (!m_buffer.empty())
+            {
+                flushBuffer();
+            }
+
+            if (0 < taken)
+            {
+                continue;
+            }
+        }
+
+        // Read before m_stop so a stop or message announced after this wakes the wait below
+        const auto signal = m_wakeSignal.load();
+
+        if (m_stop.load())
+        {
+            break;
+        }
+
+        m_writerSleeping.store(true);
+
+        const auto position = m_dequeuePosition.load(std::memory_order_relaxed);
+
+        if (m_slots[position & (SlotCount - 1)].sequence.load() != position + 1)
+        {
+            m_wakeSignal.wait(signal);
+        }
+
+        m_writerSleeping.store(false);
+    }
+
+    std::lock_guard lock(m_fileMutex);
+
+    drain();
+    flushBuffer();
+}
+
+std::uint64_t Logger::drain()
+{
+    auto position = m_dequeuePosition.load(std::memory_order_relaxed);
+    const auto start = position;
+
+    for (;; ++position)
+    {
+        auto& slot = m_slots[position & (SlotCount - 1)];
+
+        if (slot.sequence.load(std::memory_order_acquire) != position + 1)
+        {
+            break;
+        }
+
+        const std::wstring_view message(slot.spill ? slot.spill : slot.text.data(), slot.length);
+
+        format(slot.site, slot.threadId, slot.timestamp, message);
+
+        delete[] slot.spill;
+        slot.spill = nullptr;
+
+        slot.sequence.store(position + SlotCount, std::memory_order_release);
+    }
+
+    m_dequeuePosition.store(position, std::memory_order_relaxed);
+
+    if (const auto dropped = m_dropped.load(std::memory_order_relaxed); m_reportedDrops < dropped)
+    {
+        format({ LogLevel::Error, __FILE__, __LINE__ }, CurrentThreadId(), now(),
+            L"ログのリングバッファが満杯のため " + std::to_wstring(dropped - m_reportedDrops) + L" 件のメッセージを破棄しました");
+
+        m_reportedDrops = dropped;
+    }
+
+    return position - start;
+}
+
+void Logger::format(const LogSite& site, std::uint32_t threadId, std::uint64_t timestamp, std::wstring_view message)
+{
+    if (m_format == LogFormat::Binary)
+    {
+        formatBinary(site, threadId, timestamp, message);
+    }
+    else
+    {
+        formatText(site, message);
+    }
+}
+
+void Logger::formatText(const LogSite& site, std::wstring_view message)
+{
+    std::string utf8;
+    AppendUtf8(utf8, message);
+
+    AppendLine(m_buffer, site.level, FileName(site.file), site.line, utf8);
+}
+
+void Logger::formatBinary(const LogSite& site, std::uint32_t threadId, std::uint64_t timestamp, std::wstring_view message)
+{
+    const auto [id, inserted] = m_siteIds.try_emplace({ site.file, site.line }, static_cast<std::uint32_t>(m_siteIds.size()));
+
+    if (inserted)
+    {
+        const auto fileName = FileName(site.file);
+
+        Append(m_buffer, RecordType::Site);
+        Append(m_buffer, id->second);
+        Append(m_buffer, site.level);
+        Append(m_buffer, site.line);
+        Append(m_buffer, static_cast<std::uint16_t>(fileName.size()));
+        m_buffer += fileName;
+    }
+
+    const auto lengthOffset = m_buffer.size() + sizeof(RecordType) + sizeof(std::uint32_t) * 2 + sizeof(std::uint64_t);
+
+    Append(m_buffer, RecordType::Message);
+    Append(m_buffer, id->second);
+    Append(m_buffer, threadId);
+    Append(m_buffer, timestamp);
+    Append(m_buffer, std::uint32_t{ 0 });
+
+    const auto messageStart = m_buffer.size();
+
+    AppendUtf8(m_buffer, message);
+
+    const auto length = static_cast<std::uint32_t>(m_buffer.size() - messageStart);
+    std::memcpy(m_buffer.data() + lengthOffset, &length, sizeof(length));
+}
+
+std::uint64_t Logger::now()const
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_startTime).count());
+}
+
+void Logger::flushBuffer()
+{
+    if (!m_buffer.empty())
+    {
+        if (!m_file.is_open())
+        {
+            m_file.open(GetLogFileName(), std::ios::binary | std::ios::app);
+        }
+
+        m_file.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+        m_file.flush();
+
+        m_buffer.clear();
+    }
+
+    m_writtenPosition.store(m_dequeuePosition.load(std::memory_order_relaxed));
+    m_writtenPosition.notify_all();
+}
+
+bool DecodeBinaryLog(const std::filesystem::path& path, std::ostream& output)
+{
+    std::ifstream file(path, std::ios::binary);
+
+    if (!file)
+    {
+        return false;
+    }
+
+    const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    std::string_view input = data;
+
+    char magic[sizeof(BinaryMagic)] = {};
+    std::uint32_t version = 0;
+
+    if (!Read(input, magic) || std::memcmp(magic, BinaryMagic, sizeof(magic)) != 0 ||
+        !Read(input, version) || version != BinaryVersion)
+    {
+        return false;
+    }
+
+    struct Site
+    {
+        LogLevel level = LogLevel::Debug;
+
+        std::uint32_t line = 0;
+
+        std::string fileName;
+    };
+
+    std::vector<Site> sites;
+
+    std::string text;
+
+    // A process that died mid-write leaves a partial last record, which is ignored
+    for (RecordType type; Read(input, type);)
+    {
+        if (type == RecordType::Site)
+        {
+            std::uint32_t id = 0;
+            Site site;
+            std::uint16_t length = 0;
+
+            if (!Read(input, id) || !Read(input, site.level) || !Read(input, site.line) || !Read(input, length) || input.size() < length)
+            {
+                break;
+            }
+
+            site.fileName = input.substr(0, length);
+            input.remove_prefix(length);
+
+            if (sites.size() <= id)
+            {
+                sites.resize(id + 1);
+            }
+
+            sites[id] = std::move(site);
+        }
+        else if (type == RecordType::Message)
+        {
+            std::uint32_t siteId = 0;
+            std::uint32_t threadId = 0;
+            std::uint64_t timestamp = 0;
+            std::uint32_t length = 0;
+
+            if (!Read(input, siteId) || !Read(input, threadId) || !Read(input, timestamp) || !Read(input, length) || input.size() < length)
+            {
+                break;
+            }
+
+            const Site unknown = { .fileName = "?" };
+            const Site& site = siteId < sites.size() ? sites[siteId] : unknown;
+
+            char prefix[64];
+            std::snprintf(prefix, sizeof(prefix), "%12.3f ms  thread %-3u ", static_cast<double>(timestamp) / 1e6, threadId);
+
+            text = prefix;
+            AppendLine(text, site.level, site.fileName, site.line, input.substr(0, length));
+            input.remove_prefix(length);
+
+            output << text;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return static_cast<bool>(output);
+}
@@ -1,47 +1,191 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iosfwd>
+#include <map>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
 
-#include <fstream>
-#include <regex>
+enum class LogLevel : std::uint8_t
+{
+    Error,
+    Debug,
+};
 
-#ifdef OUTPUT_LOG
+enum class LogFormat
+{
+    // The same lines Log() used to write, UTF-8
+    Text,
+
+    // Call sites written once, then only site id, thread, time and message; see DecodeBinaryLog
+    Binary,
+};
 
-#define M_FileName		(strrchr(__FILE__, '\\') ? strrchr(__FILE__, '\\') + 1 : __FILE__)
-#define M_FileNameW		(wcsrchr(__FILEW__, L'\\') ? wcsrchr(__FILEW__, L'\\') + 1 : __FILEW__)
+// Where a message came from. file is the __FILE__ literal, so taking it costs
+// nothing; the name is only cut out of the path when the line is written.
+struct LogSite
+{
+    LogLevel level = LogLevel::Debug;
 
-#define FileDesc		(std::wstring(M_FileName) + L"(" + std::to_wstring(__LINE__) + L") : ")
-#define FileDescW		(std::wstring(M_FileNameW) + L"(" + std::to_wstring(__LINE__) + L") : ")
+    const char* file = "";
 
-#define ErrorTagW	(L"[ERROR] |> ")
-#define LogTagW		(L"[LOG]   |> ")
+    std::uint32_t line = 0;
+};
 
-inline std::string GetLogFileName()
+struct LoggerStats
 {
-    return "log.txt";
-}
+    std::uint64_t written = 0;
+
+    // Messages lost because the ring was full
+    std::uint64_t dropped = 0;
+
+    // Messages too long for a slot, copied to the heap instead
+    std::uint64_t spilled = 0;
+};
 
-inline void Log(const std::wstring& str)
+// Producers copy the message into a slot of a bounded lock-free ring and return;
+// a writer thread formats the slots and appends them to a file that stays open.
+// When the ring is full a debug message is dropped rather than stalling the
+// caller, while an error waits for room. Drops are reported in the log.
+class Logger
 {
-    std::wofstream ofs(GetLogFileName(), std::ios::app);
+public:
+
+    static constexpr std::uint32_t SlotCount = 4096;
+
+    // Characters stored in the slot itself
+    static constexpr std::size_t InlineLength = 100;
+
+    static Logger& instance()
+    {
+        static Logger i;
+        return i;
+    }
+
+    Logger(const Logger&) = delete;
+
+    Logger& operator=(const Logger&) = delete;
+
+    // Truncates path and writes everything from here on to it. Without a call
+    // the writer appends text to GetLogFileName().
+    bool open(const std::filesystem::path& path, LogFormat format = LogFormat::Text);
+
+    void write(const LogSite& site, std::wstring_view message);
+
+    // Returns once every message written before the call is in the file
+    void flush();
+
+    LoggerStats stats()const;
+
+private:
+
+    struct Slot
+    {
+        std::atomic<std::uint64_t> sequence = 0;
+
+        LogSite site;
+
+        std::uint64_t timestamp = 0;
+
+        std::uint32_t threadId = 0;
+
+        std::uint32_t length = 0;
+
+        // Owned by the slot when the message did not fit in text
+        wchar_t* spill = nullptr;
+
+        std::array<wchar_t, InlineLength> text = {};
+    };
+
+    Logger();
+
+    ~Logger();
+
+    void writerLoop();
 
-    std::wregex regex(L"\n");
-    ofs << std::regex_replace(str, regex, L"\n        |> ") << L"\n";
-    ofs.close();
+    // Formats every published slot into m_buffer, then a line for messages
+    // dropped since the last report; returns how many slots it took
+    std::uint64_t drain();
+
+    void format(const LogSite& site, std::uint32_t threadId, std::uint64_t timestamp, std::wstring_view message);
+
+    void formatText(const LogSite& site, std::wstring_view message);
+
+    void formatBinary(const LogSite& site, std::uint32_t threadId, std::uint64_t timestamp, std::wstring_view message);
+
+    std::uint64_t now()const;
+
+    void flushBuffer();
+
+    std::vector<Slot> m_slots;
+
+    alignas(64) std::atomic<std::uint64_t> m_enqueuePosition = 0;
+
+    alignas(64) std::atomic<std::uint64_t> m_dequeuePosition = 0;
+
+    // Positions below this are in the file; flush waits on it
+    std::atomic<std::uint64_t> m_writtenPosition = 0;
+
+    std::atomic<std::uint32_t> m_wakeSignal = 0;
+
+    std::atomic<bool> m_writerSleeping = false;
+
+    std::atomic<bool> m_stop = false;
+
+    std::atomic<std::uint64_t> m_dropped = 0;
+
+    // Drops already reported in the log
+    std::uint64_t m_reportedDrops = 0;
+
+    std::atomic<std::uint64_t> m_spilled = 0;
+
+    // Guards the file between the writer and open
+    std::mutex m_fileMutex;
+
+    std::ofstream m_file;
+
+    LogFormat m_format = LogFormat::Text;
+
+    std::string m_buffer;
+
+    // Binary mode: ids of the call sites already written to the file
+    std::map<std::pair<const char*, std::uint32_t>, std::uint32_t> m_siteIds;
+
+    std::chrono::steady_clock::time_point m_startTime;
+
+    std::thread m_writer;
+};
+
+// Turns a LogFormat::Binary file back into the text format, with each line
+// prefixed by its time since the logger started and the writing thread.
+bool DecodeBinaryLog(const std::filesystem::path& path, std::ostream& output);
+
+inline std::string GetLogFileName()
+{
+    return "log.txt";
 }
 
+#ifdef OUTPUT_LOG
+
 inline void ClearLog()
 {
-    std::wofstream ofs(GetLogFileName());
-    ofs.close();
+    Logger::instance().open(GetLogFileName());
 }
 
-#define ErrorLog(message) (Log(std::wstring() + ErrorTagW + FileDescW + message))
-#define DebugLog(message) (Log(std::wstring() + LogTagW + FileDescW  + message))
+#define ErrorLog(message) (Logger::instance().write({ LogLevel::Error, __FILE__, __LINE__ }, (message)))
+#define DebugLog(message) (Logger::instance().write({ LogLevel::Debug, __FILE__, __LINE__ }, (message)))
 
 #else
 
-inline void Log(const std::wstring& str) {}
 inline void ClearLog() {}
 
 #define ErrorLog(message)
@@ -49,6 +193,8 @@ inline void ClearLog() {}
 
 #endif
 
+#ifdef _WIN32
+
 #include <comdef.h>
 
 inline std::wstring ErrorMessage(HRESULT result)
@@ -75,3 +221,5 @@ inline std::wstring ErrorMessage(HRESULT result)
         return std::nullopt;\
     }\
 }
+
+#endif
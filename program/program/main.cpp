@@ -4,61 +4,90 @@
 #include "window.hpp"
 #include "dx.hpp"
 #include "mesh.hpp"
+#include "profiler.hpp"
+#include "renderThread.hpp"
 #include "shaderPipeline.hpp"
 
 int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPWSTR lpCmdLine, _In_ int nCmdShow)
 {
     ClearLog();
 
-    Window window(1600, 900, L"program");
+    ProfileThreadName("Window");
+
+    WindowEventQueue events;
+
+    Window window(1600, 900, L"program", &events);
 
     auto& dx = Dx::instance();
 
-    if (!dx.init(window.hwnd(), window.width(), window.height()))
-    {
-        return 1;
-    }
+    Mesh mesh;
 
-    std::vector<DirectX::XMFLOAT3> vertices(
+    ShaderPipeline pipeline;
+
+    // Dx and every resource belong to the render thread; this thread only pumps messages
+    RenderThread renderThread(events, window.width(), window.height());
+
+    renderThread.start(
         {
-            DirectX::XMFLOAT3(-1.f,-1.f,0.f),
-            DirectX::XMFLOAT3(-1.f,1.f,0.f),
-            DirectX::XMFLOAT3(1.f,-1.f,0.f),
-        }
-    );
+            .init = [&]
+            {
+                if (!dx.init(window.hwnd(), window.width(), window.height()))
+                {
+                    return false;
+                }
 
-    std::vector<int> indices({ 0,1,2 });
+                std::vector<DirectX::XMFLOAT3> vertices(
+                    {
+                        DirectX::XMFLOAT3(-1.f,-1.f,0.f),
+                        DirectX::XMFLOAT3(-1.f,1.f,0.f),
+                        DirectX::XMFLOAT3(1.f,-1.f,0.f),
+                    }
+                );
 
-    window.update();
+                std::vector<int> indices({ 0,1,2 });
 
-    Mesh mesh;
-    if (!mesh.init(vertices, indices))
+                return mesh.init(vertices, indices) && pipeline.init(L"shader/vs.hlsl", L"shader/ps.hlsl");
+            },
+            .frame = [&]
+            {
+                if (!dx.frameBegin())
+                {
+                    return false;
+                }
+
+                dx.setPipeline(pipeline);
+
+                dx.draw(mesh);
+
+                return dx.frameEnd();
+            },
+            .resize = [&](int width, int height)
+            {
+                return dx.resize(width, height);
+            },
+            .shutdown = [&]
+            {
+                dx.waitIdle();
+            },
+            .exited = [&]
+            {
+                window.close();
+            },
+        });
+
+    while (window.update())
     {
-        return 1;
+        window.wait();
     }
 
-    ShaderPipeline pipeline;
-    if (!pipeline.init(L"shader/vs.hlsl", L"shader/ps.hlsl"))
+    if (!renderThread.join())
     {
         return 1;
     }
-    
-    while (window.update())
-    {
-        if (!dx.frameBegin())
-        {
-            return 1;
-        }
-
-        dx.setPipeline(pipeline);
 
-        dx.draw(mesh);
-
-        if (!dx.frameEnd())
-        {
-            return 1;
-        }
-    }
+#ifdef ENABLE_PROFILER
+    Profiler::instance().writeChromeTrace("profile.json");
+#endif
 
     return 0;
 }
@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+#include "logger.hpp"
+#include "mesh.hpp"
+#include "renderStats.hpp"
+
+namespace
+{
+    // Meshes may be loaded on any thread
+    class MeshIdAllocator
+    {
+    public:
+
+        std::uint32_t allocate()
+        {
+            std::lock_guard lock(m_mutex);
+
+            if (!m_free.empty())
+            {
+                const auto id = m_free.back();
+                m_free.pop_back();
+                return id;
+            }
+
+            return m_next < MaxMeshIds ? m_next++ : 0;
+        }
+
+        void free(std::uint32_t id)
+        {
+            std::lock_guard lock(m_mutex);
+
+            m_free.push_back(id);
+        }
+
+    private:
+
+        std::mutex m_mutex;
+
+        std::vector<std::uint32_t> m_free;
+
+        std::uint32_t m_next = 1;
+    };
+
+    MeshIdAllocator& MeshIds()
+    {
+        static MeshIdAllocator ids;
+        return ids;
+    }
+}
+
+Mesh::Mesh(Mesh&& other) noexcept
+    : m_vbView(other.m_vbView)
+    , m_ibView(other.m_ibView)
+    , m_verticesCount(other.m_verticesCount)
+    , m_indicesCount(other.m_indicesCount)
+    , m_lods(std::move(other.m_lods))
+    , m_layoutId(other.m_layoutId)
+    , m_id(other.m_id)
+    , m_bounds(other.m_bounds)
+    , m_keepOccluder(other.m_keepOccluder)
+    , m_occluder(std::move(other.m_occluder))
+{
+    other.m_vbView = {};
+    other.m_ibView = {};
+    other.m_lods.assign(1, {});
+    other.m_id = 0;
+}
+
+Mesh& Mesh::operator=(Mesh&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+
+        m_vbView = other.m_vbView;
+        m_ibView = other.m_ibView;
+        m_verticesCount = other.m_verticesCount;
+        m_indicesCount = other.m_indicesCount;
+        m_lods = std::move(other.m_lods);
+        m_layoutId = other.m_layoutId;
+        m_id = other.m_id;
+        m_bounds = other.m_bounds;
+        m_keepOccluder = other.m_keepOccluder;
+        m_occluder = std::move(other.m_occluder);
+
+        other.m_vbView = {};
+        other.m_ibView = {};
+        other.m_lods.assign(1, {});
+        other.m_id = 0;
+    }
+
+    return *this;
+}
+
+Mesh::~Mesh()
+{
+    release();
+}
+
+void Mesh::release()
+{
+    if (m_vbView.buffer)
+    {
+        Dx::instance().backend().releaseBuffer(m_vbView.buffer);
+        RenderStats::instance().addLiveMeshBuffers(-1);
+    }
+
+    if (m_ibView.buffer)
+    {
+        Dx::instance().backend().releaseBuffer(m_ibView.buffer);
+        RenderStats::instance().addLiveMeshBuffers(-1);
+    }
+
+    if (m_id != 0)
+    {
+        MeshIds().free(m_id);
+    }
+
+    m_vbView = {};
+    m_ibView = {};
+    m_id = 0;
+    m_verticesCount = 0;
+    m_indicesCount = 0;
+    m_lods.assign(1, {});
+    m_bounds = {};
+    m_occluder.release();
+}
+
+bool Mesh::init(std::span<const std::byte> vertexData, std::uint32_t vertexStride,
+    std::span<const std::byte> indexData, IndexFormat indexFormat, std::uint64_t layoutId, PositionAttribute position)
+{
+    if (!initBuffers(vertexData, vertexStride, indexData, indexFormat, layoutId))
+    {
+        return false;
+    }
+
+    m_bounds = ComputeMeshBounds(vertexData, vertexStride, position);
+
+    // The mesh is still drawable without its occluder, which logs why it failed
+    if (m_keepOccluder)
+    {
+        m_occluder.init(vertexData, vertexStride, indexData, indexFormat, position);
+    }
+
+    return true;
+}
+
+bool Mesh::init(const MeshFileView& file)
+{
+    const auto& header = file.header();
+
+    if (!initBuffers(file.vertexData(), header.vertexStride, file.indexData(), file.indexFormat(), header.layoutId))
+    {
+        return false;
+    }
+
+    Aabb box;
+
+    std::copy(std::begin(header.bounds.min), std::end(header.bounds.min), box.min);
+    std::copy(std::begin(header.bounds.max), std::end(header.bounds.max), box.max);
+
+    m_bounds = MeshBoundsFromBox(box);
+
+    if (m_keepOccluder)
+    {
+        m_occluder.init(file.vertexData(), header.vertexStride, file.indexData(), file.indexFormat());
+    }
+
+    return true;
+}
+
+bool Mesh::initBuffers(std::span<const std::byte> vertexData, std::uint32_t vertexStride,
+    std::span<const std::byte> indexData, IndexFormat indexFormat, std::uint64_t layoutId)
+{
+    release();
+
+    if (vertexStride == 0)
+    {
+        ErrorLog(L"頂点ストライドが 0 です");
+        return false;
+    }
+
+    const auto id = MeshIds().allocate();
+    if (id == 0)
+    {
+        ErrorLog(L"メッシュ数が上限に達しました");
+        return false;
+    }
+
+    auto vbViewOpt = makeVertexBuffer(vertexData, vertexStride);
+    if (!vbViewOpt)
+    {
+        MeshIds().free(id);
+        return false;
+    }
+
+    auto ibViewOpt = makeIndexBuffer(indexData, indexFormat);
+    if (!ibViewOpt)
+    {
+        Dx::instance().backend().releaseBuffer(vbViewOpt.value().buffer);
+        RenderStats::instance().addLiveMeshBuffers(-1);
+        MeshIds().free(id);
+        return false;
+    }
+
+    m_id = id;
+
+    m_vbView = vbViewOpt.value();
+
+    m_ibView = ibViewOpt.value();
+
+    m_verticesCount = static_cast<std::uint32_t>(vertexData.size() / vertexStride);
+
+    m_indicesCount = static_cast<std::uint32_t>(indexData.size() / IndexSize(indexFormat));
+
+    m_lods.assign(1, { .indexOffset = 0, .indexCount = m_indicesCount, .error = 0.f });
+
+    m_layoutId = layoutId;
+
+    return true;
+}
+
+std::optional<VertexBufferView> Mesh::makeVertexBuffer(std::span<const std::byte> vertexData, std::uint32_t vertexStride)
+{
+    const auto sizeInBytes = static_cast<std::uint32_t>(vertexData.size());
+
+    const auto buffer = Dx::instance().backend().createBuffer(BufferUsage::Vertex, vertexData.data(), sizeInBytes);
+    if (!buffer)
+    {
+        return std::nullopt;
+    }
+
+    RenderStats::instance().add(RenderCounter::BytesUploaded, sizeInBytes);
+    RenderStats::instance().addLiveMeshBuffers(1);
+
+    return VertexBufferView{
+        .buffer = buffer.value(),
+        .offset = 0,
+        .sizeInBytes = sizeInBytes,
+        .strideInBytes = vertexStride,
+    };
+}
+
+std::optional<IndexBufferView> Mesh::makeIndexBuffer(std::span<const std::byte> indexData, IndexFormat indexFormat)
+{
+    const auto sizeInBytes = static_cast<std::uint32_t>(indexData.size());
+
+    const auto buffer = Dx::instance().backend().createBuffer(BufferUsage::Index, indexData.data(), sizeInBytes);
+    if (!buffer)
+    {
+        return std::nullopt;
+    }
+
+    RenderStats::instance().add(RenderCounter::BytesUploaded, sizeInBytes);
+    RenderStats::instance().addLiveMeshBuffers(1);
+
+    return IndexBufferView{
+        .buffer = buffer.value(),
+        .offset = 0,
+        .sizeInBytes = sizeInBytes,
+        .format = indexFormat,
+    };
+}
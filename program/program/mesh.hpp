@@ -1,12 +1,23 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
 #include <vector>
 
-#include <Windows.h>
-#include <d3d12.h>
-#include <dxgi1_6.h>
-
+#include "bounds.hpp"
 #include "dx.hpp"
+#include "meshFile.hpp"
+#include "meshOptimizer.hpp"
+#include "meshSimplifier.hpp"
+#include "occlusionCulling.hpp"
+#include "renderBackend.hpp"
+#include "vertexLayout.hpp"
+
+// Mesh ids stay below this, so a draw key can hold one with a level of detail in 32 bits
+constexpr std::uint32_t MaxMeshIds = 1u << 29;
 
 class Mesh
 {
@@ -14,147 +25,256 @@ public:
 
     Mesh() = default;
 
+    Mesh(const Mesh&) = delete;
+
+    Mesh& operator=(const Mesh&) = delete;
+
+    Mesh(Mesh&& other) noexcept;
+
+    Mesh& operator=(Mesh&& other) noexcept;
+
+    ~Mesh();
+
     template<typename VertexType, typename IndexType>
     bool init(const std::vector<VertexType>& vertices, const std::vector<IndexType>& indices);
 
+    template<typename VertexType, typename IndexType>
+    bool init(std::span<const VertexType> vertices, std::span<const IndexType> indices);
+
+    // The data is written straight into the upload staging memory, so a span
+    // over a mapped file is loaded without any intermediate copy
+    bool init(std::span<const std::byte> vertexData, std::uint32_t vertexStride,
+        std::span<const std::byte> indexData, IndexFormat indexFormat, std::uint64_t layoutId = 0, PositionAttribute position = {});
+
+    // Bounds come from the file header, which only stores the box
+    bool init(const MeshFileView& file);
+
+    // Reorders and compacts the data before upload; the vertex order is not preserved.
+    // With settings.lod the simplified levels follow level 0 in the index buffer.
+    template<typename VertexType, typename IndexType>
+    bool initOptimized(const std::vector<VertexType>& vertices, const std::vector<IndexType>& indices,
+        const MeshOptimizeSettings& settings = {}, MeshOptimizeReport* report = nullptr);
+
+    void release();
+
+    const VertexBufferView& vertexBuffer()const { return m_vbView; }
+
+    const IndexBufferView& indexBuffer()const { return m_ibView; }
+
+    std::uint32_t verticesCount()const { return m_verticesCount; }
+
+    // Level 0
+    std::uint32_t indicesCount()const { return m_indicesCount; }
+
+    // At least one level, the full mesh
+    std::span<const MeshLod> lods()const { return m_lods; }
+
+    std::uint32_t lodCount()const { return static_cast<std::uint32_t>(m_lods.size()); }
+
+    // Levels past the last give the last
+    const MeshLod& lod(std::uint32_t level)const { return m_lods[std::min(level, lodCount() - 1)]; }
+
+    std::uint64_t layoutId()const { return m_layoutId; }
+
+    // Unique among initialized meshes and below MaxMeshIds, 0 before init;
+    // released ids are handed out again, so they stay dense
+    std::uint32_t id()const { return m_id; }
+
+    // Object space
+    const MeshBounds& bounds()const { return m_bounds; }
+
+    // Keeps a CPU copy of the positions and indices from the following inits so
+    // the mesh can be drawn into the occlusion buffer; for walls and other large,
+    // simple meshes. File meshes are read as a float3 position at offset 0.
+    void setOccluder(bool keep) { m_keepOccluder = keep; }
+
+    // Empty unless setOccluder(true) came before init
+    const OccluderMesh& occluder()const { return m_occluder; }
+
 private:
 
-    friend class Dx;
+    bool initBuffers(std::span<const std::byte> vertexData, std::uint32_t vertexStride,
+        std::span<const std::byte> indexData, IndexFormat indexFormat, std::uint64_t layoutId);
+
+    std::optional<VertexBufferView> makeVertexBuffer(std::span<const std::byte> vertexData, std::uint32_t vertexStride);
+
+    std::optional<IndexBufferView> makeIndexBuffer(std::span<const std::byte> indexData, IndexFormat indexFormat);
+
+    VertexBufferView m_vbView;
+
+    IndexBufferView m_ibView;
+
+    std::uint32_t m_verticesCount = 0;
+
+    std::uint32_t m_indicesCount = 0;
 
-    template<typename VertexType>
-    std::optional<D3D12_VERTEX_BUFFER_VIEW> makeVertexBuffer(const std::vector<VertexType>& vertices);
+    std::vector<MeshLod> m_lods = std::vector<MeshLod>(1);
 
-    template<typename IndexType>
-    std::optional<D3D12_INDEX_BUFFER_VIEW> makeIndexBuffer(const std::vector<IndexType>& indices);
+    std::uint64_t m_layoutId = 0;
 
-    D3D12_VERTEX_BUFFER_VIEW m_vbView;
+    std::uint32_t m_id = 0;
 
-    D3D12_INDEX_BUFFER_VIEW m_ibView;
+    MeshBounds m_bounds;
 
-    std::uint32_t m_verticesCount;
+    bool m_keepOccluder = false;
 
-    std::uint32_t m_indicesCount;
+    OccluderMesh m_occluder;
 };
 
+// The POSITION attribute of VertexType, or a float3 at the start of a type without a layout
+template<typename VertexType>
+constexpr PositionAttribute VertexLayoutPosition()
+{
+    if constexpr (HasVertexLayout<VertexType>)
+    {
+        for (const auto& a : VertexLayout<VertexType>::attributes)
+        {
+            if (a.semanticName == "POSITION" && a.semanticIndex == 0)
+            {
+                return { .offset = a.offset, .format = a.format };
+            }
+        }
+    }
+
+    return {};
+}
+
 template<typename VertexType, typename IndexType>
 inline bool Mesh::init(const std::vector<VertexType>& vertices, const std::vector<IndexType>& indices)
 {
-    auto vbViewOpt = makeVertexBuffer(vertices);
-    if (!vbViewOpt)
+    return init(std::span<const VertexType>(vertices), std::span<const IndexType>(indices));
+}
+
+template<typename VertexType, typename IndexType>
+inline bool Mesh::init(std::span<const VertexType> vertices, std::span<const IndexType> indices)
+{
+    static_assert(sizeof(IndexType) == 2 || sizeof(IndexType) == 4, "IndexType must be a 16 or 32 bit integer");
+
+    if constexpr (HasVertexLayout<VertexType>)
     {
-        return false;
+        static_assert(ValidateVertexLayout<VertexType>(), "VertexLayout has overlapping, misaligned or out of range attributes");
     }
 
-    auto ibViewOpt = makeIndexBuffer(indices);
-    if (!ibViewOpt)
+    return init(std::as_bytes(vertices), sizeof(VertexType), std::as_bytes(indices),
+        sizeof(IndexType) == 2 ? IndexFormat::Uint16 : IndexFormat::Uint32, VertexLayoutId<VertexType>(), VertexLayoutPosition<VertexType>());
+}
+
+template<typename VertexType, typename IndexType>
+inline bool Mesh::initOptimized(const std::vector<VertexType>& vertices, const std::vector<IndexType>& indices,
+    const MeshOptimizeSettings& settings, MeshOptimizeReport* report)
+{
+    auto vertexCount = static_cast<std::uint32_t>(vertices.size());
+
+    std::vector<std::uint32_t> optimizedIndices(indices.begin(), indices.end());
+
+    if (!ValidateIndices(optimizedIndices, vertexCount))
     {
         return false;
     }
 
-    m_vbView = vbViewOpt.value();
+    std::vector<MeshLod> lods;
 
-    m_ibView = ibViewOpt.value();
+    auto position = VertexLayoutPosition<VertexType>();
 
-    m_verticesCount = static_cast<std::uint32_t>(vertices.size());
-
-    m_indicesCount = static_cast<std::uint32_t>(indices.size());
+    if constexpr (!HasVertexLayout<VertexType>)
+    {
+        position.offset = settings.positionOffset;
+    }
 
-    return true;
-}
+    MeshOptimizeReport result;
+    result.verticesBefore = vertexCount;
+    result.before = AnalyzeVertexCache(optimizedIndices, vertexCount);
 
-template<typename VertexType>
-inline std::optional<D3D12_VERTEX_BUFFER_VIEW> Mesh::makeVertexBuffer(const std::vector<VertexType>& vertices)
-{
-    const D3D12_HEAP_PROPERTIES prop =
+    if (settings.vertexCache)
     {
-        .Type = D3D12_HEAP_TYPE_UPLOAD,
-        .CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
-        .MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN,
-        //.CreationNodeMask
-        //.VisibleNodeMask
-    };
-
-    const D3D12_RESOURCE_DESC desc =
+        optimizedIndices = OptimizeVertexCache(optimizedIndices, vertexCount);
+    }
+
+    if (settings.overdraw)
     {
-        .Dimension = D3D12_RESOURCE_DIMENSION_BUFFER,
-        //.Alignment
-        .Width = sizeof(VertexType) * static_cast<int>(vertices.size()),
-        .Height = 1,
-        .DepthOrArraySize = 1,
-        .MipLevels = 1,
-        .Format = DXGI_FORMAT_UNKNOWN,
-        .SampleDesc = {.Count = 1},
-        .Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
-        .Flags = D3D12_RESOURCE_FLAG_NONE,
-    };
+        optimizedIndices = OptimizeOverdraw(optimizedIndices, reinterpret_cast<const std::uint8_t*>(vertices.data()),
+            sizeof(VertexType), position, settings.minClusterTriangles);
+    }
 
-    ID3D12Resource* verticesBuffer = nullptr;
+    // Simplified from the optimized order; each level is reordered again for the cache
+    if (1 < settings.lod.maxLevels)
+    {
+        auto chain = BuildLodChain(optimizedIndices, reinterpret_cast<const std::uint8_t*>(vertices.data()),
+            sizeof(VertexType), vertexCount, position, settings.lod);
 
-    auto device = Dx::instance().device();
+        optimizedIndices = std::move(chain.indices);
+        lods = std::move(chain.levels);
+    }
 
-    CheckOpt(device->CreateCommittedResource(&prop, D3D12_HEAP_FLAG_NONE, &desc,
-        D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&verticesBuffer)));
+    std::vector<VertexType> optimizedVertices;
 
-    VertexType* verticesMap = nullptr;
-    CheckOpt(verticesBuffer->Map(0, nullptr, reinterpret_cast<void**>(&verticesMap)));
+    // Level 0 is first, so the vertices it uses come first
+    if (settings.vertexFetch)
+    {
+        const auto remap = OptimizeVertexFetchRemap(optimizedIndices, vertexCount, vertexCount);
 
-    std::copy(vertices.begin(), vertices.end(), verticesMap);
+        optimizedVertices = RemapVertices(vertices, remap, vertexCount);
 
-    verticesBuffer->Unmap(0, nullptr);
+        for (auto& index : optimizedIndices)
+        {
+            index = remap[index];
+        }
+    }
 
-    D3D12_VERTEX_BUFFER_VIEW vbView = {
-        .BufferLocation = verticesBuffer->GetGPUVirtualAddress(),
-        .SizeInBytes = sizeof(VertexType) * static_cast<int>(vertices.size()),
-        .StrideInBytes = sizeof(VertexType),
-    };
+    const auto& uploadVertices = settings.vertexFetch ? optimizedVertices : vertices;
 
-    return vbView;
-}
+    result.verticesAfter = vertexCount;
+    result.indices16 = settings.compactIndices && CanUse16BitIndices(vertexCount);
+    result.lodLevels = lods.empty() ? 1 : static_cast<std::uint32_t>(lods.size());
 
-template<typename IndexType>
-inline std::optional<D3D12_INDEX_BUFFER_VIEW> Mesh::makeIndexBuffer(const std::vector<IndexType>& indices)
-{
-    const D3D12_HEAP_PROPERTIES prop =
+    if (lods.empty())
     {
-        .Type = D3D12_HEAP_TYPE_UPLOAD,
-        .CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
-        .MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN,
-        //.CreationNodeMask
-        //.VisibleNodeMask
-    };
-
-    const D3D12_RESOURCE_DESC desc =
+        result.after = AnalyzeVertexCache(optimizedIndices, vertexCount);
+    }
+    else
     {
-        .Dimension = D3D12_RESOURCE_DIMENSION_BUFFER,
-        //.Alignment
-        .Width = sizeof(IndexType) * static_cast<int>(indices.size()),
-        .Height = 1,
-        .DepthOrArraySize = 1,
-        .MipLevels = 1,
-        .Format = DXGI_FORMAT_UNKNOWN,
-        .SampleDesc = {.Count = 1},
-        .Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
-        .Flags = D3D12_RESOURCE_FLAG_NONE,
-    };
+        const std::vector<std::uint32_t> level0(optimizedIndices.begin(), optimizedIndices.begin() + lods.front().indexCount);
+        result.after = AnalyzeVertexCache(level0, vertexCount);
+    }
 
-    ID3D12Resource* indicesBuffer = nullptr;
+    if (report)
+    {
+        *report = result;
+    }
 
-    CheckOpt(Dx::instance().device()->CreateCommittedResource(&prop, D3D12_HEAP_FLAG_NONE, &desc,
-        D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&indicesBuffer)));
+    bool initialized = false;
 
-    IndexType* indicesMap = nullptr;
-    CheckOpt(indicesBuffer->Map(0, nullptr, reinterpret_cast<void**>(&indicesMap)));
+    // With a chain, init would build the occluder from every level only for it to be rebuilt below
+    const bool keepOccluder = m_keepOccluder;
+    m_keepOccluder = keepOccluder && lods.empty();
 
-    std::copy(indices.begin(), indices.end(), indicesMap);
+    if (result.indices16)
+    {
+        const std::vector<std::uint16_t> indices16(optimizedIndices.begin(), optimizedIndices.end());
 
-    indicesBuffer->Unmap(0, nullptr);
+        initialized = init(uploadVertices, indices16);
+    }
+    else
+    {
+        initialized = init(uploadVertices, optimizedIndices);
+    }
 
-    D3D12_INDEX_BUFFER_VIEW ibView = {
-        .BufferLocation = indicesBuffer->GetGPUVirtualAddress(),
-        .SizeInBytes = sizeof(IndexType) * static_cast<int>(indices.size()),
-        .Format = DXGI_FORMAT_R32_UINT,
-    };
+    m_keepOccluder = keepOccluder;
 
-    return ibView;
-}
+    if (!initialized || lods.empty())
+    {
+        return initialized;
+    }
+
+    m_lods = std::move(lods);
+    m_indicesCount = m_lods.front().indexCount;
 
+    // Only level 0 is conservative enough to hide other meshes
+    if (m_keepOccluder)
+    {
+        m_occluder.init(std::as_bytes(std::span(uploadVertices)), sizeof(VertexType),
+            std::as_bytes(std::span(optimizedIndices).first(m_indicesCount)), IndexFormat::Uint32, position);
+    }
+
+    return true;
+}
@@ -0,0 +1,331 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "logger.hpp"
+#include "meshFile.hpp"
+
+namespace
+{
+    std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    bool InRange(std::uint64_t offset, std::uint64_t size, std::size_t imageSize)
+    {
+        return offset <= imageSize && size <= imageSize - offset;
+    }
+
+    MeshFileBounds ComputeBounds(const MeshFileDesc& desc, std::uint32_t indexStart, std::uint32_t indexCount, std::int32_t baseVertex)
+    {
+        MeshFileBounds bounds;
+
+        std::fill(std::begin(bounds.min), std::end(bounds.min), std::numeric_limits<float>::max());
+        std::fill(std::begin(bounds.max), std::end(bounds.max), std::numeric_limits<float>::lowest());
+
+        const std::uint32_t indexSize = IndexSize(desc.indexFormat);
+        const std::uint64_t vertexCount = desc.vertexData.size() / desc.vertexStride;
+
+        for (std::uint32_t i = indexStart; i < indexStart + indexCount; ++i)
+        {
+            std::uint32_t index = 0;
+            std::memcpy(&index, desc.indexData.data() + static_cast<std::size_t>(i) * indexSize, indexSize);
+
+            const std::int64_t vertex = static_cast<std::int64_t>(index) + baseVertex;
+
+            if (vertex < 0 || vertexCount <= static_cast<std::uint64_t>(vertex))
+            {
+                continue;
+            }
+
+            float position[3];
+            std::memcpy(position, desc.vertexData.data() + vertex * desc.vertexStride + desc.positionOffset, sizeof(position));
+
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                bounds.min[axis] = std::min(bounds.min[axis], position[axis]);
+                bounds.max[axis] = std::max(bounds.max[axis], position[axis]);
+            }
+        }
+
+        if (bounds.max[0] < bounds.min[0])
+        {
+            bounds = {};
+        }
+
+        return bounds;
+    }
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+#ifdef _WIN32
+        std::swap(m_file, other.m_file);
+        std::swap(m_mapping, other.m_mapping);
+#endif
+    }
+
+    return *this;
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::filesystem::path& path)
+{
+    close();
+
+    m_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+    if (m_file == INVALID_HANDLE_VALUE)
+    {
+        m_file = nullptr;
+        ErrorLog(L"ファイルを開けません: " + path.wstring());
+        return false;
+    }
+
+    LARGE_INTEGER size = {};
+
+    if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+    {
+        close();
+        return false;
+    }
+
+    m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if (!m_mapping)
+    {
+        close();
+        return false;
+    }
+
+    m_data = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+
+    if (!m_data)
+    {
+        close();
+        return false;
+    }
+
+    m_size = static_cast<std::size_t>(size.QuadPart);
+
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (m_data)
+    {
+        UnmapViewOfFile(m_data);
+    }
+
+    if (m_mapping)
+    {
+        CloseHandle(m_mapping);
+    }
+
+    if (m_file)
+    {
+        CloseHandle(m_file);
+    }
+
+    m_data = nullptr;
+    m_size = 0;
+    m_mapping = nullptr;
+    m_file = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const std::filesystem::path& path)
+{
+    close();
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat status = {};
+
+    if (fstat(fd, &status) != 0 || status.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void* data = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping keeps its own reference to the file
+    ::close(fd);
+
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+
+    madvise(data, static_cast<std::size_t>(status.st_size), MADV_SEQUENTIAL);
+
+    m_data = data;
+    m_size = static_cast<std::size_t>(status.st_size);
+
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (m_data)
+    {
+        munmap(m_data, m_size);
+    }
+
+    m_data = nullptr;
+    m_size = 0;
+}
+
+#endif
+
+std::optional<MeshFileView> MeshFileView::parse(std::span<const std::byte> image)
+{
+    MeshFileView view;
+
+    if (image.size() < sizeof(MeshFileHeader))
+    {
+        return std::nullopt;
+    }
+
+    std::memcpy(&view.m_header, image.data(), sizeof(MeshFileHeader));
+
+    const auto& header = view.m_header;
+
+    if (header.magic != MeshFileMagic || header.version != MeshFileVersion || header.headerSize != sizeof(MeshFileHeader))
+    {
+        ErrorLog(L"メッシュファイルの形式が不正です");
+        return std::nullopt;
+    }
+
+    if (header.indexFormat != static_cast<std::uint32_t>(IndexFormat::Uint16) && header.indexFormat != static_cast<std::uint32_t>(IndexFormat::Uint32))
+    {
+        return std::nullopt;
+    }
+
+    const std::uint64_t vertexBytes = static_cast<std::uint64_t>(header.vertexStride) * header.vertexCount;
+    const std::uint64_t indexBytes = static_cast<std::uint64_t>(IndexSize(view.indexFormat())) * header.indexCount;
+    const std::uint64_t submeshBytes = sizeof(MeshFileSubmesh) * static_cast<std::uint64_t>(header.submeshCount);
+
+    if (!InRange(header.vertexOffset, vertexBytes, image.size()) ||
+        !InRange(header.indexOffset, indexBytes, image.size()) ||
+        !InRange(header.submeshOffset, submeshBytes, image.size()) ||
+        header.submeshOffset % alignof(MeshFileSubmesh) != 0)
+    {
+        ErrorLog(L"メッシュファイルが壊れています");
+        return std::nullopt;
+    }
+
+    view.m_vertexData = image.subspan(header.vertexOffset, vertexBytes);
+    view.m_indexData = image.subspan(header.indexOffset, indexBytes);
+    view.m_submeshes = { reinterpret_cast<const MeshFileSubmesh*>(image.data() + header.submeshOffset), header.submeshCount };
+
+    for (const auto& submesh : view.m_submeshes)
+    {
+        if (header.indexCount < submesh.indexStart || header.indexCount - submesh.indexStart < submesh.indexCount)
+        {
+            return std::nullopt;
+        }
+    }
+
+    return view;
+}
+
+bool WriteMeshFile(const std::filesystem::path& path, const MeshFileDesc& desc)
+{
+    if (desc.vertexStride == 0 || desc.vertexData.size() % desc.vertexStride != 0 ||
+        desc.indexData.size() % IndexSize(desc.indexFormat) != 0 ||
+        desc.vertexStride < desc.positionOffset + sizeof(float) * 3)
+    {
+        return false;
+    }
+
+    MeshFileHeader header;
+    header.layoutId = desc.layoutId;
+    header.vertexStride = desc.vertexStride;
+    header.vertexCount = static_cast<std::uint32_t>(desc.vertexData.size() / desc.vertexStride);
+    header.indexFormat = static_cast<std::uint32_t>(desc.indexFormat);
+    header.indexCount = static_cast<std::uint32_t>(desc.indexData.size() / IndexSize(desc.indexFormat));
+
+    std::vector<MeshFileSubmesh> submeshes = desc.submeshes;
+
+    if (submeshes.empty())
+    {
+        submeshes.push_back({ .indexStart = 0, .indexCount = header.indexCount, .baseVertex = 0, .bounds = {} });
+    }
+
+    for (auto& submesh : submeshes)
+    {
+        if (header.indexCount < submesh.indexStart || header.indexCount - submesh.indexStart < submesh.indexCount)
+        {
+            return false;
+        }
+
+        submesh.bounds = ComputeBounds(desc, submesh.indexStart, submesh.indexCount, submesh.baseVertex);
+    }
+
+    header.bounds = ComputeBounds(desc, 0, header.indexCount, 0);
+
+    header.vertexOffset = AlignUp(sizeof(MeshFileHeader), MeshFileStreamAlignment);
+    header.indexOffset = AlignUp(header.vertexOffset + desc.vertexData.size(), MeshFileStreamAlignment);
+    header.submeshOffset = AlignUp(header.indexOffset + desc.indexData.size(), MeshFileStreamAlignment);
+    header.submeshCount = static_cast<std::uint32_t>(submeshes.size());
+
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+
+    if (!ofs)
+    {
+        return false;
+    }
+
+    const auto writeAt = [&ofs](std::uint64_t offset, const void* data, std::size_t size)
+    {
+        static constexpr char zeros[MeshFileStreamAlignment] = {};
+
+        const auto position = static_cast<std::uint64_t>(ofs.tellp());
+        ofs.write(zeros, static_cast<std::streamsize>(offset - position));
+        ofs.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    };
+
+    writeAt(0, &header, sizeof(header));
+    writeAt(header.vertexOffset, desc.vertexData.data(), desc.vertexData.size());
+    writeAt(header.indexOffset, desc.indexData.data(), desc.indexData.size());
+    writeAt(header.submeshOffset, submeshes.data(), submeshes.size() * sizeof(MeshFileSubmesh));
+
+    return static_cast<bool>(ofs);
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "renderBackend.hpp"
+
+// Binary mesh container, little endian:
+//
+//   MeshFileHeader
+//   vertex stream   (at vertexOffset, StreamAlignment aligned)
+//   index stream    (at indexOffset, StreamAlignment aligned)
+//   submesh table   (at submeshOffset, submeshCount MeshFileSubmesh)
+//
+// Streams are stored exactly as the GPU consumes them, so a mapped file can
+// be handed to Mesh::init without any conversion.
+
+constexpr std::uint32_t MeshFileMagic = 0x534d5847; // "GXMS"
+
+constexpr std::uint16_t MeshFileVersion = 1;
+
+constexpr std::uint64_t MeshFileStreamAlignment = 64;
+
+struct MeshFileBounds
+{
+    float min[3] = { 0.f, 0.f, 0.f };
+
+    float max[3] = { 0.f, 0.f, 0.f };
+};
+
+struct MeshFileHeader
+{
+    std::uint32_t magic = MeshFileMagic;
+
+    std::uint16_t version = MeshFileVersion;
+
+    std::uint16_t headerSize = sizeof(MeshFileHeader);
+
+    std::uint64_t layoutId = 0;
+
+    std::uint32_t vertexStride = 0;
+
+    std::uint32_t vertexCount = 0;
+
+    std::uint32_t indexFormat = 0;
+
+    std::uint32_t indexCount = 0;
+
+    std::uint64_t vertexOffset = 0;
+
+    std::uint64_t indexOffset = 0;
+
+    std::uint64_t submeshOffset = 0;
+
+    std::uint32_t submeshCount = 0;
+
+    std::uint32_t reserved = 0;
+
+    MeshFileBounds bounds;
+};
+
+struct MeshFileSubmesh
+{
+    std::uint32_t indexStart = 0;
+
+    std::uint32_t indexCount = 0;
+
+    std::int32_t baseVertex = 0;
+
+    std::uint32_t reserved = 0;
+
+    MeshFileBounds bounds;
+};
+
+class MappedFile
+{
+public:
+
+    MappedFile() = default;
+
+    MappedFile(const MappedFile&) = delete;
+
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept;
+
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    ~MappedFile();
+
+    bool open(const std::filesystem::path& path);
+
+    void close();
+
+    std::span<const std::byte> data()const { return { static_cast<const std::byte*>(m_data), m_size }; }
+
+private:
+
+    void* m_data = nullptr;
+
+    std::size_t m_size = 0;
+
+#ifdef _WIN32
+    void* m_file = nullptr;
+
+    void* m_mapping = nullptr;
+#endif
+};
+
+// Validated, non-owning view over a mesh file image
+class MeshFileView
+{
+public:
+
+    static std::optional<MeshFileView> parse(std::span<const std::byte> image);
+
+    const MeshFileHeader& header()const { return m_header; }
+
+    IndexFormat indexFormat()const { return static_cast<IndexFormat>(m_header.indexFormat); }
+
+    std::span<const std::byte> vertexData()const { return m_vertexData; }
+
+    std::span<const std::byte> indexData()const { return m_indexData; }
+
+    std::span<const MeshFileSubmesh> submeshes()const { return m_submeshes; }
+
+private:
+
+    MeshFileHeader m_header;
+
+    std::span<const std::byte> m_vertexData;
+
+    std::span<const std::byte> m_indexData;
+
+    std::span<const MeshFileSubmesh> m_submeshes;
+};
+
+struct MeshFileDesc
+{
+    std::span<const std::byte> vertexData;
+
+    std::uint32_t vertexStride = 0;
+
+    std::span<const std::byte> indexData;
+
+    IndexFormat indexFormat = IndexFormat::Uint32;
+
+    std::uint64_t layoutId = 0;
+
+    // Byte offset of a float3 position inside the vertex, used for the bounds
+    std::uint32_t positionOffset = 0;
+
+    // One submesh covering everything is written when empty; bounds are filled in
+    std::vector<MeshFileSubmesh> submeshes;
+};
+
+bool WriteMeshFile(const std::filesystem::path& path, const MeshFileDesc& desc);
@@ -0,0 +1,423 @@
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include "logger.hpp"
+#include "meshOptimizer.hpp"
+
+namespace
+{
+    constexpr int CacheSize = 32;
+
+    constexpr float CacheDecayPower = 1.5f;
+
+    constexpr float LastTriangleScore = 0.75f;
+
+    constexpr float ValenceBoostScale = 2.0f;
+
+    constexpr float ValenceBoostPower = 0.5f;
+
+    constexpr std::uint32_t InvalidTriangle = 0xffffffff;
+
+    float VertexScore(int cachePosition, std::uint32_t remainingValence)
+    {
+        if (remainingValence == 0)
+        {
+            return -1.f;
+        }
+
+        float score = 0.f;
+
+        if (0 <= cachePosition)
+        {
+            if (cachePosition < 3)
+            {
+                // The vertices of the last triangle are penalized so a strip does not just continue
+                score = LastTriangleScore;
+            }
+            else
+            {
+                const float scaler = 1.f / (CacheSize - 3);
+                score = std::pow(1.f - (cachePosition - 3) * scaler, CacheDecayPower);
+            }
+        }
+
+        return score + ValenceBoostScale * std::pow(static_cast<float>(remainingValence), -ValenceBoostPower);
+    }
+
+    struct Float3
+    {
+        float x = 0.f, y = 0.f, z = 0.f;
+    };
+
+    Float3 ReadPosition(const std::uint8_t* vertices, std::size_t stride, PositionAttribute position, std::uint32_t index)
+    {
+        float p[3] = {};
+        ReadVertexPosition(reinterpret_cast<const std::byte*>(vertices + index * stride + position.offset), position.format, p);
+        return { p[0], p[1], p[2] };
+    }
+}
+
+bool ValidateIndices(const std::vector<std::uint32_t>& indices, std::uint32_t vertexCount)
+{
+    const auto outOfRange = std::find_if(indices.begin(), indices.end(), [&](std::uint32_t index) { return vertexCount <= index; });
+
+    if (outOfRange != indices.end())
+    {
+        ErrorLog(L"頂点数を超えるインデックスがあります: " + std::to_wstring(*outOfRange));
+        return false;
+    }
+
+    return true;
+}
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<std::uint32_t>& indices, std::uint32_t vertexCount, std::uint32_t cacheSize)
+{
+    std::vector<std::uint32_t> timestamps(vertexCount, 0);
+    std::vector<bool> referenced(vertexCount, false);
+
+    std::uint32_t time = cacheSize + 1;
+    std::uint64_t misses = 0;
+    std::uint32_t uniqueVertices = 0;
+
+    for (const auto index : indices)
+    {
+        // A FIFO entry is still cached if fewer than cacheSize misses happened since it was inserted
+        if (time - timestamps[index] > cacheSize)
+        {
+            timestamps[index] = time++;
+            ++misses;
+        }
+
+        if (!referenced[index])
+        {
+            referenced[index] = true;
+            ++uniqueVertices;
+        }
+    }
+
+    const std::size_t triangles = indices.size() / 3;
+
+    return VertexCacheStats{
+        .acmr = triangles ? static_cast<double>(misses) / triangles : 0.0,
+        .atvr = uniqueVertices ? static_cast<double>(misses) / uniqueVertices : 0.0,
+    };
+}
+
+std::vector<std::uint32_t> OptimizeVertexCache(const std::vector<std::uint32_t>& indices, std::uint32_t vertexCount)
+{
+    const std::uint32_t triangleCount = static_cast<std::uint32_t>(indices.size() / 3);
+
+    std::vector<std::uint32_t> result;
+    result.reserve(triangleCount * 3);
+
+    // Triangles adjacent to each vertex; the first remainingValence entries are not emitted yet
+    std::vector<std::uint32_t> remainingValence(vertexCount, 0);
+
+    for (std::uint32_t i = 0; i < triangleCount * 3; ++i)
+    {
+        ++remainingValence[indices[i]];
+    }
+
+    std::vector<std::uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+
+    for (std::uint32_t v = 0; v < vertexCount; ++v)
+    {
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remainingValence[v];
+    }
+
+    std::vector<std::uint32_t> adjacency(triangleCount * 3);
+    {
+        std::vector<std::uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+
+        for (std::uint32_t t = 0; t < triangleCount; ++t)
+        {
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                adjacency[fill[indices[t * 3 + corner]]++] = t;
+            }
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+
+    for (std::uint32_t v = 0; v < vertexCount; ++v)
+    {
+        vertexScores[v] = VertexScore(-1, remainingValence[v]);
+    }
+
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+
+    std::uint32_t bestTriangle = InvalidTriangle;
+    float bestScore = -1.f;
+
+    for (std::uint32_t t = 0; t < triangleCount; ++t)
+    {
+        triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+        if (bestScore < triangleScores[t])
+        {
+            bestScore = triangleScores[t];
+            bestTriangle = t;
+        }
+    }
+
+    std::vector<std::uint32_t> cache, newCache;
+    cache.reserve(CacheSize + 3);
+    newCache.reserve(CacheSize + 3);
+
+    std::uint32_t cursor = 0;
+
+    while (result.size() < triangleCount * 3)
+    {
+        if (bestTriangle == InvalidTriangle)
+        {
+            // Nothing in the cache is adjacent to a remaining triangle; start elsewhere
+            while (emitted[cursor])
+            {
+                ++cursor;
+            }
+
+            bestTriangle = cursor;
+        }
+
+        emitted[bestTriangle] = true;
+
+        newCache.clear();
+
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            const std::uint32_t v = indices[bestTriangle * 3 + corner];
+
+            result.push_back(v);
+            newCache.push_back(v);
+
+            // Remove the triangle from the vertex's remaining list
+            const std::uint32_t begin = adjacencyOffsets[v];
+            const std::uint32_t end = begin + remainingValence[v];
+
+            for (std::uint32_t i = begin; i < end; ++i)
+            {
+                if (adjacency[i] == bestTriangle)
+                {
+                    std::swap(adjacency[i], adjacency[end - 1]);
+                    break;
+                }
+            }
+
+            --remainingValence[v];
+        }
+
+        for (const auto v : cache)
+        {
+            if (std::find(newCache.begin(), newCache.begin() + 3, v) == newCache.begin() + 3)
+            {
+                newCache.push_back(v);
+            }
+        }
+
+        for (std::size_t i = CacheSize; i < newCache.size(); ++i)
+        {
+            cachePosition[newCache[i]] = -1;
+            vertexScores[newCache[i]] = VertexScore(-1, remainingValence[newCache[i]]);
+        }
+
+        if (CacheSize < newCache.size())
+        {
+            for (std::size_t i = CacheSize; i < newCache.size(); ++i)
+            {
+                const std::uint32_t v = newCache[i];
+
+                for (std::uint32_t a = adjacencyOffsets[v]; a < adjacencyOffsets[v] + remainingValence[v]; ++a)
+                {
+                    const std::uint32_t t = adjacency[a];
+                    triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+                }
+            }
+
+            newCache.resize(CacheSize);
+        }
+
+        std::swap(cache, newCache);
+
+        for (std::size_t i = 0; i < cache.size(); ++i)
+        {
+            cachePosition[cache[i]] = static_cast<int>(i);
+            vertexScores[cache[i]] = VertexScore(static_cast<int>(i), remainingValence[cache[i]]);
+        }
+
+        bestTriangle = InvalidTriangle;
+        bestScore = -1.f;
+
+        for (const auto v : cache)
+        {
+            for (std::uint32_t a = adjacencyOffsets[v]; a < adjacencyOffsets[v] + remainingValence[v]; ++a)
+            {
+                const std::uint32_t t = adjacency[a];
+                triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+                if (bestScore < triangleScores[t])
+                {
+                    bestScore = triangleScores[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+std::vector<std::uint32_t> OptimizeOverdraw(const std::vector<std::uint32_t>& indices, const std::uint8_t* vertices,
+    std::size_t vertexStride, PositionAttribute position, std::uint32_t minClusterTriangles)
+{
+    const std::uint32_t triangleCount = static_cast<std::uint32_t>(indices.size() / 3);
+
+    if (triangleCount == 0)
+    {
+        return indices;
+    }
+
+    // A triangle whose three vertices all miss the cache is a natural seam in
+    // the cache-optimized order; cutting there costs almost no extra misses.
+    std::vector<std::uint32_t> clusterStarts = { 0 };
+    {
+        constexpr std::uint32_t FifoSize = 16;
+
+        std::vector<std::uint32_t> fifo;
+        std::uint32_t clusterSize = 0;
+
+        for (std::uint32_t t = 0; t < triangleCount; ++t)
+        {
+            std::uint32_t misses = 0;
+
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                const std::uint32_t v = indices[t * 3 + corner];
+
+                if (std::find(fifo.begin(), fifo.end(), v) == fifo.end())
+                {
+                    ++misses;
+                    fifo.push_back(v);
+
+                    if (FifoSize < fifo.size())
+                    {
+                        fifo.erase(fifo.begin());
+                    }
+                }
+            }
+
+            if (misses == 3 && minClusterTriangles <= clusterSize)
+            {
+                clusterStarts.push_back(t);
+                clusterSize = 0;
+            }
+
+            ++clusterSize;
+        }
+    }
+
+    clusterStarts.push_back(triangleCount);
+
+    Float3 meshCentroid;
+    {
+        double sx = 0.0, sy = 0.0, sz = 0.0;
+
+        for (const auto index : indices)
+        {
+            const Float3 p = ReadPosition(vertices, vertexStride, position, index);
+            sx += p.x;
+            sy += p.y;
+            sz += p.z;
+        }
+
+        meshCentroid = { static_cast<float>(sx / indices.size()), static_cast<float>(sy / indices.size()), static_cast<float>(sz / indices.size()) };
+    }
+
+    const std::size_t clusterCount = clusterStarts.size() - 1;
+
+    std::vector<float> sortKeys(clusterCount);
+
+    for (std::size_t c = 0; c < clusterCount; ++c)
+    {
+        Float3 centroid, normal;
+        float area = 0.f;
+
+        for (std::uint32_t t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t)
+        {
+            const Float3 p0 = ReadPosition(vertices, vertexStride, position, indices[t * 3]);
+            const Float3 p1 = ReadPosition(vertices, vertexStride, position, indices[t * 3 + 1]);
+            const Float3 p2 = ReadPosition(vertices, vertexStride, position, indices[t * 3 + 2]);
+
+            const Float3 e1 = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+            const Float3 e2 = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+
+            // Area weighted, so the cross product length is used as is
+            const Float3 n = { e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x };
+            const float a = std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+
+            normal.x += n.x;
+            normal.y += n.y;
+            normal.z += n.z;
+
+            centroid.x += (p0.x + p1.x + p2.x) / 3.f * a;
+            centroid.y += (p0.y + p1.y + p2.y) / 3.f * a;
+            centroid.z += (p0.z + p1.z + p2.z) / 3.f * a;
+
+            area += a;
+        }
+
+        if (0.f < area)
+        {
+            centroid = { centroid.x / area, centroid.y / area, centroid.z / area };
+        }
+
+        const float normalLength = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+
+        if (0.f < normalLength)
+        {
+            normal = { normal.x / normalLength, normal.y / normalLength, normal.z / normalLength };
+        }
+
+        sortKeys[c] = (centroid.x - meshCentroid.x) * normal.x + (centroid.y - meshCentroid.y) * normal.y + (centroid.z - meshCentroid.z) * normal.z;
+    }
+
+    std::vector<std::uint32_t> order(clusterCount);
+
+    for (std::uint32_t c = 0; c < clusterCount; ++c)
+    {
+        order[c] = c;
+    }
+
+    // Clusters that face away from the center are likely occluders of the rest
+    std::stable_sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<std::uint32_t> result;
+    result.reserve(indices.size());
+
+    for (const auto c : order)
+    {
+        result.insert(result.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+    }
+
+    return result;
+}
+
+std::vector<std::uint32_t> OptimizeVertexFetchRemap(const std::vector<std::uint32_t>& indices, std::uint32_t vertexCount, std::uint32_t& newVertexCount)
+{
+    std::vector<std::uint32_t> remap(vertexCount, InvalidVertex);
+
+    newVertexCount = 0;
+
+    for (const auto index : indices)
+    {
+        if (remap[index] == InvalidVertex)
+        {
+            remap[index] = newVertexCount++;
+        }
+    }
+
+    return remap;
+}
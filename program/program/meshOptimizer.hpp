@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "meshSimplifier.hpp"
+
+struct VertexCacheStats
+{
+    // cache misses per triangle (ideal 0.5, worst 3.0)
+    double acmr = 0.0;
+
+    // cache misses per referenced vertex (ideal 1.0)
+    double atvr = 0.0;
+};
+
+struct MeshOptimizeSettings
+{
+    bool vertexCache = true;
+
+    bool overdraw = true;
+
+    bool vertexFetch = true;
+
+    bool compactIndices = true;
+
+    // Byte offset of a float3 position, for vertex types without a VertexLayout;
+    // with one its POSITION attribute is used. Overdraw ordering and LODs read it.
+    std::uint32_t positionOffset = 0;
+
+    std::uint32_t minClusterTriangles = 64;
+
+    // Simplified levels appended to the index buffer, none by default
+    MeshLodSettings lod;
+};
+
+struct MeshOptimizeReport
+{
+    VertexCacheStats before;
+
+    VertexCacheStats after;
+
+    std::uint32_t verticesBefore = 0;
+
+    std::uint32_t verticesAfter = 0;
+
+    bool indices16 = false;
+
+    // Including level 0
+    std::uint32_t lodLevels = 1;
+};
+
+// Everything below indexes per-vertex arrays with the indices as given, so they
+// must be checked first. Logs and returns false when one is not below vertexCount.
+bool ValidateIndices(const std::vector<std::uint32_t>& indices, std::uint32_t vertexCount);
+
+// FIFO post-transform cache simulation, the model most hardware is closest to
+VertexCacheStats AnalyzeVertexCache(const std::vector<std::uint32_t>& indices, std::uint32_t vertexCount, std::uint32_t cacheSize = 16);
+
+// Forsyth's linear-speed triangle reordering for post-transform cache locality
+std::vector<std::uint32_t> OptimizeVertexCache(const std::vector<std::uint32_t>& indices, std::uint32_t vertexCount);
+
+// Splits cache-ordered triangles into clusters and sorts them so outward facing
+// clusters are drawn first, keeping the order inside each cluster
+std::vector<std::uint32_t> OptimizeOverdraw(const std::vector<std::uint32_t>& indices, const std::uint8_t* vertices,
+    std::size_t vertexStride, PositionAttribute position, std::uint32_t minClusterTriangles);
+
+// Returns old -> new vertex index in first-use order; unreferenced vertices map to InvalidVertex
+constexpr std::uint32_t InvalidVertex = 0xffffffff;
+
+std::vector<std::uint32_t> OptimizeVertexFetchRemap(const std::vector<std::uint32_t>& indices, std::uint32_t vertexCount, std::uint32_t& newVertexCount);
+
+template<typename VertexType>
+std::vector<VertexType> RemapVertices(const std::vector<VertexType>& vertices, const std::vector<std::uint32_t>& remap, std::uint32_t newVertexCount)
+{
+    std::vector<VertexType> result(newVertexCount);
+
+    for (std::size_t i = 0; i < vertices.size(); ++i)
+    {
+        if (remap[i] != InvalidVertex)
+        {
+            result[remap[i]] = vertices[i];
+        }
+    }
+
+    return result;
+}
+
+inline bool CanUse16BitIndices(std::uint32_t vertexCount)
+{
+    return vertexCount <= 0x10000;
+}
@@ -0,0 +1,611 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <tuple>
+
+#include "meshOptimizer.hpp"
+#include "meshSimplifier.hpp"
+
+namespace
+{
+    // Planes through border edges count this much more than faces of the same size
+    constexpr float BorderWeight = 10.f;
+
+    // A level keeping more than this fraction of the previous one's indices ends the chain
+    constexpr float MinLevelReduction = 0.9f;
+
+    enum class VertexKind : std::uint8_t
+    {
+        Manifold,
+        Border,
+        // Attribute seams and non-manifold vertices
+        Locked,
+    };
+
+    struct Float3
+    {
+        float x = 0.f, y = 0.f, z = 0.f;
+    };
+
+    Float3 Sub(const Float3& a, const Float3& b)
+    {
+        return { a.x - b.x, a.y - b.y, a.z - b.z };
+    }
+
+    Float3 Cross(const Float3& a, const Float3& b)
+    {
+        return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    }
+
+    float Dot(const Float3& a, const Float3& b)
+    {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+
+    Float3 ReadPosition(const std::uint8_t* vertices, std::size_t stride, PositionAttribute position, std::uint32_t index)
+    {
+        float p[3] = {};
+        ReadVertexPosition(reinterpret_cast<const std::byte*>(vertices + index * stride + position.offset), position.format, p);
+        return { p[0], p[1], p[2] };
+    }
+
+    // Sum of weighted squared distances to a set of planes, as the symmetric
+    // matrix of (a b c d) (a b c d)^T
+    struct Quadric
+    {
+        float aa = 0.f, ab = 0.f, ac = 0.f, ad = 0.f;
+
+        float bb = 0.f, bc = 0.f, bd = 0.f;
+
+        float cc = 0.f, cd = 0.f;
+
+        float dd = 0.f;
+
+        float weight = 0.f;
+    };
+
+    // normal must be unit length
+    void AddPlane(Quadric& q, const Float3& normal, const Float3& point, float weight)
+    {
+        const float d = -Dot(normal, point);
+
+        q.aa += weight * normal.x * normal.x;
+        q.ab += weight * normal.x * normal.y;
+        q.ac += weight * normal.x * normal.z;
+        q.ad += weight * normal.x * d;
+        q.bb += weight * normal.y * normal.y;
+        q.bc += weight * normal.y * normal.z;
+        q.bd += weight * normal.y * d;
+        q.cc += weight * normal.z * normal.z;
+        q.cd += weight * normal.z * d;
+        q.dd += weight * d * d;
+        q.weight += weight;
+    }
+
+    void AddQuadric(Quadric& q, const Quadric& other)
+    {
+        q.aa += other.aa;
+        q.ab += other.ab;
+        q.ac += other.ac;
+        q.ad += other.ad;
+        q.bb += other.bb;
+        q.bc += other.bc;
+        q.bd += other.bd;
+        q.cc += other.cc;
+        q.cd += other.cd;
+        q.dd += other.dd;
+        q.weight += other.weight;
+    }
+
+    // Weighted mean of the squared distances from p to the planes of a and b together
+    float CollapseError(const Quadric& a, const Quadric& b, const Float3& p)
+    {
+        const float weight = a.weight + b.weight;
+
+        if (weight <= 0.f)
+        {
+            return 0.f;
+        }
+
+        const float aa = a.aa + b.aa, ab = a.ab + b.ab, ac = a.ac + b.ac, ad = a.ad + b.ad;
+        const float bb = a.bb + b.bb, bc = a.bc + b.bc, bd = a.bd + b.bd;
+        const float cc = a.cc + b.cc, cd = a.cd + b.cd, dd = a.dd + b.dd;
+
+        const float error =
+            aa * p.x * p.x + bb * p.y * p.y + cc * p.z * p.z +
+            2.f * (ab * p.x * p.y + ac * p.x * p.z + bc * p.y * p.z) +
+            2.f * (ad * p.x + bd * p.y + cd * p.z) + dd;
+
+        return std::max(error, 0.f) / weight;
+    }
+
+    struct Collapse
+    {
+        std::uint32_t from = 0;
+
+        std::uint32_t to = 0;
+
+        // Squared distance
+        float error = 0.f;
+    };
+
+    // Collapses are ordered by the top 16 bits of their error, close enough to exact
+    constexpr std::uint32_t SortBuckets = 1 << 16;
+
+    std::uint32_t ErrorBucket(float error)
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &error, sizeof(bits));
+        return std::min(bits >> 15, SortBuckets - 1);
+    }
+
+    // Maps every vertex to the first vertex at the same position
+    std::vector<std::uint32_t> WeldPositions(const std::vector<Float3>& positions)
+    {
+        const auto vertexCount = static_cast<std::uint32_t>(positions.size());
+
+        // Bit patterns, so the order is strict even with NaNs in unused vertices
+        struct Key
+        {
+            std::uint32_t bits[3];
+
+            std::uint32_t index;
+        };
+
+        std::vector<Key> keys(vertexCount);
+
+        for (std::uint32_t i = 0; i < vertexCount; ++i)
+        {
+            std::memcpy(keys[i].bits, &positions[i], sizeof(keys[i].bits));
+            keys[i].index = i;
+        }
+
+        const auto samePosition = [](const Key& a, const Key& b)
+        {
+            return a.bits[0] == b.bits[0] && a.bits[1] == b.bits[1] && a.bits[2] == b.bits[2];
+        };
+
+        std::sort(keys.begin(), keys.end(), [](const Key& a, const Key& b)
+        {
+            return std::tie(a.bits[0], a.bits[1], a.bits[2], a.index) < std::tie(b.bits[0], b.bits[1], b.bits[2], b.index);
+        });
+
+        std::vector<std::uint32_t> canonical(vertexCount);
+
+        for (std::uint32_t i = 0; i < vertexCount; ++i)
+        {
+            canonical[keys[i].index] = 0 < i && samePosition(keys[i - 1], keys[i]) ? canonical[keys[i - 1].index] : keys[i].index;
+        }
+
+        return canonical;
+    }
+
+    // Triangles around every vertex, as offsets into the index buffer
+    void BuildVertexTriangles(const std::vector<std::uint32_t>& indices, std::uint32_t vertexCount,
+        std::vector<std::uint32_t>& offsets, std::vector<std::uint32_t>& triangles)
+    {
+        offsets.assign(vertexCount + 1, 0);
+
+        for (const auto index : indices)
+        {
+            ++offsets[index + 1];
+        }
+
+        for (std::uint32_t i = 0; i < vertexCount; ++i)
+        {
+            offsets[i + 1] += offsets[i];
+        }
+
+        triangles.resize(indices.size());
+
+        std::vector<std::uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+
+        for (std::uint32_t i = 0; i < indices.size(); ++i)
+        {
+            triangles[cursor[indices[i]]++] = i - i % 3;
+        }
+    }
+}
+
+std::vector<std::uint32_t> SimplifyMesh(const std::vector<std::uint32_t>& indices, const std::uint8_t* vertices,
+    std::size_t vertexStride, std::uint32_t vertexCount, PositionAttribute position,
+    std::uint32_t targetIndexCount, float maxError, float* resultError)
+{
+    std::vector<std::uint32_t> result = indices;
+
+    float worstError = 0.f;
+
+    if (result.size() <= targetIndexCount || vertexCount == 0)
+    {
+        if (resultError)
+        {
+            *resultError = 0.f;
+        }
+
+        return result;
+    }
+
+    std::vector<Float3> positions(vertexCount);
+
+    for (std::uint32_t i = 0; i < vertexCount; ++i)
+    {
+        positions[i] = ReadPosition(vertices, vertexStride, position, i);
+    }
+
+    // Topology is looked at with vertices welded by position, so a UV seam is not a border
+    const auto canonical = WeldPositions(positions);
+
+    std::vector<std::uint32_t> wedges(vertexCount, 0);
+
+    for (std::uint32_t i = 0; i < vertexCount; ++i)
+    {
+        ++wedges[canonical[i]];
+    }
+
+    std::vector<std::uint32_t> offsets;
+    std::vector<std::uint32_t> vertexTriangles;
+
+    {
+        std::vector<std::uint32_t> welded(result.size());
+
+        for (std::size_t i = 0; i < result.size(); ++i)
+        {
+            welded[i] = canonical[result[i]];
+        }
+
+        BuildVertexTriangles(welded, vertexCount, offsets, vertexTriangles);
+    }
+
+    // a -> b is a border edge when no triangle around b has b -> a
+    const auto isBorder = [&](std::uint32_t a, std::uint32_t b)
+    {
+        for (auto i = offsets[b]; i < offsets[b + 1]; ++i)
+        {
+            const auto t = vertexTriangles[i];
+
+            for (std::uint32_t k = 0; k < 3; ++k)
+            {
+                if (canonical[result[t + k]] == b && canonical[result[t + (k + 1) % 3]] == a)
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    };
+
+    // A border vertex has exactly one border edge leaving and one arriving; it may
+    // only slide along them, onto the vertex at their other end
+    std::vector<VertexKind> kinds(vertexCount, VertexKind::Manifold);
+    std::vector<std::uint32_t> borderOut(vertexCount, 0);
+    std::vector<std::uint32_t> borderIn(vertexCount, 0);
+    std::vector<std::uint32_t> borderNext(vertexCount, InvalidVertex);
+    std::vector<std::uint32_t> borderPrevious(vertexCount, InvalidVertex);
+    std::vector<Quadric> quadrics(vertexCount);
+
+    for (std::size_t t = 0; t + 2 < result.size(); t += 3)
+    {
+        const std::uint32_t c[3] = { canonical[result[t]], canonical[result[t + 1]], canonical[result[t + 2]] };
+        const Float3 p[3] = { positions[c[0]], positions[c[1]], positions[c[2]] };
+
+        Float3 normal = Cross(Sub(p[1], p[0]), Sub(p[2], p[0]));
+        const float length = std::sqrt(Dot(normal, normal));
+
+        if (length <= 0.f)
+        {
+            continue;
+        }
+
+        normal = { normal.x / length, normal.y / length, normal.z / length };
+
+        for (std::uint32_t k = 0; k < 3; ++k)
+        {
+            AddPlane(quadrics[c[k]], normal, p[0], length * 0.5f);
+        }
+
+        for (std::uint32_t k = 0; k < 3; ++k)
+        {
+            const auto a = c[k];
+            const auto b = c[(k + 1) % 3];
+
+            if (!isBorder(a, b))
+            {
+                continue;
+            }
+
+            ++borderOut[a];
+            ++borderIn[b];
+            borderNext[a] = b;
+            borderPrevious[b] = a;
+
+            // Plane through the edge, perpendicular to the face
+            const Float3 edge = Sub(p[(k + 1) % 3], p[k]);
+            Float3 side = Cross(edge, normal);
+            const float sideLength = std::sqrt(Dot(side, side));
+
+            if (0.f < sideLength)
+            {
+                side = { side.x / sideLength, side.y / sideLength, side.z / sideLength };
+
+                const float weight = Dot(edge, edge) * BorderWeight;
+                AddPlane(quadrics[a], side, p[k], weight);
+                AddPlane(quadrics[b], side, p[k], weight);
+            }
+        }
+    }
+
+    for (std::uint32_t i = 0; i < vertexCount; ++i)
+    {
+        if (1 < wedges[i] || borderOut[i] != borderIn[i] || 1 < borderOut[i])
+        {
+            kinds[i] = VertexKind::Locked;
+        }
+        else if (borderOut[i] == 1)
+        {
+            kinds[i] = VertexKind::Border;
+        }
+    }
+
+    const float errorLimit = maxError * maxError;
+
+    std::vector<Collapse> collapses;
+    std::vector<Collapse> sorted;
+    std::vector<std::uint32_t> buckets(SortBuckets + 1);
+    std::vector<std::uint32_t> remap(vertexCount);
+    std::vector<std::uint8_t> locked(vertexCount);
+
+    while (targetIndexCount < result.size())
+    {
+        BuildVertexTriangles(result, vertexCount, offsets, vertexTriangles);
+
+        collapses.clear();
+
+        for (std::size_t t = 0; t + 2 < result.size(); t += 3)
+        {
+            for (std::uint32_t k = 0; k < 3; ++k)
+            {
+                const auto a = result[t + k];
+                const auto b = result[t + (k + 1) % 3];
+
+                // An inner edge also shows up reversed in its other triangle, a border edge only once
+                const std::uint32_t ends[2][2] = { { a, b }, { b, a } };
+                const std::uint32_t directions = borderNext[canonical[a]] == canonical[b] ? 2 : 1;
+
+                for (std::uint32_t d = 0; d < directions; ++d)
+                {
+                    const auto from = ends[d][0];
+                    const auto to = ends[d][1];
+
+                    // Only vertices with a single wedge move, so from is its own canonical vertex
+                    const auto kind = kinds[canonical[from]];
+
+                    if (kind == VertexKind::Locked ||
+                        (kind == VertexKind::Border && borderNext[from] != canonical[to] && borderPrevious[from] != canonical[to]))
+                    {
+                        continue;
+                    }
+
+                    const float error = CollapseError(quadrics[from], quadrics[canonical[to]], positions[to]);
+
+                    if (error <= errorLimit)
+                    {
+                        collapses.push_back({ .from = from, .to = to, .error = error });
+                    }
+                }
+            }
+        }
+
+        // Counting sort on the top bits of the errors, which order like integers as they are not negative
+        std::fill(buckets.begin(), buckets.end(), 0);
+
+        for (const auto& collapse : collapses)
+        {
+            ++buckets[ErrorBucket(collapse.error) + 1];
+        }
+
+        for (std::uint32_t i = 0; i < SortBuckets; ++i)
+        {
+            buckets[i + 1] += buckets[i];
+        }
+
+        sorted.resize(collapses.size());
+
+        for (const auto& collapse : collapses)
+        {
+            sorted[buckets[ErrorBucket(collapse.error)]++] = collapse;
+        }
+
+        for (std::uint32_t i = 0; i < vertexCount; ++i)
+        {
+            remap[i] = i;
+        }
+
+        std::fill(locked.begin(), locked.end(), std::uint8_t(0));
+
+        // Collapses in one pass touch disjoint neighbourhoods, so each one sees
+        // the geometry the pass started with
+        const auto trianglesToRemove = (result.size() - targetIndexCount + 2) / 3;
+        std::size_t removed = 0;
+        std::uint32_t performed = 0;
+
+        for (const auto& collapse : sorted)
+        {
+            if (trianglesToRemove <= removed)
+            {
+                break;
+            }
+
+            if (locked[collapse.from] || locked[collapse.to])
+            {
+                continue;
+            }
+
+            const auto target = canonical[collapse.to];
+            const auto& to = positions[collapse.to];
+            bool flips = false;
+            std::uint32_t collapsing = 0;
+
+            for (auto i = offsets[collapse.from]; i < offsets[collapse.from + 1] && !flips; ++i)
+            {
+                const auto* triangle = &result[vertexTriangles[i]];
+
+                if (canonical[triangle[0]] == target || canonical[triangle[1]] == target || canonical[triangle[2]] == target)
+                {
+                    ++collapsing;
+                    continue;
+                }
+
+                Float3 p[3] = { positions[triangle[0]], positions[triangle[1]], positions[triangle[2]] };
+                const Float3 before = Cross(Sub(p[1], p[0]), Sub(p[2], p[0]));
+
+                for (std::uint32_t k = 0; k < 3; ++k)
+                {
+                    if (triangle[k] == collapse.from)
+                    {
+                        p[k] = to;
+                    }
+                }
+
+                const Float3 after = Cross(Sub(p[1], p[0]), Sub(p[2], p[0]));
+
+                flips = Dot(before, after) <= 0.f;
+            }
+
+            if (flips)
+            {
+                continue;
+            }
+
+            remap[collapse.from] = collapse.to;
+            AddQuadric(quadrics[target], quadrics[collapse.from]);
+            worstError = std::max(worstError, collapse.error);
+            removed += collapsing;
+            ++performed;
+
+            for (auto i = offsets[collapse.from]; i < offsets[collapse.from + 1]; ++i)
+            {
+                const auto* triangle = &result[vertexTriangles[i]];
+                locked[triangle[0]] = locked[triangle[1]] = locked[triangle[2]] = 1;
+            }
+        }
+
+        if (performed == 0)
+        {
+            break;
+        }
+
+        std::size_t write = 0;
+
+        for (std::size_t t = 0; t + 2 < result.size(); t += 3)
+        {
+            const std::uint32_t v[3] = { remap[result[t]], remap[result[t + 1]], remap[result[t + 2]] };
+
+            if (canonical[v[0]] == canonical[v[1]] || canonical[v[1]] == canonical[v[2]] || canonical[v[0]] == canonical[v[2]])
+            {
+                continue;
+            }
+
+            result[write++] = v[0];
+            result[write++] = v[1];
+            result[write++] = v[2];
+        }
+
+        result.resize(write);
+    }
+
+    if (resultError)
+    {
+        *resultError = std::sqrt(worstError);
+    }
+
+    return result;
+}
+
+MeshLodChain BuildLodChain(const std::vector<std::uint32_t>& indices, const std::uint8_t* vertices,
+    std::size_t vertexStride, std::uint32_t vertexCount, PositionAttribute position, const MeshLodSettings& settings)
+{
+    MeshLodChain chain;
+    chain.indices = indices;
+    chain.levels.push_back({ .indexOffset = 0, .indexCount = static_cast<std::uint32_t>(indices.size()), .error = 0.f });
+
+    if (settings.maxLevels <= 1 || indices.empty())
+    {
+        return chain;
+    }
+
+    Float3 min = ReadPosition(vertices, vertexStride, position, indices[0]);
+    Float3 max = min;
+
+    for (const auto index : indices)
+    {
+        const auto p = ReadPosition(vertices, vertexStride, position, index);
+        min = { std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z) };
+        max = { std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z) };
+    }
+
+    const auto extent = Sub(max, min);
+    const float errorLimit = settings.maxError * std::sqrt(Dot(extent, extent));
+
+    std::vector<std::uint32_t> current = indices;
+    float error = 0.f;
+
+    const auto maxLevels = std::min(settings.maxLevels, MaxMeshLods);
+
+    while (chain.levels.size() < maxLevels)
+    {
+        const auto triangles = static_cast<std::uint32_t>(current.size() / 3);
+        const auto target = std::max(static_cast<std::uint32_t>(triangles * settings.reduction), settings.minTriangles);
+
+        if (triangles <= target || errorLimit <= error)
+        {
+            break;
+        }
+
+        // Every level starts from the previous one, so their errors add up
+        float levelError = 0.f;
+        auto next = SimplifyMesh(current, vertices, vertexStride, vertexCount, position, target * 3, errorLimit - error, &levelError);
+
+        if (static_cast<float>(current.size()) * MinLevelReduction < static_cast<float>(next.size()))
+        {
+            break;
+        }
+
+        error += levelError;
+        next = OptimizeVertexCache(next, vertexCount);
+
+        chain.levels.push_back({
+            .indexOffset = static_cast<std::uint32_t>(chain.indices.size()),
+            .indexCount = static_cast<std::uint32_t>(next.size()),
+            .error = error });
+        chain.indices.insert(chain.indices.end(), next.begin(), next.end());
+
+        current = std::move(next);
+    }
+
+    return chain;
+}
+
+float LodProjectionScale(const float* projection, float viewportHeight)
+{
+    // projection[5] is cot(fovY / 2): one unit at distance 1 covers half the viewport that many times
+    return projection[5] * viewportHeight * 0.5f;
+}
+
+std::uint32_t SelectLod(std::span<const MeshLod> levels, float distance, float projectionScale, float maxPixelError)
+{
+    std::uint32_t lod = 0;
+
+    // error * projectionScale / distance <= maxPixelError, errors grow with the level
+    for (std::uint32_t i = 1; i < levels.size(); ++i)
+    {
+        if (maxPixelError * distance < levels[i].error * projectionScale)
+        {
+            break;
+        }
+
+        lod = i;
+    }
+
+    return lod;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "bounds.hpp"
+
+// Levels a mesh can have, including the full detail one
+constexpr std::uint32_t MaxMeshLods = 8;
+
+// One level of detail: a range of the mesh's index buffer over the shared vertices
+struct MeshLod
+{
+    std::uint32_t indexOffset = 0;
+
+    std::uint32_t indexCount = 0;
+
+    // Object-space deviation from the full detail mesh, 0 for level 0
+    float error = 0.f;
+};
+
+struct MeshLodSettings
+{
+    // Including the full detail level, so 1 builds no chain; at most MaxMeshLods
+    std::uint32_t maxLevels = 1;
+
+    // Every level aims for this fraction of the triangles of the previous one
+    float reduction = 0.5f;
+
+    // Largest error a level may have, as a fraction of the mesh's bounding box diagonal
+    float maxError = 0.05f;
+
+    // No level gets fewer triangles than this
+    std::uint32_t minTriangles = 32;
+};
+
+struct MeshLodChain
+{
+    // All levels back to back, level 0 first
+    std::vector<std::uint32_t> indices;
+
+    std::vector<MeshLod> levels;
+};
+
+// Quadric error metric simplification by collapsing edges onto one of their
+// vertices, so the result indexes the same vertex buffer. Open borders only
+// collapse along themselves and vertices that share a position with another
+// (attribute seams) stay in place. Stops at targetIndexCount or before an
+// error above maxError; both error values are distances in object units.
+std::vector<std::uint32_t> SimplifyMesh(const std::vector<std::uint32_t>& indices, const std::uint8_t* vertices,
+    std::size_t vertexStride, std::uint32_t vertexCount, PositionAttribute position,
+    std::uint32_t targetIndexCount, float maxError, float* resultError = nullptr);
+
+// Simplifies level after level from the previous one and reorders each new
+// level for the vertex cache. Level 0 is indices as given. The chain ends
+// early once a level would not remove at least a tenth of the triangles.
+MeshLodChain BuildLodChain(const std::vector<std::uint32_t>& indices, const std::uint8_t* vertices,
+    std::size_t vertexStride, std::uint32_t vertexCount, PositionAttribute position, const MeshLodSettings& settings);
+
+// Pixels per object-space unit at distance 1 for a projection matrix (row-major
+// as in MakeFrustum) and a viewport height in pixels
+float LodProjectionScale(const float* projection, float viewportHeight);
+
+// The coarsest level whose error, projected from distance, stays within
+// maxPixelError pixels. distance would be from the camera to the nearest point
+// of the instance bounds, in object units, or divided by the instance scale.
+std::uint32_t SelectLod(std::span<const MeshLod> levels, float distance, float projectionScale, float maxPixelError);
@@ -0,0 +1,280 @@
+#include "logger.hpp"
+#include "frameScheduler.hpp"
+#include "nullBackend.hpp"
+
+bool NullBackend::init(const BackendDesc& desc)
+{
+    ++m_stats.apiCalls;
+
+    if (!validate(0 < desc.width && 0 < desc.height, L"画面サイズが不正です") ||
+        !validate(2 <= desc.framesInFlight && desc.framesInFlight <= FrameScheduler::MaxFramesInFlight, L"framesInFlight が不正です"))
+    {
+        return false;
+    }
+
+    m_framesInFlight = desc.framesInFlight;
+
+    if (!validate(m_descriptors.init(DescriptorAllocator::DefaultCapacity, DescriptorAllocator::DefaultTransientCapacity), L"ディスクリプタヒープの初期化に失敗しました") ||
+        !validate(m_transientMemory.init(&m_transientPageSource), L"一時バッファの初期化に失敗しました"))
+    {
+        return false;
+    }
+
+    m_initialized = true;
+
+    return true;
+}
+
+bool NullBackend::frameBegin()
+{
+    ++m_stats.apiCalls;
+
+    if (!validate(m_initialized, L"init 前に frameBegin が呼ばれました") ||
+        !validate(!m_inFrame, L"frameBegin が二重に呼ばれました"))
+    {
+        return false;
+    }
+
+    m_inFrame = true;
+
+    m_currentPipeline = {};
+    m_currentVertexBuffer = {};
+    m_currentIndexBuffer = {};
+
+    return true;
+}
+
+bool NullBackend::frameEnd()
+{
+    ++m_stats.apiCalls;
+
+    if (!validate(m_inFrame, L"frameBegin なしで frameEnd が呼ばれました"))
+    {
+        return false;
+    }
+
+    m_inFrame = false;
+
+    ++m_stats.frames;
+
+    m_descriptors.endFrame(m_stats.frames);
+    m_transientMemory.endFrame(m_stats.frames);
+
+    if (m_framesInFlight <= m_stats.frames)
+    {
+        m_descriptors.reclaim(m_stats.frames - m_framesInFlight + 1);
+        m_transientMemory.reclaim(m_stats.frames - m_framesInFlight + 1);
+    }
+
+    return true;
+}
+
+bool NullBackend::waitIdle()
+{
+    ++m_stats.apiCalls;
+
+    m_descriptors.reclaim(m_stats.frames);
+    m_transientMemory.reclaim(m_stats.frames);
+
+    return true;
+}
+
+bool NullBackend::resize(int width, int height)
+{
+    ++m_stats.apiCalls;
+
+    if (!validate(m_initialized, L"init 前に resize が呼ばれました") ||
+        !validate(!m_inFrame, L"フレームの途中で resize が呼ばれました") ||
+        !validate(0 < width && 0 < height, L"画面サイズが不正です"))
+    {
+        return false;
+    }
+
+    ++m_stats.resizes;
+
+    return true;
+}
+
+std::optional<BufferHandle> NullBackend::createBuffer(BufferUsage usage, const void* data, std::size_t sizeInBytes)
+{
+    ++m_stats.apiCalls;
+
+    if (!validate(m_initialized, L"init 前にバッファが作成されました") ||
+        !validate(data != nullptr && 0 < sizeInBytes, L"バッファのデータが空です"))
+    {
+        return std::nullopt;
+    }
+
+    m_buffers.push_back({ .usage = usage, .sizeInBytes = sizeInBytes });
+
+    ++m_stats.buffersCreated;
+    m_stats.bytesUploaded += sizeInBytes;
+
+    return BufferHandle{ static_cast<std::uint32_t>(m_buffers.size()) };
+}
+
+void NullBackend::releaseBuffer(BufferHandle buffer)
+{
+    ++m_stats.apiCalls;
+
+    if (!validate(buffer && buffer.id <= m_buffers.size(), L"不正なバッファです") ||
+        !validate(!m_buffers[buffer.id - 1].released, L"バッファが二重に解放されました"))
+    {
+        return;
+    }
+
+    m_buffers[buffer.id - 1].released = true;
+
+    ++m_stats.buffersReleased;
+}
+
+DescriptorHandle NullBackend::createBufferView(BufferHandle buffer, std::uint32_t offset, std::uint32_t sizeInBytes)
+{
+    ++m_stats.apiCalls;
+
+    if (!validate(m_initialized, L"init 前にビューが作成されました") ||
+        !validate(offset % 4 == 0 && sizeInBytes % 4 == 0 && 0 < sizeInBytes, L"バッファビューの範囲が不正です") ||
+        !validate(buffer && buffer.id <= m_buffers.size() && !m_buffers[buffer.id - 1].released, L"解放済みまたは無効なバッファのビューです") ||
+        !validate(static_cast<std::size_t>(offset) + sizeInBytes <= m_buffers[buffer.id - 1].sizeInBytes, L"バッファビューの範囲が不正です"))
+    {
+        return {};
+    }
+
+    const auto view = m_descriptors.allocate();
+
+    if (view)
+    {
+        ++m_stats.viewsCreated;
+    }
+
+    return view;
+}
+
+void NullBackend::releaseView(DescriptorHandle view)
+{
+    ++m_stats.apiCalls;
+
+    if (view)
+    {
+        m_descriptors.free(view);
+
+        ++m_stats.viewsReleased;
+    }
+}
+
+std::optional<TransientAllocation> NullBackend::allocateTransient(std::uint64_t sizeInBytes, std::uint64_t alignment)
+{
+    ++m_stats.apiCalls;
+
+    if (!validate(m_inFrame, L"フレーム外で一時バッファが確保されました") ||
+        !validate(0 < sizeInBytes, L"一時バッファのサイズが 0 です"))
+    {
+        return std::nullopt;
+    }
+
+    return m_transientMemory.allocate(sizeInBytes, alignment);
+}
+
+std::optional<PipelineHandle> NullBackend::createPipeline(const PipelineDesc& desc)
+{
+    ++m_stats.apiCalls;
+
+    if (!validate(m_initialized, L"init 前にパイプラインが作成されました") ||
+        !validate(!desc.vertexShaderPath.empty() && !desc.pixelShaderPath.empty(), L"シェーダーのパスが空です") ||
+        !validate(!desc.inputLayout.empty(), L"入力レイアウトが空です"))
+    {
+        return std::nullopt;
+    }
+
+    ++m_pipelineCount;
+    ++m_stats.pipelinesCreated;
+
+    return PipelineHandle{ m_pipelineCount };
+}
+
+void NullBackend::setPipeline(PipelineHandle pipeline)
+{
+    ++m_stats.apiCalls;
+
+    if (!validate(m_inFrame, L"frameBegin の外で setPipeline が呼ばれました") ||
+        !validate(pipeline && pipeline.id <= m_pipelineCount, L"不正なパイプラインです"))
+    {
+        return;
+    }
+
+    if (!(pipeline == m_currentPipeline))
+    {
+        m_currentPipeline = pipeline;
+        ++m_stats.stateChanges;
+    }
+}
+
+void NullBackend::draw(const DrawIndexedDesc& desc)
+{
+    ++m_stats.apiCalls;
+
+    const auto& vb = desc.vertexBuffer;
+    const auto& ib = desc.indexBuffer;
+
+    if (!validate(m_inFrame, L"frameBegin の外で draw が呼ばれました") ||
+        !validate(static_cast<bool>(m_currentPipeline), L"パイプラインが設定されていません") ||
+        !validateView(vb.buffer, BufferUsage::Vertex, vb.offset, vb.sizeInBytes) ||
+        !validateView(ib.buffer, BufferUsage::Index, ib.offset, ib.sizeInBytes) ||
+        !validate(0 < vb.strideInBytes, L"頂点ストライドが 0 です") ||
+        !validate(0 < desc.instanceCount, L"インスタンス数が 0 です") ||
+        !validate((static_cast<std::uint64_t>(desc.startIndex) + desc.indexCount) * IndexSize(ib.format) <= ib.sizeInBytes, L"インデックスがバッファの範囲外です"))
+    {
+        return;
+    }
+
+    if (const auto& instances = desc.instanceBuffer; instances)
+    {
+        // Transient memory has no buffer to check the view against
+        if ((instances.buffer && !validateView(instances.buffer, BufferUsage::Vertex, instances.offset, instances.sizeInBytes)) ||
+            !validate((static_cast<std::uint64_t>(desc.startInstance) + desc.instanceCount) * instances.strideInBytes <= instances.sizeInBytes, L"インスタンスがバッファの範囲外です"))
+        {
+            return;
+        }
+    }
+
+    if (vb.buffer.id != m_currentVertexBuffer.id)
+    {
+        m_currentVertexBuffer = vb.buffer;
+        ++m_stats.stateChanges;
+    }
+
+    if (ib.buffer.id != m_currentIndexBuffer.id)
+    {
+        m_currentIndexBuffer = ib.buffer;
+        ++m_stats.stateChanges;
+    }
+
+    ++m_stats.draws;
+    m_stats.instances += desc.instanceCount;
+    m_stats.indices += static_cast<std::uint64_t>(desc.indexCount) * desc.instanceCount;
+}
+
+bool NullBackend::validate(bool condition, const wchar_t* message)
+{
+    if (!condition)
+    {
+        ++m_stats.validationErrors;
+        ErrorLog(message);
+    }
+
+    return condition;
+}
+
+bool NullBackend::validateView(BufferHandle buffer, BufferUsage usage, std::uint32_t offset, std::uint32_t sizeInBytes)
+{
+    if (!validate(buffer && buffer.id <= m_buffers.size(), L"不正なバッファです"))
+    {
+        return false;
+    }
+
+    const auto& record = m_buffers[buffer.id - 1];
+
+    return validate(!record.released, L"解放済みのバッファです")
+        && validate(record.usage == usage, L"バッファの用途が一致しません")
+        && validate(static_cast<std::uint64_t>(offset) + sizeInBytes <= record.sizeInBytes, L"ビューがバッファの範囲外です");
+}
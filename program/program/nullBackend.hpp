@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "descriptorAllocator.hpp"
+#include "renderBackend.hpp"
+#include "transientAllocator.hpp"
+
+struct NullBackendStats
+{
+    std::uint64_t apiCalls = 0;
+
+    std::uint64_t frames = 0;
+
+    std::uint64_t resizes = 0;
+
+    std::uint64_t draws = 0;
+
+    std::uint64_t instances = 0;
+
+    std::uint64_t indices = 0;
+
+    std::uint64_t stateChanges = 0;
+
+    std::uint64_t buffersCreated = 0;
+
+    std::uint64_t buffersReleased = 0;
+
+    std::uint64_t pipelinesCreated = 0;
+
+    std::uint64_t viewsCreated = 0;
+
+    std::uint64_t viewsReleased = 0;
+
+    std::uint64_t bytesUploaded = 0;
+
+    std::uint64_t validationErrors = 0;
+};
+
+// Accepts every call without touching a GPU. Arguments are checked the way
+// the debug layer would, and everything is counted so CPU-side submission
+// cost can be measured on any platform.
+class NullBackend : public RenderBackend
+{
+public:
+
+    NullBackend() = default;
+
+    bool init(const BackendDesc& desc) override;
+
+    bool frameBegin() override;
+
+    bool frameEnd() override;
+
+    bool waitIdle() override;
+
+    bool resize(int width, int height) override;
+
+    std::optional<BufferHandle> createBuffer(BufferUsage usage, const void* data, std::size_t sizeInBytes) override;
+
+    void releaseBuffer(BufferHandle buffer) override;
+
+    DescriptorHandle createBufferView(BufferHandle buffer, std::uint32_t offset, std::uint32_t sizeInBytes) override;
+
+    void releaseView(DescriptorHandle view) override;
+
+    std::optional<TransientAllocation> allocateTransient(std::uint64_t sizeInBytes, std::uint64_t alignment = ConstantBufferAlignment) override;
+
+    std::optional<PipelineHandle> createPipeline(const PipelineDesc& desc) override;
+
+    void setPipeline(PipelineHandle pipeline) override;
+
+    PipelineHandle boundPipeline()const override { return m_currentPipeline; }
+
+    void draw(const DrawIndexedDesc& desc) override;
+
+    const NullBackendStats& stats()const { return m_stats; }
+
+    DescriptorAllocatorStats descriptorStats()const { return m_descriptors.stats(); }
+
+    TransientAllocatorStats transientStats()const { return m_transientMemory.stats(); }
+
+    void resetStats() { m_stats = {}; }
+
+private:
+
+    struct BufferRecord
+    {
+        BufferUsage usage = BufferUsage::Vertex;
+
+        std::size_t sizeInBytes = 0;
+
+        bool released = false;
+    };
+
+    bool validate(bool condition, const wchar_t* message);
+
+    bool validateView(BufferHandle buffer, BufferUsage usage, std::uint32_t offset, std::uint32_t sizeInBytes);
+
+    NullBackendStats m_stats;
+
+    std::vector<BufferRecord> m_buffers;
+
+    std::uint32_t m_pipelineCount = 0;
+
+    // A frame counts as complete once framesInFlight - 1 more have ended, where
+    // D3D12 would have waited for it, so freed slots come back no earlier than there
+    DescriptorAllocator m_descriptors;
+
+    HostTransientPageSource m_transientPageSource;
+
+    TransientAllocator m_transientMemory;
+
+    std::uint32_t m_framesInFlight = 2;
+
+    bool m_initialized = false;
+
+    bool m_inFrame = false;
+
+    PipelineHandle m_currentPipeline;
+
+    BufferHandle m_currentVertexBuffer;
+
+    BufferHandle m_currentIndexBuffer;
+};
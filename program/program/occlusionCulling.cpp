@@ -0,0 +1,728 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define OCCLUSION_CULLING_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OCCLUSION_CULLING_SSE2
+#endif
+
+#include "jobSystem.hpp"
+#include "logger.hpp"
+#include "occlusionCulling.hpp"
+#include "profiler.hpp"
+
+namespace
+{
+    constexpr std::uint32_t TileSize = OcclusionCuller::TileWidth * OcclusionCuller::TileHeight;
+
+    // Triangles are clipped to this many times the screen, so edge functions stay precise
+    constexpr float GuardBand = 4.f;
+
+    // dot(plane, clip) >= 0 inside: the D3D near plane z >= 0, then the guard band
+    constexpr float ClipPlanes[5][4] =
+    {
+        { 0.f, 0.f, 1.f, 0.f },
+        { 1.f, 0.f, 0.f, GuardBand },
+        { -1.f, 0.f, 0.f, GuardBand },
+        { 0.f, 1.f, 0.f, GuardBand },
+        { 0.f, -1.f, 0.f, GuardBand },
+    };
+
+    // Every plane adds at most one vertex to a triangle
+    constexpr std::size_t MaxClipVertices = 3 + std::size(ClipPlanes);
+
+    using ClipVertex = std::array<float, 4>;
+
+    struct ClipPolygon
+    {
+        std::array<ClipVertex, MaxClipVertices> vertices;
+
+        std::uint32_t count = 0;
+    };
+
+    // Row vector times a row-major 4x4
+    ClipVertex Transform(const float* point, const float* m)
+    {
+        ClipVertex result;
+
+        for (int c = 0; c < 4; ++c)
+        {
+            result[c] = point[0] * m[c] + point[1] * m[4 + c] + point[2] * m[8 + c] + m[12 + c];
+        }
+
+        return result;
+    }
+
+    void Multiply(const float* a, const float* b, float* result)
+    {
+        for (int row = 0; row < 4; ++row)
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                result[row * 4 + c] = a[row * 4] * b[c] + a[row * 4 + 1] * b[4 + c] + a[row * 4 + 2] * b[8 + c] + a[row * 4 + 3] * b[12 + c];
+            }
+        }
+    }
+
+    float PlaneDistance(const float* plane, const ClipVertex& v)
+    {
+        return plane[0] * v[0] + plane[1] * v[1] + plane[2] * v[2] + plane[3] * v[3];
+    }
+
+    // Bit per plane the vertex is outside of
+    std::uint32_t Outcode(const ClipVertex& v)
+    {
+        std::uint32_t code = 0;
+
+        for (std::uint32_t i = 0; i < std::size(ClipPlanes); ++i)
+        {
+            code |= PlaneDistance(ClipPlanes[i], v) < 0.f ? 1u << i : 0u;
+        }
+
+        return code;
+    }
+
+    // Sutherland-Hodgman against the planes the triangle crosses
+    ClipPolygon Clip(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c)
+    {
+        ClipPolygon polygon = { .vertices = { a, b, c }, .count = 3 };
+
+        const std::uint32_t codes[3] = { Outcode(a), Outcode(b), Outcode(c) };
+
+        std::uint32_t crossed = 0;
+
+        std::uint32_t outside = ~0u;
+
+        for (const auto code : codes)
+        {
+            crossed |= code;
+            outside &= code;
+        }
+
+        if (outside != 0)
+        {
+            return {};
+        }
+
+        for (std::uint32_t i = 0; i < std::size(ClipPlanes); ++i)
+        {
+            if ((crossed & (1u << i)) == 0)
+            {
+                continue;
+            }
+
+            const auto& plane = ClipPlanes[i];
+
+            ClipPolygon clipped;
+
+            for (std::uint32_t i = 0; i < polygon.count; ++i)
+            {
+                const auto& current = polygon.vertices[i];
+                const auto& next = polygon.vertices[(i + 1) % polygon.count];
+
+                const float currentDistance = PlaneDistance(plane, current);
+                const float nextDistance = PlaneDistance(plane, next);
+
+                if (0.f <= currentDistance)
+                {
+                    clipped.vertices[clipped.count++] = current;
+                }
+
+                if ((0.f <= currentDistance) != (0.f <= nextDistance))
+                {
+                    const float t = currentDistance / (currentDistance - nextDistance);
+
+                    auto& v = clipped.vertices[clipped.count++];
+
+                    for (int k = 0; k < 4; ++k)
+                    {
+                        v[k] = current[k] + (next[k] - current[k]) * t;
+                    }
+                }
+            }
+
+            polygon = clipped;
+
+            if (polygon.count < 3)
+            {
+                return {};
+            }
+        }
+
+        return polygon;
+    }
+
+    // Screen x, y in pixels with y down, and z / w
+    struct ScreenVertex
+    {
+        float x = 0.f;
+
+        float y = 0.f;
+
+        float z = 0.f;
+    };
+
+    ScreenVertex ToScreen(const ClipVertex& v, float width, float height)
+    {
+        const float inverseW = 1.f / v[3];
+
+        return
+        {
+            .x = (v[0] * inverseW * 0.5f + 0.5f) * width,
+            .y = (0.5f - v[1] * inverseW * 0.5f) * height,
+            .z = v[2] * inverseW,
+        };
+    }
+
+    // False for triangles without area or pixels. A pixel is covered when its center
+    // is, as on the GPU; shrinking triangles to whole pixels instead would open cracks
+    // along shared edges. Its depth is the farthest the triangle's plane reaches in it.
+    bool SetupTriangle(const ScreenVertex& a, const ScreenVertex& b, const ScreenVertex& c,
+        std::int32_t width, std::int32_t height, OcclusionTriangle& triangle)
+    {
+        const float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+
+        if (std::fabs(area) < 1e-6f)
+        {
+            return false;
+        }
+
+        triangle.minX = std::max(static_cast<std::int32_t>(std::ceil(std::min({ a.x, b.x, c.x }) - 0.5f)), 0);
+        triangle.minY = std::max(static_cast<std::int32_t>(std::ceil(std::min({ a.y, b.y, c.y }) - 0.5f)), 0);
+        triangle.maxX = std::min(static_cast<std::int32_t>(std::floor(std::max({ a.x, b.x, c.x }) - 0.5f)), width - 1);
+        triangle.maxY = std::min(static_cast<std::int32_t>(std::floor(std::max({ a.y, b.y, c.y }) - 0.5f)), height - 1);
+
+        if (triangle.maxX < triangle.minX || triangle.maxY < triangle.minY)
+        {
+            return false;
+        }
+
+        const ScreenVertex* vertices[3] = { &a, &b, &c };
+
+        const float sign = 0.f < area ? 1.f : -1.f;
+
+        for (int i = 0; i < 3; ++i)
+        {
+            const auto& p = *vertices[i];
+            const auto& q = *vertices[(i + 1) % 3];
+
+            triangle.edgeA[i] = (p.y - q.y) * sign;
+            triangle.edgeB[i] = (q.x - p.x) * sign;
+            triangle.edgeC[i] = (p.x * q.y - p.y * q.x) * sign;
+        }
+
+        const float dz1 = b.z - a.z;
+        const float dz2 = c.z - a.z;
+
+        triangle.za = (dz1 * (c.y - a.y) - dz2 * (b.y - a.y)) / area;
+        triangle.zb = (dz2 * (b.x - a.x) - dz1 * (c.x - a.x)) / area;
+        triangle.zc = a.z - triangle.za * a.x - triangle.zb * a.y + 0.5f * (std::fabs(triangle.za) + std::fabs(triangle.zb));
+
+        return true;
+    }
+
+    // Writes the nearer depth into the pixels of one tile row whose centers are inside
+    void RasterizeRow(float* depth, const OcclusionTriangle& triangle, float x, float y)
+    {
+        float rowC[3];
+
+        for (int i = 0; i < 3; ++i)
+        {
+            rowC[i] = triangle.edgeB[i] * y + triangle.edgeC[i];
+        }
+
+        const float rowZ = triangle.zb * y + triangle.zc;
+
+#if defined(OCCLUSION_CULLING_AVX2)
+        const __m256 xs = _mm256_add_ps(_mm256_set1_ps(x), _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f));
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+        for (int i = 0; i < 3; ++i)
+        {
+            const __m256 e = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(triangle.edgeA[i]), xs), _mm256_set1_ps(rowC[i]));
+
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(e, _mm256_setzero_ps(), _CMP_GE_OQ));
+        }
+
+        const __m256 z = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(triangle.za), xs), _mm256_set1_ps(rowZ));
+
+        const __m256 current = _mm256_loadu_ps(depth);
+
+        _mm256_storeu_ps(depth, _mm256_blendv_ps(current, _mm256_min_ps(current, z), inside));
+#elif defined(OCCLUSION_CULLING_SSE2)
+        for (int half = 0; half < 2; ++half)
+        {
+            const __m128 xs = _mm_add_ps(_mm_set1_ps(x + half * 4.f), _mm_setr_ps(0.f, 1.f, 2.f, 3.f));
+
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+            for (int i = 0; i < 3; ++i)
+            {
+                const __m128 e = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.edgeA[i]), xs), _mm_set1_ps(rowC[i]));
+
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(e, _mm_setzero_ps()));
+            }
+
+            const __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.za), xs), _mm_set1_ps(rowZ));
+
+            const __m128 current = _mm_loadu_ps(depth + half * 4);
+
+            const __m128 nearer = _mm_min_ps(current, z);
+
+            _mm_storeu_ps(depth + half * 4, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, current)));
+        }
+#else
+        for (std::uint32_t column = 0; column < OcclusionCuller::TileWidth; ++column)
+        {
+            const float px = x + column;
+
+            bool inside = true;
+
+            for (int i = 0; i < 3; ++i)
+            {
+                inside = inside && 0.f <= triangle.edgeA[i] * px + rowC[i];
+            }
+
+            if (inside)
+            {
+                depth[column] = std::min(depth[column], triangle.za * px + rowZ);
+            }
+        }
+#endif
+    }
+
+    // True when any depth in columns begin to end of a tile row is at least boxDepth
+    bool RowMayShow(const float* depth, std::uint32_t begin, std::uint32_t end, float boxDepth)
+    {
+        for (auto column = begin; column <= end; ++column)
+        {
+            if (boxDepth <= depth[column])
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
+
+bool OccluderMesh::init(std::span<const std::byte> vertexData, std::uint32_t vertexStride,
+    std::span<const std::byte> indexData, IndexFormat indexFormat, PositionAttribute position)
+{
+    release();
+
+    if (vertexStride == 0 || vertexStride < position.offset + std::min(VertexFormatSize(position.format), 12u))
+    {
+        ErrorLog(L"オクルーダーの頂点ストライドが位置属性より小さいです");
+        return false;
+    }
+
+    const auto vertexCount = static_cast<std::uint32_t>(vertexData.size() / vertexStride);
+
+    m_positions.resize(std::size_t(vertexCount) * 3);
+
+    for (std::uint32_t i = 0; i < vertexCount; ++i)
+    {
+        float point[3];
+
+        if (!ReadVertexPosition(vertexData.data() + std::size_t(i) * vertexStride + position.offset, position.format, point))
+        {
+            ErrorLog(L"オクルーダーの位置属性の形式に対応していません");
+            release();
+            return false;
+        }
+
+        std::copy(std::begin(point), std::end(point), m_positions.begin() + i * 3);
+    }
+
+    const auto indexSize = IndexSize(indexFormat);
+    const auto indexCount = indexData.size() / indexSize / 3 * 3;
+
+    m_indices.resize(indexCount);
+
+    for (std::size_t i = 0; i < indexCount; ++i)
+    {
+        if (indexFormat == IndexFormat::Uint16)
+        {
+            std::uint16_t index;
+            std::memcpy(&index, indexData.data() + i * indexSize, sizeof(index));
+            m_indices[i] = index;
+        }
+        else
+        {
+            std::memcpy(&m_indices[i], indexData.data() + i * indexSize, sizeof(std::uint32_t));
+        }
+
+        if (vertexCount <= m_indices[i])
+        {
+            ErrorLog(L"オクルーダーのインデックスが頂点数を超えています");
+            release();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void OccluderMesh::release()
+{
+    m_positions.clear();
+    m_indices.clear();
+}
+
+void OcclusionCuller::resize(std::uint32_t width, std::uint32_t height)
+{
+    m_tilesX = std::max((width + TileWidth - 1) / TileWidth, 1u);
+    m_tilesY = std::max((height + TileHeight - 1) / TileHeight, 1u);
+
+    m_width = m_tilesX * TileWidth;
+    m_height = m_tilesY * TileHeight;
+
+    m_depth.assign(std::size_t(m_tilesX) * m_tilesY * TileSize, 1.f);
+    m_tileMax.assign(std::size_t(m_tilesX) * m_tilesY, 1.f);
+}
+
+void OcclusionCuller::render(JobSystem& jobs, const float* viewProjection, std::span<const Occluder> occluders)
+{
+    const auto start = Profiler::Now();
+
+    std::copy(viewProjection, viewProjection + 16, m_viewProjection);
+
+    const auto occluderCount = static_cast<std::uint32_t>(occluders.size());
+
+    if (m_occluderTriangles.size() < occluderCount)
+    {
+        m_occluderTriangles.resize(occluderCount);
+    }
+
+    const float width = static_cast<float>(m_width);
+    const float height = static_cast<float>(m_height);
+
+    jobs.parallelFor(occluderCount, 1, [&](std::uint32_t begin, std::uint32_t end)
+        {
+            std::vector<ClipVertex> clipVertices;
+
+            for (auto i = begin; i < end; ++i)
+            {
+                auto& triangles = m_occluderTriangles[i];
+                triangles.clear();
+
+                const auto& occluder = occluders[i];
+
+                if (!occluder.mesh || occluder.mesh->empty())
+                {
+                    continue;
+                }
+
+                float worldViewProjection[16];
+                Multiply(occluder.world, viewProjection, worldViewProjection);
+
+                const auto positions = occluder.mesh->positions();
+
+                clipVertices.resize(positions.size() / 3);
+
+                for (std::size_t v = 0; v < clipVertices.size(); ++v)
+                {
+                    clipVertices[v] = Transform(positions.data() + v * 3, worldViewProjection);
+                }
+
+                const auto indices = occluder.mesh->indices();
+
+                for (std::size_t t = 0; t + 2 < indices.size(); t += 3)
+                {
+                    const auto polygon = Clip(clipVertices[indices[t]], clipVertices[indices[t + 1]], clipVertices[indices[t + 2]]);
+
+                    if (polygon.count < 3)
+                    {
+                        continue;
+                    }
+
+                    ScreenVertex screen[MaxClipVertices];
+
+                    for (std::uint32_t v = 0; v < polygon.count; ++v)
+                    {
+                        screen[v] = ToScreen(polygon.vertices[v], width, height);
+                    }
+
+                    for (std::uint32_t v = 2; v < polygon.count; ++v)
+                    {
+                        OcclusionTriangle triangle;
+
+                        if (SetupTriangle(screen[0], screen[v - 1], screen[v], m_width, m_height, triangle))
+                        {
+                            triangles.push_back(triangle);
+                        }
+                    }
+                }
+            }
+        });
+
+    m_triangles.clear();
+
+    std::uint32_t triangleCount = 0;
+
+    for (std::uint32_t i = 0; i < occluderCount; ++i)
+    {
+        m_triangles.insert(m_triangles.end(), m_occluderTriangles[i].begin(), m_occluderTriangles[i].end());
+
+        triangleCount += occluders[i].mesh ? occluders[i].mesh->triangleCount() : 0;
+    }
+
+    jobs.parallelFor(m_tilesY, 1, [&](std::uint32_t begin, std::uint32_t end)
+        {
+            for (auto tileY = begin; tileY < end; ++tileY)
+            {
+                rasterizeTileRow(tileY);
+            }
+        });
+
+    m_stats.occluders = occluderCount;
+    m_stats.triangles = triangleCount;
+    m_stats.rasterizedTriangles = static_cast<std::uint32_t>(m_triangles.size());
+    m_stats.renderNs = Profiler::Now() - start;
+}
+
+void OcclusionCuller::rasterizeTileRow(std::uint32_t tileY)
+{
+    auto* row = m_depth.data() + std::size_t(tileY) * m_tilesX * TileSize;
+
+    std::fill(row, row + std::size_t(m_tilesX) * TileSize, 1.f);
+
+    const auto y0 = static_cast<std::int32_t>(tileY * TileHeight);
+    const auto y1 = y0 + static_cast<std::int32_t>(TileHeight) - 1;
+
+    for (const auto& triangle : m_triangles)
+    {
+        if (triangle.maxY < y0 || y1 < triangle.minY)
+        {
+            continue;
+        }
+
+        const auto firstTile = static_cast<std::uint32_t>(triangle.minX) / TileWidth;
+        const auto lastTile = static_cast<std::uint32_t>(triangle.maxX) / TileWidth;
+
+        const auto firstRow = std::max(triangle.minY, y0) - y0;
+        const auto lastRow = std::min(triangle.maxY, y1) - y0;
+
+        for (auto tileX = firstTile; tileX <= lastTile; ++tileX)
+        {
+            const float x0 = tileX * TileWidth + 0.5f;
+            const float x1 = x0 + TileWidth - 1;
+
+            // Skip the tile when one edge is negative at every pixel center in it
+            bool outside = false;
+
+            for (int i = 0; i < 3 && !outside; ++i)
+            {
+                const float x = 0.f < triangle.edgeA[i] ? x1 : x0;
+                const float y = (0.f < triangle.edgeB[i] ? lastRow : firstRow) + y0 + 0.5f;
+
+                outside = triangle.edgeA[i] * x + triangle.edgeB[i] * y + triangle.edgeC[i] < 0.f;
+            }
+
+            if (outside)
+            {
+                continue;
+            }
+
+            auto* tile = row + std::size_t(tileX) * TileSize;
+
+            for (auto r = firstRow; r <= lastRow; ++r)
+            {
+                RasterizeRow(tile + r * TileWidth, triangle, x0, y0 + r + 0.5f);
+            }
+        }
+    }
+
+    for (std::uint32_t tileX = 0; tileX < m_tilesX; ++tileX)
+    {
+        const auto* tile = row + std::size_t(tileX) * TileSize;
+
+        m_tileMax[std::size_t(tileY) * m_tilesX + tileX] = *std::max_element(tile, tile + TileSize);
+    }
+}
+
+bool OcclusionCuller::testBox(const float* center, const float* extent)const
+{
+    float minX = std::numeric_limits<float>::max();
+    float minY = std::numeric_limits<float>::max();
+    float maxX = std::numeric_limits<float>::lowest();
+    float maxY = std::numeric_limits<float>::lowest();
+
+    float nearest = std::numeric_limits<float>::max();
+
+    // Corners are the transformed center plus or minus each scaled matrix row
+    const auto centerClip = Transform(center, m_viewProjection);
+
+    ClipVertex axes[3];
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            axes[axis][c] = extent[axis] * m_viewProjection[axis * 4 + c];
+        }
+    }
+
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        auto clip = centerClip;
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            const float sign = corner & (1 << axis) ? 1.f : -1.f;
+
+            for (int c = 0; c < 4; ++c)
+            {
+                clip[c] += sign * axes[axis][c];
+            }
+        }
+
+        // Reaching through the near plane: could cover the whole screen
+        if (clip[2] < 0.f || clip[3] <= 0.f)
+        {
+            return true;
+        }
+
+        const auto screen = ToScreen(clip, static_cast<float>(m_width), static_cast<float>(m_height));
+
+        minX = std::min(minX, screen.x);
+        minY = std::min(minY, screen.y);
+        maxX = std::max(maxX, screen.x);
+        maxY = std::max(maxY, screen.y);
+
+        nearest = std::min(nearest, screen.z);
+    }
+
+    // Every pixel the rectangle touches, not just those whose centers it covers
+    const auto x0 = static_cast<std::int32_t>(std::max(std::floor(minX), 0.f));
+    const auto y0 = static_cast<std::int32_t>(std::max(std::floor(minY), 0.f));
+    const auto x1 = static_cast<std::int32_t>(std::min(std::floor(maxX), m_width - 1.f));
+    const auto y1 = static_cast<std::int32_t>(std::min(std::floor(maxY), m_height - 1.f));
+
+    if (x1 < x0 || y1 < y0)
+    {
+        return false;
+    }
+
+    for (auto tileY = y0 / static_cast<std::int32_t>(TileHeight); tileY <= y1 / static_cast<std::int32_t>(TileHeight); ++tileY)
+    {
+        for (auto tileX = x0 / static_cast<std::int32_t>(TileWidth); tileX <= x1 / static_cast<std::int32_t>(TileWidth); ++tileX)
+        {
+            const auto tileIndex = std::size_t(tileY) * m_tilesX + tileX;
+
+            // Every occluder depth in the tile is nearer than the box
+            if (m_tileMax[tileIndex] < nearest)
+            {
+                continue;
+            }
+
+            const auto tileLeft = tileX * static_cast<std::int32_t>(TileWidth);
+            const auto tileTop = tileY * static_cast<std::int32_t>(TileHeight);
+
+            const auto begin = static_cast<std::uint32_t>(std::max(x0, tileLeft) - tileLeft);
+            const auto end = static_cast<std::uint32_t>(std::min(x1, tileLeft + static_cast<std::int32_t>(TileWidth) - 1) - tileLeft);
+
+            const auto* tile = m_depth.data() + tileIndex * TileSize;
+
+            for (auto y = std::max(y0, tileTop); y <= std::min(y1, tileTop + static_cast<std::int32_t>(TileHeight) - 1); ++y)
+            {
+                if (RowMayShow(tile + (y - tileTop) * TileWidth, begin, end, nearest))
+                {
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+bool OcclusionCuller::isVisible(const Aabb& box)const
+{
+    float center[3];
+    float extent[3];
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        center[axis] = (box.min[axis] + box.max[axis]) * 0.5f;
+        extent[axis] = (box.max[axis] - box.min[axis]) * 0.5f;
+    }
+
+    return testBox(center, extent);
+}
+
+std::span<const std::uint32_t> OcclusionCuller::cull(JobSystem& jobs, const InstanceBoundsStore& bounds, std::span<const std::uint32_t> candidates)
+{
+    const auto start = Profiler::Now();
+
+    const auto candidateCount = static_cast<std::uint32_t>(candidates.size());
+
+    const auto chunkCount = (candidateCount + ChunkSize - 1) / ChunkSize;
+
+    // Same packing as FrustumCuller: every chunk writes at its own offset, then the survivors slide down
+    m_visible.resize(candidateCount);
+    m_chunkCounts.assign(chunkCount, 0);
+
+    jobs.parallelFor(chunkCount, 1, [&](std::uint32_t begin, std::uint32_t end)
+        {
+            for (auto chunk = begin; chunk < end; ++chunk)
+            {
+                const auto first = chunk * ChunkSize;
+                const auto last = std::min(first + ChunkSize, candidateCount);
+
+                auto* visible = m_visible.data() + first;
+
+                std::uint32_t count = 0;
+
+                for (auto i = first; i < last; ++i)
+                {
+                    const auto instance = candidates[i];
+
+                    const float center[3] = { bounds.centerX()[instance], bounds.centerY()[instance], bounds.centerZ()[instance] };
+                    const float extent[3] = { bounds.extentX()[instance], bounds.extentY()[instance], bounds.extentZ()[instance] };
+
+                    visible[count] = instance;
+                    count += testBox(center, extent) ? 1 : 0;
+                }
+
+                m_chunkCounts[chunk] = count;
+            }
+        });
+
+    std::uint32_t visibleCount = 0;
+
+    for (std::uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+    {
+        const auto first = m_visible.begin() + chunk * ChunkSize;
+
+        std::copy(first, first + m_chunkCounts[chunk], m_visible.begin() + visibleCount);
+
+        visibleCount += m_chunkCounts[chunk];
+    }
+
+    m_stats.tested = candidateCount;
+    m_stats.occluded = candidateCount - visibleCount;
+    m_stats.testNs = Profiler::Now() - start;
+
+    return std::span(m_visible).first(visibleCount);
+}
+
+float OcclusionCuller::depth(std::uint32_t x, std::uint32_t y)const
+{
+    if (m_width <= x || m_height <= y)
+    {
+        return 1.f;
+    }
+
+    const auto tile = std::size_t(y / TileHeight) * m_tilesX + x / TileWidth;
+
+    return m_depth[tile * TileSize + (y % TileHeight) * TileWidth + x % TileWidth];
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "bounds.hpp"
+#include "frustumCulling.hpp"
+#include "renderBackend.hpp"
+
+class JobSystem;
+
+// Positions and triangles kept on the CPU so a mesh can be rasterized into the
+// occlusion buffer. Meant for a few large, simple meshes such as walls and floors.
+class OccluderMesh
+{
+public:
+
+    OccluderMesh() = default;
+
+    // Same data as Mesh::init; false for an unknown position format or an index out of range
+    bool init(std::span<const std::byte> vertexData, std::uint32_t vertexStride,
+        std::span<const std::byte> indexData, IndexFormat indexFormat, PositionAttribute position = {});
+
+    void release();
+
+    bool empty()const { return m_indices.empty(); }
+
+    // xyz per vertex
+    std::span<const float> positions()const { return m_positions; }
+
+    std::span<const std::uint32_t> indices()const { return m_indices; }
+
+    std::uint32_t triangleCount()const { return static_cast<std::uint32_t>(m_indices.size() / 3); }
+
+private:
+
+    std::vector<float> m_positions;
+
+    std::vector<std::uint32_t> m_indices;
+};
+
+struct Occluder
+{
+    const OccluderMesh* mesh = nullptr;
+
+    // Object to world, 4x4 row-major for row vectors as in TransformBounds
+    float world[16] = { 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f };
+};
+
+struct OcclusionStats
+{
+    std::uint32_t occluders = 0;
+
+    // Occluder triangles in, and screen triangles rasterized after clipping
+    std::uint32_t triangles = 0;
+
+    std::uint32_t rasterizedTriangles = 0;
+
+    // Instances tested by the last cull and how many of them were hidden
+    std::uint32_t tested = 0;
+
+    std::uint32_t occluded = 0;
+
+    std::uint64_t renderNs = 0;
+
+    std::uint64_t testNs = 0;
+};
+
+// One occluder triangle set up for rasterization. Edge functions are positive
+// inside and, like the depth plane, evaluated at pixel centers (x, y):
+// e = a * x + b * y + c, z = za * x + zb * y + zc
+struct OcclusionTriangle
+{
+    float edgeA[3] = {};
+
+    float edgeB[3] = {};
+
+    float edgeC[3] = {};
+
+    float za = 0.f;
+
+    float zb = 0.f;
+
+    float zc = 0.f;
+
+    // Pixel rectangle, inclusive
+    std::int32_t minX = 0;
+
+    std::int32_t minY = 0;
+
+    std::int32_t maxX = 0;
+
+    std::int32_t maxY = 0;
+};
+
+// Software occlusion culling against a small depth buffer. Occluders are
+// rasterized into 8x4 pixel tiles, 32 depths each so a row is one 8-wide or
+// two 4-wide vectors, and every tile also keeps its farthest depth. A box is
+// tested against those per-tile maxima first and only looks at pixels in tiles
+// where it may be in front. Depth is z / w in D3D clip space, 0 near and 1 far.
+class OcclusionCuller
+{
+public:
+
+    static constexpr std::uint32_t TileWidth = 8;
+
+    static constexpr std::uint32_t TileHeight = 4;
+
+    static constexpr std::uint32_t DefaultWidth = 320;
+
+    static constexpr std::uint32_t DefaultHeight = 180;
+
+    // Instances per job when testing
+    static constexpr std::uint32_t ChunkSize = 1024;
+
+    OcclusionCuller() { resize(DefaultWidth, DefaultHeight); }
+
+    // Rounded up to whole tiles; clears the buffer
+    void resize(std::uint32_t width, std::uint32_t height);
+
+    // Clears the buffer and rasterizes occluders as seen through viewProjection
+    // (row-major for row vectors, see MakeFrustum). Occluders are transformed
+    // and clipped in parallel, then every row of tiles is rasterized as its own job.
+    void render(JobSystem& jobs, const float* viewProjection, std::span<const Occluder> occluders);
+
+    // False when the world-space box is entirely behind the occluders of the last render
+    bool isVisible(const Aabb& box)const;
+
+    // The candidates that are not hidden, in their original order; candidates
+    // would normally be the result of Dx::cull. Valid until the next call.
+    std::span<const std::uint32_t> cull(JobSystem& jobs, const InstanceBoundsStore& bounds, std::span<const std::uint32_t> candidates);
+
+    std::uint32_t width()const { return m_width; }
+
+    std::uint32_t height()const { return m_height; }
+
+    // For inspecting the buffer
+    float depth(std::uint32_t x, std::uint32_t y)const;
+
+    const OcclusionStats& stats()const { return m_stats; }
+
+private:
+
+    void rasterizeTileRow(std::uint32_t tileY);
+
+    // center and extent of a world-space box
+    bool testBox(const float* center, const float* extent)const;
+
+    std::uint32_t m_width = 0;
+
+    std::uint32_t m_height = 0;
+
+    std::uint32_t m_tilesX = 0;
+
+    std::uint32_t m_tilesY = 0;
+
+    // Tile after tile, each TileHeight rows of TileWidth depths
+    std::vector<float> m_depth;
+
+    std::vector<float> m_tileMax;
+
+    float m_viewProjection[16] = {};
+
+    // Per occluder while transforming, so the jobs do not share a vector
+    std::vector<std::vector<OcclusionTriangle>> m_occluderTriangles;
+
+    std::vector<OcclusionTriangle> m_triangles;
+
+    std::vector<std::uint32_t> m_visible;
+
+    std::vector<std::uint32_t> m_chunkCounts;
+
+    OcclusionStats m_stats;
+};
@@ -0,0 +1,148 @@
+#include <algorithm>
+
+#include "pipelineCompiler.hpp"
+
+PipelineCompiler::PipelineCompiler(std::uint32_t threadCount)
+{
+    for (std::uint32_t i = 0; i < std::max(threadCount, 1u); ++i)
+    {
+        m_workers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+PipelineCompiler::~PipelineCompiler()
+{
+    {
+        std::lock_guard lock(m_mutex);
+
+        // Whoever queued these is going away; builds already running still finish
+        for (auto& job : m_jobs)
+        {
+            job.slot->status = PipelineStatus::Failed;
+        }
+
+        m_jobs.clear();
+        m_stop = true;
+    }
+
+    m_wake.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+std::uint32_t PipelineCompiler::DefaultThreadCount()
+{
+    // Leave the render thread and the frame's own workers some room
+    return std::max(std::thread::hardware_concurrency() / 2, 1u);
+}
+
+PipelineHandle PipelineCompiler::request(std::uint64_t key, BuildFunc build)
+{
+    ++m_requests;
+
+    if (const auto found = m_handles.find(key); found != m_handles.end())
+    {
+        // A failed build is not remembered; the next request tries again under a new handle
+        if (status(found->second) != PipelineStatus::Failed)
+        {
+            ++m_deduplicated;
+            return found->second;
+        }
+
+        m_handles.erase(found);
+    }
+
+    m_slots.push_back(std::make_unique<Slot>());
+
+    const PipelineHandle handle{ static_cast<std::uint32_t>(m_slots.size()) };
+
+    m_handles.emplace(key, handle);
+
+    {
+        std::lock_guard lock(m_mutex);
+        m_jobs.push_back({ .slot = m_slots.back().get(), .build = std::move(build) });
+    }
+
+    m_wake.notify_one();
+
+    return handle;
+}
+
+PipelineStatus PipelineCompiler::status(PipelineHandle pipeline)const
+{
+    if (!pipeline || m_slots.size() < pipeline.id)
+    {
+        return PipelineStatus::Failed;
+    }
+
+    return m_slots[pipeline.id - 1]->status.load(std::memory_order_acquire);
+}
+
+PipelineStatus PipelineCompiler::wait(PipelineHandle pipeline)
+{
+    if (!pipeline || m_slots.size() < pipeline.id)
+    {
+        return PipelineStatus::Failed;
+    }
+
+    const auto& slot = *m_slots[pipeline.id - 1];
+
+    std::unique_lock lock(m_mutex);
+    m_done.wait(lock, [&slot] { return slot.status != PipelineStatus::Pending; });
+
+    return slot.status;
+}
+
+void PipelineCompiler::waitAll()
+{
+    std::unique_lock lock(m_mutex);
+    m_done.wait(lock, [this] { return m_jobs.empty() && m_running == 0; });
+}
+
+PipelineCompilerStats PipelineCompiler::stats()const
+{
+    return
+    {
+        .requests = m_requests,
+        .deduplicated = m_deduplicated,
+        .built = m_built,
+        .failed = m_failed,
+    };
+}
+
+void PipelineCompiler::workerLoop()
+{
+    for (;;)
+    {
+        Job job;
+
+        {
+            std::unique_lock lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+
+            if (m_stop)
+            {
+                return;
+            }
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            ++m_running;
+        }
+
+        const bool succeeded = job.build();
+
+        ++(succeeded ? m_built : m_failed);
+
+        {
+            std::lock_guard lock(m_mutex);
+            job.slot->status.store(succeeded ? PipelineStatus::Ready : PipelineStatus::Failed, std::memory_order_release);
+            --m_running;
+        }
+
+        m_done.notify_all();
+    }
+}
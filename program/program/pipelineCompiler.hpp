@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "renderBackend.hpp"
+
+struct PipelineCompilerStats
+{
+    std::uint64_t requests = 0;
+
+    std::uint64_t deduplicated = 0;
+
+    std::uint64_t built = 0;
+
+    std::uint64_t failed = 0;
+};
+
+// Builds pipelines on background threads and hands out handles right away.
+// Requests with the same key share one handle, so identical descriptions are
+// only built once; a key whose build failed is built again on the next
+// request, e.g. after a shader was fixed. request, status and stats belong to the thread that owns
+// the backend; builds only ever touch their own slot.
+class PipelineCompiler
+{
+public:
+
+    using BuildFunc = std::function<bool()>;
+
+    explicit PipelineCompiler(std::uint32_t threadCount = DefaultThreadCount());
+
+    ~PipelineCompiler();
+
+    PipelineCompiler(const PipelineCompiler&) = delete;
+
+    PipelineCompiler& operator=(const PipelineCompiler&) = delete;
+
+    // build runs on a worker only when the key has not been requested before or
+    // its last build failed; handles of failed builds stay Failed
+    PipelineHandle request(std::uint64_t key, BuildFunc build);
+
+    PipelineStatus status(PipelineHandle pipeline)const;
+
+    // Blocks until the pipeline left the Pending state
+    PipelineStatus wait(PipelineHandle pipeline);
+
+    void waitAll();
+
+    std::uint32_t pipelineCount()const { return static_cast<std::uint32_t>(m_slots.size()); }
+
+    PipelineCompilerStats stats()const;
+
+    static std::uint32_t DefaultThreadCount();
+
+private:
+
+    struct Slot
+    {
+        std::atomic<PipelineStatus> status = PipelineStatus::Pending;
+    };
+
+    struct Job
+    {
+        Slot* slot = nullptr;
+
+        BuildFunc build;
+    };
+
+    void workerLoop();
+
+    std::vector<std::thread> m_workers;
+
+    std::vector<std::unique_ptr<Slot>> m_slots;
+
+    std::unordered_map<std::uint64_t, PipelineHandle> m_handles;
+
+    std::mutex m_mutex;
+
+    std::condition_variable m_wake;
+
+    std::condition_variable m_done;
+
+    std::deque<Job> m_jobs;
+
+    std::uint32_t m_running = 0;
+
+    std::atomic<std::uint64_t> m_built = 0;
+
+    std::atomic<std::uint64_t> m_failed = 0;
+
+    std::uint64_t m_requests = 0;
+
+    std::uint64_t m_deduplicated = 0;
+
+    bool m_stop = false;
+};
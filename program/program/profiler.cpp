@@ -0,0 +1,236 @@
+#include <cstdio>
+#include <fstream>
+
+#include "profiler.hpp"
+#include "renderBackend.hpp"
+
+namespace
+{
+    thread_local void* t_threadBuffer = nullptr;
+
+    void AppendEscaped(std::string& output, std::string_view text)
+    {
+        for (const char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                output += '\\';
+                output += c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                output += escaped;
+            }
+            else
+            {
+                output += c;
+            }
+        }
+    }
+
+    // Chrome traces count in microseconds
+    void AppendMicroseconds(std::string& output, std::uint64_t nanoseconds)
+    {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%llu.%03llu", static_cast<unsigned long long>(nanoseconds / 1000), static_cast<unsigned long long>(nanoseconds % 1000));
+        output += text;
+    }
+}
+
+Profiler::ThreadBuffer::ThreadBuffer()
+    : head(new Chunk)
+    , tail(head)
+{}
+
+Profiler::ThreadBuffer::~ThreadBuffer()
+{
+    for (Chunk* chunk = head; chunk;)
+    {
+        Chunk* next = chunk->next.load(std::memory_order_relaxed);
+        delete chunk;
+        chunk = next;
+    }
+}
+
+void Profiler::ThreadBuffer::push(const ProfileEvent& event)
+{
+    if (MaxEventsPerThread <= total)
+    {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    auto count = tail->count.load(std::memory_order_relaxed);
+
+    if (count == EventsPerChunk)
+    {
+        auto* chunk = new Chunk;
+
+        tail->next.store(chunk, std::memory_order_release);
+        tail = chunk;
+        count = 0;
+    }
+
+    tail->events[count] = event;
+    tail->count.store(count + 1, std::memory_order_release);
+
+    ++total;
+}
+
+Profiler::Profiler()
+    : m_gpu(std::make_unique<ThreadBuffer>())
+{
+    m_gpu->name = "GPU";
+}
+
+void Profiler::record(const char* name, std::uint64_t begin, std::uint64_t end)
+{
+    if (!enabled())
+    {
+        return;
+    }
+
+    threadBuffer().push({ .name = name, .begin = begin, .end = end });
+}
+
+void Profiler::recordGpu(const char* name, std::uint64_t begin, std::uint64_t end)
+{
+    if (!enabled())
+    {
+        return;
+    }
+
+    m_gpu->push({ .name = name, .begin = begin, .end = end });
+}
+
+void Profiler::setThreadName(const std::string& name)
+{
+    auto& buffer = threadBuffer();
+
+    std::lock_guard lock(m_threadsMutex);
+    buffer.name = name;
+}
+
+bool Profiler::writeChromeTrace(const std::filesystem::path& path)const
+{
+    std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    bool first = true;
+
+    const auto writeBuffer = [&](const ThreadBuffer& buffer, std::uint32_t tid)
+    {
+        json += first ? "" : ",\n";
+        first = false;
+
+        json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(tid) + ",\"args\":{\"name\":\"";
+        AppendEscaped(json, buffer.name.empty() ? "Thread " + std::to_string(tid) : buffer.name);
+        json += "\"}}";
+
+        for (const Chunk* chunk = buffer.head; chunk; chunk = chunk->next.load(std::memory_order_acquire))
+        {
+            const auto count = chunk->count.load(std::memory_order_acquire);
+
+            for (std::uint32_t i = 0; i < count; ++i)
+            {
+                const auto& event = chunk->events[i];
+
+                // GPU ranges can start before the profiler did
+                const auto begin = m_startTime < event.begin ? event.begin - m_startTime : 0;
+                const auto duration = event.begin < event.end ? event.end - event.begin : 0;
+
+                json += ",\n{\"name\":\"";
+                AppendEscaped(json, event.name);
+                json += "\",\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(tid) + ",\"ts\":";
+                AppendMicroseconds(json, begin);
+                json += ",\"dur\":";
+                AppendMicroseconds(json, duration);
+                json += '}';
+            }
+        }
+    };
+
+    {
+        std::lock_guard lock(m_threadsMutex);
+
+        for (const auto& buffer : m_threads)
+        {
+            writeBuffer(*buffer, buffer->id);
+        }
+
+        writeBuffer(*m_gpu, static_cast<std::uint32_t>(m_threads.size()) + 1);
+    }
+
+    json += "\n]}\n";
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+    file.write(json.data(), static_cast<std::streamsize>(json.size()));
+
+    return file.good();
+}
+
+ProfilerStats Profiler::stats()const
+{
+    ProfilerStats stats;
+
+    const auto count = [&stats](const ThreadBuffer& buffer)
+    {
+        for (const Chunk* chunk = buffer.head; chunk; chunk = chunk->next.load(std::memory_order_acquire))
+        {
+            stats.events += chunk->count.load(std::memory_order_acquire);
+        }
+
+        stats.dropped += buffer.dropped.load(std::memory_order_relaxed);
+    };
+
+    std::lock_guard lock(m_threadsMutex);
+
+    for (const auto& buffer : m_threads)
+    {
+        count(*buffer);
+    }
+
+    count(*m_gpu);
+
+    stats.threads = static_cast<std::uint32_t>(m_threads.size());
+
+    return stats;
+}
+
+Profiler::ThreadBuffer& Profiler::threadBuffer()
+{
+    if (t_threadBuffer)
+    {
+        return *static_cast<ThreadBuffer*>(t_threadBuffer);
+    }
+
+    return registerThread();
+}
+
+Profiler::ThreadBuffer& Profiler::registerThread()
+{
+    auto buffer = std::make_unique<ThreadBuffer>();
+
+    std::lock_guard lock(m_threadsMutex);
+
+    buffer->id = static_cast<std::uint32_t>(m_threads.size()) + 1;
+
+    t_threadBuffer = buffer.get();
+
+    m_threads.push_back(std::move(buffer));
+
+    return *m_threads.back();
+}
+
+GpuProfileMarker::GpuProfileMarker(RenderBackend& backend, const char* name)
+    : m_backend(backend)
+{
+    m_backend.beginGpuScope(name);
+}
+
+GpuProfileMarker::~GpuProfileMarker()
+{
+    m_backend.endGpuScope();
+}
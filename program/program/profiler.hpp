@@ -0,0 +1,190 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class RenderBackend;
+
+struct ProfileEvent
+{
+    // A string literal; only the pointer is stored
+    const char* name = nullptr;
+
+    // Nanoseconds on the profiler clock
+    std::uint64_t begin = 0;
+
+    std::uint64_t end = 0;
+};
+
+struct ProfilerStats
+{
+    std::uint64_t events = 0;
+
+    // Events lost to MaxEventsPerThread
+    std::uint64_t dropped = 0;
+
+    std::uint32_t threads = 0;
+};
+
+// Collects CPU scopes per thread and GPU ranges from the backend, and writes
+// them as a Chrome trace (chrome://tracing, ui.perfetto.dev). Each thread
+// appends to its own buffer, so recording takes no lock; only a thread's
+// first event registers its buffer.
+class Profiler
+{
+public:
+
+    static constexpr std::uint32_t EventsPerChunk = 4096;
+
+    static constexpr std::uint64_t MaxEventsPerThread = 1 << 20;
+
+    static Profiler& instance()
+    {
+        static Profiler i;
+        return i;
+    }
+
+    Profiler(const Profiler&) = delete;
+
+    Profiler& operator=(const Profiler&) = delete;
+
+    // The clock CPU events are measured with: steady_clock in nanoseconds
+    static std::uint64_t Now()
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    void setEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+
+    bool enabled()const { return m_enabled.load(std::memory_order_relaxed); }
+
+    void record(const char* name, std::uint64_t begin, std::uint64_t end);
+
+    // GPU ranges already converted to the CPU clock; called from the thread that ends frames
+    void recordGpu(const char* name, std::uint64_t begin, std::uint64_t end);
+
+    void setThreadName(const std::string& name);
+
+    // Safe while other threads keep recording; their newest events may be left out
+    bool writeChromeTrace(const std::filesystem::path& path)const;
+
+    ProfilerStats stats()const;
+
+private:
+
+    struct Chunk
+    {
+        std::array<ProfileEvent, EventsPerChunk> events;
+
+        // Written by the owning thread only, published with release
+        std::atomic<std::uint32_t> count = 0;
+
+        std::atomic<Chunk*> next = nullptr;
+    };
+
+    struct ThreadBuffer
+    {
+        ThreadBuffer();
+
+        ~ThreadBuffer();
+
+        void push(const ProfileEvent& event);
+
+        std::uint32_t id = 0;
+
+        std::string name;
+
+        Chunk* head = nullptr;
+
+        // Owner only
+        Chunk* tail = nullptr;
+
+        std::uint64_t total = 0;
+
+        std::atomic<std::uint64_t> dropped = 0;
+    };
+
+    Profiler();
+
+    ThreadBuffer& threadBuffer();
+
+    ThreadBuffer& registerThread();
+
+    std::atomic<bool> m_enabled = true;
+
+    mutable std::mutex m_threadsMutex;
+
+    std::vector<std::unique_ptr<ThreadBuffer>> m_threads;
+
+    std::unique_ptr<ThreadBuffer> m_gpu;
+
+    const std::uint64_t m_startTime = Now();
+};
+
+// Times the enclosing scope on the calling thread
+class ProfileMarker
+{
+public:
+
+    explicit ProfileMarker(const char* name)
+        : m_name(name)
+        , m_begin(Profiler::Now())
+    {}
+
+    ~ProfileMarker()
+    {
+        Profiler::instance().record(m_name, m_begin, Profiler::Now());
+    }
+
+    ProfileMarker(const ProfileMarker&) = delete;
+
+    ProfileMarker& operator=(const ProfileMarker&) = delete;
+
+private:
+
+    const char* m_name = nullptr;
+
+    std::uint64_t m_begin = 0;
+};
+
+// Brackets the commands recorded in the enclosing scope with GPU timestamps
+class GpuProfileMarker
+{
+public:
+
+    GpuProfileMarker(RenderBackend& backend, const char* name);
+
+    ~GpuProfileMarker();
+
+    GpuProfileMarker(const GpuProfileMarker&) = delete;
+
+    GpuProfileMarker& operator=(const GpuProfileMarker&) = delete;
+
+private:
+
+    RenderBackend& m_backend;
+};
+
+#ifdef ENABLE_PROFILER
+
+#define ProfileConcatInner(a, b) a##b
+#define ProfileConcat(a, b) ProfileConcatInner(a, b)
+
+#define ProfileScope(name) const ProfileMarker ProfileConcat(profileMarker, __LINE__)(name)
+#define GpuProfileScope(backend, name) const GpuProfileMarker ProfileConcat(gpuProfileMarker, __LINE__)(backend, name)
+#define ProfileThreadName(name) (Profiler::instance().setThreadName(name))
+
+#else
+
+#define ProfileScope(name)
+#define GpuProfileScope(backend, name)
+#define ProfileThreadName(name)
+
+#endif
@@ -0,0 +1,400 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+struct BufferHandle
+{
+    std::uint32_t id = 0;
+
+    explicit operator bool()const { return id != 0; }
+
+    bool operator==(const BufferHandle&)const = default;
+};
+
+struct PipelineHandle
+{
+    std::uint32_t id = 0;
+
+    explicit operator bool()const { return id != 0; }
+
+    bool operator==(const PipelineHandle&)const = default;
+};
+
+// Index of a descriptor in the shader-visible heap; shaders receive it as is.
+// Index 0 holds a null descriptor, so a default handle is safe to read.
+struct DescriptorHandle
+{
+    std::uint32_t index = 0;
+
+    explicit operator bool()const { return index != 0; }
+
+    bool operator==(const DescriptorHandle&)const = default;
+};
+
+// CBVs must start on this boundary
+constexpr std::uint64_t ConstantBufferAlignment = 256;
+
+// Memory the CPU writes and the GPU reads in place, valid until the frame it was
+// allocated in completes
+struct TransientAllocation
+{
+    std::byte* cpuAddress = nullptr;
+
+    std::uint64_t gpuAddress = 0;
+
+    std::uint64_t sizeInBytes = 0;
+};
+
+enum class BufferUsage
+{
+    Vertex,
+    Index,
+};
+
+enum class IndexFormat
+{
+    Uint16,
+    Uint32,
+};
+
+enum class VertexFormat
+{
+    Float2,
+    Float3,
+    Float4,
+    Half2,
+    Half4,
+    Snorm16x2,
+    Unorm16x2,
+};
+
+enum class InputRate
+{
+    PerVertex,
+    PerInstance,
+};
+
+enum class PrimitiveTopology
+{
+    TriangleList,
+    TriangleStrip,
+};
+
+struct Viewport
+{
+    float x = 0.f;
+
+    float y = 0.f;
+
+    float width = 0.f;
+
+    float height = 0.f;
+
+    float minDepth = 0.f;
+
+    float maxDepth = 1.f;
+
+    bool operator==(const Viewport&)const = default;
+};
+
+struct ScissorRect
+{
+    std::int32_t left = 0;
+
+    std::int32_t top = 0;
+
+    std::int32_t right = 0;
+
+    std::int32_t bottom = 0;
+
+    bool operator==(const ScissorRect&)const = default;
+};
+
+struct VertexBufferView
+{
+    BufferHandle buffer;
+
+    // Transient memory from allocateTransient, read instead of buffer when set
+    std::uint64_t gpuAddress = 0;
+
+    std::uint32_t offset = 0;
+
+    std::uint32_t sizeInBytes = 0;
+
+    std::uint32_t strideInBytes = 0;
+
+    explicit operator bool()const { return buffer || gpuAddress != 0; }
+
+    bool operator==(const VertexBufferView&)const = default;
+};
+
+struct IndexBufferView
+{
+    BufferHandle buffer;
+
+    std::uint32_t offset = 0;
+
+    std::uint32_t sizeInBytes = 0;
+
+    IndexFormat format = IndexFormat::Uint32;
+
+    bool operator==(const IndexBufferView&)const = default;
+};
+
+struct VertexElement
+{
+    std::string semanticName;
+
+    std::uint32_t semanticIndex = 0;
+
+    VertexFormat format = VertexFormat::Float3;
+
+    std::uint32_t offset = 0;
+
+    // Slot 0 is the mesh's vertex buffer, slot 1 the instance buffer
+    std::uint32_t inputSlot = 0;
+
+    InputRate inputRate = InputRate::PerVertex;
+};
+
+enum class PipelineStatus
+{
+    Pending,
+    Ready,
+    Failed,
+};
+
+// Debug keeps symbols and skips optimization; Release is what we ship
+enum class ShaderProfile
+{
+    Debug,
+    Release,
+};
+
+struct ShaderDefine
+{
+    std::string name;
+
+    std::string value;
+};
+
+struct PipelineDesc
+{
+    std::wstring vertexShaderPath;
+
+    std::wstring pixelShaderPath;
+
+    std::vector<VertexElement> inputLayout;
+
+    std::vector<ShaderDefine> defines;
+};
+
+struct DrawIndexedDesc
+{
+    VertexBufferView vertexBuffer;
+
+    IndexBufferView indexBuffer;
+
+    // Optional; bound to input slot 1 for InputRate::PerInstance elements
+    VertexBufferView instanceBuffer;
+
+    std::uint32_t indexCount = 0;
+
+    std::uint32_t instanceCount = 1;
+
+    std::uint32_t startIndex = 0;
+
+    std::int32_t baseVertex = 0;
+
+    std::uint32_t startInstance = 0;
+};
+
+struct BackendDesc
+{
+    void* nativeWindow = nullptr;
+
+    int width = 0;
+
+    int height = 0;
+
+    std::uint32_t framesInFlight = 2;
+
+#ifdef _DEBUG
+    ShaderProfile shaderProfile = ShaderProfile::Debug;
+#else
+    ShaderProfile shaderProfile = ShaderProfile::Release;
+#endif
+
+    // Compiled shader bytecode and the serialized pipeline library live here
+    std::wstring cacheDirectory = L"shader_cache";
+};
+
+constexpr std::uint32_t IndexSize(IndexFormat format)
+{
+    return format == IndexFormat::Uint16 ? 2 : 4;
+}
+
+constexpr std::uint32_t VertexFormatSize(VertexFormat format)
+{
+    switch (format)
+    {
+    case VertexFormat::Float2: return 8;
+    case VertexFormat::Float3: return 12;
+    case VertexFormat::Float4: return 16;
+    case VertexFormat::Half2: return 4;
+    case VertexFormat::Half4: return 8;
+    case VertexFormat::Snorm16x2: return 4;
+    case VertexFormat::Unorm16x2: return 4;
+    }
+
+    return 0;
+}
+
+class JobSystem;
+
+class CommandStream;
+
+class CommandStateTracker;
+
+// State and draws for one command list. Contexts handed out by
+// RenderBackend::recordParallel are each used by a single thread.
+class CommandContext
+{
+public:
+
+    virtual ~CommandContext() = default;
+
+    virtual void setPipeline(PipelineHandle pipeline) = 0;
+
+    virtual void draw(const DrawIndexedDesc& desc) = 0;
+};
+
+using RecordFunc = std::function<void(CommandContext& context, std::uint32_t index)>;
+
+// Everything Dx, Mesh and ShaderPipeline need from a graphics API.
+// D3D12Backend talks to the GPU; NullBackend only validates and counts.
+class RenderBackend
+{
+public:
+
+    virtual ~RenderBackend() = default;
+
+    virtual bool init(const BackendDesc& desc) = 0;
+
+    virtual bool frameBegin() = 0;
+
+    // Nanoseconds the last frameBegin spent waiting for the GPU to retire the
+    // frame context it reuses; backends that never wait report 0
+    virtual std::uint64_t frameWaitNs()const { return 0; }
+
+    virtual bool frameEnd() = 0;
+
+    virtual bool waitIdle() = 0;
+
+    // Between frames only. The GPU may still be using the old back buffers, so
+    // backends wait for it before replacing them.
+    virtual bool resize(int width, int height) = 0;
+
+    virtual std::optional<BufferHandle> createBuffer(BufferUsage usage, const void* data, std::size_t sizeInBytes) = 0;
+
+    // The GPU may still be reading the buffer; backends retire it once the current frame completes.
+    virtual void releaseBuffer(BufferHandle buffer) = 0;
+
+    // Shader-visible view of a buffer's bytes from an offset, given with their
+    // size, read in shaders as a ByteAddressBuffer through its index. Backends
+    // without bindless resources return an invalid handle.
+    virtual DescriptorHandle createBufferView(BufferHandle, std::uint32_t, std::uint32_t) { return {}; }
+
+    // Like releaseBuffer, the slot is only reused once the current frame completes
+    virtual void releaseView(DescriptorHandle) {}
+
+    // Backends without transient memory return nothing
+    virtual std::optional<TransientAllocation> allocateTransient(std::uint64_t, std::uint64_t = ConstantBufferAlignment)
+    {
+        return std::nullopt;
+    }
+
+    virtual std::optional<PipelineHandle> createPipeline(const PipelineDesc& desc) = 0;
+
+    // Returns at once; the handle may only be bound once pipelineStatus reports Ready.
+    // Backends without background compilation simply build it here.
+    virtual PipelineHandle createPipelineAsync(const PipelineDesc& desc)
+    {
+        return createPipeline(desc).value_or(PipelineHandle{});
+    }
+
+    virtual PipelineStatus pipelineStatus(PipelineHandle pipeline)
+    {
+        return pipeline ? PipelineStatus::Ready : PipelineStatus::Failed;
+    }
+
+    virtual void setPipeline(PipelineHandle pipeline) = 0;
+
+    // What setPipeline last bound, invalid before the first bind of a frame
+    virtual PipelineHandle boundPipeline()const = 0;
+
+    virtual void draw(const DrawIndexedDesc& desc) = 0;
+
+    // Both cover the whole target again at every frameBegin; backends that
+    // record through execute get them from the stream
+    virtual void setViewport(const Viewport&) {}
+
+    virtual void setScissor(const ScissorRect&) {}
+
+    // Timestamps around what is recorded between the two calls, reported to the
+    // Profiler once the frame has finished on the GPU. Scopes nest; backends
+    // without timestamp queries ignore them.
+    virtual void beginGpuScope(const char*) {}
+
+    virtual void endGpuScope() {}
+
+    // Replays a recorded stream; tracker drops state that is already bound and keeps the counts.
+    // The default, defined in commandStream.cpp, goes through setPipeline and draw.
+    virtual void execute(const CommandStream& commands, CommandStateTracker& tracker);
+
+    // Records contextCount command lists, calling record for each one on the job
+    // system's threads. They execute in index order at this point of the frame and
+    // the pipeline and constant buffer bound before the call stay bound afterwards;
+    // each list sees that constant buffer once it binds a pipeline.
+    // Backends that cannot record in parallel run everything here, in order, and
+    // bind the earlier pipeline again at the end; the default execute drops
+    // constant buffers, so they have no b1 binding to keep.
+    virtual bool recordParallel(JobSystem&, std::uint32_t contextCount, const RecordFunc& record)
+    {
+        class ImmediateContext : public CommandContext
+        {
+        public:
+
+            explicit ImmediateContext(RenderBackend& backend) : m_backend(backend) {}
+
+            void setPipeline(PipelineHandle pipeline) override { m_backend.setPipeline(pipeline); }
+
+            void draw(const DrawIndexedDesc& desc) override { m_backend.draw(desc); }
+
+        private:
+
+            RenderBackend& m_backend;
+        };
+
+        const auto bound = boundPipeline();
+
+        ImmediateContext context(*this);
+
+        for (std::uint32_t i = 0; i < contextCount; ++i)
+        {
+            record(context, i);
+        }
+
+        if (bound && !(boundPipeline() == bound))
+        {
+            setPipeline(bound);
+        }
+
+        return true;
+    }
+};
@@ -0,0 +1,615 @@
+#include <algorithm>
+
+#include "logger.hpp"
+#include "renderGraph.hpp"
+
+namespace
+{
+    constexpr std::uint64_t PlacementAlignment = 64ull * 1024;
+
+    constexpr std::uint64_t MsaaPlacementAlignment = 4ull * 1024 * 1024;
+
+    constexpr std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    std::wstring Widen(const std::string& text)
+    {
+        return std::wstring(text.begin(), text.end());
+    }
+
+    int BarrierOrder(const RenderBarrier& barrier)
+    {
+        // Memory changes hands before the new owner is transitioned
+        switch (barrier.type)
+        {
+        case BarrierType::Aliasing: return 0;
+        case BarrierType::Transition: return 1;
+        case BarrierType::UnorderedAccess: return 2;
+        }
+
+        return 3;
+    }
+}
+
+MemoryFootprint EstimateTextureFootprint(const TextureDesc& desc)
+{
+    const std::uint64_t alignment = 1 < desc.sampleCount ? MsaaPlacementAlignment : PlacementAlignment;
+
+    std::uint64_t size = 0;
+
+    for (std::uint32_t mip = 0; mip < std::max(desc.mipLevels, 1u); ++mip)
+    {
+        const std::uint64_t width = std::max(desc.width >> mip, 1u);
+        const std::uint64_t height = std::max(desc.height >> mip, 1u);
+
+        size += width * height * TextureFormatSize(desc.format) * std::max(desc.sampleCount, 1u);
+    }
+
+    return { .size = AlignUp(size, alignment), .alignment = alignment };
+}
+
+void RenderGraph::reset()
+{
+    m_resources.clear();
+    m_passes.clear();
+    m_invalid = false;
+
+    m_livePasses.clear();
+    m_placements.clear();
+    m_barriers.clear();
+    m_batches.clear();
+    m_stats = {};
+}
+
+RenderResourceHandle RenderGraph::importTexture(std::string name, const TextureDesc& desc, ResourceState initialState, ResourceState finalState)
+{
+    m_resources.push_back(
+        {
+            .name = std::move(name),
+            .desc = desc,
+            .imported = true,
+            .initialState = initialState,
+            .finalState = finalState,
+        });
+
+    return { static_cast<std::uint32_t>(m_resources.size()) };
+}
+
+RenderResourceHandle RenderGraph::createTexture(std::string name, const TextureDesc& desc)
+{
+    m_resources.push_back({ .name = std::move(name), .desc = desc });
+
+    return { static_cast<std::uint32_t>(m_resources.size()) };
+}
+
+RenderPassHandle RenderGraph::addPass(std::string name, RenderPassFunc execute)
+{
+    m_passes.push_back({ .name = std::move(name), .execute = std::move(execute), .accesses = {} });
+
+    return { static_cast<std::uint32_t>(m_passes.size()) };
+}
+
+void RenderGraph::read(RenderPassHandle pass, RenderResourceHandle resource, ResourceState state)
+{
+    addAccess(pass, resource, state, false);
+}
+
+void RenderGraph::write(RenderPassHandle pass, RenderResourceHandle resource, ResourceState state)
+{
+    if (IsReadOnlyState(state))
+    {
+        ErrorLog(L"読み取り専用の状態で書き込みが宣言されました");
+        m_invalid = true;
+        return;
+    }
+
+    addAccess(pass, resource, state, true);
+}
+
+void RenderGraph::setSideEffects(RenderPassHandle pass)
+{
+    if (!pass || m_passes.size() < pass.id)
+    {
+        ErrorLog(L"存在しないパスです");
+        m_invalid = true;
+        return;
+    }
+
+    m_passes[pass.id - 1].sideEffects = true;
+}
+
+void RenderGraph::addAccess(RenderPassHandle pass, RenderResourceHandle resource, ResourceState state, bool write)
+{
+    if (!pass || m_passes.size() < pass.id || !resource || m_resources.size() < resource.id || state == ResourceState::Undefined)
+    {
+        ErrorLog(L"レンダーグラフへの不正な宣言です");
+        m_invalid = true;
+        return;
+    }
+
+    auto& accesses = m_passes[pass.id - 1].accesses;
+
+    const auto index = resource.id - 1;
+
+    const auto found = std::find_if(accesses.begin(), accesses.end(), [&](const Access& access) { return access.resource == index; });
+
+    if (found == accesses.end())
+    {
+        accesses.push_back({ .resource = index, .state = state, .read = !write, .write = write });
+        return;
+    }
+
+    // One pass sees one state of a texture
+    if (found->state != state)
+    {
+        ErrorLog(L"同じパスで異なる状態が宣言されました: " + Widen(m_resources[index].name));
+        m_invalid = true;
+        return;
+    }
+
+    found->read = found->read || !write;
+    found->write = found->write || write;
+}
+
+bool RenderGraph::compile(const FootprintFunc& footprint)
+{
+    m_livePasses.clear();
+    m_placements.clear();
+    m_barriers.clear();
+    m_batches.clear();
+    m_stats = {};
+
+    if (m_invalid)
+    {
+        return false;
+    }
+
+    cull();
+
+    if (!validate())
+    {
+        return false;
+    }
+
+    placeTransients(footprint ? footprint : [](const TextureDesc& desc, ResourceState) { return EstimateTextureFootprint(desc); });
+
+    buildBarriers();
+
+    m_stats.passes = static_cast<std::uint32_t>(m_passes.size());
+    m_stats.culledPasses = static_cast<std::uint32_t>(m_passes.size() - m_livePasses.size());
+
+    return true;
+}
+
+void RenderGraph::cull()
+{
+    // Walking backwards, needed[r] says whether a later live pass or the outside
+    // world reads what r holds at this point
+    std::vector<bool> needed(m_resources.size());
+
+    for (std::size_t i = 0; i < m_resources.size(); ++i)
+    {
+        needed[i] = m_resources[i].imported;
+    }
+
+    std::vector<bool> live(m_passes.size());
+
+    for (std::size_t p = m_passes.size(); 0 < p--;)
+    {
+        const auto& pass = m_passes[p];
+
+        live[p] = pass.sideEffects || std::any_of(pass.accesses.begin(), pass.accesses.end(),
+            [&](const Access& access) { return access.write && needed[access.resource]; });
+
+        if (!live[p])
+        {
+            continue;
+        }
+
+        // A write ends the interest in older contents, unless the pass reads them too
+        for (const auto& access : pass.accesses)
+        {
+            if (access.write)
+            {
+                needed[access.resource] = false;
+            }
+        }
+
+        for (const auto& access : pass.accesses)
+        {
+            if (access.read)
+            {
+                needed[access.resource] = true;
+            }
+        }
+    }
+
+    for (std::uint32_t p = 0; p < m_passes.size(); ++p)
+    {
+        if (live[p])
+        {
+            m_livePasses.push_back({ p + 1 });
+        }
+    }
+}
+
+bool RenderGraph::validate()const
+{
+    std::vector<bool> written(m_resources.size());
+
+    for (const auto pass : m_livePasses)
+    {
+        for (const auto& access : m_passes[pass.id - 1].accesses)
+        {
+            const auto& resource = m_resources[access.resource];
+
+            if (access.read && !resource.imported && !written[access.resource])
+            {
+                ErrorLog(L"書き込まれていないテクスチャを読み込んでいます: " + Widen(resource.name) +
+                    L" (" + Widen(m_passes[pass.id - 1].name) + L")");
+                return false;
+            }
+        }
+
+        for (const auto& access : m_passes[pass.id - 1].accesses)
+        {
+            if (access.write)
+            {
+                written[access.resource] = true;
+            }
+        }
+    }
+
+    return true;
+}
+
+void RenderGraph::placeTransients(const FootprintFunc& footprint)
+{
+    m_placements.assign(m_resources.size(), {});
+
+    std::vector<std::uint32_t> transients;
+
+    std::vector<std::uint64_t> alignments(m_resources.size());
+
+    std::vector<bool> used(m_resources.size());
+
+    for (std::uint32_t k = 0; k < m_livePasses.size(); ++k)
+    {
+        for (const auto& access : m_passes[m_livePasses[k].id - 1].accesses)
+        {
+            if (m_resources[access.resource].imported)
+            {
+                continue;
+            }
+
+            auto& placement = m_placements[access.resource];
+
+            if (!used[access.resource])
+            {
+                used[access.resource] = true;
+
+                placement.firstPass = k;
+                placement.initialState = access.state;
+
+                transients.push_back(access.resource);
+            }
+
+            placement.lastPass = k;
+            placement.usage = placement.usage | access.state;
+        }
+    }
+
+    // Sized once every use is known, an API texture needs the flags of all of them
+    for (const auto r : transients)
+    {
+        const auto memory = footprint(m_resources[r].desc, m_placements[r].usage);
+
+        m_placements[r].size = std::max<std::uint64_t>(memory.size, 1);
+
+        alignments[r] = std::max<std::uint64_t>(memory.alignment, 1);
+    }
+
+    // Largest first keeps the heap tight; first-fit below the textures alive at the same time
+    std::sort(transients.begin(), transients.end(), [&](std::uint32_t a, std::uint32_t b)
+        {
+            const auto& pa = m_placements[a];
+            const auto& pb = m_placements[b];
+
+            if (pa.size != pb.size)
+            {
+                return pb.size < pa.size;
+            }
+
+            return pa.firstPass != pb.firstPass ? pa.firstPass < pb.firstPass : a < b;
+        });
+
+    struct Range
+    {
+        std::uint64_t begin = 0;
+
+        std::uint64_t end = 0;
+    };
+
+    std::vector<Range> occupied;
+
+    for (std::size_t i = 0; i < transients.size(); ++i)
+    {
+        auto& placement = m_placements[transients[i]];
+
+        occupied.clear();
+
+        for (std::size_t j = 0; j < i; ++j)
+        {
+            const auto& other = m_placements[transients[j]];
+
+            if (other.firstPass <= placement.lastPass && placement.firstPass <= other.lastPass)
+            {
+                occupied.push_back({ .begin = other.offset, .end = other.offset + other.size });
+            }
+        }
+
+        std::sort(occupied.begin(), occupied.end(), [](const Range& a, const Range& b) { return a.begin < b.begin; });
+
+        std::uint64_t offset = 0;
+
+        for (const auto& range : occupied)
+        {
+            if (offset + placement.size <= range.begin)
+            {
+                break;
+            }
+
+            offset = std::max(offset, AlignUp(range.end, alignments[transients[i]]));
+        }
+
+        placement.offset = offset;
+
+        m_stats.transientBytes += placement.size;
+        m_stats.heapBytes = std::max(m_stats.heapBytes, offset + placement.size);
+    }
+
+    m_stats.transientTextures = static_cast<std::uint32_t>(transients.size());
+}
+
+void RenderGraph::buildBarriers()
+{
+    const auto passCount = static_cast<std::uint32_t>(m_livePasses.size());
+
+    std::vector<std::vector<RenderBarrier>> batches(passCount + 1);
+
+    struct Track
+    {
+        ResourceState state = ResourceState::Undefined;
+
+        // Live pass index of the last use, -1 before the graph
+        std::int64_t lastUse = -1;
+
+        bool lastWrite = false;
+
+        bool started = false;
+    };
+
+    std::vector<Track> tracks(m_resources.size());
+
+    for (std::size_t i = 0; i < m_resources.size(); ++i)
+    {
+        if (m_resources[i].imported)
+        {
+            tracks[i] = { .state = m_resources[i].initialState, .started = true };
+        }
+    }
+
+    const auto findAccess = [&](std::uint32_t livePass, std::uint32_t resource) -> const Access*
+    {
+        for (const auto& access : m_passes[m_livePasses[livePass].id - 1].accesses)
+        {
+            if (access.resource == resource)
+            {
+                return &access;
+            }
+        }
+
+        return nullptr;
+    };
+
+    const auto transition = [&](std::uint32_t resource, ResourceState after, std::uint32_t batch)
+    {
+        auto& track = tracks[resource];
+
+        const RenderBarrier barrier =
+        {
+            .resource = { resource + 1 },
+            .aliasBefore = {},
+            .before = track.state,
+            .after = after,
+        };
+
+        // Nothing touches the texture in between, so the GPU can start early
+        if (track.lastUse + 1 < batch)
+        {
+            auto begin = barrier;
+            begin.split = BarrierSplit::Begin;
+            batches[track.lastUse + 1].push_back(begin);
+
+            auto end = barrier;
+            end.split = BarrierSplit::End;
+            batches[batch].push_back(end);
+
+            ++m_stats.splitTransitions;
+        }
+        else
+        {
+            batches[batch].push_back(barrier);
+        }
+
+        ++m_stats.transitions;
+
+        track.state = after;
+    };
+
+    for (std::uint32_t k = 0; k < passCount; ++k)
+    {
+        for (const auto& access : m_passes[m_livePasses[k].id - 1].accesses)
+        {
+            const auto r = access.resource;
+
+            auto& track = tracks[r];
+
+            if (!track.started)
+            {
+                // A transient starts its lifetime in the state of its first use
+                const auto& placement = m_placements[r];
+
+                bool overlaps = false;
+
+                std::uint32_t before = 0;
+
+                std::uint32_t beforeLastPass = 0;
+
+                for (std::uint32_t q = 0; q < m_placements.size(); ++q)
+                {
+                    const auto& other = m_placements[q];
+
+                    if (q == r || other.size == 0 ||
+                        placement.offset + placement.size <= other.offset || other.offset + other.size <= placement.offset)
+                    {
+                        continue;
+                    }
+
+                    overlaps = true;
+
+                    if (other.lastPass < placement.firstPass && (!before || beforeLastPass < other.lastPass))
+                    {
+                        before = q + 1;
+                        beforeLastPass = other.lastPass;
+                    }
+                }
+
+                if (overlaps)
+                {
+                    batches[k].push_back({ .type = BarrierType::Aliasing, .resource = { r + 1 }, .aliasBefore = { before } });
+
+                    ++m_stats.aliasingBarriers;
+                }
+
+                track.state = access.state;
+                track.started = true;
+            }
+            else if (IsReadOnlyState(access.state))
+            {
+                if (!IsReadOnlyState(track.state) || (track.state & access.state) != access.state)
+                {
+                    // Every read up to the next write in one transition
+                    auto target = access.state;
+
+                    for (auto m = k + 1; m < passCount; ++m)
+                    {
+                        const auto* next = findAccess(m, r);
+
+                        if (!next)
+                        {
+                            continue;
+                        }
+
+                        if (next->write || !IsReadOnlyState(next->state))
+                        {
+                            break;
+                        }
+
+                        target = target | next->state;
+                    }
+
+                    transition(r, target, k);
+                }
+            }
+            else if (track.state == access.state)
+            {
+                if (access.state == ResourceState::UnorderedAccess && (track.lastWrite || access.write))
+                {
+                    batches[k].push_back({ .type = BarrierType::UnorderedAccess, .resource = { r + 1 }, .aliasBefore = {} });
+
+                    ++m_stats.uavBarriers;
+                }
+            }
+            else
+            {
+                transition(r, access.state, k);
+            }
+
+            track.lastUse = k;
+            track.lastWrite = access.write;
+        }
+    }
+
+    for (std::uint32_t r = 0; r < m_resources.size(); ++r)
+    {
+        if (m_resources[r].imported)
+        {
+            if (tracks[r].state != m_resources[r].finalState)
+            {
+                transition(r, m_resources[r].finalState, passCount);
+            }
+        }
+        else if (tracks[r].started)
+        {
+            m_placements[r].finalState = tracks[r].state;
+        }
+    }
+
+    for (auto& batch : batches)
+    {
+        std::stable_sort(batch.begin(), batch.end(), [](const RenderBarrier& a, const RenderBarrier& b)
+            {
+                return BarrierOrder(a) < BarrierOrder(b);
+            });
+
+        m_batches.push_back({ .first = static_cast<std::uint32_t>(m_barriers.size()), .count = static_cast<std::uint32_t>(batch.size()) });
+
+        m_barriers.insert(m_barriers.end(), batch.begin(), batch.end());
+
+        if (!batch.empty())
+        {
+            ++m_stats.batches;
+        }
+    }
+}
+
+void RenderGraph::execute(const BarrierFunc& barriers)const
+{
+    for (std::uint32_t k = 0; k <= m_livePasses.size(); ++k)
+    {
+        const auto batch = this->barriers(k);
+
+        if (!batch.empty())
+        {
+            barriers(batch);
+        }
+
+        if (k < m_livePasses.size() && m_passes[m_livePasses[k].id - 1].execute)
+        {
+            m_passes[m_livePasses[k].id - 1].execute();
+        }
+    }
+}
+
+std::span<const RenderBarrier> RenderGraph::barriers(std::uint32_t batch)const
+{
+    if (m_batches.size() <= batch)
+    {
+        return {};
+    }
+
+    return std::span(m_barriers).subspan(m_batches[batch].first, m_batches[batch].count);
+}
+
+std::optional<TexturePlacement> RenderGraph::placement(RenderResourceHandle resource)const
+{
+    if (!resource || m_placements.size() < resource.id || m_placements[resource.id - 1].size == 0)
+    {
+        return std::nullopt;
+    }
+
+    return m_placements[resource.id - 1];
+}
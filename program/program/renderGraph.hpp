@@ -0,0 +1,339 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+// Backend-neutral resource states. The read-only ones combine, so a texture
+// sampled by several passes in a row is transitioned once to all of them.
+enum class ResourceState : std::uint32_t
+{
+    Undefined = 0,
+    Present = 1 << 0,
+    RenderTarget = 1 << 1,
+    DepthWrite = 1 << 2,
+    DepthRead = 1 << 3,
+    PixelShaderResource = 1 << 4,
+    NonPixelShaderResource = 1 << 5,
+    UnorderedAccess = 1 << 6,
+    CopySource = 1 << 7,
+    CopyDest = 1 << 8,
+};
+
+constexpr ResourceState operator|(ResourceState a, ResourceState b)
+{
+    return static_cast<ResourceState>(static_cast<std::uint32_t>(a) | static_cast<std::uint32_t>(b));
+}
+
+constexpr ResourceState operator&(ResourceState a, ResourceState b)
+{
+    return static_cast<ResourceState>(static_cast<std::uint32_t>(a) & static_cast<std::uint32_t>(b));
+}
+
+constexpr ResourceState ReadOnlyStates =
+    ResourceState::DepthRead | ResourceState::PixelShaderResource | ResourceState::NonPixelShaderResource | ResourceState::CopySource;
+
+constexpr bool IsReadOnlyState(ResourceState state)
+{
+    return state != ResourceState::Undefined && (state & ReadOnlyStates) == state;
+}
+
+enum class TextureFormat
+{
+    RGBA8Unorm,
+    RGBA16Float,
+    RGBA32Float,
+    RG16Float,
+    R11G11B10Float,
+    R32Float,
+    Depth32Float,
+    Depth24Stencil8,
+};
+
+constexpr std::uint32_t TextureFormatSize(TextureFormat format)
+{
+    switch (format)
+    {
+    case TextureFormat::RGBA8Unorm: return 4;
+    case TextureFormat::RGBA16Float: return 8;
+    case TextureFormat::RGBA32Float: return 16;
+    case TextureFormat::RG16Float: return 4;
+    case TextureFormat::R11G11B10Float: return 4;
+    case TextureFormat::R32Float: return 4;
+    case TextureFormat::Depth32Float: return 4;
+    case TextureFormat::Depth24Stencil8: return 4;
+    }
+
+    return 0;
+}
+
+struct TextureDesc
+{
+    std::uint32_t width = 0;
+
+    std::uint32_t height = 0;
+
+    TextureFormat format = TextureFormat::RGBA8Unorm;
+
+    std::uint32_t mipLevels = 1;
+
+    std::uint32_t sampleCount = 1;
+
+    bool operator==(const TextureDesc&)const = default;
+};
+
+struct MemoryFootprint
+{
+    std::uint64_t size = 0;
+
+    std::uint64_t alignment = 0;
+};
+
+// What D3D12 asks of placed render targets: 64 KB alignment, 4 MB with MSAA.
+// Backends that can query the driver pass their own to RenderGraph::compile.
+MemoryFootprint EstimateTextureFootprint(const TextureDesc& desc);
+
+using FootprintFunc = std::function<MemoryFootprint(const TextureDesc& desc, ResourceState usage)>;
+
+struct RenderResourceHandle
+{
+    std::uint32_t id = 0;
+
+    explicit operator bool()const { return id != 0; }
+
+    bool operator==(const RenderResourceHandle&)const = default;
+};
+
+struct RenderPassHandle
+{
+    std::uint32_t id = 0;
+
+    explicit operator bool()const { return id != 0; }
+
+    bool operator==(const RenderPassHandle&)const = default;
+};
+
+enum class BarrierType
+{
+    Transition,
+    // The resource takes over memory another transient used earlier
+    Aliasing,
+    // Orders unordered access writes between passes in the same state
+    UnorderedAccess,
+};
+
+// A transition whose two halves sit in different batches lets the GPU finish it
+// while the passes in between run
+enum class BarrierSplit
+{
+    None,
+    Begin,
+    End,
+};
+
+struct RenderBarrier
+{
+    BarrierType type = BarrierType::Transition;
+
+    BarrierSplit split = BarrierSplit::None;
+
+    RenderResourceHandle resource;
+
+    // Aliasing only; invalid when whatever last used the memory is not known,
+    // which is the case for the first user in a frame
+    RenderResourceHandle aliasBefore;
+
+    ResourceState before = ResourceState::Undefined;
+
+    ResourceState after = ResourceState::Undefined;
+};
+
+// Where a transient texture lives in the shared heap and in which states
+struct TexturePlacement
+{
+    std::uint64_t offset = 0;
+
+    std::uint64_t size = 0;
+
+    // Live pass indices of the first and last use
+    std::uint32_t firstPass = 0;
+
+    std::uint32_t lastPass = 0;
+
+    // The graph expects the texture in initialState when its lifetime starts and
+    // leaves it in finalState
+    ResourceState initialState = ResourceState::Undefined;
+
+    ResourceState finalState = ResourceState::Undefined;
+
+    // Every state a live pass uses it in, for the flags of the API texture
+    ResourceState usage = ResourceState::Undefined;
+};
+
+struct RenderGraphStats
+{
+    std::uint32_t passes = 0;
+
+    std::uint32_t culledPasses = 0;
+
+    std::uint32_t transitions = 0;
+
+    std::uint32_t splitTransitions = 0;
+
+    std::uint32_t aliasingBarriers = 0;
+
+    std::uint32_t uavBarriers = 0;
+
+    // Non-empty batches, each one ResourceBarrier call
+    std::uint32_t batches = 0;
+
+    std::uint32_t transientTextures = 0;
+
+    // Every transient in memory of its own
+    std::uint64_t transientBytes = 0;
+
+    // What the heap needs with aliasing
+    std::uint64_t heapBytes = 0;
+};
+
+using RenderPassFunc = std::function<void()>;
+
+using BarrierFunc = std::function<void(std::span<const RenderBarrier> barriers)>;
+
+// Passes declare which textures they read and write and in which state; the
+// graph orders nothing, passes run in the order they were added. compile()
+// culls passes whose results nobody uses, places transient textures with
+// disjoint lifetimes in the same memory and works out the barriers between
+// passes, one batch per gap. Pure bookkeeping, no graphics API; rebuilt each
+// frame or kept as long as its shape does not change. Not thread-safe.
+class RenderGraph
+{
+public:
+
+    RenderGraph() = default;
+
+    // Keeps capacity for the next frame
+    void reset();
+
+    // Owned outside the graph, e.g. the back buffer; the graph moves it from
+    // initialState and hands it back in finalState. Always treated as an output.
+    RenderResourceHandle importTexture(std::string name, const TextureDesc& desc, ResourceState initialState, ResourceState finalState);
+
+    // Lives only while passes use it and may share memory with other transients
+    RenderResourceHandle createTexture(std::string name, const TextureDesc& desc);
+
+    RenderPassHandle addPass(std::string name, RenderPassFunc execute = {});
+
+    // Reading and writing the same texture in one pass needs the same state for both
+    void read(RenderPassHandle pass, RenderResourceHandle resource, ResourceState state);
+
+    // Overwrites the previous contents unless the pass also reads them
+    void write(RenderPassHandle pass, RenderResourceHandle resource, ResourceState state);
+
+    // Never culled, for passes with effects outside the graph such as readbacks
+    void setSideEffects(RenderPassHandle pass);
+
+    // Fails on inconsistent declarations and on reads of transients nothing wrote.
+    // Without footprint, sizes come from EstimateTextureFootprint.
+    bool compile(const FootprintFunc& footprint = {});
+
+    // Runs the live passes with their barrier batches in between; empty batches are skipped
+    void execute(const BarrierFunc& barriers)const;
+
+    std::uint32_t livePassCount()const { return static_cast<std::uint32_t>(m_livePasses.size()); }
+
+    RenderPassHandle livePass(std::uint32_t index)const { return m_livePasses[index]; }
+
+    // Handles run from 1 to resourceCount()
+    std::uint32_t resourceCount()const { return static_cast<std::uint32_t>(m_resources.size()); }
+
+    // Batch i runs before live pass i; batch livePassCount() after the last one
+    std::span<const RenderBarrier> barriers(std::uint32_t batch)const;
+
+    // Only for transients used by live passes
+    std::optional<TexturePlacement> placement(RenderResourceHandle resource)const;
+
+    const std::string& name(RenderResourceHandle resource)const { return m_resources[resource.id - 1].name; }
+
+    const std::string& name(RenderPassHandle pass)const { return m_passes[pass.id - 1].name; }
+
+    const TextureDesc& desc(RenderResourceHandle resource)const { return m_resources[resource.id - 1].desc; }
+
+    const RenderGraphStats& stats()const { return m_stats; }
+
+private:
+
+    struct Resource
+    {
+        std::string name;
+
+        TextureDesc desc;
+
+        bool imported = false;
+
+        ResourceState initialState = ResourceState::Undefined;
+
+        ResourceState finalState = ResourceState::Undefined;
+    };
+
+    struct Access
+    {
+        std::uint32_t resource = 0;
+
+        ResourceState state = ResourceState::Undefined;
+
+        bool read = false;
+
+        bool write = false;
+    };
+
+    struct Pass
+    {
+        std::string name;
+
+        RenderPassFunc execute;
+
+        std::vector<Access> accesses;
+
+        bool sideEffects = false;
+    };
+
+    struct Batch
+    {
+        std::uint32_t first = 0;
+
+        std::uint32_t count = 0;
+    };
+
+    void addAccess(RenderPassHandle pass, RenderResourceHandle resource, ResourceState state, bool write);
+
+    void cull();
+
+    bool validate()const;
+
+    void placeTransients(const FootprintFunc& footprint);
+
+    void buildBarriers();
+
+    std::vector<Resource> m_resources;
+
+    std::vector<Pass> m_passes;
+
+    bool m_invalid = false;
+
+    // Filled by compile
+
+    std::vector<RenderPassHandle> m_livePasses;
+
+    // By resource index; size 0 for imports and unused transients
+    std::vector<TexturePlacement> m_placements;
+
+    std::vector<RenderBarrier> m_barriers;
+
+    std::vector<Batch> m_batches;
+
+    RenderGraphStats m_stats;
+};
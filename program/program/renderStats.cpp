@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include "renderStats.hpp"
+
+std::uint64_t FrameTimeHistogram::percentile(double q)const
+{
+    if (m_count == 0)
+    {
+        return 0;
+    }
+
+    // Rank of the sample at q, 1-based, so p100 is the largest sample
+    const auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(m_count))));
+
+    std::uint64_t seen = 0;
+
+    for (std::uint32_t i = 0; i < BucketCount; ++i)
+    {
+        seen += m_buckets[i];
+
+        if (rank <= seen)
+        {
+            return BucketValue(i);
+        }
+    }
+
+    return BucketValue(BucketCount - 1);
+}
+
+void RenderStats::endFrame(std::uint64_t frameTimeNs)
+{
+    const auto take = [this](RenderCounter counter)
+    {
+        return m_counters[static_cast<std::size_t>(counter)].exchange(0, std::memory_order_relaxed);
+    };
+
+    // Judged against the window before this frame joins it
+    const bool stutter = StutterMinFrames <= m_histogram.count() &&
+        static_cast<double>(m_histogram.percentile(0.5)) * StutterFactor < static_cast<double>(frameTimeNs);
+
+    if (m_histogram.count() == WindowFrames)
+    {
+        m_histogram.remove(m_window[m_windowNext]);
+    }
+
+    m_histogram.add(frameTimeNs);
+
+    m_window[m_windowNext] = frameTimeNs;
+    m_windowNext = (m_windowNext + 1) % WindowFrames;
+
+    m_stutters += stutter ? 1 : 0;
+
+    m_lastFrame =
+    {
+        .frameIndex = m_lastFrame.frameIndex + 1,
+        .frameTimeNs = frameTimeNs,
+        .drawCalls = take(RenderCounter::DrawCalls),
+        .pipelineSwitches = take(RenderCounter::PipelineSwitches),
+        .bytesUploaded = take(RenderCounter::BytesUploaded),
+        .fenceWaitNs = take(RenderCounter::FenceWaitNs),
+        .liveMeshBuffers = m_liveMeshBuffers.load(std::memory_order_relaxed),
+        .stutter = stutter,
+    };
+
+    if (m_dumpFile.is_open())
+    {
+        const auto now = std::chrono::steady_clock::now();
+
+        if (m_dumpInterval <= now - m_lastDump)
+        {
+            m_lastDump = now;
+
+            dump();
+        }
+    }
+}
+
+FrameTimeSummary RenderStats::summary()const
+{
+    const auto frames = m_histogram.count();
+
+    return
+    {
+        .frames = frames,
+        .p50Ns = m_histogram.percentile(0.5),
+        .p99Ns = m_histogram.percentile(0.99),
+        .p999Ns = m_histogram.percentile(0.999),
+        .maxNs = frames == 0 ? 0 : *std::max_element(m_window.begin(), m_window.begin() + frames),
+        .stutters = m_stutters,
+    };
+}
+
+bool RenderStats::setDump(const std::filesystem::path& path, std::chrono::milliseconds interval)
+{
+    m_dumpFile.close();
+
+    if (path.empty())
+    {
+        return true;
+    }
+
+    m_dumpFile.open(path, std::ios::binary | std::ios::app);
+
+    m_dumpInterval = interval;
+    m_lastDump = std::chrono::steady_clock::now();
+
+    return m_dumpFile.is_open();
+}
+
+void RenderStats::dump()
+{
+    const auto times = summary();
+    const auto& frame = m_lastFrame;
+
+    const auto field = [](const char* name, auto value)
+    {
+        return std::string("\"") + name + "\":" + std::to_string(value);
+    };
+
+    const std::string line = std::string("{") +
+        field("frame", frame.frameIndex) + "," +
+        field("frameTimeNs", frame.frameTimeNs) + "," +
+        field("drawCalls", frame.drawCalls) + "," +
+        field("pipelineSwitches", frame.pipelineSwitches) + "," +
+        field("bytesUploaded", frame.bytesUploaded) + "," +
+        field("fenceWaitNs", frame.fenceWaitNs) + "," +
+        field("liveMeshBuffers", frame.liveMeshBuffers) + "," +
+        field("windowFrames", times.frames) + "," +
+        field("p50Ns", times.p50Ns) + "," +
+        field("p99Ns", times.p99Ns) + "," +
+        field("p999Ns", times.p999Ns) + "," +
+        field("maxNs", times.maxNs) + "," +
+        field("stutters", times.stutters) + "}\n";
+
+    m_dumpFile.write(line.data(), static_cast<std::streamsize>(line.size()));
+    m_dumpFile.flush();
+}
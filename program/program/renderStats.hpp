@@ -0,0 +1,191 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+// Counters cleared at every frame end
+enum class RenderCounter : std::uint32_t
+{
+    DrawCalls,
+    PipelineSwitches,
+    BytesUploaded,
+    FenceWaitNs,
+    Count,
+};
+
+// Log-linear buckets in the style of HdrHistogram: exact below SubBuckets,
+// then SubBuckets / 2 buckets per power of two, so any recorded value is
+// off by less than 1/64 of itself. Covers nanoseconds up to ~4.9 hours.
+class FrameTimeHistogram
+{
+public:
+
+    static constexpr std::uint32_t SubBuckets = 128;
+
+    static constexpr std::uint32_t MaxShift = 37;
+
+    static constexpr std::uint32_t BucketCount = SubBuckets + MaxShift * SubBuckets / 2;
+
+    static constexpr std::uint32_t BucketIndex(std::uint64_t value)
+    {
+        if (value < SubBuckets)
+        {
+            return static_cast<std::uint32_t>(value);
+        }
+
+        const auto shift = static_cast<std::uint32_t>(std::bit_width(value)) - std::bit_width(SubBuckets - 1);
+
+        if (MaxShift < shift)
+        {
+            return BucketCount - 1;
+        }
+
+        return SubBuckets + (shift - 1) * (SubBuckets / 2) + static_cast<std::uint32_t>(value >> shift) - SubBuckets / 2;
+    }
+
+    // Largest value that falls into index, so percentiles never read low
+    static constexpr std::uint64_t BucketValue(std::uint32_t index)
+    {
+        if (index < SubBuckets)
+        {
+            return index;
+        }
+
+        const auto shift = (index - SubBuckets) / (SubBuckets / 2) + 1;
+        const auto sub = (index - SubBuckets) % (SubBuckets / 2) + SubBuckets / 2;
+
+        return ((static_cast<std::uint64_t>(sub) + 1) << shift) - 1;
+    }
+
+    FrameTimeHistogram() : m_buckets(BucketCount) {}
+
+    void add(std::uint64_t value) { ++m_buckets[BucketIndex(value)]; ++m_count; }
+
+    void remove(std::uint64_t value) { --m_buckets[BucketIndex(value)]; --m_count; }
+
+    // q in [0, 1]; 0 when empty
+    std::uint64_t percentile(double q)const;
+
+    std::uint64_t count()const { return m_count; }
+
+private:
+
+    std::vector<std::uint32_t> m_buckets;
+
+    std::uint64_t m_count = 0;
+};
+
+struct FrameStats
+{
+    std::uint64_t frameIndex = 0;
+
+    std::uint64_t frameTimeNs = 0;
+
+    std::uint64_t drawCalls = 0;
+
+    std::uint64_t pipelineSwitches = 0;
+
+    std::uint64_t bytesUploaded = 0;
+
+    std::uint64_t fenceWaitNs = 0;
+
+    std::int64_t liveMeshBuffers = 0;
+
+    bool stutter = false;
+};
+
+// Frame times over the last WindowFrames frames
+struct FrameTimeSummary
+{
+    std::uint64_t frames = 0;
+
+    std::uint64_t p50Ns = 0;
+
+    std::uint64_t p99Ns = 0;
+
+    std::uint64_t p999Ns = 0;
+
+    std::uint64_t maxNs = 0;
+
+    // Since start, not just the window
+    std::uint64_t stutters = 0;
+};
+
+// Always-on metrics. Any thread may bump a counter with a relaxed add; the
+// thread that ends frames folds them into per-frame stats and a rolling
+// frame-time histogram, and appends a JSON line to the dump file now and then.
+class RenderStats
+{
+public:
+
+    static constexpr std::uint32_t WindowFrames = 1024;
+
+    // A frame slower than this many times the window's median is a stutter
+    static constexpr double StutterFactor = 2.0;
+
+    // Too few frames make the median meaningless
+    static constexpr std::uint32_t StutterMinFrames = 30;
+
+    static RenderStats& instance()
+    {
+        static RenderStats i;
+        return i;
+    }
+
+    RenderStats(const RenderStats&) = delete;
+
+    RenderStats& operator=(const RenderStats&) = delete;
+
+    void add(RenderCounter counter, std::uint64_t value = 1)
+    {
+        m_counters[static_cast<std::size_t>(counter)].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    void addLiveMeshBuffers(std::int64_t delta)
+    {
+        m_liveMeshBuffers.fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    void endFrame(std::uint64_t frameTimeNs);
+
+    const FrameStats& lastFrame()const { return m_lastFrame; }
+
+    FrameTimeSummary summary()const;
+
+    // Appends one JSON line per interval to path; a FIFO or named pipe works for a
+    // live consumer. An empty path stops dumping.
+    bool setDump(const std::filesystem::path& path, std::chrono::milliseconds interval = std::chrono::seconds(1));
+
+private:
+
+    RenderStats() = default;
+
+    void dump();
+
+    std::array<std::atomic<std::uint64_t>, static_cast<std::size_t>(RenderCounter::Count)> m_counters = {};
+
+    std::atomic<std::int64_t> m_liveMeshBuffers = 0;
+
+    FrameStats m_lastFrame;
+
+    FrameTimeHistogram m_histogram;
+
+    // Frame times in the window, oldest at m_windowNext once full
+    std::array<std::uint64_t, WindowFrames> m_window = {};
+
+    std::uint32_t m_windowNext = 0;
+
+    std::uint64_t m_stutters = 0;
+
+    std::ofstream m_dumpFile;
+
+    std::chrono::steady_clock::duration m_dumpInterval = {};
+
+    std::chrono::steady_clock::time_point m_lastDump;
+};
@@ -0,0 +1,151 @@
+#include <algorithm>
+
+#include "logger.hpp"
+#include "profiler.hpp"
+#include "renderThread.hpp"
+
+RenderThread::~RenderThread()
+{
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+void RenderThread::start(Callbacks callbacks)
+{
+    m_callbacks = std::move(callbacks);
+
+    m_thread = std::thread([this] { run(); });
+}
+
+bool RenderThread::join()
+{
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+
+    return m_succeeded;
+}
+
+void RenderThread::run()
+{
+    ProfileThreadName("Render");
+
+    m_succeeded = !m_callbacks.init || m_callbacks.init();
+
+    if (!m_succeeded)
+    {
+        ErrorLog(L"描画スレッドの初期化に失敗しました");
+    }
+
+    while (m_succeeded)
+    {
+        // Nothing to draw while minimized, so sleep until the window sends something
+        if (m_minimized)
+        {
+            m_events.wait();
+        }
+
+        if (!drainEvents())
+        {
+            break;
+        }
+
+        if (m_pendingResize)
+        {
+            const auto width = m_pendingResize->x;
+            const auto height = m_pendingResize->y;
+
+            m_pendingResize.reset();
+
+            m_minimized = width <= 0 || height <= 0;
+
+            if (!m_minimized && (width != m_width || height != m_height))
+            {
+                ProfileScope("RenderThread::resize");
+
+                if (m_callbacks.resize && !m_callbacks.resize(width, height))
+                {
+                    ErrorLog(L"画面サイズの変更に失敗しました");
+                    m_succeeded = false;
+                    break;
+                }
+
+                m_width = width;
+                m_height = height;
+
+                ++m_stats.resizes;
+            }
+        }
+
+        if (m_minimized)
+        {
+            continue;
+        }
+
+        if (m_callbacks.frame && !m_callbacks.frame())
+        {
+            m_succeeded = false;
+            break;
+        }
+
+        ++m_stats.frames;
+    }
+
+    // Resizes the window thread replaced before this thread saw them were skipped too
+    m_stats.coalescedResizes += m_events.stats().replacedResizes;
+
+    if (m_callbacks.shutdown)
+    {
+        m_callbacks.shutdown();
+    }
+
+    if (m_callbacks.exited)
+    {
+        m_callbacks.exited();
+    }
+}
+
+bool RenderThread::drainEvents()
+{
+    ProfileScope("RenderThread::drainEvents");
+
+    const auto now = Profiler::Now();
+
+    while (const auto event = m_events.pop())
+    {
+        ++m_stats.events;
+
+        const auto latency = event->timestamp < now ? now - event->timestamp : 0;
+
+        m_stats.totalEventLatencyNs += latency;
+        m_stats.maxEventLatencyNs = std::max(m_stats.maxEventLatencyNs, latency);
+
+        switch (event->type)
+        {
+        case WindowEventType::Quit:
+            // The rest of the batch would only feed a frame that is never drawn
+            return false;
+
+        case WindowEventType::Resize:
+            if (m_pendingResize)
+            {
+                ++m_stats.coalescedResizes;
+            }
+
+            m_pendingResize = event;
+            break;
+
+        default:
+            if (m_callbacks.input)
+            {
+                m_callbacks.input(event.value());
+            }
+            break;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <thread>
+
+#include "windowEvent.hpp"
+
+struct RenderThreadStats
+{
+    std::uint64_t frames = 0;
+
+    std::uint64_t events = 0;
+
+    // Resizes applied, and those skipped because a later one arrived before the frame
+    std::uint64_t resizes = 0;
+
+    std::uint64_t coalescedResizes = 0;
+
+    // From WindowEvent::timestamp to the render thread taking the event
+    std::uint64_t totalEventLatencyNs = 0;
+
+    std::uint64_t maxEventLatencyNs = 0;
+};
+
+// Runs the frame loop on its own thread, so a long frame never holds up the
+// window's message pump and a message backlog never delays a frame. Events
+// arrive through a WindowEventQueue and are drained before every frame:
+// input is handed on in order, only the last resize of the batch is applied,
+// and a quit ends the loop before another frame is started.
+class RenderThread
+{
+public:
+
+    // Every callback runs on the render thread
+    struct Callbacks
+    {
+        // Before the first frame; creates the device and resources
+        std::function<bool()> init;
+
+        std::function<bool()> frame;
+
+        std::function<bool(int width, int height)> resize;
+
+        std::function<void(const WindowEvent& event)> input;
+
+        // After the last frame, also when init or a frame failed
+        std::function<void()> shutdown;
+
+        // Last of all, however the loop ended; the window closes itself from here
+        std::function<void()> exited;
+    };
+
+    // width and height are the size init creates the swap chain with; a resize
+    // event to the same size is ignored
+    RenderThread(WindowEventQueue& events, int width, int height)
+        : m_events(events)
+        , m_width(width)
+        , m_height(height)
+    {}
+
+    ~RenderThread();
+
+    RenderThread(const RenderThread&) = delete;
+
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    void start(Callbacks callbacks);
+
+    // False when init, a frame or a resize failed
+    bool join();
+
+    // Complete once join returned
+    const RenderThreadStats& stats()const { return m_stats; }
+
+private:
+
+    void run();
+
+    // Takes every queued event; returns false on a quit
+    bool drainEvents();
+
+    WindowEventQueue& m_events;
+
+    Callbacks m_callbacks;
+
+    std::thread m_thread;
+
+    RenderThreadStats m_stats;
+
+    int m_width = 0;
+
+    int m_height = 0;
+
+    // The newest resize of the current batch
+    std::optional<WindowEvent> m_pendingResize;
+
+    bool m_minimized = false;
+
+    bool m_succeeded = true;
+};
@@ -0,0 +1,350 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+
+#include "logger.hpp"
+#include "shaderCache.hpp"
+
+namespace
+{
+    constexpr std::uint64_t FnvPrime = 0x100000001b3ull;
+
+    constexpr std::uint32_t CacheEntryMagic = 0x43444853; // "SHDC"
+
+    struct CacheEntryHeader
+    {
+        std::uint32_t magic = CacheEntryMagic;
+
+        std::uint32_t version = ShaderCacheVersion;
+
+        std::uint64_t key = 0;
+
+        std::uint64_t size = 0;
+
+        std::uint64_t checksum = 0;
+    };
+
+    std::uint64_t HashValue(std::uint64_t value, std::uint64_t seed)
+    {
+        return HashBytes(std::as_bytes(std::span(&value, 1)), seed);
+    }
+
+    std::optional<std::string> ReadTextFile(const std::filesystem::path& path)
+    {
+        std::ifstream ifs(path, std::ios::binary);
+
+        if (!ifs)
+        {
+            return std::nullopt;
+        }
+
+        return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    }
+
+    // Returns the name inside "..." or <...> when the line is an include directive
+    std::optional<std::string> ParseInclude(std::string_view line)
+    {
+        const auto skipSpace = [&line]()
+        {
+            while (!line.empty() && (line.front() == ' ' || line.front() == '\t'))
+            {
+                line.remove_prefix(1);
+            }
+        };
+
+        skipSpace();
+
+        if (line.empty() || line.front() != '#')
+        {
+            return std::nullopt;
+        }
+
+        line.remove_prefix(1);
+        skipSpace();
+
+        constexpr std::string_view directive = "include";
+
+        if (!line.starts_with(directive))
+        {
+            return std::nullopt;
+        }
+
+        line.remove_prefix(directive.size());
+        skipSpace();
+
+        if (line.empty() || (line.front() != '"' && line.front() != '<'))
+        {
+            return std::nullopt;
+        }
+
+        const char close = line.front() == '"' ? '"' : '>';
+        line.remove_prefix(1);
+
+        const auto end = line.find(close);
+
+        if (end == std::string_view::npos || end == 0)
+        {
+            return std::nullopt;
+        }
+
+        return std::string(line.substr(0, end));
+    }
+
+    void ScanFile(const std::filesystem::path& path, const std::string& text, ShaderSourceInfo& info)
+    {
+        info.contentHash = HashString(path.filename().string(), info.contentHash);
+        info.contentHash = HashString(text, info.contentHash);
+
+        std::string_view remaining = text;
+
+        while (!remaining.empty())
+        {
+            const auto end = remaining.find('\n');
+            const auto line = remaining.substr(0, end);
+
+            remaining = end == std::string_view::npos ? std::string_view{} : remaining.substr(end + 1);
+
+            const auto name = ParseInclude(line);
+
+            if (!name)
+            {
+                continue;
+            }
+
+            const auto includePath = (path.parent_path() / name.value()).lexically_normal();
+
+            // Shared headers are usually guarded, so each file only counts once
+            if (std::find(info.files.begin(), info.files.end(), includePath) != info.files.end())
+            {
+                continue;
+            }
+
+            info.files.push_back(includePath);
+
+            const auto includeText = ReadTextFile(includePath);
+
+            if (!includeText)
+            {
+                info.contentHash = HashString(includePath.generic_string(), info.contentHash);
+                continue;
+            }
+
+            ScanFile(includePath, includeText.value(), info);
+        }
+    }
+
+    std::string KeyName(std::uint64_t key)
+    {
+        static constexpr char digits[] = "0123456789abcdef";
+
+        std::string name(16, '0');
+
+        for (int i = 15; i >= 0; --i, key >>= 4)
+        {
+            name[i] = digits[key & 0xf];
+        }
+
+        return name;
+    }
+}
+
+std::uint64_t HashBytes(std::span<const std::byte> data, std::uint64_t seed)
+{
+    std::uint64_t hash = seed;
+
+    for (const auto byte : data)
+    {
+        hash ^= static_cast<std::uint8_t>(byte);
+        hash *= FnvPrime;
+    }
+
+    return hash;
+}
+
+std::uint64_t HashString(std::string_view text, std::uint64_t seed)
+{
+    // The length goes in first so "ab" + "c" and "a" + "bc" hash differently
+    return HashBytes(std::as_bytes(std::span(text.data(), text.size())), HashValue(text.size(), seed));
+}
+
+std::optional<ShaderSourceInfo> ScanShaderSource(const std::filesystem::path& sourcePath)
+{
+    const auto text = ReadTextFile(sourcePath);
+
+    if (!text)
+    {
+        return std::nullopt;
+    }
+
+    ShaderSourceInfo info;
+    info.files.push_back(sourcePath.lexically_normal());
+    info.contentHash = HashValue(ShaderCacheVersion, 0xcbf29ce484222325ull);
+
+    ScanFile(info.files.front(), text.value(), info);
+
+    return info;
+}
+
+std::optional<std::uint64_t> ComputeShaderKey(const ShaderCompileDesc& desc)
+{
+    const auto source = ScanShaderSource(desc.sourcePath);
+
+    if (!source)
+    {
+        return std::nullopt;
+    }
+
+    std::uint64_t key = source->contentHash;
+
+    key = HashString(desc.entryPoint, key);
+    key = HashString(desc.target, key);
+    key = HashValue(desc.defines.size(), key);
+
+    for (const auto& define : desc.defines)
+    {
+        key = HashString(define.name, key);
+        key = HashString(define.value, key);
+    }
+
+    key = HashValue(desc.flags, key);
+    key = HashValue(desc.compilerVersion, key);
+
+    return key;
+}
+
+bool ShaderCache::init(const std::filesystem::path& directory)
+{
+    std::error_code error;
+
+    std::filesystem::create_directories(directory, error);
+
+    if (error)
+    {
+        ErrorLog(L"シェーダーキャッシュのディレクトリを作成できません");
+        return false;
+    }
+
+    m_directory = directory;
+
+    return true;
+}
+
+ShaderCacheStats ShaderCache::stats()const
+{
+    std::lock_guard lock(m_mutex);
+
+    return m_stats;
+}
+
+void ShaderCache::count(std::uint64_t ShaderCacheStats::* counter)
+{
+    std::lock_guard lock(m_mutex);
+
+    ++(m_stats.*counter);
+}
+
+std::optional<std::vector<std::byte>> ShaderCache::loadBytecode(std::uint64_t key)
+{
+    return load(m_directory / (KeyName(key) + ".cso"), key);
+}
+
+bool ShaderCache::storeBytecode(std::uint64_t key, std::span<const std::byte> bytecode)
+{
+    return store(m_directory / (KeyName(key) + ".cso"), key, bytecode);
+}
+
+std::optional<std::vector<std::byte>> ShaderCache::loadBlob(const std::string& name)
+{
+    return load(m_directory / (name + ".bin"), HashString(name));
+}
+
+bool ShaderCache::storeBlob(const std::string& name, std::span<const std::byte> data)
+{
+    return store(m_directory / (name + ".bin"), HashString(name), data);
+}
+
+std::optional<std::vector<std::byte>> ShaderCache::load(const std::filesystem::path& path, std::uint64_t key)
+{
+    std::ifstream ifs(path, std::ios::binary | std::ios::ate);
+
+    if (!ifs)
+    {
+        count(&ShaderCacheStats::misses);
+        return std::nullopt;
+    }
+
+    const auto fileSize = static_cast<std::uint64_t>(ifs.tellg());
+    ifs.seekg(0);
+
+    CacheEntryHeader header;
+
+    ifs.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    if (!ifs || header.magic != CacheEntryMagic || header.version != ShaderCacheVersion || header.key != key ||
+        fileSize - sizeof(header) != header.size)
+    {
+        count(&ShaderCacheStats::rejected);
+        return std::nullopt;
+    }
+
+    std::vector<std::byte> data(header.size);
+
+    ifs.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+
+    if (!ifs || HashBytes(data) != header.checksum)
+    {
+        count(&ShaderCacheStats::rejected);
+        return std::nullopt;
+    }
+
+    count(&ShaderCacheStats::hits);
+
+    return data;
+}
+
+bool ShaderCache::store(const std::filesystem::path& path, std::uint64_t key, std::span<const std::byte> data)
+{
+    if (m_directory.empty())
+    {
+        return false;
+    }
+
+    const CacheEntryHeader header =
+    {
+        .key = key,
+        .size = data.size(),
+        .checksum = HashBytes(data),
+    };
+
+    // Two threads may store the same key; each writes its own file and the last rename wins
+    auto temporaryPath = path;
+    temporaryPath += ".tmp" + std::to_string(m_temporaryId.fetch_add(1));
+
+    {
+        std::ofstream ofs(temporaryPath, std::ios::binary | std::ios::trunc);
+
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        ofs.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+
+        if (!ofs)
+        {
+            return false;
+        }
+    }
+
+    std::error_code error;
+
+    std::filesystem::rename(temporaryPath, path, error);
+
+    if (error)
+    {
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+
+    count(&ShaderCacheStats::writes);
+
+    return true;
+}
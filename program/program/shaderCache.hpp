@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "renderBackend.hpp"
+
+// Bump whenever the key layout or the cache file format changes
+constexpr std::uint32_t ShaderCacheVersion = 1;
+
+std::uint64_t HashBytes(std::span<const std::byte> data, std::uint64_t seed = 0xcbf29ce484222325ull);
+
+std::uint64_t HashString(std::string_view text, std::uint64_t seed = 0xcbf29ce484222325ull);
+
+struct ShaderCompileDesc
+{
+    std::filesystem::path sourcePath;
+
+    std::string entryPoint;
+
+    std::string target;
+
+    std::vector<ShaderDefine> defines;
+
+    // Backend specific compiler flags and compiler version, only hashed here
+    std::uint32_t flags = 0;
+
+    std::uint32_t compilerVersion = 0;
+};
+
+struct ShaderSourceInfo
+{
+    // The source itself first, then every resolved include in discovery order
+    std::vector<std::filesystem::path> files;
+
+    std::uint64_t contentHash = 0;
+};
+
+// Follows #include "..." and #include <...> relative to the including file,
+// the same way D3D_COMPILE_STANDARD_FILE_INCLUDE resolves them. Includes that
+// cannot be opened are hashed by name so adding them later changes the key.
+std::optional<ShaderSourceInfo> ScanShaderSource(const std::filesystem::path& sourcePath);
+
+std::optional<std::uint64_t> ComputeShaderKey(const ShaderCompileDesc& desc);
+
+struct ShaderCacheStats
+{
+    std::uint64_t hits = 0;
+
+    std::uint64_t misses = 0;
+
+    std::uint64_t writes = 0;
+
+    std::uint64_t rejected = 0;
+};
+
+// Stores compiled bytecode by key and arbitrary named blobs (e.g. a serialized
+// pipeline library) under one directory. Entries are written to a temporary
+// file and renamed into place, and carry a checksum so a torn or stale file
+// is treated as a miss. Loads and stores may run on several threads at once.
+class ShaderCache
+{
+public:
+
+    ShaderCache() = default;
+
+    bool init(const std::filesystem::path& directory);
+
+    std::optional<std::vector<std::byte>> loadBytecode(std::uint64_t key);
+
+    bool storeBytecode(std::uint64_t key, std::span<const std::byte> bytecode);
+
+    std::optional<std::vector<std::byte>> loadBlob(const std::string& name);
+
+    bool storeBlob(const std::string& name, std::span<const std::byte> data);
+
+    ShaderCacheStats stats()const;
+
+    const std::filesystem::path& directory()const { return m_directory; }
+
+private:
+
+    std::optional<std::vector<std::byte>> load(const std::filesystem::path& path, std::uint64_t key);
+
+    bool store(const std::filesystem::path& path, std::uint64_t key, std::span<const std::byte> data);
+
+    void count(std::uint64_t ShaderCacheStats::* counter);
+
+    std::filesystem::path m_directory;
+
+    mutable std::mutex m_mutex;
+
+    ShaderCacheStats m_stats;
+
+    std::atomic<std::uint64_t> m_temporaryId = 0;
+};
@@ -1,10 +1,12 @@
 #pragma once
 
-#include <Windows.h>
-#include <d3d12.h>
-#include <dxgi1_6.h>
+#include <string>
+#include <type_traits>
+#include <vector>
 
 #include "dx.hpp"
+#include "renderBackend.hpp"
+#include "vertexLayout.hpp"
 
 class ShaderPipeline
 {
@@ -12,13 +14,69 @@ public:
 
     ShaderPipeline() = default;
 
+    // POSITION as float3 only, for vertex types without a VertexLayout
     bool init(const std::wstring& vertexShaderPath, const std::wstring& pixelShaderPath);
 
+    // InstanceType, when given, supplies per-instance attributes from input slot 1
+    template<typename VertexType, typename InstanceType = void>
+    bool init(const std::wstring& vertexShaderPath, const std::wstring& pixelShaderPath);
+
+    // Returns at once and compiles in the background; Dx::setPipeline skips or
+    // substitutes a fallback until ready() is true
+    bool initAsync(const std::wstring& vertexShaderPath, const std::wstring& pixelShaderPath);
+
+    template<typename VertexType, typename InstanceType = void>
+    bool initAsync(const std::wstring& vertexShaderPath, const std::wstring& pixelShaderPath);
+
+    PipelineStatus status()const;
+
+    bool ready()const { return status() == PipelineStatus::Ready; }
+
+    PipelineHandle handle()const { return m_handle; }
+
+    std::uint64_t layoutId()const { return m_layoutId; }
+
 private:
 
-    friend class Dx;
+    bool initWithLayout(const std::wstring& vertexShaderPath, const std::wstring& pixelShaderPath,
+        std::vector<VertexElement> inputLayout, std::uint64_t layoutId, bool async);
+
+    static std::vector<VertexElement> PositionOnlyLayout();
 
-    ID3D12PipelineState* m_pipelineState = nullptr;
+    template<typename VertexType, typename InstanceType>
+    static std::vector<VertexElement> MakeLayout();
 
-    ID3D12RootSignature* m_rootSignature = nullptr;
+    PipelineHandle m_handle;
+
+    std::uint64_t m_layoutId = 0;
 };
+
+template<typename VertexType, typename InstanceType>
+inline bool ShaderPipeline::init(const std::wstring& vertexShaderPath, const std::wstring& pixelShaderPath)
+{
+    return initWithLayout(vertexShaderPath, pixelShaderPath, MakeLayout<VertexType, InstanceType>(), VertexLayoutId<VertexType>(), false);
+}
+
+template<typename VertexType, typename InstanceType>
+inline bool ShaderPipeline::initAsync(const std::wstring& vertexShaderPath, const std::wstring& pixelShaderPath)
+{
+    return initWithLayout(vertexShaderPath, pixelShaderPath, MakeLayout<VertexType, InstanceType>(), VertexLayoutId<VertexType>(), true);
+}
+
+template<typename VertexType, typename InstanceType>
+inline std::vector<VertexElement> ShaderPipeline::MakeLayout()
+{
+    static_assert(HasVertexLayout<VertexType>, "VertexType needs a VertexLayout specialization");
+    static_assert(VertexLayoutHas<VertexType>("POSITION"), "VertexLayout needs a POSITION attribute");
+
+    if constexpr (std::is_void_v<InstanceType>)
+    {
+        return MakeInputLayout<VertexType>();
+    }
+    else
+    {
+        static_assert(HasVertexLayout<InstanceType>, "InstanceType needs a VertexLayout specialization");
+
+        return MakeInputLayout<VertexType, InstanceType>();
+    }
+}
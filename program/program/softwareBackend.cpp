@@ -0,0 +1,506 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SOFTWARE_RASTER_SSE2
+#endif
+
+#include "logger.hpp"
+#include "softwareBackend.hpp"
+#include "vertexQuantization.hpp"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double SecondsSince(Clock::time_point begin)
+    {
+        return std::chrono::duration<double>(Clock::now() - begin).count();
+    }
+
+    std::uint32_t ReadIndex(const std::uint8_t* data, IndexFormat format, std::uint32_t i)
+    {
+        if (format == IndexFormat::Uint16)
+        {
+            std::uint16_t index;
+            std::memcpy(&index, data + i * 2, sizeof(index));
+            return index;
+        }
+
+        std::uint32_t index;
+        std::memcpy(&index, data + i * 4, sizeof(index));
+        return index;
+    }
+
+    std::array<float, 4> ReadPosition(const std::uint8_t* data, VertexFormat format)
+    {
+        std::array<float, 4> position = { 0.f, 0.f, 0.f, 1.f };
+
+        switch (format)
+        {
+        case VertexFormat::Float2:
+        case VertexFormat::Float3:
+        case VertexFormat::Float4:
+            std::memcpy(position.data(), data, VertexFormatSize(format));
+            break;
+        case VertexFormat::Half2:
+        case VertexFormat::Half4:
+            for (std::uint32_t i = 0; i < VertexFormatSize(format) / 2; ++i)
+            {
+                std::uint16_t half;
+                std::memcpy(&half, data + i * 2, sizeof(half));
+                position[i] = HalfToFloat(half);
+            }
+            break;
+        default:
+            break;
+        }
+
+        return position;
+    }
+
+    int PopCount4(int mask)
+    {
+        return (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+    }
+}
+
+SoftwareBackend::SoftwareBackend(std::uint32_t threadCount)
+    : m_threadPool(threadCount)
+{}
+
+bool SoftwareBackend::init(const BackendDesc& desc)
+{
+    return resize(desc.width, desc.height);
+}
+
+bool SoftwareBackend::resize(int width, int height)
+{
+    if (width <= 0 || height <= 0)
+    {
+        ErrorLog(L"画面サイズが不正です");
+        return false;
+    }
+
+    if (m_inFrame)
+    {
+        ErrorLog(L"フレームの途中で resize が呼ばれました");
+        return false;
+    }
+
+    m_width = width;
+    m_height = height;
+
+    m_tilesX = (m_width + TileSize - 1) / TileSize;
+    m_tilesY = (m_height + TileSize - 1) / TileSize;
+
+    m_colorBuffer.assign(static_cast<std::size_t>(m_width) * m_height, m_clearColor);
+
+    m_tileBins.assign(static_cast<std::size_t>(m_tilesX) * m_tilesY, {});
+    m_tilePixels.assign(m_tileBins.size(), 0);
+
+    setViewport({ .width = static_cast<float>(m_width), .height = static_cast<float>(m_height) });
+    setScissor({ .right = m_width, .bottom = m_height });
+
+    return true;
+}
+
+bool SoftwareBackend::frameBegin()
+{
+    if (m_inFrame)
+    {
+        ErrorLog(L"frameBegin が二重に呼ばれました");
+        return false;
+    }
+
+    m_inFrame = true;
+
+    m_currentPipeline = {};
+    m_triangles.clear();
+
+    // Both start out covering the whole target, as in D3D12Backend
+    setViewport({ .width = static_cast<float>(m_width), .height = static_cast<float>(m_height) });
+    setScissor({ .right = m_width, .bottom = m_height });
+
+    for (auto& bin : m_tileBins)
+    {
+        bin.clear();
+    }
+
+    return true;
+}
+
+bool SoftwareBackend::frameEnd()
+{
+    if (!m_inFrame)
+    {
+        ErrorLog(L"frameBegin なしで frameEnd が呼ばれました");
+        return false;
+    }
+
+    const auto begin = Clock::now();
+
+    std::fill(m_tilePixels.begin(), m_tilePixels.end(), 0);
+
+    m_threadPool.parallelFor(static_cast<std::uint32_t>(m_tileBins.size()), [this](std::uint32_t tileIndex)
+        {
+            rasterizeTile(tileIndex);
+        });
+
+    for (auto pixels : m_tilePixels)
+    {
+        m_stats.pixels += pixels;
+    }
+
+    m_stats.triangles += m_triangles.size();
+    m_stats.rasterSeconds += SecondsSince(begin);
+
+    m_inFrame = false;
+
+    return true;
+}
+
+bool SoftwareBackend::waitIdle()
+{
+    return true;
+}
+
+std::optional<BufferHandle> SoftwareBackend::createBuffer(BufferUsage, const void* data, std::size_t sizeInBytes)
+{
+    if (!data || sizeInBytes == 0)
+    {
+        ErrorLog(L"バッファのデータが空です");
+        return std::nullopt;
+    }
+
+    const auto bytes = static_cast<const std::uint8_t*>(data);
+
+    // Dx creates and releases an instance buffer every frame, so ids are recycled
+    if (!m_freeBufferIds.empty())
+    {
+        const auto id = m_freeBufferIds.back();
+        m_freeBufferIds.pop_back();
+
+        m_buffers[id - 1].assign(bytes, bytes + sizeInBytes);
+
+        return BufferHandle{ id };
+    }
+
+    m_buffers.emplace_back(bytes, bytes + sizeInBytes);
+
+    return BufferHandle{ static_cast<std::uint32_t>(m_buffers.size()) };
+}
+
+void SoftwareBackend::releaseBuffer(BufferHandle buffer)
+{
+    if (!buffer || m_buffers.size() < buffer.id || m_buffers[buffer.id - 1].empty())
+    {
+        ErrorLog(L"不正なバッファです");
+        return;
+    }
+
+    // Rasterization finishes inside frameEnd, so nothing can still be reading it
+    std::vector<std::uint8_t>().swap(m_buffers[buffer.id - 1]);
+
+    m_freeBufferIds.push_back(buffer.id);
+}
+
+std::optional<PipelineHandle> SoftwareBackend::createPipeline(const PipelineDesc& desc)
+{
+    const auto position = std::find_if(desc.inputLayout.begin(), desc.inputLayout.end(), [](const VertexElement& element)
+        {
+            return element.semanticName == "POSITION" && element.semanticIndex == 0;
+        });
+
+    if (position == desc.inputLayout.end())
+    {
+        ErrorLog(L"POSITION 要素がありません");
+        return std::nullopt;
+    }
+
+    m_pipelines.push_back({ .positionOffset = position->offset, .positionFormat = position->format });
+
+    return PipelineHandle{ static_cast<std::uint32_t>(m_pipelines.size()) };
+}
+
+void SoftwareBackend::setPipeline(PipelineHandle pipeline)
+{
+    m_currentPipeline = pipeline;
+}
+
+void SoftwareBackend::setViewport(const Viewport& viewport)
+{
+    m_viewport = viewport;
+}
+
+void SoftwareBackend::setScissor(const ScissorRect& scissor)
+{
+    m_scissor = scissor;
+}
+
+void SoftwareBackend::draw(const DrawIndexedDesc& desc)
+{
+    if (!m_inFrame || !m_currentPipeline)
+    {
+        ErrorLog(L"描画の前提条件を満たしていません");
+        return;
+    }
+
+    if (!desc.vertexBuffer.buffer || m_buffers.size() < desc.vertexBuffer.buffer.id ||
+        m_buffers[desc.vertexBuffer.buffer.id - 1].size() < static_cast<std::size_t>(desc.vertexBuffer.offset) + desc.vertexBuffer.sizeInBytes ||
+        !desc.indexBuffer.buffer || m_buffers.size() < desc.indexBuffer.buffer.id ||
+        m_buffers[desc.indexBuffer.buffer.id - 1].size() < desc.indexBuffer.offset + static_cast<std::size_t>(desc.startIndex + desc.indexCount) * IndexSize(desc.indexBuffer.format))
+    {
+        ErrorLog(L"不正なバッファです");
+        return;
+    }
+
+    const auto begin = Clock::now();
+
+    const auto& pipeline = m_pipelines[m_currentPipeline.id - 1];
+    const auto& vertexData = m_buffers[desc.vertexBuffer.buffer.id - 1];
+    const auto& indexData = m_buffers[desc.indexBuffer.buffer.id - 1];
+
+    const std::uint8_t* vertices = vertexData.data() + desc.vertexBuffer.offset;
+    const std::uint8_t* indices = indexData.data() + desc.indexBuffer.offset;
+
+    const std::uint32_t stride = desc.vertexBuffer.strideInBytes;
+    const std::uint32_t verticesCount = stride ? desc.vertexBuffer.sizeInBytes / stride : 0;
+
+    for (std::uint32_t instance = 0; instance < desc.instanceCount; ++instance)
+    {
+        for (std::uint32_t i = 0; i + 2 < desc.indexCount; i += 3)
+        {
+            std::array<std::array<float, 4>, 3> clip;
+            bool valid = true;
+
+            for (std::uint32_t corner = 0; corner < 3; ++corner)
+            {
+                const std::int64_t vertexIndex = static_cast<std::int64_t>(ReadIndex(indices, desc.indexBuffer.format, desc.startIndex + i + corner)) + desc.baseVertex;
+
+                if (vertexIndex < 0 || verticesCount <= vertexIndex)
+                {
+                    valid = false;
+                    break;
+                }
+
+                clip[corner] = ReadPosition(vertices + vertexIndex * stride + pipeline.positionOffset, pipeline.positionFormat);
+            }
+
+            if (valid)
+            {
+                setupTriangle(clip);
+            }
+        }
+    }
+
+    m_stats.rasterSeconds += SecondsSince(begin);
+}
+
+void SoftwareBackend::setupTriangle(const std::array<std::array<float, 4>, 3>& clip)
+{
+    std::array<float, 3> xs, ys;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        // No near-plane clipping; the pass-through shader never produces w <= 0.
+        if (clip[i][3] <= 0.f)
+        {
+            return;
+        }
+
+        const float invW = 1.f / clip[i][3];
+
+        xs[i] = m_viewport.x + (clip[i][0] * invW + 1.f) * 0.5f * m_viewport.width;
+        ys[i] = m_viewport.y + (1.f - clip[i][1] * invW) * 0.5f * m_viewport.height;
+    }
+
+    float area = (xs[1] - xs[0]) * (ys[2] - ys[0]) - (ys[1] - ys[0]) * (xs[2] - xs[0]);
+
+    if (area == 0.f || !std::isfinite(area))
+    {
+        return;
+    }
+
+    // CullMode is NONE, so flip clockwise triangles into a single winding.
+    if (area < 0.f)
+    {
+        std::swap(xs[1], xs[2]);
+        std::swap(ys[1], ys[2]);
+    }
+
+    Triangle triangle;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        const int j = (i + 1) % 3;
+
+        triangle.edgeA[i] = ys[i] - ys[j];
+        triangle.edgeB[i] = xs[j] - xs[i];
+        triangle.edgeC[i] = xs[i] * ys[j] - ys[i] * xs[j];
+
+        // Top-left fill rule so shared edges are drawn exactly once. Inside is
+        // positive and y points down, so a horizontal edge with B > 0 has the
+        // triangle below it.
+        const bool top = triangle.edgeA[i] == 0.f && 0.f < triangle.edgeB[i];
+        const bool left = 0.f < triangle.edgeA[i];
+        triangle.topLeft[i] = top || left;
+    }
+
+    const float minX = std::min({ xs[0], xs[1], xs[2] });
+    const float maxX = std::max({ xs[0], xs[1], xs[2] });
+    const float minY = std::min({ ys[0], ys[1], ys[2] });
+    const float maxY = std::max({ ys[0], ys[1], ys[2] });
+
+    // Nothing is clipped in clip space, so the viewport bounds the pixels as
+    // well: those whose center lies inside it, the scissor and the target
+    const int viewportMinX = static_cast<int>(std::ceil(m_viewport.x - 0.5f));
+    const int viewportMinY = static_cast<int>(std::ceil(m_viewport.y - 0.5f));
+    const int viewportMaxX = static_cast<int>(std::ceil(m_viewport.x + m_viewport.width - 0.5f)) - 1;
+    const int viewportMaxY = static_cast<int>(std::ceil(m_viewport.y + m_viewport.height - 0.5f)) - 1;
+
+    triangle.minX = std::max({ 0, m_scissor.left, viewportMinX, static_cast<int>(std::floor(minX)) });
+    triangle.minY = std::max({ 0, m_scissor.top, viewportMinY, static_cast<int>(std::floor(minY)) });
+    triangle.maxX = std::min({ m_width - 1, m_scissor.right - 1, viewportMaxX, static_cast<int>(std::ceil(maxX)) });
+    triangle.maxY = std::min({ m_height - 1, m_scissor.bottom - 1, viewportMaxY, static_cast<int>(std::ceil(maxY)) });
+
+    if (triangle.maxX < triangle.minX || triangle.maxY < triangle.minY)
+    {
+        return;
+    }
+
+    triangle.color = 0xffffffff;
+
+    const auto triangleIndex = static_cast<std::uint32_t>(m_triangles.size());
+    m_triangles.push_back(triangle);
+
+    for (int ty = triangle.minY / TileSize; ty <= triangle.maxY / TileSize; ++ty)
+    {
+        for (int tx = triangle.minX / TileSize; tx <= triangle.maxX / TileSize; ++tx)
+        {
+            m_tileBins[ty * m_tilesX + tx].push_back(triangleIndex);
+        }
+    }
+}
+
+void SoftwareBackend::rasterizeTile(std::uint32_t tileIndex)
+{
+    const int tileX = static_cast<int>(tileIndex) % m_tilesX * TileSize;
+    const int tileY = static_cast<int>(tileIndex) / m_tilesX * TileSize;
+
+    std::uint32_t* target = m_colorBuffer.data();
+
+    const int tileMaxX = std::min(tileX + TileSize, m_width) - 1;
+    const int tileMaxY = std::min(tileY + TileSize, m_height) - 1;
+
+    for (int y = tileY; y <= tileMaxY; ++y)
+    {
+        std::fill(target + y * m_width + tileX, target + y * m_width + tileMaxX + 1, m_clearColor);
+    }
+
+    std::uint64_t pixels = 0;
+
+    for (const auto triangleIndex : m_tileBins[tileIndex])
+    {
+        const Triangle& triangle = m_triangles[triangleIndex];
+
+        const int minX = std::max(triangle.minX, tileX);
+        const int maxX = std::min(triangle.maxX, tileMaxX);
+        const int minY = std::max(triangle.minY, tileY);
+        const int maxY = std::min(triangle.maxY, tileMaxY);
+
+#ifdef SOFTWARE_RASTER_SSE2
+        __m128 a[3], b[3], c[3], onEdge[3];
+
+        for (int e = 0; e < 3; ++e)
+        {
+            a[e] = _mm_set1_ps(triangle.edgeA[e]);
+            b[e] = _mm_set1_ps(triangle.edgeB[e]);
+            c[e] = _mm_set1_ps(triangle.edgeC[e]);
+            onEdge[e] = _mm_castsi128_ps(_mm_set1_epi32(triangle.topLeft[e] ? -1 : 0));
+        }
+
+        const __m128 laneOffset = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        const __m128i color = _mm_set1_epi32(static_cast<int>(triangle.color));
+
+        for (int y = minY; y <= maxY; ++y)
+        {
+            const __m128 py = _mm_set1_ps(y + 0.5f);
+            std::uint32_t* row = target + y * m_width;
+
+            for (int x = minX; x <= maxX; x += 4)
+            {
+                const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneOffset);
+
+                __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+                for (int e = 0; e < 3; ++e)
+                {
+                    const __m128 value = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[e], px), _mm_mul_ps(b[e], py)), c[e]);
+                    const __m128 pass = _mm_or_ps(_mm_cmpgt_ps(value, _mm_setzero_ps()),
+                        _mm_and_ps(_mm_cmpeq_ps(value, _mm_setzero_ps()), onEdge[e]));
+                    inside = _mm_and_ps(inside, pass);
+                }
+
+                int mask = _mm_movemask_ps(inside);
+
+                if (maxX < x + 3)
+                {
+                    mask &= (1 << (maxX - x + 1)) - 1;
+                }
+
+                if (mask == 0)
+                {
+                    continue;
+                }
+
+                pixels += PopCount4(mask);
+
+                if (mask == 0xf)
+                {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x), color);
+                }
+                else
+                {
+                    for (int lane = 0; lane < 4; ++lane)
+                    {
+                        if (mask & (1 << lane))
+                        {
+                            row[x + lane] = triangle.color;
+                        }
+                    }
+                }
+            }
+        }
+#else
+        for (int y = minY; y <= maxY; ++y)
+        {
+            const float py = y + 0.5f;
+            std::uint32_t* row = target + y * m_width;
+
+            for (int x = minX; x <= maxX; ++x)
+            {
+                const float px = x + 0.5f;
+                bool inside = true;
+
+                for (int e = 0; e < 3 && inside; ++e)
+                {
+                    const float value = triangle.edgeA[e] * px + triangle.edgeB[e] * py + triangle.edgeC[e];
+                    inside = 0.f < value || (value == 0.f && triangle.topLeft[e]);
+                }
+
+                if (inside)
+                {
+                    row[x] = triangle.color;
+                    ++pixels;
+                }
+            }
+        }
+#endif
+    }
+
+    m_tilePixels[tileIndex] = pixels;
+}
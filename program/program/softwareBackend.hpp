@@ -0,0 +1,139 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "renderBackend.hpp"
+#include "threadPool.hpp"
+
+struct SoftwareRasterStats
+{
+    std::uint64_t triangles = 0;
+
+    std::uint64_t pixels = 0;
+
+    double rasterSeconds = 0.0;
+
+    double trianglesPerSecond()const { return 0.0 < rasterSeconds ? triangles / rasterSeconds : 0.0; }
+
+    double pixelsPerSecond()const { return 0.0 < rasterSeconds ? pixels / rasterSeconds : 0.0; }
+};
+
+// Renders into an in-memory RGBA8 target without a GPU.
+// Draws are set up and binned into screen tiles as they arrive; frameEnd
+// rasterizes the tiles in parallel. The shader stages are treated as the
+// pass-through VS and constant white PS in shader/, since HLSL cannot run here.
+class SoftwareBackend : public RenderBackend
+{
+public:
+
+    static constexpr int TileSize = 64;
+
+    explicit SoftwareBackend(std::uint32_t threadCount = std::thread::hardware_concurrency());
+
+    bool init(const BackendDesc& desc) override;
+
+    bool frameBegin() override;
+
+    bool frameEnd() override;
+
+    bool waitIdle() override;
+
+    bool resize(int width, int height) override;
+
+    std::optional<BufferHandle> createBuffer(BufferUsage usage, const void* data, std::size_t sizeInBytes) override;
+
+    void releaseBuffer(BufferHandle buffer) override;
+
+    std::optional<PipelineHandle> createPipeline(const PipelineDesc& desc) override;
+
+    void setPipeline(PipelineHandle pipeline) override;
+
+    PipelineHandle boundPipeline()const override { return m_currentPipeline; }
+
+    void draw(const DrawIndexedDesc& desc) override;
+
+    // Applied to the draws that follow; pixels are covered when their center is inside both
+    void setViewport(const Viewport& viewport) override;
+
+    void setScissor(const ScissorRect& scissor) override;
+
+    int width()const { return m_width; }
+
+    int height()const { return m_height; }
+
+    // R, G, B, A bytes per pixel, rows from top to bottom
+    const std::uint8_t* pixels()const { return reinterpret_cast<const std::uint8_t*>(m_colorBuffer.data()); }
+
+    const SoftwareRasterStats& stats()const { return m_stats; }
+
+    void resetStats() { m_stats = {}; }
+
+private:
+
+    struct PipelineRecord
+    {
+        std::uint32_t positionOffset = 0;
+
+        VertexFormat positionFormat = VertexFormat::Float3;
+    };
+
+    struct Triangle
+    {
+        std::array<float, 3> edgeA;
+
+        std::array<float, 3> edgeB;
+
+        std::array<float, 3> edgeC;
+
+        std::array<bool, 3> topLeft;
+
+        int minX, minY, maxX, maxY;
+
+        std::uint32_t color;
+    };
+
+    void setupTriangle(const std::array<std::array<float, 4>, 3>& clip);
+
+    void rasterizeTile(std::uint32_t tileIndex);
+
+    ThreadPool m_threadPool;
+
+    int m_width = 0;
+
+    int m_height = 0;
+
+    int m_tilesX = 0;
+
+    int m_tilesY = 0;
+
+    std::vector<std::uint32_t> m_colorBuffer;
+
+    std::uint32_t m_clearColor = 0xff000000;
+
+    // Released buffers are empty until their id is handed out again
+    std::vector<std::vector<std::uint8_t>> m_buffers;
+
+    std::vector<std::uint32_t> m_freeBufferIds;
+
+    std::vector<PipelineRecord> m_pipelines;
+
+    PipelineHandle m_currentPipeline;
+
+    Viewport m_viewport;
+
+    ScissorRect m_scissor;
+
+    std::vector<Triangle> m_triangles;
+
+    std::vector<std::vector<std::uint32_t>> m_tileBins;
+
+    std::vector<std::uint64_t> m_tilePixels;
+
+    bool m_inFrame = false;
+
+    SoftwareRasterStats m_stats;
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <optional>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Each side keeps a private copy of the other side's index and only
+// reloads the shared one when the copy says the queue is full or empty, so in
+// the steady state a push or pop touches no cache line the other thread writes.
+template<typename T, std::size_t Capacity>
+class SpscQueue
+{
+    static_assert(std::has_single_bit(Capacity), "Capacity must be a power of two");
+
+public:
+
+    SpscQueue() = default;
+
+    SpscQueue(const SpscQueue&) = delete;
+
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    static constexpr std::size_t capacity() { return Capacity; }
+
+    // Producer only. False when the queue is full; nothing is written then.
+    bool push(const T& value)
+    {
+        const auto tail = m_tail.load(std::memory_order_relaxed);
+
+        if (tail - m_cachedHead == Capacity)
+        {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+
+            if (tail - m_cachedHead == Capacity)
+            {
+                return false;
+            }
+        }
+
+        m_items[tail & (Capacity - 1)] = value;
+
+        // Paired with the consumer's store to m_waiting: either it sees the new tail
+        // before sleeping or this load sees it waiting
+        m_tail.store(tail + 1, std::memory_order_seq_cst);
+
+        if (m_waiting.load(std::memory_order_seq_cst))
+        {
+            m_tail.notify_one();
+        }
+
+        return true;
+    }
+
+    // Consumer only
+    std::optional<T> pop()
+    {
+        const auto head = m_head.load(std::memory_order_relaxed);
+
+        if (head == m_cachedTail)
+        {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+
+            if (head == m_cachedTail)
+            {
+                return std::nullopt;
+            }
+        }
+
+        std::optional<T> value = m_items[head & (Capacity - 1)];
+
+        m_head.store(head + 1, std::memory_order_release);
+
+        return value;
+    }
+
+    // Consumer only. Sleeps until the queue holds something.
+    void wait()
+    {
+        m_waiting.store(true, std::memory_order_seq_cst);
+
+        m_tail.wait(m_head.load(std::memory_order_relaxed), std::memory_order_seq_cst);
+
+        m_waiting.store(false, std::memory_order_relaxed);
+    }
+
+    // Either side; only a snapshot
+    std::size_t size()const
+    {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+private:
+
+    // Written by the consumer
+    alignas(64) std::atomic<std::size_t> m_head = 0;
+
+    std::size_t m_cachedTail = 0;
+
+    std::atomic<bool> m_waiting = false;
+
+    // Written by the producer
+    alignas(64) std::atomic<std::size_t> m_tail = 0;
+
+    std::size_t m_cachedHead = 0;
+
+    alignas(64) std::array<T, Capacity> m_items = {};
+};
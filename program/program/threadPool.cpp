@@ -0,0 +1,107 @@
+#include "threadPool.hpp"
+
+ThreadPool::ThreadPool(std::uint32_t threadCount)
+{
+    const std::uint32_t workerCount = 1 < threadCount ? threadCount - 1 : 0;
+
+    for (std::uint32_t i = 0; i < workerCount; ++i)
+    {
+        m_workers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_wake.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(std::uint32_t count, const std::function<void(std::uint32_t)>& func)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    if (m_workers.empty() || count == 1)
+    {
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            func(i);
+        }
+
+        return;
+    }
+
+    {
+        std::lock_guard lock(m_mutex);
+        m_func = &func;
+        m_count = count;
+        m_next = 0;
+        m_busyWorkers = m_workers.size();
+        ++m_generation;
+    }
+
+    m_wake.notify_all();
+
+    runJobs();
+
+    std::unique_lock lock(m_mutex);
+    m_done.wait(lock, [this] { return m_busyWorkers == 0; });
+    m_func = nullptr;
+}
+
+void ThreadPool::workerLoop()
+{
+    std::uint64_t seenGeneration = 0;
+
+    for (;;)
+    {
+        {
+            std::unique_lock lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stop || m_generation != seenGeneration; });
+
+            if (m_stop)
+            {
+                return;
+            }
+
+            seenGeneration = m_generation;
+        }
+
+        runJobs();
+
+        {
+            std::lock_guard lock(m_mutex);
+
+            if (--m_busyWorkers == 0)
+            {
+                m_done.notify_one();
+            }
+        }
+    }
+}
+
+void ThreadPool::runJobs()
+{
+    for (;;)
+    {
+        const std::uint32_t i = m_next.fetch_add(1);
+
+        if (m_count <= i)
+        {
+            break;
+        }
+
+        (*m_func)(i);
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker threads for data-parallel loops.
+// The calling thread takes part in parallelFor and returns once every index ran.
+class ThreadPool
+{
+public:
+
+    explicit ThreadPool(std::uint32_t threadCount = std::thread::hardware_concurrency());
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void parallelFor(std::uint32_t count, const std::function<void(std::uint32_t)>& func);
+
+    std::uint32_t threadCount()const { return static_cast<std::uint32_t>(m_workers.size()) + 1; }
+
+private:
+
+    void workerLoop();
+
+    void runJobs();
+
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_mutex;
+
+    std::condition_variable m_wake;
+
+    std::condition_variable m_done;
+
+    const std::function<void(std::uint32_t)>* m_func = nullptr;
+
+    std::uint32_t m_count = 0;
+
+    std::atomic<std::uint32_t> m_next = 0;
+
+    std::size_t m_busyWorkers = 0;
+
+    std::uint64_t m_generation = 0;
+
+    bool m_stop = false;
+};
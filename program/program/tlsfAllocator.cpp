@@ -0,0 +1,334 @@
+#include <algorithm>
+#include <bit>
+
+#include "logger.hpp"
+#include "tlsfAllocator.hpp"
+
+namespace
+{
+    std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+TlsfAllocator::TlsfAllocator(std::uint64_t capacity)
+{
+    reset(capacity);
+}
+
+void TlsfAllocator::reset(std::uint64_t capacity)
+{
+    m_capacity = capacity - capacity % Granularity;
+
+    m_blocks.clear();
+    m_unusedBlocks.clear();
+
+    m_firstLevelBitmap = 0;
+    m_secondLevelBitmaps.fill(0);
+
+    for (auto& heads : m_freeHeads)
+    {
+        heads.fill(InvalidBlock);
+    }
+
+    m_usedBytes = 0;
+    m_allocationCount = 0;
+    m_freeBlockCount = 0;
+
+    if (0 < m_capacity)
+    {
+        const std::uint32_t block = newBlock();
+        m_blocks[block].offset = 0;
+        m_blocks[block].size = m_capacity;
+        insertFree(block);
+    }
+}
+
+std::optional<TlsfAllocation> TlsfAllocator::allocate(std::uint64_t size, std::uint64_t alignment)
+{
+    if (size == 0 || !std::has_single_bit(alignment))
+    {
+        return std::nullopt;
+    }
+
+    alignment = alignment < Granularity ? Granularity : alignment;
+
+    const std::uint64_t request = AlignUp(size, Granularity);
+
+    // Block offsets are multiples of Granularity, so this much slack always
+    // leaves room to move the start up to the requested alignment.
+    const std::uint64_t searchSize = request + (alignment - Granularity);
+
+    if (m_capacity < searchSize)
+    {
+        return std::nullopt;
+    }
+
+    std::uint32_t block = findFree(searchSize);
+
+    if (block == InvalidBlock)
+    {
+        return std::nullopt;
+    }
+
+    removeFree(block);
+
+    const std::uint64_t padding = AlignUp(m_blocks[block].offset, alignment) - m_blocks[block].offset;
+
+    if (0 < padding)
+    {
+        const std::uint32_t front = block;
+        block = split(front, padding);
+        insertFree(front);
+    }
+
+    if (Granularity <= m_blocks[block].size - request)
+    {
+        const std::uint32_t tail = split(block, request);
+        insertFree(tail);
+    }
+
+    m_blocks[block].free = false;
+
+    m_usedBytes += m_blocks[block].size;
+    ++m_allocationCount;
+
+    return TlsfAllocation{ .offset = m_blocks[block].offset, .size = m_blocks[block].size, .block = block };
+}
+
+void TlsfAllocator::free(const TlsfAllocation& allocation)
+{
+    if (!owns(allocation))
+    {
+        ErrorLog(L"確保されていない領域の解放です");
+        return;
+    }
+
+    std::uint32_t block = allocation.block;
+
+    m_usedBytes -= m_blocks[block].size;
+    --m_allocationCount;
+
+    const std::uint32_t prev = m_blocks[block].prevPhysical;
+
+    if (prev != InvalidBlock && m_blocks[prev].free)
+    {
+        removeFree(prev);
+
+        m_blocks[prev].size += m_blocks[block].size;
+        m_blocks[prev].nextPhysical = m_blocks[block].nextPhysical;
+
+        if (m_blocks[block].nextPhysical != InvalidBlock)
+        {
+            m_blocks[m_blocks[block].nextPhysical].prevPhysical = prev;
+        }
+
+        m_blocks[block].size = 0;
+        m_unusedBlocks.push_back(block);
+        block = prev;
+    }
+
+    const std::uint32_t next = m_blocks[block].nextPhysical;
+
+    if (next != InvalidBlock && m_blocks[next].free)
+    {
+        removeFree(next);
+
+        m_blocks[block].size += m_blocks[next].size;
+        m_blocks[block].nextPhysical = m_blocks[next].nextPhysical;
+
+        if (m_blocks[next].nextPhysical != InvalidBlock)
+        {
+            m_blocks[m_blocks[next].nextPhysical].prevPhysical = block;
+        }
+
+        m_blocks[next].size = 0;
+        m_unusedBlocks.push_back(next);
+    }
+
+    insertFree(block);
+}
+
+bool TlsfAllocator::owns(const TlsfAllocation& allocation)const
+{
+    // Merged-away blocks have size 0, so a stale handle never matches one
+    return allocation.block < m_blocks.size() &&
+        !m_blocks[allocation.block].free &&
+        m_blocks[allocation.block].size != 0 &&
+        m_blocks[allocation.block].offset == allocation.offset &&
+        m_blocks[allocation.block].size == allocation.size;
+}
+
+TlsfStats TlsfAllocator::stats()const
+{
+    TlsfStats stats =
+    {
+        .capacity = m_capacity,
+        .usedBytes = m_usedBytes,
+        .freeBytes = m_capacity - m_usedBytes,
+        .allocationCount = m_allocationCount,
+        .freeBlockCount = m_freeBlockCount,
+    };
+
+    if (m_firstLevelBitmap != 0)
+    {
+        const std::uint32_t fl = 63 - std::countl_zero(m_firstLevelBitmap);
+        const std::uint32_t sl = 31 - std::countl_zero(m_secondLevelBitmaps[fl]);
+
+        for (std::uint32_t block = m_freeHeads[fl][sl]; block != InvalidBlock; block = m_blocks[block].nextFree)
+        {
+            stats.largestFreeBlock = std::max(stats.largestFreeBlock, m_blocks[block].size);
+        }
+    }
+
+    return stats;
+}
+
+void TlsfAllocator::mapping(std::uint64_t size, std::uint32_t& fl, std::uint32_t& sl)
+{
+    if (size < SecondLevelCount)
+    {
+        fl = 0;
+        sl = static_cast<std::uint32_t>(size);
+        return;
+    }
+
+    const std::uint32_t log2 = 63 - std::countl_zero(size);
+
+    fl = log2 - SecondLevelBits + 1;
+    sl = static_cast<std::uint32_t>(size >> (log2 - SecondLevelBits)) ^ SecondLevelCount;
+}
+
+std::uint32_t TlsfAllocator::newBlock()
+{
+    if (!m_unusedBlocks.empty())
+    {
+        const std::uint32_t block = m_unusedBlocks.back();
+        m_unusedBlocks.pop_back();
+        m_blocks[block] = {};
+        return block;
+    }
+
+    m_blocks.emplace_back();
+
+    return static_cast<std::uint32_t>(m_blocks.size() - 1);
+}
+
+void TlsfAllocator::insertFree(std::uint32_t block)
+{
+    std::uint32_t fl, sl;
+    mapping(m_blocks[block].size, fl, sl);
+
+    const std::uint32_t head = m_freeHeads[fl][sl];
+
+    m_blocks[block].free = true;
+    m_blocks[block].prevFree = InvalidBlock;
+    m_blocks[block].nextFree = head;
+
+    if (head != InvalidBlock)
+    {
+        m_blocks[head].prevFree = block;
+    }
+
+    m_freeHeads[fl][sl] = block;
+
+    m_firstLevelBitmap |= 1ull << fl;
+    m_secondLevelBitmaps[fl] |= 1u << sl;
+
+    ++m_freeBlockCount;
+}
+
+void TlsfAllocator::removeFree(std::uint32_t block)
+{
+    std::uint32_t fl, sl;
+    mapping(m_blocks[block].size, fl, sl);
+
+    const std::uint32_t prev = m_blocks[block].prevFree;
+    const std::uint32_t next = m_blocks[block].nextFree;
+
+    if (prev != InvalidBlock)
+    {
+        m_blocks[prev].nextFree = next;
+    }
+    else
+    {
+        m_freeHeads[fl][sl] = next;
+
+        if (next == InvalidBlock)
+        {
+            m_secondLevelBitmaps[fl] &= ~(1u << sl);
+
+            if (m_secondLevelBitmaps[fl] == 0)
+            {
+                m_firstLevelBitmap &= ~(1ull << fl);
+            }
+        }
+    }
+
+    if (next != InvalidBlock)
+    {
+        m_blocks[next].prevFree = prev;
+    }
+
+    m_blocks[block].free = false;
+
+    --m_freeBlockCount;
+}
+
+std::uint32_t TlsfAllocator::findFree(std::uint64_t size)const
+{
+    // Round up to the next list boundary so any block found is large enough
+    if (SecondLevelCount <= size)
+    {
+        const std::uint32_t log2 = 63 - std::countl_zero(size);
+        size += (1ull << (log2 - SecondLevelBits)) - 1;
+    }
+
+    std::uint32_t fl, sl;
+    mapping(size, fl, sl);
+
+    if (FirstLevelCount <= fl)
+    {
+        return InvalidBlock;
+    }
+
+    std::uint32_t secondLevelMap = m_secondLevelBitmaps[fl] & (~0u << sl);
+
+    if (secondLevelMap == 0)
+    {
+        const std::uint64_t firstLevelMap = fl + 1 < 64 ? m_firstLevelBitmap & (~0ull << (fl + 1)) : 0;
+
+        if (firstLevelMap == 0)
+        {
+            return InvalidBlock;
+        }
+
+        fl = std::countr_zero(firstLevelMap);
+        secondLevelMap = m_secondLevelBitmaps[fl];
+    }
+
+    sl = std::countr_zero(secondLevelMap);
+
+    return m_freeHeads[fl][sl];
+}
+
+std::uint32_t TlsfAllocator::split(std::uint32_t block, std::uint64_t size)
+{
+    const std::uint32_t rest = newBlock();
+
+    m_blocks[rest].offset = m_blocks[block].offset + size;
+    m_blocks[rest].size = m_blocks[block].size - size;
+    m_blocks[rest].prevPhysical = block;
+    m_blocks[rest].nextPhysical = m_blocks[block].nextPhysical;
+
+    if (m_blocks[block].nextPhysical != InvalidBlock)
+    {
+        m_blocks[m_blocks[block].nextPhysical].prevPhysical = rest;
+    }
+
+    m_blocks[block].size = size;
+    m_blocks[block].nextPhysical = rest;
+
+    return rest;
+}
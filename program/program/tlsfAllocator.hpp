@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+struct TlsfAllocation
+{
+    std::uint64_t offset = 0;
+
+    std::uint64_t size = 0;
+
+    std::uint32_t block = 0;
+};
+
+struct TlsfStats
+{
+    std::uint64_t capacity = 0;
+
+    std::uint64_t usedBytes = 0;
+
+    std::uint64_t freeBytes = 0;
+
+    std::uint64_t largestFreeBlock = 0;
+
+    std::uint32_t allocationCount = 0;
+
+    std::uint32_t freeBlockCount = 0;
+
+    // 0 when all free space is one block, approaching 1 as it splinters
+    double fragmentation()const { return freeBytes == 0 ? 0.0 : 1.0 - static_cast<double>(largestFreeBlock) / freeBytes; }
+};
+
+// Two-level segregated fit allocator over an abstract address range.
+// It only hands out offsets, so the same code packs GPU heaps and can be
+// exercised without any graphics API.
+class TlsfAllocator
+{
+public:
+
+    static constexpr std::uint64_t Granularity = 16;
+
+    explicit TlsfAllocator(std::uint64_t capacity = 0);
+
+    void reset(std::uint64_t capacity);
+
+    std::optional<TlsfAllocation> allocate(std::uint64_t size, std::uint64_t alignment = Granularity);
+
+    // Allocations this allocator does not hold, freed twice or from another
+    // allocator, are logged and ignored
+    void free(const TlsfAllocation& allocation);
+
+    bool owns(const TlsfAllocation& allocation)const;
+
+    TlsfStats stats()const;
+
+    std::uint64_t capacity()const { return m_capacity; }
+
+    bool empty()const { return m_allocationCount == 0; }
+
+private:
+
+    static constexpr std::uint32_t SecondLevelBits = 4;
+
+    static constexpr std::uint32_t SecondLevelCount = 1u << SecondLevelBits;
+
+    static constexpr std::uint32_t FirstLevelCount = 64 - SecondLevelBits;
+
+    static constexpr std::uint32_t InvalidBlock = 0xffffffff;
+
+    struct Block
+    {
+        std::uint64_t offset = 0;
+
+        std::uint64_t size = 0;
+
+        std::uint32_t prevPhysical = InvalidBlock;
+
+        std::uint32_t nextPhysical = InvalidBlock;
+
+        std::uint32_t prevFree = InvalidBlock;
+
+        std::uint32_t nextFree = InvalidBlock;
+
+        bool free = false;
+    };
+
+    static void mapping(std::uint64_t size, std::uint32_t& fl, std::uint32_t& sl);
+
+    std::uint32_t newBlock();
+
+    void insertFree(std::uint32_t block);
+
+    void removeFree(std::uint32_t block);
+
+    std::uint32_t findFree(std::uint64_t size)const;
+
+    std::uint32_t split(std::uint32_t block, std::uint64_t size);
+
+    std::uint64_t m_capacity = 0;
+
+    std::vector<Block> m_blocks;
+
+    std::vector<std::uint32_t> m_unusedBlocks;
+
+    std::uint64_t m_firstLevelBitmap = 0;
+
+    std::array<std::uint32_t, FirstLevelCount> m_secondLevelBitmaps = {};
+
+    std::array<std::array<std::uint32_t, SecondLevelCount>, FirstLevelCount> m_freeHeads;
+
+    std::uint64_t m_usedBytes = 0;
+
+    std::uint32_t m_allocationCount = 0;
+
+    std::uint32_t m_freeBlockCount = 0;
+};
@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <new>
+
+#include "logger.hpp"
+#include "transientAllocator.hpp"
+
+std::optional<TransientPage> HostTransientPageSource::createPage(std::uint64_t size)
+{
+    auto memory = static_cast<std::byte*>(::operator new(size, std::align_val_t{ ConstantBufferAlignment }, std::nothrow));
+
+    if (!memory)
+    {
+        return std::nullopt;
+    }
+
+    return TransientPage{ .cpuAddress = memory, .gpuAddress = reinterpret_cast<std::uint64_t>(memory), .size = size };
+}
+
+void HostTransientPageSource::releasePage(const TransientPage& page)
+{
+    ::operator delete(page.cpuAddress, std::align_val_t{ ConstantBufferAlignment });
+}
+
+TransientAllocator::~TransientAllocator()
+{
+    release();
+}
+
+bool TransientAllocator::init(TransientPageSource* source, std::uint64_t pageSize)
+{
+    release();
+
+    m_source = source;
+
+    m_frameBytes = 0;
+    m_lastFrameBytes = 0;
+    m_peakFrameBytes = 0;
+    m_grows = 0;
+
+    if (!m_source || !grow(pageSize))
+    {
+        ErrorLog(L"一時バッファの初期化に失敗しました");
+        return false;
+    }
+
+    // The first page is not growth
+    m_grows = 0;
+
+    return true;
+}
+
+std::optional<TransientAllocation> TransientAllocator::allocate(std::uint64_t size, std::uint64_t alignment)
+{
+    if (m_pages.empty() || size == 0 || !std::has_single_bit(alignment))
+    {
+        return std::nullopt;
+    }
+
+    auto offset = m_pages.back().ring.allocate(size, alignment);
+
+    if (!offset)
+    {
+        // Either the GPU is behind or a frame needs more than the page holds
+        if (!grow(size + alignment))
+        {
+            ErrorLog(L"一時バッファの拡張に失敗しました");
+            return std::nullopt;
+        }
+
+        offset = m_pages.back().ring.allocate(size, alignment);
+
+        if (!offset)
+        {
+            return std::nullopt;
+        }
+    }
+
+    m_frameBytes += size;
+
+    const auto& page = m_pages.back().memory;
+
+    return TransientAllocation
+    {
+        .cpuAddress = page.cpuAddress + offset.value(),
+        .gpuAddress = page.gpuAddress + offset.value(),
+        .sizeInBytes = size,
+    };
+}
+
+std::optional<TransientAllocation> TransientAllocator::write(std::span<const std::byte> data, std::uint64_t alignment)
+{
+    const auto allocation = allocate(data.size(), alignment);
+
+    if (allocation)
+    {
+        std::memcpy(allocation->cpuAddress, data.data(), data.size());
+    }
+
+    return allocation;
+}
+
+void TransientAllocator::endFrame(std::uint64_t fenceValue)
+{
+    // A page replaced during the frame still holds part of it
+    for (auto& page : m_pages)
+    {
+        page.ring.close(fenceValue);
+    }
+
+    m_lastFrameBytes = m_frameBytes;
+    m_peakFrameBytes = std::max(m_peakFrameBytes, m_frameBytes);
+    m_frameBytes = 0;
+}
+
+void TransientAllocator::reclaim(std::uint64_t completedValue)
+{
+    for (auto& page : m_pages)
+    {
+        page.ring.reclaim(completedValue);
+    }
+
+    // Drained pages other than the current one are not needed again
+    for (std::size_t i = 0; i + 1 < m_pages.size();)
+    {
+        if (m_pages[i].ring.usedBytes() != 0)
+        {
+            ++i;
+            continue;
+        }
+
+        m_source->releasePage(m_pages[i].memory);
+
+        m_pages.erase(m_pages.begin() + i);
+    }
+}
+
+void TransientAllocator::release()
+{
+    for (const auto& page : m_pages)
+    {
+        m_source->releasePage(page.memory);
+    }
+
+    m_pages.clear();
+}
+
+TransientAllocatorStats TransientAllocator::stats()const
+{
+    TransientAllocatorStats stats =
+    {
+        .lastFrameBytes = m_lastFrameBytes,
+        .peakFrameBytes = m_peakFrameBytes,
+        .pages = static_cast<std::uint32_t>(m_pages.size()),
+        .grows = m_grows,
+    };
+
+    for (const auto& page : m_pages)
+    {
+        stats.capacity += page.ring.capacity();
+        stats.usedBytes += page.ring.usedBytes();
+    }
+
+    return stats;
+}
+
+bool TransientAllocator::grow(std::uint64_t minimumSize)
+{
+    const std::uint64_t current = m_pages.empty() ? 0 : m_pages.back().ring.capacity();
+
+    const auto size = std::bit_ceil(std::max({ current * 2, minimumSize, ConstantBufferAlignment }));
+
+    const auto memory = m_source->createPage(size);
+
+    if (!memory)
+    {
+        return false;
+    }
+
+    if (!m_pages.empty())
+    {
+        DebugLog(L"一時バッファを " + std::to_wstring(size / 1024) + L" KB に拡張しました");
+    }
+
+    m_pages.push_back({ .memory = memory.value(), .ring = UploadRing(size) });
+
+    ++m_grows;
+
+    return true;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "renderBackend.hpp"
+#include "uploadManager.hpp"
+
+// A persistently mapped block of memory the GPU can read
+struct TransientPage
+{
+    std::byte* cpuAddress = nullptr;
+
+    std::uint64_t gpuAddress = 0;
+
+    std::uint64_t size = 0;
+
+    // Whatever the source needs to release the page
+    void* native = nullptr;
+};
+
+class TransientPageSource
+{
+public:
+
+    virtual ~TransientPageSource() = default;
+
+    virtual std::optional<TransientPage> createPage(std::uint64_t size) = 0;
+
+    // Only called once the GPU is done with the page
+    virtual void releasePage(const TransientPage& page) = 0;
+};
+
+// Pages in ordinary memory, for backends without a GPU; the GPU address is the CPU one
+class HostTransientPageSource : public TransientPageSource
+{
+public:
+
+    std::optional<TransientPage> createPage(std::uint64_t size) override;
+
+    void releasePage(const TransientPage& page) override;
+};
+
+struct TransientAllocatorStats
+{
+    std::uint64_t capacity = 0;
+
+    // Allocated and not yet reclaimed, across all frames in flight
+    std::uint64_t usedBytes = 0;
+
+    std::uint64_t lastFrameBytes = 0;
+
+    std::uint64_t peakFrameBytes = 0;
+
+    std::uint32_t pages = 0;
+
+    std::uint64_t grows = 0;
+};
+
+// Linear allocator for data written once per frame, such as per-draw constants.
+// Allocations are bumped out of a ring over a mapped page and given back in bulk
+// when the fence value of their frame completes. If the GPU lags so far that the
+// ring is full, a page twice the size takes over; the old page keeps serving the
+// frames already in it and is released once they complete. Not thread-safe.
+class TransientAllocator
+{
+public:
+
+    static constexpr std::uint64_t DefaultPageSize = 4ull * 1024 * 1024;
+
+    TransientAllocator() = default;
+
+    ~TransientAllocator();
+
+    TransientAllocator(const TransientAllocator&) = delete;
+
+    TransientAllocator& operator=(const TransientAllocator&) = delete;
+
+    bool init(TransientPageSource* source, std::uint64_t pageSize = DefaultPageSize);
+
+    std::optional<TransientAllocation> allocate(std::uint64_t size, std::uint64_t alignment = ConstantBufferAlignment);
+
+    // Allocates and copies data in
+    std::optional<TransientAllocation> write(std::span<const std::byte> data, std::uint64_t alignment = ConstantBufferAlignment);
+
+    // Closes the current frame with the fence value that marks its completion
+    void endFrame(std::uint64_t fenceValue);
+
+    void reclaim(std::uint64_t completedValue);
+
+    // Gives every page back; the GPU must be idle
+    void release();
+
+    TransientAllocatorStats stats()const;
+
+private:
+
+    struct Page
+    {
+        TransientPage memory;
+
+        UploadRing ring;
+    };
+
+    bool grow(std::uint64_t minimumSize);
+
+    TransientPageSource* m_source = nullptr;
+
+    // The last page is the one allocations come from; earlier ones only drain
+    std::vector<Page> m_pages;
+
+    std::uint64_t m_frameBytes = 0;
+
+    std::uint64_t m_lastFrameBytes = 0;
+
+    std::uint64_t m_peakFrameBytes = 0;
+
+    std::uint64_t m_grows = 0;
+};
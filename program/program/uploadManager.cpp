@@ -0,0 +1,239 @@
+#include <algorithm>
+#include <cstring>
+
+#include "uploadManager.hpp"
+
+namespace
+{
+    constexpr std::uint64_t CopyAlignment = 16;
+
+    std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+UploadRing::UploadRing(std::uint64_t capacity)
+{
+    reset(capacity);
+}
+
+void UploadRing::reset(std::uint64_t capacity)
+{
+    m_capacity = capacity;
+    m_head = 0;
+    m_tail = 0;
+    m_used = 0;
+    m_openBytes = 0;
+    m_submissions.clear();
+}
+
+std::optional<std::uint64_t> UploadRing::allocate(std::uint64_t size, std::uint64_t alignment)
+{
+    if (m_used == 0)
+    {
+        m_head = 0;
+        m_tail = 0;
+    }
+
+    const std::uint64_t aligned = AlignUp(m_head, alignment);
+
+    std::optional<std::uint64_t> offset;
+    std::uint64_t consumed = 0;
+
+    if (m_used == 0 || m_tail < m_head)
+    {
+        if (aligned + size <= m_capacity)
+        {
+            offset = aligned;
+            consumed = aligned + size - m_head;
+        }
+        else if (size <= m_tail)
+        {
+            // Skip the end of the ring and continue from the start
+            offset = 0;
+            consumed = m_capacity - m_head + size;
+        }
+    }
+    else if (m_head < m_tail && aligned + size <= m_tail)
+    {
+        offset = aligned;
+        consumed = aligned + size - m_head;
+    }
+
+    if (!offset)
+    {
+        return std::nullopt;
+    }
+
+    m_head = offset.value() + size;
+    m_used += consumed;
+    m_openBytes += consumed;
+
+    return offset;
+}
+
+void UploadRing::close(std::uint64_t fenceValue)
+{
+    if (m_openBytes == 0)
+    {
+        return;
+    }
+
+    m_submissions.push_back({ .fenceValue = fenceValue, .head = m_head, .bytes = m_openBytes });
+    m_openBytes = 0;
+}
+
+void UploadRing::reclaim(std::uint64_t completedValue)
+{
+    while (!m_submissions.empty() && m_submissions.front().fenceValue <= completedValue)
+    {
+        m_tail = m_submissions.front().head;
+        m_used -= m_submissions.front().bytes;
+        m_submissions.pop_front();
+    }
+}
+
+bool UploadManager::init(CopyQueue* queue, std::uint8_t* stagingMemory, std::uint64_t stagingCapacity)
+{
+    if (!queue || !stagingMemory || stagingCapacity < CopyAlignment * 2)
+    {
+        return false;
+    }
+
+    m_queue = queue;
+    m_stagingMemory = stagingMemory;
+    m_ring.reset(stagingCapacity);
+    m_batch.clear();
+    m_submittedValue = m_queue->completedValue();
+    m_stats = {};
+
+    return true;
+}
+
+std::optional<UploadManager::Ticket> UploadManager::enqueue(const void* data, std::uint64_t size, std::uint32_t destination, std::uint64_t destinationOffset)
+{
+    const auto bytes = static_cast<const std::uint8_t*>(data);
+
+    // Uploads larger than half the ring are split so that one chunk can be in
+    // flight while the next is written.
+    const std::uint64_t maxChunk = m_ring.capacity() / 2 & ~(CopyAlignment - 1);
+
+    for (std::uint64_t done = 0; done < size;)
+    {
+        const std::uint64_t chunk = std::min(size - done, maxChunk);
+
+        const auto stagingOffset = allocateStaging(chunk);
+        if (!stagingOffset)
+        {
+            return std::nullopt;
+        }
+
+        std::memcpy(m_stagingMemory + stagingOffset.value(), bytes + done, chunk);
+
+        m_batch.push_back(
+            {
+                .stagingOffset = stagingOffset.value(),
+                .destination = destination,
+                .destinationOffset = destinationOffset + done,
+                .size = chunk,
+            });
+
+        done += chunk;
+
+        m_stats.bytesUploaded += chunk;
+        ++m_stats.copies;
+    }
+
+    return m_submittedValue + 1;
+}
+
+bool UploadManager::flush()
+{
+    if (m_batch.empty())
+    {
+        return true;
+    }
+
+    if (!m_queue->submitCopies(m_batch))
+    {
+        return false;
+    }
+
+    const std::uint64_t value = m_submittedValue + 1;
+
+    if (!m_queue->signal(value))
+    {
+        return false;
+    }
+
+    m_submittedValue = value;
+    m_ring.close(value);
+    m_batch.clear();
+
+    ++m_stats.batches;
+
+    return true;
+}
+
+void UploadManager::reclaim()
+{
+    m_ring.reclaim(m_queue->completedValue());
+}
+
+bool UploadManager::isComplete(Ticket ticket)
+{
+    return ticket <= m_queue->completedValue();
+}
+
+bool UploadManager::wait(Ticket ticket)
+{
+    if (m_submittedValue < ticket && !flush())
+    {
+        return false;
+    }
+
+    if (isComplete(ticket))
+    {
+        return true;
+    }
+
+    ++m_stats.stalls;
+
+    return m_queue->wait(ticket);
+}
+
+std::optional<std::uint64_t> UploadManager::allocateStaging(std::uint64_t size)
+{
+    reclaim();
+
+    if (auto offset = m_ring.allocate(size, CopyAlignment))
+    {
+        return offset;
+    }
+
+    // The ring is full: submit what is pending and wait for the oldest batch.
+    if (!flush())
+    {
+        return std::nullopt;
+    }
+
+    while (m_ring.hasPendingSubmissions())
+    {
+        ++m_stats.stalls;
+
+        if (!m_queue->wait(m_ring.oldestFenceValue()))
+        {
+            return std::nullopt;
+        }
+
+        reclaim();
+
+        if (auto offset = m_ring.allocate(size, CopyAlignment))
+        {
+            return offset;
+        }
+    }
+
+    return m_ring.allocate(size, CopyAlignment);
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <vector>
+
+#include "frameScheduler.hpp"
+
+// Linear ring over a staging buffer. Space is handed out in submission order
+// and given back when the fence value it was closed with completes.
+class UploadRing
+{
+public:
+
+    explicit UploadRing(std::uint64_t capacity = 0);
+
+    void reset(std::uint64_t capacity);
+
+    std::optional<std::uint64_t> allocate(std::uint64_t size, std::uint64_t alignment);
+
+    void close(std::uint64_t fenceValue);
+
+    void reclaim(std::uint64_t completedValue);
+
+    std::uint64_t capacity()const { return m_capacity; }
+
+    std::uint64_t usedBytes()const { return m_used; }
+
+    bool hasPendingSubmissions()const { return !m_submissions.empty(); }
+
+    std::uint64_t oldestFenceValue()const { return m_submissions.empty() ? 0 : m_submissions.front().fenceValue; }
+
+private:
+
+    struct Submission
+    {
+        std::uint64_t fenceValue = 0;
+
+        std::uint64_t head = 0;
+
+        std::uint64_t bytes = 0;
+    };
+
+    std::uint64_t m_capacity = 0;
+
+    std::uint64_t m_head = 0;
+
+    std::uint64_t m_tail = 0;
+
+    std::uint64_t m_used = 0;
+
+    std::uint64_t m_openBytes = 0;
+
+    std::deque<Submission> m_submissions;
+};
+
+struct CopyRegion
+{
+    std::uint64_t stagingOffset = 0;
+
+    // Backend-defined id of the destination resource
+    std::uint32_t destination = 0;
+
+    std::uint64_t destinationOffset = 0;
+
+    std::uint64_t size = 0;
+};
+
+class CopyQueue : public GpuTimeline
+{
+public:
+
+    virtual bool submitCopies(const std::vector<CopyRegion>& regions) = 0;
+};
+
+struct UploadStats
+{
+    std::uint64_t bytesUploaded = 0;
+
+    std::uint64_t copies = 0;
+
+    std::uint64_t batches = 0;
+
+    std::uint64_t stalls = 0;
+};
+
+// Writes data into a persistently mapped staging ring and batches the copies
+// into as few copy-queue submissions as possible. A ticket is the fence value
+// of the batch that finishes an upload.
+class UploadManager
+{
+public:
+
+    using Ticket = std::uint64_t;
+
+    UploadManager() = default;
+
+    bool init(CopyQueue* queue, std::uint8_t* stagingMemory, std::uint64_t stagingCapacity);
+
+    std::optional<Ticket> enqueue(const void* data, std::uint64_t size, std::uint32_t destination, std::uint64_t destinationOffset);
+
+    bool flush();
+
+    void reclaim();
+
+    bool isComplete(Ticket ticket);
+
+    bool wait(Ticket ticket);
+
+    std::uint64_t submittedValue()const { return m_submittedValue; }
+
+    const UploadStats& stats()const { return m_stats; }
+
+private:
+
+    std::optional<std::uint64_t> allocateStaging(std::uint64_t size);
+
+    CopyQueue* m_queue = nullptr;
+
+    std::uint8_t* m_stagingMemory = nullptr;
+
+    UploadRing m_ring;
+
+    std::vector<CopyRegion> m_batch;
+
+    std::uint64_t m_submittedValue = 0;
+
+    UploadStats m_stats;
+};
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "renderBackend.hpp"
+#include "vertexQuantization.hpp"
+
+struct VertexAttribute
+{
+    std::string_view semanticName;
+
+    std::uint32_t semanticIndex = 0;
+
+    VertexFormat format = VertexFormat::Float3;
+
+    std::uint32_t offset = 0;
+};
+
+// Specialize with a constexpr array named attributes to describe a vertex type:
+//
+// template<>
+// struct VertexLayout<MyVertex>
+// {
+//     static constexpr std::array attributes = { VertexAttribute{ "POSITION", 0, VertexFormat::Float3, offsetof(MyVertex, position) } };
+// };
+template<typename VertexType>
+struct VertexLayout;
+
+template<typename VertexType>
+concept HasVertexLayout = requires { VertexLayout<VertexType>::attributes; };
+
+template<typename VertexType>
+constexpr bool ValidateVertexLayout()
+{
+    constexpr auto& attributes = VertexLayout<VertexType>::attributes;
+
+    for (std::size_t i = 0; i < attributes.size(); ++i)
+    {
+        const auto& a = attributes[i];
+        const std::uint32_t end = a.offset + VertexFormatSize(a.format);
+
+        // D3D12 requires input element offsets to be 4-byte aligned
+        if (a.offset % 4 != 0 || sizeof(VertexType) < end)
+        {
+            return false;
+        }
+
+        for (std::size_t j = i + 1; j < attributes.size(); ++j)
+        {
+            const auto& b = attributes[j];
+
+            if (a.offset < b.offset + VertexFormatSize(b.format) && b.offset < end)
+            {
+                return false;
+            }
+
+            if (a.semanticName == b.semanticName && a.semanticIndex == b.semanticIndex)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+template<typename VertexType>
+constexpr bool VertexLayoutHas(std::string_view semanticName)
+{
+    for (const auto& a : VertexLayout<VertexType>::attributes)
+    {
+        if (a.semanticName == semanticName)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Identifies the layout at compile time; 0 means no layout was declared
+template<typename VertexType>
+constexpr std::uint64_t VertexLayoutId()
+{
+    if constexpr (HasVertexLayout<VertexType>)
+    {
+        std::uint64_t hash = 14695981039346656037ull;
+
+        const auto mix = [&hash](std::uint64_t value)
+        {
+            hash ^= value;
+            hash *= 1099511628211ull;
+        };
+
+        mix(sizeof(VertexType));
+
+        for (const auto& a : VertexLayout<VertexType>::attributes)
+        {
+            for (const char c : a.semanticName)
+            {
+                mix(static_cast<std::uint8_t>(c));
+            }
+
+            mix(a.semanticIndex);
+            mix(static_cast<std::uint64_t>(a.format));
+            mix(a.offset);
+        }
+
+        return hash == 0 ? 1 : hash;
+    }
+    else
+    {
+        return 0;
+    }
+}
+
+template<typename VertexType>
+std::vector<VertexElement> MakeInputLayout()
+{
+    static_assert(ValidateVertexLayout<VertexType>(), "VertexLayout has overlapping, misaligned or out of range attributes");
+
+    std::vector<VertexElement> elements;
+
+    for (const auto& a : VertexLayout<VertexType>::attributes)
+    {
+        elements.push_back({ .semanticName = std::string(a.semanticName), .semanticIndex = a.semanticIndex, .format = a.format, .offset = a.offset });
+    }
+
+    return elements;
+}
+
+// Vertex attributes from slot 0, then InstanceType's attributes per instance from slot 1
+template<typename VertexType, typename InstanceType>
+std::vector<VertexElement> MakeInputLayout()
+{
+    static_assert(ValidateVertexLayout<InstanceType>(), "VertexLayout has overlapping, misaligned or out of range attributes");
+
+    auto elements = MakeInputLayout<VertexType>();
+
+    for (const auto& a : VertexLayout<InstanceType>::attributes)
+    {
+        elements.push_back(
+            {
+                .semanticName = std::string(a.semanticName), .semanticIndex = a.semanticIndex, .format = a.format, .offset = a.offset,
+                .inputSlot = 1, .inputRate = InputRate::PerInstance,
+            });
+    }
+
+    return elements;
+}
+
+// Half-float position, octahedral SNORM16 normal and UNORM16 uv: 16 bytes instead of 32
+template<>
+struct VertexLayout<PackedVertex>
+{
+    static constexpr std::array attributes =
+    {
+        VertexAttribute{ "POSITION", 0, VertexFormat::Half4, offsetof(PackedVertex, position) },
+        VertexAttribute{ "NORMAL", 0, VertexFormat::Snorm16x2, offsetof(PackedVertex, normal) },
+        VertexAttribute{ "TEXCOORD", 0, VertexFormat::Unorm16x2, offsetof(PackedVertex, uv) },
+    };
+};
@@ -0,0 +1,305 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VERTEX_QUANTIZATION_SSE2
+#endif
+
+#include "vertexQuantization.hpp"
+
+namespace
+{
+    float Saturate(float value)
+    {
+        // NaN becomes 0, like _mm_max_ps(value, 0)
+        return 0.f < value ? (value < 1.f ? value : 1.f) : 0.f;
+    }
+
+    float ClampSnorm(float value)
+    {
+        // NaN becomes -1, like _mm_max_ps(value, -1)
+        return -1.f < value ? (value < 1.f ? value : 1.f) : -1.f;
+    }
+
+    void EncodeOctahedral(float x, float y, float z, std::int16_t* dst)
+    {
+        // A NaN sum becomes the floor, like _mm_max_ps(sum, 1e-20f)
+        const float sum = std::fabs(x) + std::fabs(y) + std::fabs(z);
+        const float l1 = 1e-20f < sum ? sum : 1e-20f;
+
+        float px = x / l1;
+        float py = y / l1;
+
+        if (z < 0.f)
+        {
+            const float wx = (1.f - std::fabs(py)) * std::copysign(1.f, px);
+            const float wy = (1.f - std::fabs(px)) * std::copysign(1.f, py);
+            px = wx;
+            py = wy;
+        }
+
+        dst[0] = static_cast<std::int16_t>(std::lrint(ClampSnorm(px) * 32767.f));
+        dst[1] = static_cast<std::int16_t>(std::lrint(ClampSnorm(py) * 32767.f));
+    }
+
+#ifdef VERTEX_QUANTIZATION_SSE2
+    __m128i PackLow16(__m128i value)
+    {
+        // Sign-extend the low halves so the saturating pack keeps their bits
+        const __m128i extended = _mm_srai_epi32(_mm_slli_epi32(value, 16), 16);
+        return _mm_packs_epi32(extended, extended);
+    }
+
+    __m128i Select(__m128i mask, __m128i a, __m128i b)
+    {
+        return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+    }
+
+    __m128 Select(__m128 mask, __m128 a, __m128 b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+#endif
+}
+
+std::uint16_t FloatToHalf(float value)
+{
+    std::uint32_t f;
+    std::memcpy(&f, &value, sizeof(f));
+
+    const std::uint32_t sign = f & 0x80000000u;
+    f ^= sign;
+
+    std::uint16_t half;
+
+    if (0x47800000u <= f)
+    {
+        // Too large for half: infinity, or a quiet NaN
+        half = 0x7f800000u < f ? 0x7e00 : 0x7c00;
+    }
+    else if (f < 0x38800000u)
+    {
+        // Denormal or zero: let the FPU round by adding 0.5f
+        float magic;
+        std::memcpy(&magic, &f, sizeof(magic));
+        magic += 0.5f;
+
+        std::uint32_t u;
+        std::memcpy(&u, &magic, sizeof(u));
+        half = static_cast<std::uint16_t>(u - 0x3f000000u);
+    }
+    else
+    {
+        // Rebias the exponent and round the mantissa to nearest even
+        const std::uint32_t mantissaOdd = (f >> 13) & 1;
+        f += 0xc8000fffu;
+        f += mantissaOdd;
+        half = static_cast<std::uint16_t>(f >> 13);
+    }
+
+    return static_cast<std::uint16_t>(half | (sign >> 16));
+}
+
+float HalfToFloat(std::uint16_t value)
+{
+    const std::uint32_t sign = static_cast<std::uint32_t>(value & 0x8000) << 16;
+    const std::uint32_t exponent = (value >> 10) & 0x1f;
+    const std::uint32_t mantissa = value & 0x3ff;
+
+    if (exponent == 0)
+    {
+        const float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -magnitude : magnitude;
+    }
+
+    std::uint32_t f;
+
+    if (exponent == 31)
+    {
+        f = sign | 0x7f800000u | (mantissa << 13);
+    }
+    else
+    {
+        f = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+
+    float result;
+    std::memcpy(&result, &f, sizeof(result));
+    return result;
+}
+
+void EncodeHalf(const float* src, std::uint16_t* dst, std::size_t count)
+{
+    std::size_t i = 0;
+
+#ifdef VERTEX_QUANTIZATION_SSE2
+    const __m128i signMask = _mm_set1_epi32(static_cast<int>(0x80000000u));
+    const __m128i infinity = _mm_set1_epi32(0x7f800000);
+    const __m128i halfMaxExclusive = _mm_set1_epi32(0x477fffff);
+    const __m128i denormLimit = _mm_set1_epi32(0x38800000);
+    const __m128i rebias = _mm_set1_epi32(static_cast<int>(0xc8000fffu));
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128i halfBits = _mm_set1_epi32(0x3f000000);
+    const __m128i one = _mm_set1_epi32(1);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i f = _mm_castps_si128(_mm_loadu_ps(src + i));
+
+        const __m128i sign = _mm_and_si128(f, signMask);
+        f = _mm_xor_si128(f, sign);
+
+        const __m128i isLarge = _mm_cmpgt_epi32(f, halfMaxExclusive);
+        const __m128i isSmall = _mm_cmplt_epi32(f, denormLimit);
+
+        const __m128i large = _mm_or_si128(_mm_set1_epi32(0x7c00), _mm_and_si128(_mm_cmpgt_epi32(f, infinity), _mm_set1_epi32(0x0200)));
+        const __m128i small = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(f), half)), halfBits);
+
+        const __m128i mantissaOdd = _mm_and_si128(_mm_srli_epi32(f, 13), one);
+        const __m128i normal = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(f, rebias), mantissaOdd), 13);
+
+        __m128i result = Select(isSmall, small, normal);
+        result = Select(isLarge, large, result);
+        result = _mm_or_si128(result, _mm_srli_epi32(sign, 16));
+
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), PackLow16(result));
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        dst[i] = FloatToHalf(src[i]);
+    }
+}
+
+void EncodeUnorm16(const float* src, std::uint16_t* dst, std::size_t count)
+{
+    std::size_t i = 0;
+
+#ifdef VERTEX_QUANTIZATION_SSE2
+    const __m128 scale = _mm_set1_ps(65535.f);
+    const __m128i bias = _mm_set1_epi32(32768);
+    const __m128i flip = _mm_set1_epi16(static_cast<short>(0x8000));
+
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), _mm_setzero_ps()), _mm_set1_ps(1.f));
+        const __m128i integer = _mm_sub_epi32(_mm_cvtps_epi32(_mm_mul_ps(v, scale)), bias);
+
+        // SSE2 has no unsigned 32 -> 16 pack, so pack around the midpoint
+        const __m128i packed = _mm_xor_si128(_mm_packs_epi32(integer, integer), flip);
+
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), packed);
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        dst[i] = static_cast<std::uint16_t>(std::lrint(Saturate(src[i]) * 65535.f));
+    }
+}
+
+void EncodeOctahedralSnorm16(const float* src, std::int16_t* dst, std::size_t count)
+{
+    std::size_t i = 0;
+
+#ifdef VERTEX_QUANTIZATION_SSE2
+    const __m128 signMask = _mm_set1_ps(-0.f);
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 scale = _mm_set1_ps(32767.f);
+    const __m128 tiny = _mm_set1_ps(1e-20f);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        const float* n = src + i * 3;
+
+        const __m128 x = _mm_setr_ps(n[0], n[3], n[6], n[9]);
+        const __m128 y = _mm_setr_ps(n[1], n[4], n[7], n[10]);
+        const __m128 z = _mm_setr_ps(n[2], n[5], n[8], n[11]);
+
+        const __m128 l1 = _mm_max_ps(_mm_add_ps(_mm_add_ps(_mm_andnot_ps(signMask, x), _mm_andnot_ps(signMask, y)), _mm_andnot_ps(signMask, z)), tiny);
+
+        const __m128 px = _mm_div_ps(x, l1);
+        const __m128 py = _mm_div_ps(y, l1);
+
+        // Fold the lower hemisphere over the diagonals
+        const __m128 wx = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, py)), _mm_or_ps(_mm_and_ps(px, signMask), one));
+        const __m128 wy = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, px)), _mm_or_ps(_mm_and_ps(py, signMask), one));
+
+        const __m128 lower = _mm_cmplt_ps(z, _mm_setzero_ps());
+
+        const __m128 ox = _mm_min_ps(_mm_max_ps(Select(lower, wx, px), _mm_set1_ps(-1.f)), one);
+        const __m128 oy = _mm_min_ps(_mm_max_ps(Select(lower, wy, py), _mm_set1_ps(-1.f)), one);
+
+        const __m128i ix = _mm_cvtps_epi32(_mm_mul_ps(ox, scale));
+        const __m128i iy = _mm_cvtps_epi32(_mm_mul_ps(oy, scale));
+
+        const __m128i packed = _mm_packs_epi32(_mm_unpacklo_epi32(ix, iy), _mm_unpackhi_epi32(ix, iy));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 2), packed);
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        EncodeOctahedral(src[i * 3], src[i * 3 + 1], src[i * 3 + 2], dst + i * 2);
+    }
+}
+
+void DecodeOctahedralSnorm16(const std::int16_t* src, float* dst, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        float x = std::max(src[i * 2] / 32767.f, -1.f);
+        float y = std::max(src[i * 2 + 1] / 32767.f, -1.f);
+        const float z = 1.f - std::fabs(x) - std::fabs(y);
+
+        if (z < 0.f)
+        {
+            const float wx = (1.f - std::fabs(y)) * std::copysign(1.f, x);
+            const float wy = (1.f - std::fabs(x)) * std::copysign(1.f, y);
+            x = wx;
+            y = wy;
+        }
+
+        const float length = std::sqrt(x * x + y * y + z * z);
+
+        dst[i * 3] = x / length;
+        dst[i * 3 + 1] = y / length;
+        dst[i * 3 + 2] = z / length;
+    }
+}
+
+std::vector<PackedVertex> PackVertices(const float* positions, const float* normals, const float* uvs, std::size_t count)
+{
+    std::vector<float> positions4(count * 4);
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        positions4[i * 4] = positions[i * 3];
+        positions4[i * 4 + 1] = positions[i * 3 + 1];
+        positions4[i * 4 + 2] = positions[i * 3 + 2];
+        positions4[i * 4 + 3] = 1.f;
+    }
+
+    std::vector<std::uint16_t> halfPositions(count * 4);
+    std::vector<std::int16_t> octNormals(count * 2);
+    std::vector<std::uint16_t> unormUvs(count * 2);
+
+    EncodeHalf(positions4.data(), halfPositions.data(), count * 4);
+    EncodeOctahedralSnorm16(normals, octNormals.data(), count);
+    EncodeUnorm16(uvs, unormUvs.data(), count * 2);
+
+    std::vector<PackedVertex> vertices(count);
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        std::memcpy(vertices[i].position, &halfPositions[i * 4], sizeof(vertices[i].position));
+        std::memcpy(vertices[i].normal, &octNormals[i * 2], sizeof(vertices[i].normal));
+        std::memcpy(vertices[i].uv, &unormUvs[i * 2], sizeof(vertices[i].uv));
+    }
+
+    return vertices;
+}
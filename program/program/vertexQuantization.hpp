@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Batch encoders for packed vertex attributes. They use SSE2 four values at
+// a time where available; the scalar versions are the reference.
+
+std::uint16_t FloatToHalf(float value);
+
+float HalfToFloat(std::uint16_t value);
+
+// src and dst hold count values
+void EncodeHalf(const float* src, std::uint16_t* dst, std::size_t count);
+
+void EncodeUnorm16(const float* src, std::uint16_t* dst, std::size_t count);
+
+// src holds count xyz normals, dst count octahedral xy pairs
+void EncodeOctahedralSnorm16(const float* src, std::int16_t* dst, std::size_t count);
+
+void DecodeOctahedralSnorm16(const std::int16_t* src, float* dst, std::size_t count);
+
+struct PackedVertex
+{
+    std::uint16_t position[4];
+
+    std::int16_t normal[2];
+
+    std::uint16_t uv[2];
+};
+
+// positions and normals are xyz per vertex, uvs are xy in [0, 1]
+std::vector<PackedVertex> PackVertices(const float* positions, const float* normals, const float* uvs, std::size_t count);
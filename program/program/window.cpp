@@ -1,7 +1,29 @@
+#include <windowsx.h>
+
+#include "profiler.hpp"
 #include "window.hpp"
 
-LRESULT WndProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam)
+namespace
 {
+    // Posted by close(); DestroyWindow only works on the thread that created the window
+    constexpr UINT CloseMessage = WM_APP;
+}
+
+LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam)
+{
+    if (msg == WM_NCCREATE)
+    {
+        const auto create = reinterpret_cast<const CREATESTRUCTW*>(lparam);
+        SetWindowLongPtrW(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(create->lpCreateParams));
+    }
+
+    auto window = reinterpret_cast<Window*>(GetWindowLongPtrW(hwnd, GWLP_USERDATA));
+
+    if (window && window->handleMessage(msg, wparam, lparam))
+    {
+        return 0;
+    }
+
     if (msg == WM_DESTROY)
     {
         PostQuitMessage(0);
@@ -11,11 +33,12 @@ LRESULT WndProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam)
     return DefWindowProcW(hwnd, msg, wparam, lparam);
 }
 
-Window::Window(int width, int height, const std::wstring& appName)
+Window::Window(int width, int height, const std::wstring& appName, WindowEventQueue* events)
     : m_appName(appName)
     , m_hinstance(GetModuleHandle(nullptr))
     , m_width(width)
     , m_height(height)
+    , m_events(events)
 {
     WNDCLASSEX wc =
     {
@@ -49,7 +72,7 @@ Window::Window(int width, int height, const std::wstring& appName)
         WS_EX_APPWINDOW, m_appName.c_str(), m_appName.c_str(),
         WS_OVERLAPPEDWINDOW | WS_VISIBLE,
         posX, posY, adjustedWidth, adjustedHeight,
-        nullptr, nullptr, m_hinstance, nullptr);
+        nullptr, nullptr, m_hinstance, this);
 
     ShowWindow(m_hwnd, SW_SHOW);
 
@@ -67,16 +90,89 @@ bool Window::update()
 {
     MSG msg = {};
 
-    if (PeekMessageW(&msg, nullptr, 0, 0, PM_REMOVE))
+    // Everything queued, not just one message, so a backlog never builds up
+    while (PeekMessageW(&msg, nullptr, 0, 0, PM_REMOVE))
     {
-        TranslateMessage(&msg);
-        DispatchMessageW(&msg);
-
         if (msg.message == WM_QUIT)
         {
             return false;
         }
+
+        TranslateMessage(&msg);
+        DispatchMessageW(&msg);
     }
 
     return true;
 }
+
+void Window::wait()
+{
+    WaitMessage();
+}
+
+void Window::close()
+{
+    PostMessageW(m_hwnd, CloseMessage, 0, 0);
+}
+
+bool Window::handleMessage(UINT msg, WPARAM wparam, LPARAM lparam)
+{
+    switch (msg)
+    {
+    case WM_CLOSE:
+        // The render thread finishes its frame and calls close()
+        if (m_events)
+        {
+            post(WindowEventType::Quit);
+            return true;
+        }
+        return false;
+
+    case CloseMessage:
+        DestroyWindow(m_hwnd);
+        return true;
+
+    case WM_SIZE:
+        m_width = LOWORD(lparam);
+        m_height = HIWORD(lparam);
+
+        post(WindowEventType::Resize, 0, wparam == SIZE_MINIMIZED ? 0 : m_width, wparam == SIZE_MINIMIZED ? 0 : m_height);
+        return false;
+
+    case WM_KEYDOWN:
+        post(WindowEventType::KeyDown, static_cast<std::uint32_t>(wparam));
+        return false;
+
+    case WM_KEYUP:
+        post(WindowEventType::KeyUp, static_cast<std::uint32_t>(wparam));
+        return false;
+
+    case WM_MOUSEMOVE:
+        post(WindowEventType::MouseMove, 0, GET_X_LPARAM(lparam), GET_Y_LPARAM(lparam));
+        return false;
+
+    case WM_LBUTTONDOWN:
+    case WM_RBUTTONDOWN:
+    case WM_MBUTTONDOWN:
+        post(WindowEventType::MouseDown, msg == WM_LBUTTONDOWN ? 0 : msg == WM_RBUTTONDOWN ? 1 : 2, GET_X_LPARAM(lparam), GET_Y_LPARAM(lparam));
+        return false;
+
+    case WM_LBUTTONUP:
+    case WM_RBUTTONUP:
+    case WM_MBUTTONUP:
+        post(WindowEventType::MouseUp, msg == WM_LBUTTONUP ? 0 : msg == WM_RBUTTONUP ? 1 : 2, GET_X_LPARAM(lparam), GET_Y_LPARAM(lparam));
+        return false;
+    }
+
+    return false;
+}
+
+void Window::post(WindowEventType type, std::uint32_t code, std::int32_t x, std::int32_t y)
+{
+    // Never waits for the render thread, which may be inside Present waiting for this pump;
+    // the queue drops and counts input that does not fit
+    if (m_events)
+    {
+        m_events->push({ .type = type, .code = code, .x = x, .y = y, .timestamp = Profiler::Now() });
+    }
+}
@@ -1,16 +1,21 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 
 #include <Windows.h>
 
+#include "windowEvent.hpp"
+
 class Window
 {
 public:
 
     Window() = default;
 
-    Window(int width, int height, const std::wstring& appName = L"");
+    // With events, input, resizes and close requests are queued there for the render
+    // thread, and the window is only destroyed once close() is called
+    Window(int width, int height, const std::wstring& appName = L"", WindowEventQueue* events = nullptr);
 
     ~Window();
 
@@ -20,10 +25,26 @@ public:
 
     int height()const { return m_height; }
 
+    // Dispatches every pending message; false once the window is gone
     bool update();
 
+    // Sleeps until a message arrives
+    void wait();
+
+    // Any thread; destroys the window from its own thread
+    void close();
+
+    // Input lost because the queue was full
+    std::uint64_t droppedEvents()const { return m_events ? m_events->stats().droppedInput : 0; }
+
 private:
 
+    friend LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam);
+
+    bool handleMessage(UINT msg, WPARAM wparam, LPARAM lparam);
+
+    void post(WindowEventType type, std::uint32_t code = 0, std::int32_t x = 0, std::int32_t y = 0);
+
     std::wstring m_appName = L"";
 
     HINSTANCE m_hinstance = nullptr;
@@ -33,4 +54,6 @@ private:
     int m_width = 0;
 
     int m_height = 0;
+
+    WindowEventQueue* m_events = nullptr;
 };
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "spscQueue.hpp"
+
+enum class WindowEventType : std::uint8_t
+{
+    // x, y: new client size; 0 x 0 when minimized
+    Resize,
+
+    // The window was asked to close; the renderer stops and then closes it
+    Quit,
+
+    // code: virtual-key code
+    KeyDown,
+
+    KeyUp,
+
+    // x, y: client coordinates
+    MouseMove,
+
+    // code: 0 left, 1 right, 2 middle; x, y: client coordinates
+    MouseDown,
+
+    MouseUp,
+};
+
+struct WindowEvent
+{
+    WindowEventType type = WindowEventType::Quit;
+
+    std::uint32_t code = 0;
+
+    std::int32_t x = 0;
+
+    std::int32_t y = 0;
+
+    // Profiler::Now() when the window thread queued it
+    std::uint64_t timestamp = 0;
+};
+
+struct WindowEventQueueStats
+{
+    // Input events lost because the queue was full
+    std::uint64_t droppedInput = 0;
+
+    // Resizes replaced by a newer one before the render thread took them
+    std::uint64_t replacedResizes = 0;
+};
+
+// Window thread to render thread. push never blocks, because the render thread
+// may itself be waiting on the message pump inside Present or ResizeBuffers:
+// input goes through a bounded queue and is dropped and counted when it does
+// not fit, a resize only keeps the newest size, and a quit is a flag. pop hands
+// out a quit first, then input in order, then the pending resize.
+class WindowEventQueue
+{
+public:
+
+    static constexpr std::size_t InputCapacity = 1024;
+
+    WindowEventQueue() = default;
+
+    WindowEventQueue(const WindowEventQueue&) = delete;
+
+    WindowEventQueue& operator=(const WindowEventQueue&) = delete;
+
+    static constexpr std::size_t capacity() { return InputCapacity; }
+
+    // Window thread only. False when input was dropped.
+    bool push(const WindowEvent& event)
+    {
+        switch (event.type)
+        {
+        case WindowEventType::Quit:
+            m_quitTimestamp.store(event.timestamp, std::memory_order_relaxed);
+            m_quit.store(true, std::memory_order_release);
+            break;
+
+        case WindowEventType::Resize:
+            m_resizeSize.store(PackSize(event.x, event.y), std::memory_order_relaxed);
+            m_resizeTimestamp.store(event.timestamp, std::memory_order_relaxed);
+
+            if (m_resizePending.exchange(true, std::memory_order_acq_rel))
+            {
+                m_replacedResizes.fetch_add(1, std::memory_order_relaxed);
+            }
+            break;
+
+        default:
+            if (!m_input.push(event))
+            {
+                m_droppedInput.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            break;
+        }
+
+        // Paired with wait: either it sees the change before sleeping or this sees it waiting
+        m_signal.fetch_add(1, std::memory_order_seq_cst);
+
+        if (m_waiting.load(std::memory_order_seq_cst))
+        {
+            m_signal.notify_one();
+        }
+
+        return true;
+    }
+
+    // Render thread only
+    std::optional<WindowEvent> pop()
+    {
+        if (m_quit.load(std::memory_order_acquire))
+        {
+            return WindowEvent{ .type = WindowEventType::Quit, .timestamp = m_quitTimestamp.load(std::memory_order_relaxed) };
+        }
+
+        if (auto event = m_input.pop())
+        {
+            return event;
+        }
+
+        if (m_resizePending.exchange(false, std::memory_order_acq_rel))
+        {
+            const auto size = m_resizeSize.load(std::memory_order_relaxed);
+
+            return WindowEvent
+            {
+                .type = WindowEventType::Resize,
+                .x = static_cast<std::int32_t>(size >> 32),
+                .y = static_cast<std::int32_t>(size & 0xffffffff),
+                .timestamp = m_resizeTimestamp.load(std::memory_order_relaxed),
+            };
+        }
+
+        return std::nullopt;
+    }
+
+    // Render thread only. Sleeps until pop has something.
+    void wait()
+    {
+        const auto signal = m_signal.load(std::memory_order_seq_cst);
+
+        m_waiting.store(true, std::memory_order_seq_cst);
+
+        if (!pending())
+        {
+            m_signal.wait(signal, std::memory_order_seq_cst);
+        }
+
+        m_waiting.store(false, std::memory_order_relaxed);
+    }
+
+    // Either side; only a snapshot
+    bool pending()const
+    {
+        return m_quit.load(std::memory_order_acquire) || m_resizePending.load(std::memory_order_acquire) || m_input.size() != 0;
+    }
+
+    WindowEventQueueStats stats()const
+    {
+        return
+        {
+            .droppedInput = m_droppedInput.load(std::memory_order_relaxed),
+            .replacedResizes = m_replacedResizes.load(std::memory_order_relaxed),
+        };
+    }
+
+private:
+
+    static std::uint64_t PackSize(std::int32_t width, std::int32_t height)
+    {
+        return static_cast<std::uint64_t>(static_cast<std::uint32_t>(width)) << 32 | static_cast<std::uint32_t>(height);
+    }
+
+    SpscQueue<WindowEvent, InputCapacity> m_input;
+
+    // Both sides; latest value wins
+    std::atomic<bool> m_resizePending = false;
+
+    std::atomic<std::uint64_t> m_resizeSize = 0;
+
+    std::atomic<std::uint64_t> m_resizeTimestamp = 0;
+
+    std::atomic<bool> m_quit = false;
+
+    std::atomic<std::uint64_t> m_quitTimestamp = 0;
+
+    // Bumped by every push, for wait
+    std::atomic<std::uint32_t> m_signal = 0;
+
+    std::atomic<bool> m_waiting = false;
+
+    std::atomic<std::uint64_t> m_droppedInput = 0;
+
+    std::atomic<std::uint64_t> m_replacedResizes = 0;
+};
@@ -0,0 +1,480 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "bvh.hpp"
+#include "jobSystem.hpp"
+#include "test.hpp"
+
+namespace
+{
+    std::vector<Aabb> RandomBoxes(std::mt19937& random, std::uint32_t count)
+    {
+        std::uniform_real_distribution<float> unit(-1.f, 1.f);
+
+        std::vector<Aabb> boxes(count);
+
+        for (auto& box : boxes)
+        {
+            for (std::uint32_t axis = 0; axis < 3; ++axis)
+            {
+                const float center = unit(random) * 100.f;
+                const float extent = 0.1f + std::fabs(unit(random)) * 4.f;
+
+                box.min[axis] = center - extent;
+                box.max[axis] = center + extent;
+            }
+        }
+
+        // Duplicates and a point, which SAH cannot split
+        if (4 <= count)
+        {
+            boxes[1] = boxes[0];
+            boxes[2] = boxes[0];
+            boxes[3].max[0] = boxes[3].min[0];
+            boxes[3].max[1] = boxes[3].min[1];
+            boxes[3].max[2] = boxes[3].min[2];
+        }
+
+        return boxes;
+    }
+
+    // Looking down +z from a random spot, some queries see the whole scene and some very little
+    Frustum RandomFrustum(std::mt19937& random)
+    {
+        std::uniform_real_distribution<float> unit(-1.f, 1.f);
+
+        const float x = unit(random) * 80.f;
+        const float y = unit(random) * 80.f;
+        const float z = -120.f + unit(random) * 100.f;
+
+        const float scale = 1.f + std::fabs(unit(random)) * 4.f;
+        const float near = 0.5f;
+        const float far = 50.f + std::fabs(unit(random)) * 250.f;
+        const float zScale = far / (far - near);
+
+        // Translation by -camera, then the projection
+        const float viewProjection[16] =
+        {
+            scale, 0.f, 0.f, 0.f,
+            0.f, scale, 0.f, 0.f,
+            0.f, 0.f, zScale, 1.f,
+            -x * scale, -y * scale, -z * zScale - zScale * near, -z,
+        };
+
+        return MakeFrustum(viewProjection);
+    }
+
+    // The box test queryFrustum applies to single instances
+    bool InFrustum(const Frustum& frustum, const Aabb& box)
+    {
+        for (const auto& plane : frustum.planes)
+        {
+            float distance = plane[3];
+            float radius = 0.f;
+
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                distance += plane[axis] * (box.min[axis] + box.max[axis]) * 0.5f;
+                radius += std::fabs(plane[axis]) * (box.max[axis] - box.min[axis]) * 0.5f;
+            }
+
+            if (distance + radius < 0.f)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool Overlaps(const Aabb& a, const Aabb& b)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (b.max[axis] < a.min[axis] || a.max[axis] < b.min[axis])
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Slab test as the BVH does it, entry distance or infinity
+    float RayEntry(const float (&origin)[3], const float (&direction)[3], const Aabb& box, float maxDistance)
+    {
+        float near = 0.f;
+        float far = maxDistance;
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            const float inverse = direction[axis] != 0.f ? 1.f / direction[axis] : std::copysign(1e30f, direction[axis]);
+
+            float t0 = (box.min[axis] - origin[axis]) * inverse;
+            float t1 = (box.max[axis] - origin[axis]) * inverse;
+
+            if (t1 < t0)
+            {
+                std::swap(t0, t1);
+            }
+
+            near = std::max(near, t0);
+            far = std::min(far, t1);
+        }
+
+        return near <= far ? near : std::numeric_limits<float>::infinity();
+    }
+
+    std::vector<std::uint32_t> Sorted(std::vector<std::uint32_t> instances)
+    {
+        std::sort(instances.begin(), instances.end());
+        return instances;
+    }
+
+    // Every instance once, and every node box holds its children and instances
+    bool WellFormed(const Bvh& bvh, const std::vector<Aabb>& boxes)
+    {
+        const auto primitives = bvh.primitives();
+        const auto nodes = bvh.nodes();
+
+        const auto sorted = Sorted({ primitives.begin(), primitives.end() });
+
+        for (std::uint32_t i = 0; i < sorted.size(); ++i)
+        {
+            if (sorted[i] != i)
+            {
+                return false;
+            }
+        }
+
+        if (sorted.size() != boxes.size())
+        {
+            return false;
+        }
+
+        const auto contains = [](const BvhNode& node, const float* min, const float* max)
+        {
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                if (min[axis] < node.min[axis] || node.max[axis] < max[axis])
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        };
+
+        std::uint32_t leafInstances = 0;
+
+        for (std::size_t i = 0; i < nodes.size(); ++i)
+        {
+            const auto& node = nodes[i];
+
+            if (node.isLeaf())
+            {
+                for (auto p = node.offset; p < node.offset + node.count; ++p)
+                {
+                    const auto& box = boxes[primitives[p]];
+
+                    if (!contains(node, box.min, box.max))
+                    {
+                        return false;
+                    }
+                }
+
+                leafInstances += node.count;
+                continue;
+            }
+
+            const auto& left = nodes[i + 1];
+            const auto& right = nodes[node.offset];
+
+            if (node.offset <= i + 1 || nodes.size() <= node.offset ||
+                !contains(node, left.min, left.max) || !contains(node, right.min, right.max))
+            {
+                return false;
+            }
+        }
+
+        return leafInstances == boxes.size();
+    }
+
+    // Frustum, box and ray queries against a loop over every box
+    void CheckQueries(const Bvh& bvh, const std::vector<Aabb>& boxes, std::mt19937& random)
+    {
+        std::uniform_real_distribution<float> unit(-1.f, 1.f);
+
+        std::vector<std::uint32_t> found;
+
+        for (std::uint32_t q = 0; q < 20; ++q)
+        {
+            const auto frustum = RandomFrustum(random);
+
+            std::vector<std::uint32_t> expected;
+
+            for (std::uint32_t i = 0; i < boxes.size(); ++i)
+            {
+                if (InFrustum(frustum, boxes[i]))
+                {
+                    expected.push_back(i);
+                }
+            }
+
+            found.clear();
+            bvh.queryFrustum(frustum, found);
+
+            CHECK(Sorted(found) == expected);
+        }
+
+        for (std::uint32_t q = 0; q < 30; ++q)
+        {
+            // From small boxes to ones covering most of the scene
+            Aabb query;
+            const float size = q % 10 == 0 ? 150.f : 1.f + std::fabs(unit(random)) * 30.f;
+
+            for (std::uint32_t axis = 0; axis < 3; ++axis)
+            {
+                const float center = unit(random) * 100.f;
+
+                query.min[axis] = center - size;
+                query.max[axis] = center + size;
+            }
+
+            std::vector<std::uint32_t> expected;
+
+            for (std::uint32_t i = 0; i < boxes.size(); ++i)
+            {
+                if (Overlaps(query, boxes[i]))
+                {
+                    expected.push_back(i);
+                }
+            }
+
+            found.clear();
+            bvh.queryBox(query, found);
+
+            CHECK(Sorted(found) == expected);
+        }
+
+        for (std::uint32_t q = 0; q < 50; ++q)
+        {
+            // Some from outside the scene, some along an axis, some starting inside a box
+            float origin[3] = { unit(random) * 150.f, unit(random) * 150.f, unit(random) * 150.f };
+            float direction[3] = { unit(random), unit(random), unit(random) };
+
+            if (q % 5 == 0)
+            {
+                direction[0] = 0.f;
+                direction[1] = 0.f;
+                direction[2] = 1.f;
+            }
+
+            if (q % 7 == 0 && !boxes.empty())
+            {
+                const auto& box = boxes[random() % boxes.size()];
+
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    origin[axis] = (box.min[axis] + box.max[axis]) * 0.5f;
+                }
+            }
+
+            const float maxDistance = q % 3 == 0 ? 50.f : 1000.f;
+
+            float nearest = std::numeric_limits<float>::infinity();
+
+            for (const auto& box : boxes)
+            {
+                nearest = std::min(nearest, RayEntry(origin, direction, box, maxDistance));
+            }
+
+            const auto hit = bvh.raycast(origin, direction, maxDistance);
+
+            CHECK(hit.has_value() == !std::isinf(nearest));
+
+            if (hit)
+            {
+                // Ties may pick either box, but never a farther one
+                CHECK(hit->distance == nearest);
+                CHECK(hit->instance < boxes.size() && RayEntry(origin, direction, boxes[hit->instance], maxDistance) == nearest);
+            }
+        }
+    }
+
+    // Most instances jitter a little, a few jump across the scene
+    void MoveBoxes(std::mt19937& random, std::vector<Aabb>& boxes, float jitter, std::uint32_t jumpEvery)
+    {
+        std::uniform_real_distribution<float> unit(-1.f, 1.f);
+
+        for (std::uint32_t i = 0; i < boxes.size(); ++i)
+        {
+            for (std::uint32_t axis = 0; axis < 3; ++axis)
+            {
+                const float offset = jumpEvery && i % jumpEvery == 0 ? unit(random) * 150.f : unit(random) * jitter;
+
+                boxes[i].min[axis] += offset;
+                boxes[i].max[axis] += offset;
+            }
+        }
+    }
+}
+
+TEST_CASE(BvhQueriesMatchBruteForce)
+{
+    std::mt19937 random(13);
+
+    JobSystem jobs(4);
+
+    // A low threshold sends most nodes of the larger builds through the job system
+    const BvhBuildSettings parallelSettings = { .parallelThreshold = 64 };
+
+    for (const std::uint32_t count : { 0u, 1u, 2u, 5u, 17u, 300u, 5000u })
+    {
+        const auto boxes = RandomBoxes(random, count);
+
+        Bvh serial;
+        CHECK(serial.build(nullptr, boxes));
+        CHECK(WellFormed(serial, boxes));
+        CheckQueries(serial, boxes, random);
+
+        Bvh parallel;
+        CHECK(parallel.build(&jobs, boxes, parallelSettings));
+        CHECK(WellFormed(parallel, boxes));
+        CheckQueries(parallel, boxes, random);
+
+        // The default threshold on the job system as well
+        Bvh defaults;
+        CHECK(defaults.build(&jobs, boxes));
+        CHECK(WellFormed(defaults, boxes));
+        CheckQueries(defaults, boxes, random);
+
+        CHECK(serial.stats().nodes == serial.nodes().size());
+        CHECK(count == 0 || serial.stats().depth <= Bvh::MaxDepth + 1);
+    }
+
+    // An empty tree answers nothing
+    Bvh empty;
+    CHECK(empty.build(nullptr, {}));
+
+    std::vector<std::uint32_t> found;
+    empty.queryBox({ .min = { -1e9f, -1e9f, -1e9f }, .max = { 1e9f, 1e9f, 1e9f } }, found);
+    CHECK(found.empty());
+    CHECK(!empty.raycast({ 0.f, 0.f, 0.f }, { 1.f, 0.f, 0.f }, 1e9f));
+}
+
+TEST_CASE(BvhQueriesAfterRefit)
+{
+    std::mt19937 random(17);
+
+    JobSystem jobs(4);
+
+    for (const bool parallel : { false, true })
+    {
+        auto boxes = RandomBoxes(random, 2000);
+
+        Bvh bvh;
+        CHECK(bvh.build(parallel ? &jobs : nullptr, boxes, { .parallelThreshold = 128 }));
+
+        const auto refits = bvh.stats().refits;
+        const auto fullRebuilds = bvh.stats().fullRebuilds;
+
+        // Refitting keeps the topology and still answers every query exactly
+        for (std::uint32_t frame = 0; frame < 3; ++frame)
+        {
+            MoveBoxes(random, boxes, 2.f, 97);
+
+            bvh.refit(boxes);
+
+            CHECK(WellFormed(bvh, boxes));
+            CheckQueries(bvh, boxes, random);
+        }
+
+        CHECK(bvh.stats().refits == refits + 3);
+        CHECK(bvh.stats().fullRebuilds == fullRebuilds);
+
+        // Bounds for a different number of instances are ignored
+        const auto nodes = std::vector<BvhNode>(bvh.nodes().begin(), bvh.nodes().end());
+        bvh.refit(std::span(boxes).first(10));
+        CHECK(bvh.nodes().size() == nodes.size());
+        CHECK(bvh.refitAndRebuild(&jobs, std::span(boxes).first(10)) == 0);
+    }
+}
+
+TEST_CASE(BvhQueriesAfterRefitAndRebuild)
+{
+    std::mt19937 random(19);
+
+    JobSystem jobs(4);
+
+    for (const bool parallel : { false, true })
+    {
+        JobSystem* jobSystem = parallel ? &jobs : nullptr;
+
+        auto boxes = RandomBoxes(random, 3000);
+
+        // A few instances in one corner, so one subtree grows a lot when they scatter
+        for (std::uint32_t i = 0; i < 200; ++i)
+        {
+            for (std::uint32_t axis = 0; axis < 3; ++axis)
+            {
+                boxes[i].min[axis] = 200.f + (i % 10);
+                boxes[i].max[axis] = 201.f + (i % 10);
+            }
+        }
+
+        Bvh bvh;
+        CHECK(bvh.build(jobSystem, boxes, { .parallelThreshold = 128 }));
+
+        // Small motion rebuilds nothing
+        MoveBoxes(random, boxes, 0.01f, 0);
+        CHECK(bvh.refitAndRebuild(jobSystem, boxes) == 0);
+        CHECK(WellFormed(bvh, boxes));
+        CheckQueries(bvh, boxes, random);
+
+        // The corner scatters over the scene
+        std::uniform_real_distribution<float> unit(-1.f, 1.f);
+
+        for (std::uint32_t i = 0; i < 200; ++i)
+        {
+            for (std::uint32_t axis = 0; axis < 3; ++axis)
+            {
+                const float center = unit(random) * 100.f;
+
+                boxes[i].min[axis] = center - 1.f;
+                boxes[i].max[axis] = center + 1.f;
+            }
+        }
+
+        const auto partialRebuilds = bvh.stats().partialRebuilds;
+        const auto fullRebuilds = bvh.stats().fullRebuilds;
+
+        const auto rebuilt = bvh.refitAndRebuild(jobSystem, boxes);
+
+        CHECK(0 < rebuilt && rebuilt < boxes.size());
+        CHECK(bvh.stats().partialRebuilds == partialRebuilds + 1);
+        CHECK(bvh.stats().fullRebuilds == fullRebuilds);
+        CHECK(WellFormed(bvh, boxes));
+        CheckQueries(bvh, boxes, random);
+
+        // Everything spread far out grows the root, which rebuilds the whole tree
+        for (auto& box : boxes)
+        {
+            for (std::uint32_t axis = 0; axis < 3; ++axis)
+            {
+                box.min[axis] *= 4.f;
+                box.max[axis] *= 4.f;
+            }
+        }
+
+        CHECK(bvh.refitAndRebuild(jobSystem, boxes) == boxes.size());
+        CHECK(bvh.stats().fullRebuilds == fullRebuilds + 1);
+        CHECK(WellFormed(bvh, boxes));
+        CheckQueries(bvh, boxes, random);
+    }
+}
@@ -0,0 +1,264 @@
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "commandStream.hpp"
+#include "nullBackend.hpp"
+#include "test.hpp"
+
+namespace
+{
+    // Writes down every call that got past the tracker
+    class RecordingSink : public CommandSink
+    {
+    public:
+
+        std::vector<std::string> calls;
+
+        // Pipelines 2 and 3 share a root signature
+        std::uint64_t rootSignatureKey(PipelineHandle pipeline) override { return pipeline.id / 2; }
+
+        void setPipelineState(PipelineHandle pipeline) override { calls.push_back("pso " + std::to_string(pipeline.id)); }
+
+        void setRootSignature(PipelineHandle pipeline) override { calls.push_back("root " + std::to_string(pipeline.id)); }
+
+        void setTopology(PrimitiveTopology topology) override { calls.push_back("topology " + std::to_string(static_cast<int>(topology))); }
+
+        void setVertexBuffer(std::uint32_t slot, const VertexBufferView&) override { calls.push_back("vb " + std::to_string(slot)); }
+
+        void setIndexBuffer(const IndexBufferView&) override { calls.push_back("ib"); }
+
+        void setViewport(const Viewport&) override { calls.push_back("viewport"); }
+
+        void setScissor(const ScissorRect&) override { calls.push_back("scissor"); }
+
+        void setConstantBuffer(std::uint64_t gpuAddress) override { calls.push_back("cb " + std::to_string(gpuAddress)); }
+
+        void drawIndexed(const DrawIndexedArgs& args) override { calls.push_back("draw " + std::to_string(args.indexCount)); }
+    };
+
+    // Counts what the default execute hands to the backend
+    class CountingBackend : public NullBackend
+    {
+    public:
+
+        std::vector<PipelineHandle> pipelines;
+
+        std::vector<Viewport> viewports;
+
+        std::vector<ScissorRect> scissors;
+
+        std::vector<DrawIndexedDesc> draws;
+
+        void setPipeline(PipelineHandle pipeline) override
+        {
+            pipelines.push_back(pipeline);
+            NullBackend::setPipeline(pipeline);
+        }
+
+        void setViewport(const Viewport& viewport) override { viewports.push_back(viewport); }
+
+        void setScissor(const ScissorRect& scissor) override { scissors.push_back(scissor); }
+
+        void draw(const DrawIndexedDesc& desc) override
+        {
+            draws.push_back(desc);
+            NullBackend::draw(desc);
+        }
+    };
+
+    bool Equal(const StateCounter& counter, std::uint64_t issued, std::uint64_t dropped)
+    {
+        return counter.issued == issued && counter.dropped == dropped;
+    }
+}
+
+TEST_CASE(TrackerDropsRedundantState)
+{
+    const VertexBufferView vertices = { .buffer = { 1 }, .sizeInBytes = 36, .strideInBytes = 12 };
+
+    CommandStream commands;
+
+    commands.setPipeline({ 2 });
+    commands.setConstantBuffer(256);
+    commands.drawIndexed({ .indexCount = 3 });
+
+    // New PSO on the same root signature keeps the constant buffer
+    commands.setPipeline({ 3 });
+    commands.setConstantBuffer(256);
+    commands.drawIndexed({ .indexCount = 3 });
+
+    // A root signature change clears root arguments, so b1 is bound again
+    commands.setPipeline({ 1 });
+    commands.setConstantBuffer(256);
+    commands.drawIndexed({ .indexCount = 3 });
+
+    // Slots are tracked apart; one past the last is ignored
+    commands.setVertexBuffer(0, vertices);
+    commands.setVertexBuffer(1, vertices);
+    commands.setVertexBuffer(1, vertices);
+    commands.setVertexBuffer(CommandStream::VertexBufferSlots, vertices);
+
+    CHECK(commands.commandCount() == 13);
+
+    CommandStateTracker tracker;
+    RecordingSink sink;
+
+    tracker.replay(commands, sink);
+
+    const std::vector<std::string> expected =
+    {
+        "root 2", "pso 2", "cb 256", "draw 3",
+        "pso 3", "draw 3",
+        "root 1", "pso 1", "cb 256", "draw 3",
+        "vb 0", "vb 1",
+    };
+
+    CHECK(sink.calls == expected);
+
+    const auto& stats = tracker.stats();
+    CHECK(stats.commands == 13);
+    CHECK(stats.draws == 3);
+    CHECK(Equal(stats.pipelineState, 3, 0));
+    CHECK(Equal(stats.rootSignature, 2, 1));
+    CHECK(Equal(stats.constantBuffer, 2, 1));
+    CHECK(Equal(stats.vertexBuffer, 2, 1));
+    CHECK(stats.dropped() == 3);
+
+    // The pipeline is still bound; only the first topology gets through
+    commands.clear();
+    commands.setPipeline({ 1 });
+    commands.setTopology(PrimitiveTopology::TriangleStrip);
+    commands.setTopology(PrimitiveTopology::TriangleStrip);
+
+    sink.calls.clear();
+    tracker.replay(commands, sink);
+
+    CHECK((sink.calls == std::vector<std::string>{ "topology 1" }));
+    CHECK(Equal(tracker.stats().pipelineState, 3, 1));
+    CHECK(Equal(tracker.stats().topology, 1, 1));
+
+    // Forgotten after reset
+    sink.calls.clear();
+    tracker.reset();
+    tracker.replay(commands, sink);
+
+    CHECK((sink.calls == std::vector<std::string>{ "root 1", "pso 1", "topology 1" }));
+    CHECK(Equal(tracker.stats().pipelineState, 4, 1));
+    CHECK(Equal(tracker.stats().rootSignature, 3, 1));
+    CHECK(Equal(tracker.stats().topology, 2, 2));
+    CHECK(tracker.stats().commands == 19);
+
+    tracker.resetStats();
+    CHECK(tracker.stats().commands == 0);
+    CHECK(tracker.stats().dropped() == 0);
+}
+
+TEST_CASE(ExecuteForwardsOnlyChangesToNullBackend)
+{
+    CountingBackend backend;
+    CHECK(backend.init({ .width = 64, .height = 64 }));
+
+    const std::vector<float> vertexData(9, 0.f);
+    const std::vector<std::uint32_t> indexData = { 0, 1, 2 };
+
+    PipelineDesc desc = { .vertexShaderPath = L"vs.hlsl", .pixelShaderPath = L"ps.hlsl", .inputLayout = {}, .defines = {} };
+    desc.inputLayout.push_back({ .semanticName = "POSITION", .format = VertexFormat::Float3 });
+
+    const auto first = backend.createPipeline(desc).value_or(PipelineHandle{});
+    const auto second = backend.createPipeline(desc).value_or(PipelineHandle{});
+    const auto vertexBuffer = backend.createBuffer(BufferUsage::Vertex, vertexData.data(), 36).value_or(BufferHandle{});
+    const auto otherVertexBuffer = backend.createBuffer(BufferUsage::Vertex, vertexData.data(), 36).value_or(BufferHandle{});
+    const auto indexBuffer = backend.createBuffer(BufferUsage::Index, indexData.data(), 12).value_or(BufferHandle{});
+
+    const VertexBufferView vertices = { .buffer = vertexBuffer, .sizeInBytes = 36, .strideInBytes = 12 };
+    const VertexBufferView otherVertices = { .buffer = otherVertexBuffer, .sizeInBytes = 36, .strideInBytes = 12 };
+    const IndexBufferView indices = { .buffer = indexBuffer, .sizeInBytes = 12, .format = IndexFormat::Uint32 };
+    const Viewport viewport = { .width = 64.f, .height = 64.f };
+    const Viewport halfViewport = { .width = 32.f, .height = 64.f };
+    const ScissorRect scissor = { .right = 64, .bottom = 64 };
+
+    CommandStream commands;
+
+    const auto bindAll = [&]()
+    {
+        commands.setPipeline(first);
+        commands.setTopology(PrimitiveTopology::TriangleList);
+        commands.setVertexBuffer(0, vertices);
+        commands.setIndexBuffer(indices);
+        commands.setViewport(viewport);
+        commands.setScissor(scissor);
+        commands.drawIndexed({ .indexCount = 3 });
+    };
+
+    // The second time every state is already bound
+    bindAll();
+    bindAll();
+
+    commands.setPipeline(second);
+    commands.setVertexBuffer(0, otherVertices);
+    commands.drawIndexed({ .indexCount = 3 });
+
+    commands.setPipeline(first);
+    commands.setVertexBuffer(0, vertices);
+    commands.setViewport(halfViewport);
+    commands.setScissor(scissor);
+    commands.drawIndexed({ .indexCount = 3 });
+
+    CHECK(backend.frameBegin());
+    backend.resetStats();
+
+    CommandStateTracker tracker;
+    backend.execute(commands, tracker);
+
+    CHECK(backend.frameEnd());
+
+    const auto& stats = tracker.stats();
+    CHECK(stats.commands == 22);
+    CHECK(stats.draws == 4);
+    CHECK(Equal(stats.pipelineState, 3, 1));
+    CHECK(Equal(stats.rootSignature, 3, 0));
+    CHECK(Equal(stats.topology, 1, 1));
+    CHECK(Equal(stats.vertexBuffer, 3, 1));
+    CHECK(Equal(stats.indexBuffer, 1, 1));
+    CHECK(Equal(stats.viewport, 2, 1));
+    CHECK(Equal(stats.scissor, 1, 2));
+    CHECK(stats.dropped() == 7);
+
+    CHECK((backend.pipelines == std::vector<PipelineHandle>{ first, second, first }));
+    CHECK((backend.viewports == std::vector<Viewport>{ viewport, halfViewport }));
+    CHECK((backend.scissors == std::vector<ScissorRect>{ scissor }));
+
+    // Every draw still sees the buffers the stream bound before it
+    CHECK(backend.draws.size() == 4);
+
+    const VertexBufferView drawnVertices[] = { vertices, vertices, otherVertices, vertices };
+
+    for (std::size_t i = 0; i < backend.draws.size() && i < std::size(drawnVertices); ++i)
+    {
+        CHECK(backend.draws[i].vertexBuffer == drawnVertices[i]);
+        CHECK(backend.draws[i].indexBuffer == indices);
+        CHECK(backend.draws[i].indexCount == 3);
+    }
+
+    // frameEnd, three pipelines, four draws; three of them changed the vertex buffer
+    // and one the index buffer
+    const auto& backendStats = backend.stats();
+    CHECK(backendStats.validationErrors == 0);
+    CHECK(backendStats.draws == 4);
+    CHECK(backendStats.apiCalls == 8);
+    CHECK(backendStats.stateChanges == 7);
+
+    // execute starts from nothing bound, so a second frame issues the same calls
+    CHECK(backend.frameBegin());
+    backend.execute(commands, tracker);
+    CHECK(backend.frameEnd());
+
+    CHECK(tracker.stats().commands == 44);
+    CHECK(Equal(tracker.stats().pipelineState, 6, 2));
+    CHECK(backend.pipelines.size() == 6);
+    CHECK(backend.viewports.size() == 4);
+    CHECK(backend.draws.size() == 8);
+    CHECK(backend.stats().validationErrors == 0);
+}
@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "descriptorAllocator.hpp"
+#include "test.hpp"
+
+TEST_CASE(DescriptorAllocatorRejectsBadSizes)
+{
+    DescriptorAllocator descriptors;
+
+    CHECK(!descriptors.init(16, 15));
+    CHECK(!descriptors.init(16, 16));
+    CHECK(descriptors.init(16, 14));
+
+    // Only slot 1 is persistent
+    CHECK(descriptors.allocate() == DescriptorHandle{ 1 });
+    CHECK(!descriptors.allocate());
+}
+
+TEST_CASE(DescriptorAllocatorPersistentSlots)
+{
+    constexpr std::uint32_t Capacity = 64;
+    constexpr std::uint32_t TransientCapacity = 16;
+    constexpr std::uint32_t PersistentCapacity = Capacity - TransientCapacity - 1;
+
+    DescriptorAllocator descriptors;
+    CHECK(descriptors.init(Capacity, TransientCapacity));
+
+    std::vector<DescriptorHandle> handles;
+
+    for (std::uint32_t i = 0; i < PersistentCapacity; ++i)
+    {
+        const auto handle = descriptors.allocate();
+
+        // Never the null descriptor and never inside the transient ring
+        CHECK(handle);
+        CHECK(handle.index < Capacity - TransientCapacity);
+        handles.push_back(handle);
+    }
+
+    std::vector<DescriptorHandle> sorted = handles;
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.index < b.index; });
+    CHECK(std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end());
+
+    CHECK(!descriptors.allocate());
+    CHECK(descriptors.stats().persistentUsed == PersistentCapacity);
+    CHECK(descriptors.stats().persistentPeak == PersistentCapacity);
+
+    const DescriptorHandle freed = handles[7];
+    descriptors.free(freed);
+
+    // Double frees, the null handle and transient slots are ignored
+    descriptors.free(freed);
+    descriptors.free({});
+    descriptors.free({ Capacity - 1 });
+
+    CHECK(descriptors.stats().persistentUsed == PersistentCapacity - 1);
+    CHECK(descriptors.stats().pendingFrees == 1);
+
+    // Still read by the frame that freed it
+    CHECK(!descriptors.allocate());
+
+    descriptors.endFrame(1);
+    descriptors.reclaim(0);
+    CHECK(!descriptors.allocate());
+
+    descriptors.reclaim(1);
+    CHECK(descriptors.stats().pendingFrees == 0);
+    CHECK(descriptors.allocate() == freed);
+    CHECK(!descriptors.allocate());
+}
+
+TEST_CASE(DescriptorAllocatorTransientRingWraps)
+{
+    constexpr std::uint32_t Capacity = 1024;
+    constexpr std::uint32_t TransientCapacity = 256;
+    constexpr std::uint32_t TransientBase = Capacity - TransientCapacity;
+    constexpr std::uint64_t FramesInFlight = 2;
+
+    DescriptorAllocator descriptors;
+    CHECK(descriptors.init(Capacity, TransientCapacity));
+
+    std::mt19937 random(3);
+
+    struct Frame
+    {
+        std::uint64_t fenceValue = 0;
+
+        std::vector<DescriptorRange> ranges;
+    };
+
+    std::deque<Frame> inFlight;
+    bool wrapped = false;
+
+    for (std::uint64_t frame = 1; frame <= 200; ++frame)
+    {
+        // The GPU runs FramesInFlight frames behind
+        if (FramesInFlight < frame)
+        {
+            descriptors.reclaim(frame - FramesInFlight);
+        }
+
+        while (!inFlight.empty() && inFlight.front().fenceValue + FramesInFlight <= frame)
+        {
+            inFlight.pop_front();
+        }
+
+        Frame current = { .fenceValue = frame, .ranges = {} };
+        std::uint32_t previousFirst = 0;
+
+        for (std::uint32_t used = 0; used < TransientCapacity / (FramesInFlight + 1);)
+        {
+            const std::uint32_t count = 1 + random() % 24;
+            const auto range = descriptors.allocateTransient(count);
+
+            CHECK(range);
+
+            if (!range)
+            {
+                break;
+            }
+
+            CHECK(range->count == count);
+            CHECK(TransientBase <= range->first);
+            CHECK(range->first + range->count <= Capacity);
+
+            // Every range of the frames still in flight stays untouched
+            for (const auto& pending : inFlight)
+            {
+                for (const auto& other : pending.ranges)
+                {
+                    CHECK(range->first + range->count <= other.first || other.first + other.count <= range->first);
+                }
+            }
+
+            wrapped = wrapped || range->first < previousFirst;
+            previousFirst = range->first;
+
+            current.ranges.push_back(range.value());
+            used += count;
+        }
+
+        descriptors.endFrame(frame);
+        inFlight.push_back(std::move(current));
+    }
+
+    CHECK(wrapped);
+    CHECK(descriptors.stats().transientFailures == 0);
+}
+
+TEST_CASE(DescriptorAllocatorTransientExhaustion)
+{
+    DescriptorAllocator descriptors;
+    CHECK(descriptors.init(128, 64));
+
+    const auto first = descriptors.allocateTransient(48);
+    CHECK(first && first->first == 64);
+
+    // Nothing is handed out past the end of the heap
+    CHECK(!descriptors.allocateTransient(17));
+    CHECK(descriptors.stats().transientFailures == 1);
+    CHECK(descriptors.stats().transientUsed == 48);
+
+    // An empty table needs no slots
+    const auto empty = descriptors.allocateTransient(0);
+    CHECK(empty && empty->count == 0);
+
+    descriptors.endFrame(1);
+    CHECK(!descriptors.allocateTransient(17));
+
+    descriptors.reclaim(1);
+    CHECK(descriptors.stats().transientUsed == 0);
+
+    const auto reused = descriptors.allocateTransient(64);
+    CHECK(reused && reused->first == 64);
+    CHECK(descriptors.stats().transientFailures == 2);
+}
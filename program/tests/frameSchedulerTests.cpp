@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include "frameScheduler.hpp"
+#include "test.hpp"
+
+namespace
+{
+    // GPU that finishes a value once latency more values have been signaled
+    // after it. wait() stands for the CPU blocking until the GPU got there.
+    class FakeTimeline : public GpuTimeline
+    {
+    public:
+
+        explicit FakeTimeline(std::uint64_t latency) : m_latency(latency) {}
+
+        bool signal(std::uint64_t value) override
+        {
+            m_signaled = value;
+            m_completed = std::max(m_completed, m_latency < value ? value - m_latency : 0);
+            return true;
+        }
+
+        std::uint64_t completedValue() override { return m_completed; }
+
+        bool wait(std::uint64_t value) override
+        {
+            ++waits;
+
+            // Waiting for a value never signaled would hang a real queue
+            if (m_signaled < value)
+            {
+                return false;
+            }
+
+            m_completed = std::max(m_completed, value);
+            return true;
+        }
+
+        std::uint64_t waits = 0;
+
+    private:
+
+        std::uint64_t m_latency = 0;
+
+        std::uint64_t m_signaled = 0;
+
+        std::uint64_t m_completed = 0;
+    };
+
+    // Blocks a while in every wait, as a CPU ahead of the GPU would
+    class SlowTimeline : public FakeTimeline
+    {
+    public:
+
+        using FakeTimeline::FakeTimeline;
+
+        bool wait(std::uint64_t value) override
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            return FakeTimeline::wait(value);
+        }
+    };
+}
+
+TEST_CASE(FrameSchedulerRejectsBadInit)
+{
+    FakeTimeline timeline(0);
+    FrameScheduler scheduler;
+
+    CHECK(!scheduler.init(nullptr, 2));
+    CHECK(!scheduler.init(&timeline, 1));
+    CHECK(!scheduler.init(&timeline, FrameScheduler::MaxFramesInFlight + 1));
+    CHECK(scheduler.init(&timeline, 2));
+}
+
+// Frame k signals k + 1 and reuses the context of frame k - framesInFlight,
+// which is done once latency < framesInFlight; beginFrame must block exactly then
+TEST_CASE(FrameSchedulerWaitsOnlyForBusyContext)
+{
+    for (std::uint32_t framesInFlight = 2; framesInFlight <= 3; ++framesInFlight)
+    {
+        for (std::uint64_t latency = 0; latency <= 4; ++latency)
+        {
+            FakeTimeline timeline(latency);
+            FrameScheduler scheduler;
+            CHECK(scheduler.init(&timeline, framesInFlight));
+
+            for (std::uint64_t frame = 0; frame < 20; ++frame)
+            {
+                const auto waitsBefore = scheduler.waitCount();
+                const auto pending = framesInFlight <= frame ? frame - framesInFlight + 1 : 0;
+                const bool busy = timeline.completedValue() < pending;
+
+                const auto context = scheduler.beginFrame();
+
+                CHECK(context && *context == frame % framesInFlight);
+                CHECK(scheduler.waitCount() - waitsBefore == (busy ? 1u : 0u));
+                CHECK(busy == (framesInFlight <= frame && framesInFlight <= latency));
+                CHECK(pending <= timeline.completedValue());
+
+                CHECK(scheduler.endFrame());
+                CHECK(scheduler.submittedValue() == frame + 1);
+            }
+
+            CHECK(timeline.waits == scheduler.waitCount());
+
+            CHECK(scheduler.flush());
+            CHECK(timeline.completedValue() == scheduler.submittedValue());
+        }
+    }
+}
+
+TEST_CASE(FrameSchedulerFlushSkipsIdleGpu)
+{
+    FakeTimeline timeline(0);
+    FrameScheduler scheduler;
+    CHECK(scheduler.init(&timeline, 3));
+
+    CHECK(scheduler.beginFrame());
+    CHECK(scheduler.endFrame());
+    CHECK(scheduler.flush());
+    CHECK(timeline.waits == 0);
+}
+
+// Only frames that had to wait report time, and then at least the blocked time
+TEST_CASE(FrameSchedulerReportsWaitTime)
+{
+    SlowTimeline timeline(4);
+    FrameScheduler scheduler;
+    CHECK(scheduler.init(&timeline, 2));
+
+    for (std::uint64_t frame = 0; frame < 6; ++frame)
+    {
+        const auto waitsBefore = scheduler.waitCount();
+
+        CHECK(scheduler.beginFrame());
+
+        if (scheduler.waitCount() != waitsBefore)
+        {
+            CHECK(2'000'000 <= scheduler.lastWaitNs());
+        }
+        else
+        {
+            CHECK(scheduler.lastWaitNs() == 0);
+        }
+
+        CHECK(scheduler.endFrame());
+    }
+
+    CHECK(scheduler.waitCount() == 4);
+}
@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "frustumCulling.hpp"
+#include "jobSystem.hpp"
+#include "test.hpp"
+
+namespace
+{
+    std::array<float, 16> Multiply(const std::array<float, 16>& a, const std::array<float, 16>& b)
+    {
+        std::array<float, 16> result = {};
+
+        for (std::uint32_t row = 0; row < 4; ++row)
+        {
+            for (std::uint32_t column = 0; column < 4; ++column)
+            {
+                for (std::uint32_t k = 0; k < 4; ++k)
+                {
+                    result[row * 4 + column] += a[row * 4 + k] * b[k * 4 + column];
+                }
+            }
+        }
+
+        return result;
+    }
+
+    // A camera at a random spot turned by a random angle about y, looking
+    // through a D3D-style perspective, row-major for row vectors
+    Frustum RandomFrustum(std::mt19937& random)
+    {
+        std::uniform_real_distribution<float> unit(-1.f, 1.f);
+
+        const float angle = unit(random) * 3.14159265f;
+        const float s = std::sin(angle);
+        const float c = std::cos(angle);
+
+        const float x = unit(random) * 20.f;
+        const float y = unit(random) * 5.f;
+        const float z = unit(random) * 20.f;
+
+        // Inverse of rotate-then-translate
+        const std::array<float, 16> view =
+        {
+            c, 0.f, s, 0.f,
+            0.f, 1.f, 0.f, 0.f,
+            -s, 0.f, c, 0.f,
+            -(x * c - z * s), -y, -(x * s + z * c), 1.f,
+        };
+
+        const float yScale = 1.f / std::tan(0.5f + std::fabs(unit(random)) * 0.4f);
+        const float near = 0.5f;
+        const float far = 100.f + std::fabs(unit(random)) * 100.f;
+        const float zScale = far / (far - near);
+
+        const std::array<float, 16> projection =
+        {
+            yScale / 1.75f, 0.f, 0.f, 0.f,
+            0.f, yScale, 0.f, 0.f,
+            0.f, 0.f, zScale, 1.f,
+            0.f, 0.f, -zScale * near, 0.f,
+        };
+
+        return MakeFrustum(Multiply(view, projection).data());
+    }
+
+    // Scattered all around the camera, so many instances straddle a plane
+    void RandomInstances(std::mt19937& random, std::uint32_t count, InstanceBoundsStore& bounds)
+    {
+        std::uniform_real_distribution<float> unit(-1.f, 1.f);
+
+        bounds.clear();
+        bounds.reserve(count);
+
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            const float center[3] = { unit(random) * 150.f, unit(random) * 40.f, unit(random) * 150.f };
+
+            Aabb box;
+
+            for (std::uint32_t axis = 0; axis < 3; ++axis)
+            {
+                // Some points, mostly small boxes, a few large ones
+                const float extent = i % 13 == 0 ? 0.f : std::fabs(unit(random)) * (i % 7 == 0 ? 30.f : 3.f);
+
+                box.min[axis] = center[axis] - extent;
+                box.max[axis] = center[axis] + extent;
+            }
+
+            bounds.add(MeshBoundsFromBox(box));
+        }
+    }
+
+    std::vector<std::uint32_t> Scalar(const Frustum& frustum, const InstanceBoundsStore& bounds, std::uint32_t begin, std::uint32_t end)
+    {
+        std::vector<std::uint32_t> visible(end - begin);
+
+        visible.resize(CullInstancesScalar(frustum, bounds, begin, end, visible.data()));
+
+        return visible;
+    }
+}
+
+TEST_CASE(CullInstancesMatchesScalar)
+{
+    std::mt19937 random(5);
+
+    InstanceBoundsStore bounds;
+
+    // Counts around the 4- and 8-wide kernels, and ranges that start unaligned
+    const std::uint32_t counts[] = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 12, 15, 16, 17, 23, 31, 33, 63, 65, 100, 1001 };
+
+    for (const auto count : counts)
+    {
+        for (std::uint32_t round = 0; round < 8; ++round)
+        {
+            const auto frustum = RandomFrustum(random);
+
+            const std::uint32_t offset = round % 5;
+
+            RandomInstances(random, count + offset, bounds);
+
+            std::vector<std::uint32_t> visible(count);
+            visible.resize(CullInstances(frustum, bounds, offset, offset + count, visible.data()));
+
+            CHECK(visible == Scalar(frustum, bounds, offset, offset + count));
+            CHECK(std::all_of(visible.begin(), visible.end(), [&](std::uint32_t i) { return offset <= i && i < offset + count; }));
+        }
+    }
+}
+
+TEST_CASE(CullInstancesKeepsBoundaryCases)
+{
+    // Looking down +z from the origin
+    const std::array<float, 16> viewProjection =
+    {
+        1.f, 0.f, 0.f, 0.f,
+        0.f, 1.f, 0.f, 0.f,
+        0.f, 0.f, 1.f, 1.f,
+        0.f, 0.f, -1.f, 0.f,
+    };
+
+    const auto frustum = MakeFrustum(viewProjection.data());
+
+    InstanceBoundsStore bounds;
+
+    // Inside, straddling the near plane, containing the camera, behind it,
+    // beyond the side, straddling the side, a point inside
+    bounds.add(MeshBoundsFromBox({ .min = { -1.f, -1.f, 9.f }, .max = { 1.f, 1.f, 11.f } }));
+    bounds.add(MeshBoundsFromBox({ .min = { -1.f, -1.f, 0.f }, .max = { 1.f, 1.f, 2.f } }));
+    bounds.add(MeshBoundsFromBox({ .min = { -5.f, -5.f, -5.f }, .max = { 5.f, 5.f, 5.f } }));
+    bounds.add(MeshBoundsFromBox({ .min = { -1.f, -1.f, -11.f }, .max = { 1.f, 1.f, -9.f } }));
+    bounds.add(MeshBoundsFromBox({ .min = { 30.f, -1.f, 9.f }, .max = { 32.f, 1.f, 11.f } }));
+    bounds.add(MeshBoundsFromBox({ .min = { 9.f, -1.f, 9.f }, .max = { 12.f, 1.f, 11.f } }));
+    bounds.add(MeshBoundsFromBox({ .min = { 0.f, 0.f, 5.f }, .max = { 0.f, 0.f, 5.f } }));
+
+    const std::vector<std::uint32_t> expected = { 0, 1, 2, 5, 6 };
+
+    CHECK(Scalar(frustum, bounds, 0, bounds.size()) == expected);
+
+    std::vector<std::uint32_t> visible(bounds.size());
+    visible.resize(CullInstances(frustum, bounds, 0, bounds.size(), visible.data()));
+
+    CHECK(visible == expected);
+}
+
+TEST_CASE(FrustumCullerMatchesScalarAcrossChunks)
+{
+    std::mt19937 random(9);
+
+    JobSystem jobs(4);
+    FrustumCuller culler;
+    InstanceBoundsStore bounds;
+
+    constexpr auto Chunk = FrustumCuller::ChunkSize;
+
+    const std::uint32_t counts[] = { 1, 7, Chunk - 1, Chunk, Chunk + 1, Chunk + 3, 2 * Chunk - 1, 2 * Chunk, 2 * Chunk + 5, 3 * Chunk + 1001 };
+
+    for (const auto count : counts)
+    {
+        const auto frustum = RandomFrustum(random);
+
+        RandomInstances(random, count, bounds);
+
+        const auto visible = culler.cull(jobs, frustum, bounds);
+        const std::vector<std::uint32_t> result(visible.begin(), visible.end());
+
+        CHECK(result == Scalar(frustum, bounds, 0, count));
+
+        // Strictly ascending across chunk boundaries
+        CHECK(std::adjacent_find(result.begin(), result.end(), [](std::uint32_t a, std::uint32_t b) { return b <= a; }) == result.end());
+
+        const auto& stats = culler.stats();
+        CHECK(stats.instances == count);
+        CHECK(stats.visible == result.size());
+        CHECK(stats.chunks == (count + Chunk - 1) / Chunk);
+    }
+
+    // A single worker packs the same list
+    JobSystem serial(1);
+    FrustumCuller single;
+
+    const auto frustum = RandomFrustum(random);
+    RandomInstances(random, 2 * Chunk + 17, bounds);
+
+    const auto parallel = culler.cull(jobs, frustum, bounds);
+    const std::vector<std::uint32_t> expected(parallel.begin(), parallel.end());
+    const auto one = single.cull(serial, frustum, bounds);
+
+    CHECK(std::vector<std::uint32_t>(one.begin(), one.end()) == expected);
+
+    // Nothing to cull
+    bounds.clear();
+    CHECK(culler.cull(jobs, frustum, bounds).empty());
+    CHECK(culler.stats().instances == 0);
+}
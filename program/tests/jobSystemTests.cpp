@@ -0,0 +1,91 @@
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "jobSystem.hpp"
+#include "test.hpp"
+
+namespace
+{
+    // Schedules count jobs and waits for all; returns how many ran
+    std::uint32_t RunJobs(JobSystem& jobs, std::uint32_t count)
+    {
+        std::atomic<std::uint32_t> ran = 0;
+        std::vector<JobHandle> handles;
+
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            handles.push_back(jobs.schedule([&ran] { ran.fetch_add(1); }));
+        }
+
+        for (const auto& handle : handles)
+        {
+            jobs.wait(handle);
+        }
+
+        return ran.load();
+    }
+}
+
+// The creating thread keeps deque 0 of every system it created, whatever
+// was created or destroyed on it since
+TEST_CASE(JobSystemOwnerKeepsDequeAcrossSystems)
+{
+    JobSystem first(2);
+
+    CHECK(RunJobs(first, 16) == 16);
+    CHECK(first.stats().shared == 0);
+
+    {
+        JobSystem second(2);
+
+        CHECK(RunJobs(first, 16) == 16);
+        CHECK(RunJobs(second, 16) == 16);
+        CHECK(first.stats().shared == 0);
+        CHECK(second.stats().shared == 0);
+
+        // Destroyed out of creation order as well
+        auto third = std::make_unique<JobSystem>(1);
+        CHECK(RunJobs(*third, 4) == 4);
+
+        JobSystem fourth(1);
+        third.reset();
+
+        CHECK(RunJobs(fourth, 4) == 4);
+        CHECK(fourth.stats().shared == 0);
+    }
+
+    CHECK(RunJobs(first, 16) == 16);
+    CHECK(first.stats().shared == 0);
+}
+
+TEST_CASE(JobSystemOtherThreadsUseSharedQueue)
+{
+    JobSystem jobs(2);
+
+    std::thread([&jobs] { RunJobs(jobs, 8); }).join();
+
+    CHECK(jobs.stats().shared == 8);
+
+    // Jobs scheduled by jobs run on the worker's or the owner's deque
+    std::atomic<std::uint32_t> nested = 0;
+
+    const auto parent = jobs.schedule([&jobs, &nested]
+        {
+            for (std::uint32_t i = 0; i < 8; ++i)
+            {
+                jobs.schedule([&nested] { nested.fetch_add(1); });
+            }
+        });
+
+    jobs.wait(parent);
+
+    while (nested.load() < 8)
+    {
+        std::this_thread::yield();
+    }
+
+    CHECK(jobs.stats().shared == 8);
+}
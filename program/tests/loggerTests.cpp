@@ -0,0 +1,226 @@
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logger.hpp"
+#include "test.hpp"
+
+namespace
+{
+    // A fresh directory under the system temporary one, removed again at the end
+    class TemporaryDirectory
+    {
+    public:
+
+        TemporaryDirectory()
+        {
+            std::random_device random;
+
+            m_path = std::filesystem::temp_directory_path() / ("logger_test_" + std::to_string(random()));
+            std::filesystem::create_directories(m_path);
+        }
+
+        ~TemporaryDirectory()
+        {
+            // Back to the default file, so the logger lets go of the ones in here
+            ClearLog();
+
+            std::error_code error;
+            std::filesystem::remove_all(m_path, error);
+        }
+
+        const std::filesystem::path& path()const { return m_path; }
+
+    private:
+
+        std::filesystem::path m_path;
+    };
+
+    std::string ReadText(const std::filesystem::path& path)
+    {
+        std::ifstream ifs(path, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    }
+
+    std::vector<std::string> Lines(const std::string& text)
+    {
+        std::vector<std::string> lines;
+        std::istringstream stream(text);
+
+        for (std::string line; std::getline(stream, line);)
+        {
+            lines.push_back(line);
+        }
+
+        return lines;
+    }
+
+    // The same calls for both formats, so both see the same sites
+    void WriteSample()
+    {
+        ErrorLog(L"エラーです");
+
+        for (int i = 0; i < 3; ++i)
+        {
+            DebugLog(L"message " + std::to_wstring(i));
+        }
+
+        DebugLog(L"first line\nsecond line\nthird line");
+        DebugLog(std::wstring(Logger::InlineLength + 50, L'x'));
+        DebugLog(L"outside the BMP: \U0001F600");
+        DebugLog(L"");
+    }
+
+    // Adds up the counts in the logger's own reports of dropped messages
+    std::uint64_t ReportedDrops(const std::string& text)
+    {
+        std::uint64_t total = 0;
+
+        for (const auto& line : Lines(text))
+        {
+            const auto site = line.find("logger.cpp(");
+
+            if (site == std::string::npos)
+            {
+                continue;
+            }
+
+            const auto digits = line.find_first_of("0123456789", line.find(") : ", site));
+
+            if (digits != std::string::npos)
+            {
+                total += std::stoull(line.substr(digits));
+            }
+        }
+
+        return total;
+    }
+}
+
+TEST_CASE(BinaryLogDecodesToTextFormat)
+{
+    TemporaryDirectory directory;
+
+    const auto binaryPath = directory.path() / "log.bin";
+    const auto textPath = directory.path() / "log.txt";
+
+    auto& logger = Logger::instance();
+
+    CHECK(logger.open(binaryPath, LogFormat::Binary));
+    WriteSample();
+    logger.flush();
+
+    CHECK(logger.open(textPath, LogFormat::Text));
+    WriteSample();
+    logger.flush();
+
+    std::ostringstream decoded;
+    CHECK(DecodeBinaryLog(binaryPath, decoded));
+
+    const auto text = ReadText(textPath);
+    const auto textLines = Lines(text);
+    const auto decodedLines = Lines(decoded.str());
+
+    // Errors and debug messages, one entry a call plus two continuation lines
+    CHECK(textLines.size() == 10);
+    CHECK(textLines.front().starts_with("[ERROR] |> loggerTests.cpp("));
+    CHECK(textLines[1].starts_with("[LOG]   |> loggerTests.cpp("));
+    CHECK(textLines[5] == "        |> second line");
+    CHECK(text.find(std::string(Logger::InlineLength + 50, 'x')) != std::string::npos);
+    CHECK(text.find("\xF0\x9F\x98\x80") != std::string::npos);
+
+    // Every entry gains a time and thread prefix; continuation lines do not
+    CHECK(decodedLines.size() == textLines.size());
+
+    double previousTime = 0.;
+
+    for (std::size_t i = 0; i < decodedLines.size() && i < textLines.size(); ++i)
+    {
+        const auto& line = decodedLines[i];
+
+        if (line.starts_with("        |> "))
+        {
+            CHECK(line == textLines[i]);
+            continue;
+        }
+
+        const auto tag = line.find('[');
+        CHECK(tag != std::string::npos && line.substr(tag) == textLines[i]);
+
+        const auto time = std::stod(line);
+        CHECK(previousTime <= time);
+        previousTime = time;
+
+        CHECK(line.find(" ms  thread ") != std::string::npos);
+    }
+
+    // Not a binary log
+    std::ostringstream ignored;
+    CHECK(!DecodeBinaryLog(textPath, ignored));
+    CHECK(!DecodeBinaryLog(directory.path() / "missing.bin", ignored));
+
+    // A record cut short by a crash is left out
+    const auto binary = ReadText(binaryPath);
+    {
+        std::ofstream ofs(binaryPath, std::ios::binary | std::ios::trunc);
+        ofs.write(binary.data(), static_cast<std::streamsize>(binary.size() - 3));
+    }
+
+    std::ostringstream truncated;
+    CHECK(DecodeBinaryLog(binaryPath, truncated));
+    CHECK(Lines(truncated.str()).size() == decodedLines.size() - 1);
+}
+
+TEST_CASE(LoggerWritesDropReportWithoutFurtherMessages)
+{
+    TemporaryDirectory directory;
+
+    const auto path = directory.path() / "log.txt";
+
+    auto& logger = Logger::instance();
+
+    CHECK(logger.open(path));
+
+    const auto before = logger.stats().dropped;
+
+    // Far more than the ring holds, faster than the writer empties it
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([]
+        {
+            for (std::uint32_t i = 0; i < 4 * Logger::SlotCount; ++i)
+            {
+                DebugLog(L"burst");
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    logger.flush();
+
+    const auto dropped = logger.stats().dropped - before;
+
+    // Nothing else is logged, so the report has to reach the file on its own
+    auto reported = ReportedDrops(ReadText(path));
+
+    for (int i = 0; i < 200 && reported < dropped; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        reported = ReportedDrops(ReadText(path));
+    }
+
+    CHECK(reported == dropped);
+}
@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "mesh.hpp"
+#include "meshOptimizer.hpp"
+#include "meshSimplifier.hpp"
+#include "test.hpp"
+#include "vertexQuantization.hpp"
+
+namespace
+{
+    // Bumpy grid whose coordinates are multiples of 1/8, exact in half precision
+    void MakeTerrain(std::uint32_t size, std::vector<float>& positions, std::vector<std::uint32_t>& indices)
+    {
+        positions.clear();
+        indices.clear();
+
+        for (std::uint32_t z = 0; z < size; ++z)
+        {
+            for (std::uint32_t x = 0; x < size; ++x)
+            {
+                positions.insert(positions.end(), { x / 4.f, static_cast<float>(x * z % 5) / 8.f, z / 4.f });
+            }
+        }
+
+        for (std::uint32_t z = 0; z + 1 < size; ++z)
+        {
+            for (std::uint32_t x = 0; x + 1 < size; ++x)
+            {
+                const std::uint32_t a = z * size + x;
+                const std::uint32_t b = a + size;
+
+                indices.insert(indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+            }
+        }
+    }
+
+    std::vector<std::array<std::uint32_t, 3>> SortedTriangles(const std::vector<std::uint32_t>& indices)
+    {
+        std::vector<std::array<std::uint32_t, 3>> triangles;
+
+        for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            // Rotated so the smallest index is first, keeping the winding
+            std::array<std::uint32_t, 3> t = { indices[i], indices[i + 1], indices[i + 2] };
+            std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+            triangles.push_back(t);
+        }
+
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    }
+}
+
+TEST_CASE(VertexCacheOrderKeepsTriangles)
+{
+    std::vector<float> positions;
+    std::vector<std::uint32_t> indices;
+    MakeTerrain(33, positions, indices);
+
+    const auto vertexCount = static_cast<std::uint32_t>(positions.size() / 3);
+
+    // Shuffled triangles are close to the worst case of 3 misses each
+    std::vector<std::uint32_t> shuffled;
+    std::vector<std::uint32_t> order(indices.size() / 3);
+
+    for (std::uint32_t i = 0; i < order.size(); ++i)
+    {
+        order[i] = i;
+    }
+
+    std::shuffle(order.begin(), order.end(), std::mt19937(1));
+
+    for (const auto t : order)
+    {
+        shuffled.insert(shuffled.end(), { indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2] });
+    }
+
+    const auto optimized = OptimizeVertexCache(shuffled, vertexCount);
+
+    CHECK(SortedTriangles(optimized) == SortedTriangles(shuffled));
+    CHECK(AnalyzeVertexCache(optimized, vertexCount).acmr < 0.8);
+    CHECK(2.5 < AnalyzeVertexCache(shuffled, vertexCount).acmr);
+}
+
+// Positions packed as Half4 must order and simplify exactly like the same
+// positions as float3, as long as half precision holds them exactly
+TEST_CASE(OptimizerReadsLayoutPosition)
+{
+    std::vector<float> positions;
+    std::vector<std::uint32_t> indices;
+    MakeTerrain(17, positions, indices);
+
+    const auto vertexCount = static_cast<std::uint32_t>(positions.size() / 3);
+
+    const std::vector<float> normals(positions.size(), 0.f);
+    const std::vector<float> uvs(vertexCount * 2, 0.f);
+    const auto packed = PackVertices(positions.data(), normals.data(), uvs.data(), vertexCount);
+
+    const auto floatData = reinterpret_cast<const std::uint8_t*>(positions.data());
+    const auto packedData = reinterpret_cast<const std::uint8_t*>(packed.data());
+    const auto packedPosition = VertexLayoutPosition<PackedVertex>();
+
+    CHECK(packedPosition.format == VertexFormat::Half4);
+
+    const auto cached = OptimizeVertexCache(indices, vertexCount);
+
+    CHECK(OptimizeOverdraw(cached, floatData, sizeof(float) * 3, {}, 16) ==
+        OptimizeOverdraw(cached, packedData, sizeof(PackedVertex), packedPosition, 16));
+
+    const MeshLodSettings settings = { .maxLevels = 4, .maxError = 1.f, .minTriangles = 8 };
+
+    const auto floatChain = BuildLodChain(indices, floatData, sizeof(float) * 3, vertexCount, {}, settings);
+    const auto packedChain = BuildLodChain(indices, packedData, sizeof(PackedVertex), vertexCount, packedPosition, settings);
+
+    CHECK(1 < floatChain.levels.size());
+    CHECK(floatChain.indices == packedChain.indices);
+    CHECK(floatChain.levels.size() == packedChain.levels.size());
+
+    for (std::size_t level = 0; level < std::min(floatChain.levels.size(), packedChain.levels.size()); ++level)
+    {
+        CHECK(floatChain.levels[level].error == packedChain.levels[level].error);
+    }
+}
+
+// A stray index would otherwise write past the optimizer's per-vertex arrays
+TEST_CASE(OptimizerRejectsOutOfRangeIndices)
+{
+    std::vector<float> positions;
+    std::vector<std::uint32_t> indices;
+    MakeTerrain(5, positions, indices);
+
+    const auto vertexCount = static_cast<std::uint32_t>(positions.size() / 3);
+
+    CHECK(ValidateIndices(indices, vertexCount));
+    CHECK(ValidateIndices({}, 0));
+
+    indices[7] = vertexCount;
+    CHECK(!ValidateIndices(indices, vertexCount));
+
+    indices[7] = 0xffffffff;
+    CHECK(!ValidateIndices(indices, vertexCount));
+
+    // Rejected before anything is optimized or uploaded
+    std::vector<std::array<float, 3>> vertices(vertexCount);
+    MeshOptimizeReport report;
+    report.verticesBefore = 12345;
+
+    Mesh mesh;
+    CHECK(!mesh.initOptimized(vertices, indices, {}, &report));
+    CHECK(mesh.id() == 0);
+    CHECK(report.verticesBefore == 12345);
+}
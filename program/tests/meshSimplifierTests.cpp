@@ -0,0 +1,373 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "meshSimplifier.hpp"
+#include "test.hpp"
+
+namespace
+{
+    struct SeamVertex
+    {
+        float position[3] = {};
+
+        float uv[2] = {};
+    };
+
+    // Smooth hills over a size x size grid of unit cells facing +y. With seam,
+    // the middle column exists twice with different uvs, one copy per half.
+    void MakeHills(std::uint32_t size, bool seam, std::vector<SeamVertex>& vertices, std::vector<std::uint32_t>& indices)
+    {
+        vertices.clear();
+        indices.clear();
+
+        const std::uint32_t middle = size / 2;
+
+        const auto height = [](std::uint32_t x, std::uint32_t z)
+        {
+            return std::sin(x * 0.35f) * std::cos(z * 0.3f) * 1.5f;
+        };
+
+        // Left copy of every vertex, then the right copies of the middle column
+        std::vector<std::uint32_t> right((size + 1) * (size + 1));
+
+        for (std::uint32_t z = 0; z <= size; ++z)
+        {
+            for (std::uint32_t x = 0; x <= size; ++x)
+            {
+                right[z * (size + 1) + x] = static_cast<std::uint32_t>(vertices.size());
+                vertices.push_back({ .position = { static_cast<float>(x), height(x, z), static_cast<float>(z) }, .uv = { 0.f, 0.f } });
+            }
+        }
+
+        if (seam)
+        {
+            for (std::uint32_t z = 0; z <= size; ++z)
+            {
+                right[z * (size + 1) + middle] = static_cast<std::uint32_t>(vertices.size());
+                vertices.push_back({ .position = { static_cast<float>(middle), height(middle, z), static_cast<float>(z) }, .uv = { 1.f, 0.f } });
+            }
+        }
+
+        for (std::uint32_t z = 0; z < size; ++z)
+        {
+            for (std::uint32_t x = 0; x < size; ++x)
+            {
+                // Cells right of the seam use the right copies
+                const auto vertex = [&](std::uint32_t vx, std::uint32_t vz)
+                {
+                    const auto i = vz * (size + 1) + vx;
+                    return middle <= x ? right[i] : i;
+                };
+
+                const auto a = vertex(x, z);
+                const auto b = vertex(x + 1, z);
+                const auto c = vertex(x, z + 1);
+                const auto d = vertex(x + 1, z + 1);
+
+                // Counterclockwise seen from above
+                indices.insert(indices.end(), { a, c, b, b, c, d });
+            }
+        }
+    }
+
+    std::vector<std::uint32_t> Simplify(const std::vector<SeamVertex>& vertices, const std::vector<std::uint32_t>& indices,
+        std::uint32_t targetIndexCount, float maxError, float* error = nullptr)
+    {
+        return SimplifyMesh(indices, reinterpret_cast<const std::uint8_t*>(vertices.data()), sizeof(SeamVertex),
+            static_cast<std::uint32_t>(vertices.size()), {}, targetIndexCount, maxError, error);
+    }
+
+    // y of the triangle normal, positive when it faces up
+    float NormalY(const std::vector<SeamVertex>& vertices, std::uint32_t a, std::uint32_t b, std::uint32_t c)
+    {
+        const auto& pa = vertices[a].position;
+        const auto& pb = vertices[b].position;
+        const auto& pc = vertices[c].position;
+
+        return (pc[0] - pa[0]) * (pb[2] - pa[2]) - (pc[2] - pa[2]) * (pb[0] - pa[0]);
+    }
+
+    // Area of the triangles seen from above; the whole square when nothing
+    // overlaps, flips or opens up
+    float ProjectedArea(const std::vector<SeamVertex>& vertices, const std::vector<std::uint32_t>& indices)
+    {
+        float area = 0.f;
+
+        for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            area += NormalY(vertices, indices[i], indices[i + 1], indices[i + 2]) * 0.5f;
+        }
+
+        return area;
+    }
+
+    // Border edges of the mesh with vertices welded by position, as pairs of grid points
+    std::vector<std::pair<std::array<float, 2>, std::array<float, 2>>> WeldedBorder(const std::vector<SeamVertex>& vertices,
+        const std::vector<std::uint32_t>& indices)
+    {
+        std::map<std::pair<std::array<float, 2>, std::array<float, 2>>, int> edges;
+
+        const auto point = [&](std::uint32_t v) { return std::array<float, 2>{ vertices[v].position[0], vertices[v].position[2] }; };
+
+        for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            for (std::uint32_t e = 0; e < 3; ++e)
+            {
+                const auto a = point(indices[i + e]);
+                const auto b = point(indices[i + (e + 1) % 3]);
+
+                // The same edge once in each direction cancels out
+                if (edges.count({ b, a }))
+                {
+                    if (--edges[{ b, a }] == 0)
+                    {
+                        edges.erase({ b, a });
+                    }
+                }
+                else
+                {
+                    ++edges[{ a, b }];
+                }
+            }
+        }
+
+        std::vector<std::pair<std::array<float, 2>, std::array<float, 2>>> border;
+
+        for (const auto& [edge, count] : edges)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                border.push_back(edge);
+            }
+        }
+
+        return border;
+    }
+
+    bool OnOutline(const std::array<float, 2>& a, const std::array<float, 2>& b, float size)
+    {
+        for (std::uint32_t axis = 0; axis < 2; ++axis)
+        {
+            for (const float side : { 0.f, size })
+            {
+                if (a[axis] == side && b[axis] == side)
+                {
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+}
+
+TEST_CASE(SimplifierKeepsOpenBorders)
+{
+    constexpr std::uint32_t Size = 32;
+
+    std::vector<SeamVertex> vertices;
+    std::vector<std::uint32_t> indices;
+    MakeHills(Size, false, vertices, indices);
+
+    float error = 0.f;
+    const auto simplified = Simplify(vertices, indices, static_cast<std::uint32_t>(indices.size() / 8), 10.f, &error);
+
+    CHECK(simplified.size() < indices.size() / 4);
+    CHECK(simplified.size() % 3 == 0);
+    CHECK(0.f < error);
+
+    // Still covers the whole square, and the border stays on its outline
+    CHECK(std::fabs(ProjectedArea(vertices, simplified) - Size * Size) < 1e-3f);
+
+    const auto border = WeldedBorder(vertices, simplified);
+    CHECK(!border.empty());
+    CHECK(std::all_of(border.begin(), border.end(), [&](const auto& edge) { return OnOutline(edge.first, edge.second, Size); }));
+
+    // The corners cannot go anywhere
+    std::set<std::uint32_t> used(simplified.begin(), simplified.end());
+
+    for (const std::uint32_t corner : { 0u, Size, Size * (Size + 1), (Size + 1) * (Size + 1) - 1 })
+    {
+        CHECK(used.count(corner) == 1);
+    }
+}
+
+TEST_CASE(SimplifierKeepsAttributeSeams)
+{
+    constexpr std::uint32_t Size = 32;
+
+    std::vector<SeamVertex> vertices;
+    std::vector<std::uint32_t> indices;
+    MakeHills(Size, true, vertices, indices);
+
+    const auto simplified = Simplify(vertices, indices, static_cast<std::uint32_t>(indices.size() / 8), 10.f);
+
+    CHECK(simplified.size() < indices.size() / 2);
+
+    // Both copies of every seam vertex are still there
+    std::set<std::uint32_t> used(simplified.begin(), simplified.end());
+
+    for (std::uint32_t z = 0; z <= Size; ++z)
+    {
+        CHECK(used.count(z * (Size + 1) + Size / 2) == 1);
+        CHECK(used.count((Size + 1) * (Size + 1) + z) == 1);
+    }
+
+    // Each half only references its own copies
+    const auto seamBase = (Size + 1) * (Size + 1);
+
+    for (std::size_t i = 0; i + 2 < simplified.size(); i += 3)
+    {
+        bool left = false;
+        bool right = false;
+
+        for (std::uint32_t k = 0; k < 3; ++k)
+        {
+            const auto v = simplified[i + k];
+            const float x = vertices[v].position[0];
+
+            left = left || x < Size / 2 || (x == Size / 2 && v < seamBase);
+            right = right || Size / 2 < x || seamBase <= v;
+        }
+
+        CHECK(!(left && right));
+    }
+
+    // Welded, the seam closes without cracks and the outline is the only border
+    CHECK(std::fabs(ProjectedArea(vertices, simplified) - Size * Size) < 1e-3f);
+
+    const auto border = WeldedBorder(vertices, simplified);
+    CHECK(std::all_of(border.begin(), border.end(), [&](const auto& edge) { return OnOutline(edge.first, edge.second, Size); }));
+}
+
+TEST_CASE(SimplifierNeverFlipsTriangles)
+{
+    std::vector<SeamVertex> vertices;
+    std::vector<std::uint32_t> indices;
+
+    for (const bool seam : { false, true })
+    {
+        MakeHills(40, seam, vertices, indices);
+
+        // Every step from light to as far as the error allows
+        for (const std::uint32_t divisor : { 2u, 4u, 16u, 64u, 1000u })
+        {
+            const auto simplified = Simplify(vertices, indices, static_cast<std::uint32_t>(indices.size() / divisor), 100.f);
+
+            // A flipped triangle would face down; triangles may end up on edge, but
+            // then the rest still covers the square exactly once
+            bool facingDown = false;
+
+            for (std::size_t i = 0; i + 2 < simplified.size(); i += 3)
+            {
+                facingDown = facingDown || NormalY(vertices, simplified[i], simplified[i + 1], simplified[i + 2]) < 0.f;
+            }
+
+            CHECK(!facingDown);
+            CHECK(std::fabs(ProjectedArea(vertices, simplified) - 40.f * 40.f) < 1e-2f);
+        }
+    }
+}
+
+TEST_CASE(LodChainShrinksEveryLevel)
+{
+    std::vector<SeamVertex> vertices;
+    std::vector<std::uint32_t> indices;
+    MakeHills(48, true, vertices, indices);
+
+    const MeshLodSettings settings = { .maxLevels = MaxMeshLods, .reduction = 0.5f, .maxError = 0.2f, .minTriangles = 32 };
+
+    const auto chain = BuildLodChain(indices, reinterpret_cast<const std::uint8_t*>(vertices.data()), sizeof(SeamVertex),
+        static_cast<std::uint32_t>(vertices.size()), {}, settings);
+
+    CHECK(3 <= chain.levels.size());
+    CHECK(chain.levels.size() <= MaxMeshLods);
+
+    // Level 0 is the input untouched
+    CHECK(chain.levels[0].indexOffset == 0);
+    CHECK(chain.levels[0].error == 0.f);
+    CHECK(std::equal(indices.begin(), indices.end(), chain.indices.begin(), chain.indices.begin() + chain.levels[0].indexCount));
+
+    const float diagonal = std::sqrt(48.f * 48.f * 2.f + 3.f * 3.f);
+
+    for (std::size_t i = 1; i < chain.levels.size(); ++i)
+    {
+        const auto& previous = chain.levels[i - 1];
+        const auto& level = chain.levels[i];
+
+        // At least a tenth fewer triangles each time, errors only grow
+        CHECK(level.indexCount % 3 == 0);
+        CHECK(level.indexCount * 10 <= previous.indexCount * 9);
+        CHECK(settings.minTriangles * 3 <= level.indexCount);
+        CHECK(previous.error <= level.error);
+        CHECK(level.error <= settings.maxError * diagonal);
+        CHECK(level.indexOffset == previous.indexOffset + previous.indexCount);
+    }
+
+    CHECK(chain.levels.back().indexOffset + chain.levels.back().indexCount == chain.indices.size());
+
+    // One level asked for, one level built
+    const auto single = BuildLodChain(indices, reinterpret_cast<const std::uint8_t*>(vertices.data()), sizeof(SeamVertex),
+        static_cast<std::uint32_t>(vertices.size()), {}, {});
+
+    CHECK(single.levels.size() == 1);
+    CHECK(single.indices == indices);
+}
+
+TEST_CASE(SelectLodPicksCoarsestWithinBudget)
+{
+    // 90 degree field of view on a 1000 pixel high viewport
+    const float projection[16] =
+    {
+        1.f, 0.f, 0.f, 0.f,
+        0.f, 1.f, 0.f, 0.f,
+        0.f, 0.f, 1.f, 1.f,
+        0.f, 0.f, -0.1f, 0.f,
+    };
+
+    const float scale = LodProjectionScale(projection, 1000.f);
+    CHECK(scale == 500.f);
+
+    const MeshLod levels[] =
+    {
+        { .indexOffset = 0, .indexCount = 3000, .error = 0.f },
+        { .indexOffset = 3000, .indexCount = 1500, .error = 0.01f },
+        { .indexOffset = 4500, .indexCount = 700, .error = 0.04f },
+        { .indexOffset = 5200, .indexCount = 300, .error = 0.2f },
+    };
+
+    constexpr float Budget = 1.f;
+
+    for (float distance = 0.f; distance < 200.f; distance += 0.37f)
+    {
+        // The last level whose projected error fits
+        std::uint32_t expected = 0;
+
+        for (std::uint32_t i = 0; i < std::size(levels); ++i)
+        {
+            if (levels[i].error * scale / std::max(distance, 1e-6f) <= Budget)
+            {
+                expected = i;
+            }
+        }
+
+        CHECK(SelectLod(levels, distance, scale, Budget) == expected);
+    }
+
+    // An error of exactly one pixel still fits: 0.04 * 500 / 20 == 1
+    CHECK(SelectLod(levels, 20.f, scale, Budget) == 2);
+    CHECK(SelectLod(levels, 0.f, scale, Budget) == 0);
+    CHECK(SelectLod(levels, 1e6f, scale, Budget) == 3);
+    CHECK(SelectLod(std::span(levels, 1), 1e6f, scale, Budget) == 0);
+
+    // A bigger budget allows coarser levels at the same distance
+    CHECK(SelectLod(levels, 10.f, scale, 0.5f) == 1);
+    CHECK(SelectLod(levels, 10.f, scale, 2.f) == 2);
+    CHECK(SelectLod(levels, 10.f, scale, 10.f) == 3);
+}
@@ -0,0 +1,202 @@
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "dx.hpp"
+#include "mesh.hpp"
+#include "nullBackend.hpp"
+#include "shaderPipeline.hpp"
+#include "test.hpp"
+
+namespace
+{
+    struct TestVertex
+    {
+        float position[3];
+    };
+
+    struct TestInstance
+    {
+        float offset[4];
+    };
+}
+
+template<>
+struct VertexLayout<TestVertex>
+{
+    static constexpr std::array attributes = { VertexAttribute{ "POSITION", 0, VertexFormat::Float3, 0 } };
+};
+
+template<>
+struct VertexLayout<TestInstance>
+{
+    static constexpr std::array attributes = { VertexAttribute{ "TEXCOORD", 0, VertexFormat::Float4, 0 } };
+};
+
+namespace
+{
+    // Meshes create their buffers through Dx, which is initialized once per process
+    bool InitDx()
+    {
+        static const bool initialized = Dx::instance().init(std::make_unique<NullBackend>(), { .width = 64, .height = 64 });
+        return initialized;
+    }
+
+    bool InitTriangle(Mesh& mesh)
+    {
+        const std::vector<TestVertex> vertices = { { { 0.f, 0.f, 0.f } }, { { 1.f, 0.f, 0.f } }, { { 0.f, 1.f, 0.f } } };
+        const std::vector<std::uint32_t> indices = { 0, 1, 2 };
+
+        return mesh.init(vertices, indices);
+    }
+}
+
+TEST_CASE(MeshIdsAreUniqueAndReused)
+{
+    CHECK(InitDx());
+
+    Mesh a, b;
+    CHECK(a.id() == 0);
+
+    CHECK(InitTriangle(a));
+    CHECK(InitTriangle(b));
+    CHECK(a.id() != 0 && b.id() != 0 && a.id() != b.id());
+    CHECK(a.id() < MaxMeshIds && b.id() < MaxMeshIds);
+
+    // Moving carries the id along and leaves none behind
+    const auto id = a.id();
+    Mesh moved(std::move(a));
+    CHECK(moved.id() == id);
+    CHECK(a.id() == 0);
+
+    Mesh assigned;
+    assigned = std::move(moved);
+    CHECK(assigned.id() == id);
+    CHECK(moved.id() == 0);
+
+    // A released id goes to the next mesh, so ids stay dense
+    assigned.release();
+    CHECK(assigned.id() == 0);
+
+    Mesh c;
+    CHECK(InitTriangle(c));
+    CHECK(c.id() == id);
+
+    // Initializing again keeps the mesh unique
+    CHECK(InitTriangle(b));
+    CHECK(b.id() != c.id() && b.id() != 0);
+}
+
+TEST_CASE(MeshRejectsZeroVertexStride)
+{
+    CHECK(InitDx());
+
+    const std::vector<float> positions = { 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 1.f, 0.f };
+    const std::vector<std::uint32_t> indices = { 0, 1, 2 };
+
+    Mesh mesh;
+    CHECK(!mesh.init(std::as_bytes(std::span(positions)), 0, std::as_bytes(std::span(indices)), IndexFormat::Uint32));
+    CHECK(mesh.id() == 0);
+    CHECK(mesh.verticesCount() == 0);
+}
+
+// Each mesh is a batch of its own, whatever ids the backend gave its buffers
+TEST_CASE(SubmitBatchesByMesh)
+{
+    CHECK(InitDx());
+
+    Mesh a, b;
+    CHECK(InitTriangle(a));
+    CHECK(InitTriangle(b));
+
+    ShaderPipeline pipeline;
+    auto& dx = Dx::instance();
+
+    const auto before = dx.drawQueueStats();
+
+    for (std::uint32_t i = 0; i < 4; ++i)
+    {
+        dx.submit(pipeline, a);
+        dx.submit(pipeline, b);
+    }
+
+    CHECK(dx.flushDraws());
+
+    const auto after = dx.drawQueueStats();
+    CHECK(after.itemsIn - before.itemsIn == 8);
+    CHECK(after.drawsOut - before.drawsOut == 2);
+}
+
+// Instance data is read from the frame's transient memory, so flushing creates no buffers
+TEST_CASE(InstancedDrawsUseTransientMemory)
+{
+    CHECK(InitDx());
+
+    Mesh mesh;
+    CHECK(InitTriangle(mesh));
+
+    ShaderPipeline pipeline;
+    CHECK((pipeline.init<TestVertex, TestInstance>(L"vs.hlsl", L"ps.hlsl")));
+
+    auto& dx = Dx::instance();
+    const auto& backend = static_cast<const NullBackend&>(dx.backend());
+
+    const auto before = backend.stats();
+
+    for (std::uint32_t frame = 0; frame < 4; ++frame)
+    {
+        CHECK(dx.frameBegin());
+
+        for (std::uint32_t i = 0; i < 16; ++i)
+        {
+            const TestInstance instance = { { static_cast<float>(i), 0.f, 0.f, 0.f } };
+            dx.submit(pipeline, mesh, std::as_bytes(std::span(&instance, 1)));
+        }
+
+        CHECK(dx.flushDraws());
+        CHECK(dx.frameEnd());
+    }
+
+    const auto after = backend.stats();
+    CHECK(after.buffersCreated == before.buffersCreated);
+    CHECK(after.draws - before.draws == 4);
+    CHECK(after.instances - before.instances == 64);
+    CHECK(after.validationErrors == before.validationErrors);
+}
+
+// Backends without parallel recording run the workers inline, which must not
+// leave the last worker's pipeline bound for the draws that follow
+TEST_CASE(DrawParallelKeepsPipelineBound)
+{
+    CHECK(InitDx());
+
+    Mesh mesh;
+    CHECK(InitTriangle(mesh));
+
+    ShaderPipeline before, worker;
+    CHECK(before.init<TestVertex>(L"vs.hlsl", L"ps.hlsl"));
+    CHECK(worker.init<TestVertex>(L"vs.hlsl", L"worker.hlsl"));
+    CHECK(!(before.handle() == worker.handle()));
+
+    auto& dx = Dx::instance();
+    const auto& backend = static_cast<const NullBackend&>(dx.backend());
+
+    const auto validationErrors = backend.stats().validationErrors;
+
+    CHECK(dx.frameBegin());
+
+    dx.setPipeline(before);
+    dx.draw(mesh);
+
+    const std::vector<DrawItem> items(8, { .pipeline = &worker, .mesh = &mesh, .lod = 0 });
+    CHECK(dx.drawParallel(items, 4));
+
+    CHECK(backend.boundPipeline() == before.handle());
+
+    dx.draw(mesh);
+    CHECK(dx.frameEnd());
+
+    CHECK(backend.stats().validationErrors == validationErrors);
+}
@@ -0,0 +1,447 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "jobSystem.hpp"
+#include "occlusionCulling.hpp"
+#include "test.hpp"
+
+namespace
+{
+    // D3D-style perspective, 16:9, near 1, far 200, row-major for row vectors
+    std::array<float, 16> ViewProjection()
+    {
+        constexpr float FovY = 1.2f;
+        constexpr float Aspect = 16.f / 9.f;
+        constexpr float Near = 1.f;
+        constexpr float Far = 200.f;
+
+        const float yScale = 1.f / std::tan(FovY / 2.f);
+        const float zScale = Far / (Far - Near);
+
+        return
+        {
+            yScale / Aspect, 0.f, 0.f, 0.f,
+            0.f, yScale, 0.f, 0.f,
+            0.f, 0.f, zScale, 1.f,
+            0.f, 0.f, -zScale * Near, 0.f,
+        };
+    }
+
+    Aabb Box(float x, float y, float z, float extent)
+    {
+        return { .min = { x - extent, y - extent, z - extent }, .max = { x + extent, y + extent, z + extent } };
+    }
+
+    OccluderMesh MakeMesh(std::span<const float> positions, std::span<const std::uint32_t> indices)
+    {
+        OccluderMesh mesh;
+
+        CHECK(mesh.init(std::as_bytes(positions), 3 * sizeof(float), std::as_bytes(indices), IndexFormat::Uint32));
+
+        return mesh;
+    }
+
+    // A 60 x 40 wall facing the camera at z = 50
+    constexpr float WallPositions[] = { -30.f, -20.f, 50.f, 30.f, -20.f, 50.f, 30.f, 20.f, 50.f, -30.f, 20.f, 50.f };
+
+    // Straightforward scalar rasterizer sampling pixel centers, without clipping;
+    // every vertex must be in front of the near plane
+    class ReferenceRasterizer
+    {
+    public:
+
+        ReferenceRasterizer(std::uint32_t width, std::uint32_t height, const float* viewProjection)
+            : m_width(static_cast<std::int32_t>(width))
+            , m_height(static_cast<std::int32_t>(height))
+            , m_viewProjection(viewProjection)
+            , m_depth(width * height, 1.f)
+        {}
+
+        // Calls pixel(x, y, z) for every covered pixel center, either winding
+        template<typename PixelFunc>
+        void rasterize(const float* a, const float* b, const float* c, PixelFunc pixel)const
+        {
+            const float* vertices[3] = { a, b, c };
+
+            float screen[3][3];
+
+            for (int i = 0; i < 3; ++i)
+            {
+                float clip[4];
+
+                for (int j = 0; j < 4; ++j)
+                {
+                    clip[j] = vertices[i][0] * m_viewProjection[j] + vertices[i][1] * m_viewProjection[4 + j] +
+                        vertices[i][2] * m_viewProjection[8 + j] + m_viewProjection[12 + j];
+                }
+
+                screen[i][0] = (clip[0] / clip[3] * 0.5f + 0.5f) * m_width;
+                screen[i][1] = (0.5f - clip[1] / clip[3] * 0.5f) * m_height;
+                screen[i][2] = clip[2] / clip[3];
+            }
+
+            const float area = (screen[1][0] - screen[0][0]) * (screen[2][1] - screen[0][1]) -
+                (screen[1][1] - screen[0][1]) * (screen[2][0] - screen[0][0]);
+
+            if (std::fabs(area) < 1e-9f)
+            {
+                return;
+            }
+
+            const auto minX = std::max(0, static_cast<std::int32_t>(std::floor(std::min({ screen[0][0], screen[1][0], screen[2][0] }))));
+            const auto maxX = std::min(m_width - 1, static_cast<std::int32_t>(std::ceil(std::max({ screen[0][0], screen[1][0], screen[2][0] }))));
+            const auto minY = std::max(0, static_cast<std::int32_t>(std::floor(std::min({ screen[0][1], screen[1][1], screen[2][1] }))));
+            const auto maxY = std::min(m_height - 1, static_cast<std::int32_t>(std::ceil(std::max({ screen[0][1], screen[1][1], screen[2][1] }))));
+
+            for (auto y = minY; y <= maxY; ++y)
+            {
+                for (auto x = minX; x <= maxX; ++x)
+                {
+                    const float px = x + 0.5f;
+                    const float py = y + 0.5f;
+
+                    float weights[3];
+
+                    for (int i = 0; i < 3; ++i)
+                    {
+                        const auto& p = screen[(i + 1) % 3];
+                        const auto& q = screen[(i + 2) % 3];
+
+                        weights[i] = ((q[0] - p[0]) * (py - p[1]) - (q[1] - p[1]) * (px - p[0])) / area;
+                    }
+
+                    if (0.f <= weights[0] && 0.f <= weights[1] && 0.f <= weights[2])
+                    {
+                        pixel(x, y, weights[0] * screen[0][2] + weights[1] * screen[1][2] + weights[2] * screen[2][2]);
+                    }
+                }
+            }
+        }
+
+        void drawOccluder(const float* a, const float* b, const float* c)
+        {
+            rasterize(a, b, c, [&](std::int32_t x, std::int32_t y, float z)
+                {
+                    auto& depth = m_depth[y * m_width + x];
+                    depth = std::min(depth, z);
+                });
+        }
+
+        // Whether any face of the box is in front of the occluders somewhere
+        bool boxVisible(const Aabb& box)const
+        {
+            static constexpr int Faces[6][4] = { { 0, 1, 3, 2 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 }, { 2, 3, 7, 6 }, { 0, 2, 6, 4 }, { 1, 3, 7, 5 } };
+
+            float corners[8][3];
+
+            for (int k = 0; k < 8; ++k)
+            {
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    corners[k][axis] = (k >> axis) & 1 ? box.max[axis] : box.min[axis];
+                }
+            }
+
+            bool visible = false;
+
+            for (const auto& face : Faces)
+            {
+                for (int half = 0; half < 2 && !visible; ++half)
+                {
+                    rasterize(corners[face[0]], corners[face[1 + half]], corners[face[2 + half]], [&](std::int32_t x, std::int32_t y, float z)
+                        {
+                            visible = visible || z < m_depth[y * m_width + x] - 1e-6f;
+                        });
+                }
+            }
+
+            return visible;
+        }
+
+    private:
+
+        std::int32_t m_width = 0;
+
+        std::int32_t m_height = 0;
+
+        const float* m_viewProjection = nullptr;
+
+        std::vector<float> m_depth;
+    };
+
+    // Random triangles in front of the camera, all at least 2 units away
+    void RandomOccluders(std::mt19937& random, std::vector<float>& positions, std::vector<std::uint32_t>& indices)
+    {
+        std::uniform_real_distribution<float> unit(-1.f, 1.f);
+
+        for (std::uint32_t t = 0; t < 40; ++t)
+        {
+            const float z = 10.f + std::fabs(unit(random)) * 60.f;
+            const float x = unit(random) * z * 0.8f;
+            const float y = unit(random) * z * 0.5f;
+            const float size = 3.f + std::fabs(unit(random)) * z * 0.4f;
+
+            for (std::uint32_t k = 0; k < 3; ++k)
+            {
+                positions.push_back(x + unit(random) * size);
+                positions.push_back(y + unit(random) * size);
+                positions.push_back(std::max(2.f, z + unit(random) * size * 0.5f));
+
+                indices.push_back(static_cast<std::uint32_t>(indices.size()));
+            }
+        }
+    }
+}
+
+TEST_CASE(OcclusionCullerHidesBoxesBehindWall)
+{
+    const auto viewProjection = ViewProjection();
+
+    const std::uint32_t indices[] = { 0, 1, 2, 0, 2, 3 };
+    const auto wall = MakeMesh(WallPositions, indices);
+
+    const Occluder occluder = { .mesh = &wall };
+
+    JobSystem jobs(4);
+    OcclusionCuller culler;
+    culler.render(jobs, viewProjection.data(), std::span(&occluder, 1));
+
+    CHECK(!culler.isVisible(Box(0.f, 0.f, 80.f, 2.f)));
+    CHECK(culler.isVisible(Box(0.f, 0.f, 20.f, 2.f)));
+
+    // Beside the wall, straddling it, and off screen
+    CHECK(culler.isVisible(Box(55.f, 0.f, 80.f, 2.f)));
+    CHECK(culler.isVisible(Box(0.f, 0.f, 48.f, 3.f)));
+    CHECK(!culler.isVisible(Box(500.f, 0.f, 80.f, 2.f)));
+
+    CHECK(culler.stats().occluders == 1);
+    CHECK(culler.stats().triangles == 2);
+
+    // Moved by the occluder's world matrix: 40 to the right, nothing behind the original spot
+    Occluder moved = occluder;
+    moved.world[12] = 40.f;
+
+    culler.render(jobs, viewProjection.data(), std::span(&moved, 1));
+
+    CHECK(culler.isVisible(Box(0.f, 0.f, 80.f, 2.f)));
+    CHECK(!culler.isVisible(Box(40.f, 0.f, 80.f, 2.f)));
+
+    // Indices past the vertices are rejected
+    const std::uint32_t bad[] = { 0, 1, 9 };
+    OccluderMesh broken;
+    CHECK(!broken.init(std::as_bytes(std::span(WallPositions)), 3 * sizeof(float), std::as_bytes(std::span(bad)), IndexFormat::Uint32));
+}
+
+TEST_CASE(OcclusionCullerAcceptsBothWindings)
+{
+    const auto viewProjection = ViewProjection();
+
+    const std::uint32_t clockwise[] = { 0, 1, 2, 0, 2, 3 };
+    const std::uint32_t counterClockwise[] = { 0, 2, 1, 0, 3, 2 };
+
+    const auto front = MakeMesh(WallPositions, clockwise);
+    const auto back = MakeMesh(WallPositions, counterClockwise);
+
+    const Occluder frontOccluder = { .mesh = &front };
+    const Occluder backOccluder = { .mesh = &back };
+
+    JobSystem jobs(2);
+
+    OcclusionCuller frontCuller;
+    frontCuller.render(jobs, viewProjection.data(), std::span(&frontOccluder, 1));
+
+    OcclusionCuller backCuller;
+    backCuller.render(jobs, viewProjection.data(), std::span(&backOccluder, 1));
+
+    CHECK(!frontCuller.isVisible(Box(0.f, 0.f, 80.f, 2.f)));
+    CHECK(!backCuller.isVisible(Box(0.f, 0.f, 80.f, 2.f)));
+
+    // Same depth everywhere
+    bool identical = true;
+
+    for (std::uint32_t y = 0; y < frontCuller.height(); ++y)
+    {
+        for (std::uint32_t x = 0; x < frontCuller.width(); ++x)
+        {
+            identical = identical && frontCuller.depth(x, y) == backCuller.depth(x, y);
+        }
+    }
+
+    CHECK(identical);
+    CHECK(frontCuller.depth(frontCuller.width() / 2, frontCuller.height() / 2) < 1.f);
+}
+
+TEST_CASE(OcclusionCullerKeepsBoxesThroughNearPlane)
+{
+    const auto viewProjection = ViewProjection();
+
+    const std::uint32_t indices[] = { 0, 1, 2, 0, 2, 3 };
+    const auto wall = MakeMesh(WallPositions, indices);
+
+    // A floor from behind the camera to far away, clipped against the near plane
+    const float floorPositions[] = { -100.f, -2.f, -10.f, 100.f, -2.f, -10.f, 100.f, -2.f, 150.f, -100.f, -2.f, 150.f };
+    const auto floor = MakeMesh(floorPositions, indices);
+
+    const Occluder occluders[] = { { .mesh = &wall }, { .mesh = &floor } };
+
+    JobSystem jobs(2);
+    OcclusionCuller culler;
+    culler.render(jobs, viewProjection.data(), occluders);
+
+    // Boxes through the near plane, in front of the wall and even centered behind the camera
+    CHECK(culler.isVisible(Box(0.f, 0.f, 0.5f, 2.f)));
+    CHECK(culler.isVisible(Box(0.f, 0.f, 1.f, 0.5f)));
+    CHECK(culler.isVisible(Box(0.f, 0.f, -1.f, 2.5f)));
+    CHECK(culler.isVisible(Box(0.f, -2.5f, 0.f, 2.f)));
+
+    // Under the clipped floor is hidden, above it is not
+    CHECK(!culler.isVisible(Box(0.f, -6.f, 30.f, 1.f)));
+    CHECK(!culler.isVisible(Box(3.f, -10.f, 60.f, 1.f)));
+    CHECK(culler.isVisible(Box(0.f, 0.f, 30.f, 1.f)));
+
+    CHECK(0 < culler.stats().rasterizedTriangles);
+}
+
+TEST_CASE(OcclusionCullerParallelMatchesSerial)
+{
+    const auto viewProjection = ViewProjection();
+
+    std::mt19937 random(3);
+
+    JobSystem serial(1);
+    JobSystem parallel(4);
+
+    for (std::uint32_t scene = 0; scene < 10; ++scene)
+    {
+        std::vector<float> positions;
+        std::vector<std::uint32_t> indices;
+        RandomOccluders(random, positions, indices);
+
+        const auto mesh = MakeMesh(positions, indices);
+
+        // Several occluders, so transforming runs as more than one job
+        std::vector<Occluder> occluders(4, { .mesh = &mesh });
+
+        for (std::uint32_t i = 0; i < occluders.size(); ++i)
+        {
+            occluders[i].world[12] = 5.f * i;
+        }
+
+        // Sizes that are not whole tiles
+        OcclusionCuller one;
+        OcclusionCuller many;
+        one.resize(161 + scene * 8, 93 + scene * 4);
+        many.resize(161 + scene * 8, 93 + scene * 4);
+
+        one.render(serial, viewProjection.data(), occluders);
+        many.render(parallel, viewProjection.data(), occluders);
+
+        CHECK(one.width() == many.width() && one.height() == many.height());
+        CHECK(one.width() % OcclusionCuller::TileWidth == 0 && one.height() % OcclusionCuller::TileHeight == 0);
+
+        bool identical = true;
+
+        for (std::uint32_t y = 0; y < one.height(); ++y)
+        {
+            for (std::uint32_t x = 0; x < one.width(); ++x)
+            {
+                identical = identical && one.depth(x, y) == many.depth(x, y);
+            }
+        }
+
+        CHECK(identical);
+        CHECK(one.stats().rasterizedTriangles == many.stats().rasterizedTriangles);
+    }
+}
+
+TEST_CASE(OcclusionCullerNeverHidesVisibleBoxes)
+{
+    const auto viewProjection = ViewProjection();
+
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> unit(-1.f, 1.f);
+
+    JobSystem jobs(4);
+
+    std::uint32_t occluded = 0;
+    std::uint32_t falselyOccluded = 0;
+
+    for (std::uint32_t scene = 0; scene < 20; ++scene)
+    {
+        std::vector<float> positions;
+        std::vector<std::uint32_t> indices;
+        RandomOccluders(random, positions, indices);
+
+        const auto mesh = MakeMesh(positions, indices);
+        const Occluder occluder = { .mesh = &mesh };
+
+        OcclusionCuller culler;
+        culler.resize(160 + scene * 8, 90 + scene * 4);
+        culler.render(jobs, viewProjection.data(), std::span(&occluder, 1));
+
+        ReferenceRasterizer reference(culler.width(), culler.height(), viewProjection.data());
+
+        for (std::size_t t = 0; t < indices.size(); t += 3)
+        {
+            reference.drawOccluder(&positions[indices[t] * 3], &positions[indices[t + 1] * 3], &positions[indices[t + 2] * 3]);
+        }
+
+        // Boxes stay in front of the near plane so the reference needs no clipping
+        InstanceBoundsStore bounds;
+        std::vector<Aabb> boxes;
+
+        for (std::uint32_t b = 0; b < 400; ++b)
+        {
+            const float z = 5.f + std::fabs(unit(random)) * 120.f;
+            const float center[3] = { unit(random) * z * 0.8f, unit(random) * z * 0.5f, z };
+
+            Aabb box;
+
+            for (std::uint32_t axis = 0; axis < 3; ++axis)
+            {
+                const float extent = 0.2f + std::fabs(unit(random)) * 3.f;
+
+                box.min[axis] = center[axis] - extent;
+                box.max[axis] = center[axis] + extent;
+            }
+
+            bounds.add(MeshBoundsFromBox(box));
+            boxes.push_back(box);
+        }
+
+        std::vector<std::uint32_t> candidates(bounds.size());
+
+        for (std::uint32_t i = 0; i < candidates.size(); ++i)
+        {
+            candidates[i] = i;
+        }
+
+        const auto visible = culler.cull(jobs, bounds, candidates);
+
+        CHECK(std::is_sorted(visible.begin(), visible.end()));
+
+        for (std::uint32_t i = 0; i < boxes.size(); ++i)
+        {
+            const bool culled = !std::binary_search(visible.begin(), visible.end(), i);
+
+            // cull and isVisible agree
+            CHECK(culled == !culler.isVisible(boxes[i]));
+
+            if (culled)
+            {
+                ++occluded;
+                falselyOccluded += reference.boxVisible(boxes[i]);
+            }
+        }
+
+        CHECK(culler.stats().tested == boxes.size());
+    }
+
+    CHECK(falselyOccluded == 0);
+    CHECK(0 < occluded);
+}
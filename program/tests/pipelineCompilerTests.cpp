@@ -0,0 +1,105 @@
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "pipelineCompiler.hpp"
+#include "test.hpp"
+
+TEST_CASE(PipelineCompilerDeduplicatesKeys)
+{
+    PipelineCompiler compiler(4);
+
+    std::atomic<std::uint32_t> builds = 0;
+
+    const auto build = [&]
+    {
+        ++builds;
+        return true;
+    };
+
+    std::vector<PipelineHandle> handles;
+
+    for (std::uint32_t i = 0; i < 64; ++i)
+    {
+        handles.push_back(compiler.request(i % 8, build));
+    }
+
+    compiler.waitAll();
+
+    CHECK(builds == 8);
+    CHECK(compiler.pipelineCount() == 8);
+
+    for (std::uint32_t i = 0; i < handles.size(); ++i)
+    {
+        CHECK(handles[i] == handles[i % 8]);
+        CHECK(compiler.status(handles[i]) == PipelineStatus::Ready);
+    }
+
+    const auto stats = compiler.stats();
+    CHECK(stats.requests == 64);
+    CHECK(stats.deduplicated == 56);
+    CHECK(stats.built == 8);
+    CHECK(stats.failed == 0);
+
+    CHECK(compiler.status({}) == PipelineStatus::Failed);
+    CHECK(compiler.wait({ 100 }) == PipelineStatus::Failed);
+}
+
+TEST_CASE(PipelineCompilerRetriesFailedBuilds)
+{
+    constexpr std::uint64_t Key = 42;
+
+    PipelineCompiler compiler(2);
+
+    std::atomic<bool> release = false;
+
+    // Held until released, so the next request finds it still pending
+    const auto failing = compiler.request(Key, [&]
+        {
+            while (!release)
+            {
+                std::this_thread::yield();
+            }
+
+            return false;
+        });
+
+    std::atomic<std::uint32_t> retries = 0;
+
+    const auto succeeding = [&]
+    {
+        ++retries;
+        return true;
+    };
+
+    // A build still in flight is shared, not started again
+    CHECK(compiler.request(Key, succeeding) == failing);
+
+    release = true;
+
+    CHECK(compiler.wait(failing) == PipelineStatus::Failed);
+
+    // Once it failed, the same key builds again under a new handle
+    const auto retried = compiler.request(Key, succeeding);
+
+    CHECK(!(retried == failing));
+    CHECK(compiler.wait(retried) == PipelineStatus::Ready);
+    CHECK(retries == 1);
+
+    // Holders of the old handle still see the failure
+    CHECK(compiler.status(failing) == PipelineStatus::Failed);
+
+    // And the successful build is what later requests share
+    CHECK(compiler.request(Key, succeeding) == retried);
+
+    compiler.waitAll();
+
+    CHECK(retries == 1);
+
+    const auto stats = compiler.stats();
+    CHECK(stats.requests == 4);
+    CHECK(stats.deduplicated == 2);
+    CHECK(stats.built == 1);
+    CHECK(stats.failed == 1);
+}
@@ -0,0 +1,645 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "profiler.hpp"
+#include "test.hpp"
+
+namespace
+{
+    class TemporaryFile
+    {
+    public:
+
+        TemporaryFile()
+        {
+            std::random_device random;
+
+            m_path = std::filesystem::temp_directory_path() / ("profiler_test_" + std::to_string(random()) + ".json");
+        }
+
+        ~TemporaryFile()
+        {
+            std::error_code error;
+            std::filesystem::remove(m_path, error);
+        }
+
+        const std::filesystem::path& path()const { return m_path; }
+
+    private:
+
+        std::filesystem::path m_path;
+    };
+
+    // Just enough JSON for a Chrome trace; numbers keep their text so
+    // microseconds with three decimals convert to nanoseconds exactly
+    struct JsonValue
+    {
+        enum class Type { Null, Bool, Number, String, Array, Object };
+
+        Type type = Type::Null;
+
+        std::string text;
+
+        std::vector<JsonValue> items;
+
+        std::map<std::string, JsonValue> members;
+
+        const JsonValue* find(const std::string& key)const
+        {
+            const auto found = members.find(key);
+            return found != members.end() ? &found->second : nullptr;
+        }
+    };
+
+    class JsonParser
+    {
+    public:
+
+        explicit JsonParser(const std::string& text)
+            : m_text(text)
+        {}
+
+        // The whole text is one value and nothing else
+        std::optional<JsonValue> parse()
+        {
+            auto value = parseValue();
+
+            skipSpace();
+
+            if (!value || m_position != m_text.size())
+            {
+                return std::nullopt;
+            }
+
+            return value;
+        }
+
+    private:
+
+        void skipSpace()
+        {
+            while (m_position < m_text.size() && std::isspace(static_cast<unsigned char>(m_text[m_position])))
+            {
+                ++m_position;
+            }
+        }
+
+        bool consume(char c)
+        {
+            skipSpace();
+
+            if (m_position < m_text.size() && m_text[m_position] == c)
+            {
+                ++m_position;
+                return true;
+            }
+
+            return false;
+        }
+
+        bool consumeWord(const char* word)
+        {
+            const std::string expected = word;
+
+            if (m_text.compare(m_position, expected.size(), expected) != 0)
+            {
+                return false;
+            }
+
+            m_position += expected.size();
+            return true;
+        }
+
+        std::optional<JsonValue> parseValue()
+        {
+            skipSpace();
+
+            if (m_text.size() <= m_position)
+            {
+                return std::nullopt;
+            }
+
+            JsonValue value;
+
+            const char c = m_text[m_position];
+
+            if (c == '{')
+            {
+                ++m_position;
+                value.type = JsonValue::Type::Object;
+
+                if (consume('}'))
+                {
+                    return value;
+                }
+
+                do
+                {
+                    skipSpace();
+
+                    auto key = parseString();
+
+                    if (!key || !consume(':'))
+                    {
+                        return std::nullopt;
+                    }
+
+                    auto member = parseValue();
+
+                    if (!member || !value.members.emplace(key.value(), std::move(member.value())).second)
+                    {
+                        return std::nullopt;
+                    }
+                } while (consume(','));
+
+                return consume('}') ? std::optional(std::move(value)) : std::nullopt;
+            }
+
+            if (c == '[')
+            {
+                ++m_position;
+                value.type = JsonValue::Type::Array;
+
+                if (consume(']'))
+                {
+                    return value;
+                }
+
+                do
+                {
+                    auto item = parseValue();
+
+                    if (!item)
+                    {
+                        return std::nullopt;
+                    }
+
+                    value.items.push_back(std::move(item.value()));
+                } while (consume(','));
+
+                return consume(']') ? std::optional(std::move(value)) : std::nullopt;
+            }
+
+            if (c == '"')
+            {
+                auto text = parseString();
+
+                if (!text)
+                {
+                    return std::nullopt;
+                }
+
+                value.type = JsonValue::Type::String;
+                value.text = std::move(text.value());
+                return value;
+            }
+
+            if (consumeWord("true") || consumeWord("false"))
+            {
+                value.type = JsonValue::Type::Bool;
+                return value;
+            }
+
+            if (consumeWord("null"))
+            {
+                return value;
+            }
+
+            return parseNumber();
+        }
+
+        std::optional<std::string> parseString()
+        {
+            if (m_text.size() <= m_position || m_text[m_position] != '"')
+            {
+                return std::nullopt;
+            }
+
+            ++m_position;
+
+            std::string text;
+
+            while (m_position < m_text.size())
+            {
+                const char c = m_text[m_position++];
+
+                if (c == '"')
+                {
+                    return text;
+                }
+
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    return std::nullopt;
+                }
+
+                if (c != '\\')
+                {
+                    text += c;
+                    continue;
+                }
+
+                if (m_text.size() <= m_position)
+                {
+                    return std::nullopt;
+                }
+
+                const char escaped = m_text[m_position++];
+
+                switch (escaped)
+                {
+                case '"': text += '"'; break;
+                case '\\': text += '\\'; break;
+                case '/': text += '/'; break;
+                case 'b': text += '\b'; break;
+                case 'f': text += '\f'; break;
+                case 'n': text += '\n'; break;
+                case 'r': text += '\r'; break;
+                case 't': text += '\t'; break;
+                case 'u':
+                {
+                    if (m_text.size() < m_position + 4)
+                    {
+                        return std::nullopt;
+                    }
+
+                    const auto hex = m_text.substr(m_position, 4);
+
+                    if (!std::all_of(hex.begin(), hex.end(), [](char h) { return std::isxdigit(static_cast<unsigned char>(h)); }))
+                    {
+                        return std::nullopt;
+                    }
+
+                    // The profiler only escapes control characters this way
+                    text += static_cast<char>(std::stoul(hex, nullptr, 16));
+                    m_position += 4;
+                    break;
+                }
+                default:
+                    return std::nullopt;
+                }
+            }
+
+            return std::nullopt;
+        }
+
+        std::optional<JsonValue> parseNumber()
+        {
+            const auto begin = m_position;
+
+            if (m_position < m_text.size() && m_text[m_position] == '-')
+            {
+                ++m_position;
+            }
+
+            const auto digits = [&]
+            {
+                const auto start = m_position;
+
+                while (m_position < m_text.size() && std::isdigit(static_cast<unsigned char>(m_text[m_position])))
+                {
+                    ++m_position;
+                }
+
+                return start < m_position;
+            };
+
+            if (!digits())
+            {
+                return std::nullopt;
+            }
+
+            if (m_position < m_text.size() && m_text[m_position] == '.')
+            {
+                ++m_position;
+
+                if (!digits())
+                {
+                    return std::nullopt;
+                }
+            }
+
+            return JsonValue{ .type = JsonValue::Type::Number, .text = m_text.substr(begin, m_position - begin), .items = {}, .members = {} };
+        }
+
+        const std::string& m_text;
+
+        std::size_t m_position = 0;
+    };
+
+    std::optional<JsonValue> ReadTrace(const std::filesystem::path& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        std::stringstream text;
+        text << file.rdbuf();
+
+        return JsonParser(text.str()).parse();
+    }
+
+    // "12.345" microseconds as 12345 nanoseconds
+    std::uint64_t Nanoseconds(const JsonValue& value)
+    {
+        const auto dot = value.text.find('.');
+
+        if (dot == std::string::npos)
+        {
+            return std::stoull(value.text) * 1000;
+        }
+
+        auto fraction = value.text.substr(dot + 1);
+        fraction.resize(3, '0');
+
+        return std::stoull(value.text.substr(0, dot)) * 1000 + std::stoull(fraction);
+    }
+
+    struct TraceEvent
+    {
+        std::string name;
+
+        std::uint64_t begin = 0;
+
+        std::uint64_t end = 0;
+    };
+
+    struct TraceThread
+    {
+        std::string name;
+
+        std::vector<TraceEvent> events;
+    };
+
+    // Complete events and thread names by tid; false if anything is malformed
+    bool CollectThreads(const JsonValue& trace, std::map<std::uint32_t, TraceThread>& threads)
+    {
+        const auto* events = trace.find("traceEvents");
+
+        if (!events || events->type != JsonValue::Type::Array)
+        {
+            return false;
+        }
+
+        for (const auto& event : events->items)
+        {
+            const auto* name = event.find("name");
+            const auto* phase = event.find("ph");
+            const auto* tid = event.find("tid");
+
+            if (!name || name->type != JsonValue::Type::String || !phase || !tid || tid->type != JsonValue::Type::Number)
+            {
+                return false;
+            }
+
+            auto& thread = threads[static_cast<std::uint32_t>(std::stoul(tid->text))];
+
+            if (phase->text == "M")
+            {
+                const auto* args = event.find("args");
+                const auto* threadName = args ? args->find("name") : nullptr;
+
+                if (name->text != "thread_name" || !threadName)
+                {
+                    return false;
+                }
+
+                thread.name = threadName->text;
+                continue;
+            }
+
+            const auto* ts = event.find("ts");
+            const auto* dur = event.find("dur");
+
+            if (phase->text != "X" || !ts || ts->type != JsonValue::Type::Number || !dur || dur->type != JsonValue::Type::Number)
+            {
+                return false;
+            }
+
+            const auto begin = Nanoseconds(*ts);
+
+            thread.events.push_back({ .name = name->text, .begin = begin, .end = begin + Nanoseconds(*dur) });
+        }
+
+        return true;
+    }
+
+    // Inner scopes sit inside an outer scope of the same thread
+    bool Nested(const TraceThread& thread, const std::string& outer, const std::string& inner)
+    {
+        for (const auto& event : thread.events)
+        {
+            if (event.name != inner)
+            {
+                continue;
+            }
+
+            const bool enclosed = std::any_of(thread.events.begin(), thread.events.end(), [&](const TraceEvent& other)
+                {
+                    return other.name == outer && other.begin <= event.begin && event.end <= other.end;
+                });
+
+            if (!enclosed)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    std::uint32_t Count(const TraceThread& thread, const std::string& name)
+    {
+        return static_cast<std::uint32_t>(std::count_if(thread.events.begin(), thread.events.end(),
+            [&](const TraceEvent& event) { return event.name == name; }));
+    }
+
+    std::uint32_t s_evaluated = 0;
+
+    [[maybe_unused]] const char* CountedName()
+    {
+        ++s_evaluated;
+        return "Counted";
+    }
+}
+
+// What a marker macro expands to, as a string
+#define ProfileStringInner(...) #__VA_ARGS__
+#define ProfileString(...) ProfileStringInner(__VA_ARGS__)
+
+TEST_CASE(ProfilerTraceWhileThreadsRecord)
+{
+    constexpr std::uint32_t ThreadCount = 4;
+    constexpr std::uint32_t Iterations = 3000;
+
+    auto& profiler = Profiler::instance();
+    profiler.setEnabled(true);
+
+    TemporaryFile file;
+
+    std::atomic<std::uint32_t> ready = 0;
+    std::atomic<bool> done = false;
+    std::vector<std::thread> threads;
+
+    for (std::uint32_t t = 0; t < ThreadCount; ++t)
+    {
+        threads.emplace_back([&, t]
+            {
+                // Quotes, backslashes and control characters must come out escaped
+                profiler.setThreadName("Worker \"" + std::to_string(t) + "\"\\\t");
+                ++ready;
+
+                for (std::uint32_t i = 0; i < Iterations; ++i)
+                {
+                    const ProfileMarker outer("ProfilerTestOuter");
+
+                    {
+                        const ProfileMarker inner("ProfilerTestInner");
+                        const ProfileMarker innermost("ProfilerTestInnermost");
+                    }
+
+                    const ProfileMarker second("ProfilerTestInner");
+                }
+            });
+    }
+
+    // Traces written while the workers keep recording are complete JSON every time
+    std::uint32_t traces = 0;
+
+    std::thread writer([&]
+        {
+            while (!done)
+            {
+                if (ready < ThreadCount)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                CHECK(profiler.writeChromeTrace(file.path()));
+
+                const auto trace = ReadTrace(file.path());
+                CHECK(trace);
+
+                std::map<std::uint32_t, TraceThread> collected;
+                CHECK(trace && CollectThreads(trace.value(), collected));
+
+                ++traces;
+            }
+        });
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    done = true;
+    writer.join();
+
+    CHECK(0 < traces);
+
+    CHECK(profiler.writeChromeTrace(file.path()));
+
+    const auto trace = ReadTrace(file.path());
+    CHECK(trace);
+
+    if (!trace)
+    {
+        return;
+    }
+
+    std::map<std::uint32_t, TraceThread> collected;
+    CHECK(CollectThreads(trace.value(), collected));
+
+    std::uint32_t workers = 0;
+
+    for (const auto& [tid, thread] : collected)
+    {
+        if (thread.name.rfind("Worker \"", 0) != 0)
+        {
+            continue;
+        }
+
+        ++workers;
+
+        CHECK(thread.name.size() == 12 && thread.name.substr(9) == "\"\\\t");
+
+        // Every scope made it, and each inner one inside its outer one
+        CHECK(Count(thread, "ProfilerTestOuter") == Iterations);
+        CHECK(Count(thread, "ProfilerTestInner") == 2 * Iterations);
+        CHECK(Count(thread, "ProfilerTestInnermost") == Iterations);
+        CHECK(Nested(thread, "ProfilerTestOuter", "ProfilerTestInner"));
+        CHECK(Nested(thread, "ProfilerTestInner", "ProfilerTestInnermost"));
+
+        for (const auto& event : thread.events)
+        {
+            CHECK(event.begin <= event.end);
+        }
+    }
+
+    CHECK(workers == ThreadCount);
+    CHECK(profiler.stats().dropped == 0);
+}
+
+TEST_CASE(ProfilerDisabledRecordsNothing)
+{
+    auto& profiler = Profiler::instance();
+
+    const auto before = profiler.stats().events;
+
+    profiler.setEnabled(false);
+
+    {
+        const ProfileMarker marker("ProfilerTestDisabled");
+    }
+
+    profiler.recordGpu("ProfilerTestDisabledGpu", 0, 1);
+
+    CHECK(profiler.stats().events == before);
+
+    profiler.setEnabled(true);
+
+    {
+        const ProfileMarker marker("ProfilerTestEnabled");
+    }
+
+    profiler.recordGpu("ProfilerTestEnabledGpu", 1, 2);
+
+    CHECK(profiler.stats().events == before + 2);
+}
+
+TEST_CASE(ProfilerMacrosFollowBuildOption)
+{
+    auto& profiler = Profiler::instance();
+    profiler.setEnabled(true);
+
+    const auto before = profiler.stats().events;
+    s_evaluated = 0;
+
+    {
+        ProfileScope(CountedName());
+        ProfileThreadName("ProfilerTestMacros");
+    }
+
+#ifdef ENABLE_PROFILER
+    CHECK(s_evaluated == 1);
+    CHECK(profiler.stats().events == before + 1);
+    CHECK(std::string(ProfileString(ProfileScope("Name"))).find("ProfileMarker") != std::string::npos);
+#else
+    // Nothing left of the markers, not even their arguments
+    CHECK(s_evaluated == 0);
+    CHECK(profiler.stats().events == before);
+    CHECK(std::string(ProfileString(ProfileScope("Name"))).empty());
+    CHECK(std::string(ProfileString(GpuProfileScope(backend, "Name"))).empty());
+    CHECK(std::string(ProfileString(ProfileThreadName("Name"))).empty());
+#endif
+}
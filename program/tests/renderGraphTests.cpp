@@ -0,0 +1,540 @@
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "renderGraph.hpp"
+#include "test.hpp"
+
+namespace
+{
+    using enum ResourceState;
+
+    constexpr TextureDesc ColorDesc = { .width = 256, .height = 256, .format = TextureFormat::RGBA8Unorm };
+
+    // Every texture the same size so offsets are easy to predict
+    MemoryFootprint FixedFootprint(const TextureDesc&, ResourceState)
+    {
+        return { .size = 1000, .alignment = 256 };
+    }
+
+    std::vector<std::string> LivePassNames(const RenderGraph& graph)
+    {
+        std::vector<std::string> names;
+
+        for (std::uint32_t i = 0; i < graph.livePassCount(); ++i)
+        {
+            names.push_back(graph.name(graph.livePass(i)));
+        }
+
+        return names;
+    }
+
+    std::uint32_t CountBarriers(const RenderGraph& graph, std::uint32_t batch, BarrierType type, RenderResourceHandle resource)
+    {
+        const auto barriers = graph.barriers(batch);
+
+        return static_cast<std::uint32_t>(std::count_if(barriers.begin(), barriers.end(),
+            [&](const RenderBarrier& barrier) { return barrier.type == type && barrier.resource == resource; }));
+    }
+
+    const RenderBarrier* FindTransition(const RenderGraph& graph, std::uint32_t batch, RenderResourceHandle resource)
+    {
+        for (const auto& barrier : graph.barriers(batch))
+        {
+            if (barrier.type == BarrierType::Transition && barrier.resource == resource)
+            {
+                return &barrier;
+            }
+        }
+
+        return nullptr;
+    }
+
+    std::uint32_t CountAllTransitions(const RenderGraph& graph, RenderResourceHandle resource)
+    {
+        std::uint32_t count = 0;
+
+        for (std::uint32_t batch = 0; batch <= graph.livePassCount(); ++batch)
+        {
+            count += CountBarriers(graph, batch, BarrierType::Transition, resource);
+        }
+
+        return count;
+    }
+
+    // Transients alive in the same pass never share a byte
+    bool LiveTexturesDisjoint(const RenderGraph& graph)
+    {
+        std::vector<TexturePlacement> placements;
+
+        for (std::uint32_t id = 1; id <= graph.resourceCount(); ++id)
+        {
+            if (const auto placement = graph.placement({ id }))
+            {
+                placements.push_back(placement.value());
+            }
+        }
+
+        for (std::size_t i = 0; i < placements.size(); ++i)
+        {
+            for (std::size_t j = i + 1; j < placements.size(); ++j)
+            {
+                const auto& a = placements[i];
+                const auto& b = placements[j];
+
+                const bool liveTogether = a.firstPass <= b.lastPass && b.firstPass <= a.lastPass;
+                const bool shareMemory = a.offset < b.offset + b.size && b.offset < a.offset + a.size;
+
+                if (liveTogether && shareMemory)
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+}
+
+TEST_CASE(RenderGraphCullsUnusedPasses)
+{
+    RenderGraph graph;
+
+    const auto backBuffer = graph.importTexture("BackBuffer", ColorDesc, Present, Present);
+    const auto scene = graph.createTexture("Scene", ColorDesc);
+    const auto unused = graph.createTexture("Unused", ColorDesc);
+    const auto readback = graph.createTexture("Readback", ColorDesc);
+    const auto derived = graph.createTexture("Derived", ColorDesc);
+
+    // Fully overwritten by Composite, so nothing sees what it drew
+    const auto early = graph.addPass("Early");
+    graph.write(early, backBuffer, RenderTarget);
+
+    const auto draw = graph.addPass("Scene");
+    graph.write(draw, scene, RenderTarget);
+
+    const auto dead = graph.addPass("Dead");
+    graph.write(dead, unused, RenderTarget);
+
+    // Only reaches the outside world through its side effects
+    const auto copy = graph.addPass("Readback");
+    graph.read(copy, scene, CopySource);
+    graph.write(copy, readback, CopyDest);
+    graph.setSideEffects(copy);
+
+    // Reads a live texture, but nothing reads what it writes
+    const auto deadReader = graph.addPass("DeadReader");
+    graph.read(deadReader, scene, PixelShaderResource);
+    graph.write(deadReader, derived, RenderTarget);
+
+    const auto composite = graph.addPass("Composite");
+    graph.read(composite, scene, PixelShaderResource);
+    graph.write(composite, backBuffer, RenderTarget);
+
+    CHECK(graph.compile());
+
+    CHECK((LivePassNames(graph) == std::vector<std::string>{ "Scene", "Readback", "Composite" }));
+    CHECK(graph.stats().passes == 6);
+    CHECK(graph.stats().culledPasses == 3);
+
+    // Culled passes place nothing
+    CHECK(graph.placement(scene));
+    CHECK(graph.placement(readback));
+    CHECK(!graph.placement(unused));
+    CHECK(!graph.placement(derived));
+    CHECK(graph.stats().transientTextures == 2);
+
+    // Passes that run do so in the order they were added
+    std::vector<std::string> executed;
+
+    RenderGraph ordered;
+    const auto target = ordered.importTexture("BackBuffer", ColorDesc, Present, Present);
+    const auto first = ordered.addPass("First", [&] { executed.push_back("First"); });
+    ordered.write(first, target, RenderTarget);
+    const auto skipped = ordered.addPass("Skipped", [&] { executed.push_back("Skipped"); });
+    ordered.write(skipped, ordered.createTexture("Nowhere", ColorDesc), RenderTarget);
+    const auto second = ordered.addPass("Second", [&] { executed.push_back("Second"); });
+    ordered.read(second, target, RenderTarget);
+    ordered.write(second, target, RenderTarget);
+
+    CHECK(ordered.compile());
+
+    std::uint32_t batches = 0;
+    ordered.execute([&](std::span<const RenderBarrier>) { ++batches; });
+
+    CHECK((executed == std::vector<std::string>{ "First", "Second" }));
+    CHECK(batches == ordered.stats().batches);
+}
+
+TEST_CASE(RenderGraphRejectsBadDeclarations)
+{
+    RenderGraph graph;
+
+    const auto texture = graph.createTexture("Never", ColorDesc);
+    const auto backBuffer = graph.importTexture("BackBuffer", ColorDesc, Present, Present);
+
+    // A transient read before anything wrote it
+    const auto pass = graph.addPass("Reader");
+    graph.read(pass, texture, PixelShaderResource);
+    graph.write(pass, backBuffer, RenderTarget);
+
+    CHECK(!graph.compile());
+
+    // One pass, two states of the same texture
+    graph.reset();
+
+    const auto other = graph.createTexture("Other", ColorDesc);
+    const auto mixed = graph.addPass("Mixed");
+    graph.write(mixed, other, RenderTarget);
+    graph.read(mixed, other, PixelShaderResource);
+    graph.setSideEffects(mixed);
+
+    CHECK(!graph.compile());
+
+    // reset forgets the error
+    graph.reset();
+    CHECK(graph.compile());
+    CHECK(graph.livePassCount() == 0);
+}
+
+TEST_CASE(RenderGraphAliasesDisjointLifetimes)
+{
+    RenderGraph graph;
+
+    const auto backBuffer = graph.importTexture("BackBuffer", ColorDesc, Present, Present);
+    const auto a = graph.createTexture("A", ColorDesc);
+    const auto b = graph.createTexture("B", ColorDesc);
+    const auto c = graph.createTexture("C", ColorDesc);
+
+    // A is dead by the time C is written, B overlaps both
+    const auto first = graph.addPass("First");
+    graph.write(first, a, RenderTarget);
+
+    const auto second = graph.addPass("Second");
+    graph.read(second, a, PixelShaderResource);
+    graph.write(second, b, RenderTarget);
+
+    const auto third = graph.addPass("Third");
+    graph.read(third, b, PixelShaderResource);
+    graph.write(third, c, RenderTarget);
+
+    const auto last = graph.addPass("Last");
+    graph.read(last, c, PixelShaderResource);
+    graph.write(last, backBuffer, RenderTarget);
+
+    CHECK(graph.compile(FixedFootprint));
+
+    const auto pa = graph.placement(a);
+    const auto pb = graph.placement(b);
+    const auto pc = graph.placement(c);
+
+    CHECK(pa && pb && pc);
+
+    if (!pa || !pb || !pc)
+    {
+        return;
+    }
+
+    CHECK(pa->firstPass == 0 && pa->lastPass == 1);
+    CHECK(pb->firstPass == 1 && pb->lastPass == 2);
+    CHECK(pc->firstPass == 2 && pc->lastPass == 3);
+
+    // C reuses A's memory; B sits after A, rounded up to the alignment
+    CHECK(pa->offset == 0);
+    CHECK(pb->offset == 1024);
+    CHECK(pc->offset == pa->offset);
+    CHECK(LiveTexturesDisjoint(graph));
+
+    // Every state a live pass used, for the API texture's flags
+    CHECK(pa->usage == (RenderTarget | PixelShaderResource));
+    CHECK(pa->initialState == RenderTarget);
+    CHECK(pa->finalState == PixelShaderResource);
+
+    // C takes over from A before its first pass; B and A overlap nothing earlier
+    CHECK(CountBarriers(graph, 2, BarrierType::Aliasing, c) == 1);
+
+    for (const auto& barrier : graph.barriers(2))
+    {
+        if (barrier.type == BarrierType::Aliasing && barrier.resource == c)
+        {
+            CHECK(barrier.aliasBefore == a);
+        }
+    }
+
+    CHECK(CountBarriers(graph, 0, BarrierType::Aliasing, a) == 1);
+    CHECK(CountBarriers(graph, 1, BarrierType::Aliasing, b) == 0);
+
+    // Aliasing comes first in a batch, before the transitions of the new owner
+    const auto batch = graph.barriers(2);
+    CHECK(!batch.empty() && batch.front().type == BarrierType::Aliasing);
+}
+
+TEST_CASE(RenderGraphReportsAliasingSavings)
+{
+    RenderGraph graph;
+
+    const auto backBuffer = graph.importTexture("BackBuffer", ColorDesc, Present, Present);
+
+    // A chain of four: each pass reads the previous texture and writes the next,
+    // so at most two are ever alive
+    auto previous = RenderResourceHandle{};
+
+    for (std::uint32_t i = 0; i < 4; ++i)
+    {
+        const auto texture = graph.createTexture("Chain", ColorDesc);
+        const auto pass = graph.addPass("Chain");
+
+        if (previous)
+        {
+            graph.read(pass, previous, PixelShaderResource);
+        }
+
+        graph.write(pass, texture, RenderTarget);
+
+        previous = texture;
+    }
+
+    const auto present = graph.addPass("Present");
+    graph.read(present, previous, PixelShaderResource);
+    graph.write(present, backBuffer, RenderTarget);
+
+    CHECK(graph.compile(FixedFootprint));
+
+    const auto& stats = graph.stats();
+
+    CHECK(stats.transientTextures == 4);
+    CHECK(stats.transientBytes == 4 * 1000);
+    CHECK(stats.heapBytes == 1024 + 1000);
+    CHECK(LiveTexturesDisjoint(graph));
+
+    // The default footprint matches EstimateTextureFootprint, 64 KB aligned
+    CHECK(graph.compile());
+
+    const auto estimate = EstimateTextureFootprint(ColorDesc);
+    CHECK(estimate.size == 256 * 256 * 4);
+    CHECK(estimate.alignment == 64 * 1024);
+    CHECK(graph.stats().transientBytes == 4 * estimate.size);
+    CHECK(graph.stats().heapBytes == 2 * estimate.size);
+
+    // MSAA needs the larger alignment
+    const auto msaa = EstimateTextureFootprint({ .width = 16, .height = 16, .format = TextureFormat::RGBA8Unorm, .mipLevels = 1, .sampleCount = 4 });
+    CHECK(msaa.alignment == 4 * 1024 * 1024);
+    CHECK(msaa.size == msaa.alignment);
+}
+
+TEST_CASE(RenderGraphLiveTexturesNeverOverlap)
+{
+    std::mt19937 random(11);
+
+    const TextureFormat formats[] = { TextureFormat::RGBA8Unorm, TextureFormat::RGBA16Float, TextureFormat::R32Float, TextureFormat::Depth32Float };
+
+    for (std::uint32_t round = 0; round < 50; ++round)
+    {
+        RenderGraph graph;
+
+        const auto backBuffer = graph.importTexture("BackBuffer", ColorDesc, Present, Present);
+
+        std::vector<RenderResourceHandle> written;
+
+        const std::uint32_t passCount = 4 + random() % 20;
+
+        for (std::uint32_t p = 0; p < passCount; ++p)
+        {
+            const auto pass = graph.addPass("Random");
+
+            // Read a few earlier results, write a new one of random size
+            std::vector<RenderResourceHandle> reads;
+
+            for (std::uint32_t r = 0; r < random() % 3 && !written.empty(); ++r)
+            {
+                const auto source = written[random() % written.size()];
+
+                if (std::find(reads.begin(), reads.end(), source) == reads.end())
+                {
+                    reads.push_back(source);
+                    graph.read(pass, source, PixelShaderResource);
+                }
+            }
+
+            const auto scale = random() % 4;
+            const auto format = formats[random() % std::size(formats)];
+            const auto texture = graph.createTexture("Random", { .width = 512u >> scale, .height = 256u >> scale, .format = format });
+
+            graph.write(pass, texture, format == TextureFormat::Depth32Float ? DepthWrite : RenderTarget);
+            written.push_back(texture);
+
+            if (random() % 5 == 0)
+            {
+                graph.setSideEffects(pass);
+            }
+        }
+
+        const auto present = graph.addPass("Present");
+        graph.read(present, written.back(), PixelShaderResource);
+        graph.write(present, backBuffer, RenderTarget);
+
+        CHECK(graph.compile());
+        CHECK(LiveTexturesDisjoint(graph));
+
+        const auto& stats = graph.stats();
+        CHECK(stats.heapBytes <= stats.transientBytes);
+
+        // Placements are aligned and inside the heap
+        for (std::uint32_t id = 1; id <= graph.resourceCount(); ++id)
+        {
+            if (const auto placement = graph.placement({ id }))
+            {
+                CHECK(placement->offset % EstimateTextureFootprint(graph.desc({ id })).alignment == 0);
+                CHECK(placement->offset + placement->size <= stats.heapBytes);
+            }
+        }
+    }
+}
+
+TEST_CASE(RenderGraphMergesTransitions)
+{
+    RenderGraph graph;
+
+    const auto scene = graph.createTexture("Scene", ColorDesc);
+
+    const auto draw = graph.addPass("Draw");
+    graph.write(draw, scene, RenderTarget);
+
+    // Drawing again in the same state needs no transition
+    const auto overlay = graph.addPass("Overlay");
+    graph.read(overlay, scene, RenderTarget);
+    graph.write(overlay, scene, RenderTarget);
+
+    // Three readers in two read states up to the next write
+    const auto blur = graph.addPass("Blur");
+    graph.read(blur, scene, PixelShaderResource);
+
+    const auto histogram = graph.addPass("Histogram");
+    graph.read(histogram, scene, NonPixelShaderResource);
+
+    const auto tonemap = graph.addPass("Tonemap");
+    graph.read(tonemap, scene, PixelShaderResource);
+
+    // Written again, then read once more
+    const auto redraw = graph.addPass("Redraw");
+    graph.write(redraw, scene, RenderTarget);
+
+    const auto present = graph.addPass("Present");
+    graph.read(present, scene, CopySource);
+
+    for (const auto pass : { draw, overlay, blur, histogram, tonemap, redraw, present })
+    {
+        graph.setSideEffects(pass);
+    }
+
+    CHECK(graph.compile());
+    CHECK(graph.livePassCount() == 7);
+
+    // One combined read state before Blur serves Histogram and Tonemap as well
+    const auto* read = FindTransition(graph, 2, scene);
+    CHECK(read && read->before == RenderTarget && read->after == (PixelShaderResource | NonPixelShaderResource));
+    CHECK(read && read->split == BarrierSplit::None);
+
+    CHECK(!FindTransition(graph, 1, scene));
+    CHECK(!FindTransition(graph, 3, scene));
+    CHECK(!FindTransition(graph, 4, scene));
+
+    const auto* write = FindTransition(graph, 5, scene);
+    CHECK(write && write->before == (PixelShaderResource | NonPixelShaderResource) && write->after == RenderTarget);
+
+    const auto* copy = FindTransition(graph, 6, scene);
+    CHECK(copy && copy->before == RenderTarget && copy->after == CopySource);
+
+    CHECK(CountAllTransitions(graph, scene) == 3);
+    CHECK(graph.stats().transitions == 3);
+    CHECK(graph.stats().splitTransitions == 0);
+
+    // A transient starts in the state of its first use and ends in the last one
+    const auto placement = graph.placement(scene);
+    CHECK(placement && placement->initialState == RenderTarget && placement->finalState == CopySource);
+
+    // Writes to the same unordered-access texture are ordered by UAV barriers
+    RenderGraph compute;
+
+    const auto buffer = compute.createTexture("Buffer", ColorDesc);
+
+    const auto first = compute.addPass("First");
+    compute.write(first, buffer, UnorderedAccess);
+
+    const auto second = compute.addPass("Second");
+    compute.read(second, buffer, UnorderedAccess);
+    compute.write(second, buffer, UnorderedAccess);
+    compute.setSideEffects(second);
+
+    CHECK(compute.compile());
+    CHECK(CountBarriers(compute, 1, BarrierType::UnorderedAccess, buffer) == 1);
+    CHECK(compute.stats().uavBarriers == 1);
+    CHECK(compute.stats().transitions == 0);
+}
+
+TEST_CASE(RenderGraphSplitsIdleTransitions)
+{
+    RenderGraph graph;
+
+    const auto backBuffer = graph.importTexture("BackBuffer", ColorDesc, Present, Present);
+    const auto shadow = graph.createTexture("Shadow", { .width = 1024, .height = 1024, .format = TextureFormat::Depth32Float });
+    const auto scene = graph.createTexture("Scene", ColorDesc);
+    const auto bloom = graph.createTexture("Bloom", ColorDesc);
+
+    // Shadow is written in pass 0 and not touched again until pass 3
+    const auto shadows = graph.addPass("Shadows");
+    graph.write(shadows, shadow, DepthWrite);
+
+    const auto draw = graph.addPass("Scene");
+    graph.write(draw, scene, RenderTarget);
+
+    const auto blur = graph.addPass("Bloom");
+    graph.read(blur, scene, PixelShaderResource);
+    graph.write(blur, bloom, RenderTarget);
+
+    const auto lighting = graph.addPass("Lighting");
+    graph.read(lighting, shadow, PixelShaderResource);
+    graph.read(lighting, bloom, PixelShaderResource);
+    graph.write(lighting, backBuffer, RenderTarget);
+
+    CHECK(graph.compile());
+    CHECK(graph.livePassCount() == 4);
+
+    // Begun right after the last write, ended before the reader
+    const auto* begin = FindTransition(graph, 1, shadow);
+    const auto* end = FindTransition(graph, 3, shadow);
+
+    CHECK(begin && begin->split == BarrierSplit::Begin && begin->before == DepthWrite && begin->after == PixelShaderResource);
+    CHECK(end && end->split == BarrierSplit::End && end->before == DepthWrite && end->after == PixelShaderResource);
+    CHECK(!FindTransition(graph, 2, shadow));
+
+    // Bloom was written by the pass just before, nothing to overlap
+    const auto* adjacent = FindTransition(graph, 3, bloom);
+    CHECK(adjacent && adjacent->split == BarrierSplit::None);
+
+    // The back buffer idles from the start of the frame until Lighting, then goes back to Present
+    const auto* acquire = FindTransition(graph, 0, backBuffer);
+    CHECK(acquire && acquire->split == BarrierSplit::Begin && acquire->before == Present && acquire->after == RenderTarget);
+
+    const auto* release = FindTransition(graph, 4, backBuffer);
+    CHECK(release && release->split == BarrierSplit::None && release->before == RenderTarget && release->after == Present);
+
+    CHECK(graph.stats().splitTransitions == 2);
+
+    // Each split transition is one begin and one end
+    std::uint32_t begins = 0;
+    std::uint32_t ends = 0;
+
+    for (std::uint32_t batch = 0; batch <= graph.livePassCount(); ++batch)
+    {
+        for (const auto& barrier : graph.barriers(batch))
+        {
+            begins += barrier.split == BarrierSplit::Begin;
+            ends += barrier.split == BarrierSplit::End;
+        }
+    }
+
+    CHECK(begins == 2 && ends == 2);
+}
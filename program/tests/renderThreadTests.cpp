@@ -0,0 +1,275 @@
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "renderThread.hpp"
+#include "test.hpp"
+
+namespace
+{
+    WindowEvent Key(std::uint32_t code)
+    {
+        return { .type = WindowEventType::KeyDown, .code = code };
+    }
+
+    WindowEvent Resize(std::int32_t width, std::int32_t height)
+    {
+        return { .type = WindowEventType::Resize, .x = width, .y = height };
+    }
+
+    // Polls until condition holds or a second has passed
+    template<typename Condition>
+    bool WaitFor(Condition condition)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+
+        while (!condition())
+        {
+            if (deadline < std::chrono::steady_clock::now())
+            {
+                return false;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        return true;
+    }
+}
+
+TEST_CASE(WindowEventQueueWrapsInOrder)
+{
+    WindowEventQueue events;
+
+    std::uint32_t pushed = 0;
+    std::uint32_t popped = 0;
+    bool ordered = true;
+
+    // Nearly full, then one in and one out several times around the ring
+    while (pushed < WindowEventQueue::capacity() - 3)
+    {
+        CHECK(events.push(Key(pushed++)));
+    }
+
+    for (std::size_t i = 0; i < WindowEventQueue::capacity() * 5; ++i)
+    {
+        CHECK(events.push(Key(pushed++)));
+
+        const auto event = events.pop();
+        ordered = ordered && event && event->code == popped++;
+    }
+
+    while (const auto event = events.pop())
+    {
+        ordered = ordered && event->code == popped++;
+    }
+
+    CHECK(ordered);
+    CHECK(popped == pushed);
+    CHECK(!events.pending());
+}
+
+TEST_CASE(WindowEventQueueDropsInputWhenFull)
+{
+    WindowEventQueue events;
+
+    CHECK(!events.pop());
+    CHECK(!events.pending());
+
+    for (std::uint32_t i = 0; i < WindowEventQueue::capacity(); ++i)
+    {
+        CHECK(events.push(Key(i)));
+    }
+
+    // Input that does not fit is counted, but a resize always gets through
+    CHECK(!events.push(Key(9999)));
+    CHECK(!events.push({ .type = WindowEventType::MouseMove }));
+    CHECK(events.push(Resize(640, 480)));
+    CHECK(events.stats().droppedInput == 2);
+
+    // Input first, in order, then the resize
+    for (std::uint32_t i = 0; i < WindowEventQueue::capacity(); ++i)
+    {
+        const auto event = events.pop();
+        CHECK(event && event->type == WindowEventType::KeyDown && event->code == i);
+    }
+
+    const auto resize = events.pop();
+    CHECK(resize && resize->type == WindowEventType::Resize && resize->x == 640 && resize->y == 480);
+
+    CHECK(!events.pop());
+    CHECK(!events.pending());
+}
+
+TEST_CASE(WindowEventQueueKeepsNewestResizeAndQuit)
+{
+    WindowEventQueue events;
+
+    CHECK(events.push(Resize(800, 600)));
+    CHECK(events.push(Resize(1024, 768)));
+    CHECK(events.push(Resize(1920, 1080)));
+    CHECK(events.stats().replacedResizes == 2);
+
+    const auto resize = events.pop();
+    CHECK(resize && resize->x == 1920 && resize->y == 1080);
+    CHECK(!events.pop());
+
+    // A quit goes ahead of anything still queued
+    CHECK(events.push(Key(1)));
+    CHECK(events.push({ .type = WindowEventType::Quit, .timestamp = 42 }));
+
+    const auto quit = events.pop();
+    CHECK(quit && quit->type == WindowEventType::Quit && quit->timestamp == 42);
+}
+
+TEST_CASE(WindowEventQueueWaitWakesOnResize)
+{
+    WindowEventQueue events;
+
+    std::thread consumer([&]
+        {
+            events.wait();
+        });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    CHECK(events.push(Resize(1, 1)));
+
+    consumer.join();
+
+    CHECK(events.pending());
+}
+
+TEST_CASE(RenderThreadAppliesOnlyNewestResize)
+{
+    WindowEventQueue events;
+    RenderThread renderThread(events, 1280, 720);
+
+    // Queued before the first frame, so they all land in one drain
+    CHECK(events.push(Resize(800, 600)));
+    CHECK(events.push(Key(7)));
+    CHECK(events.push(Resize(1024, 768)));
+
+    std::vector<std::pair<int, int>> resizes;
+    std::vector<std::uint32_t> keys;
+    std::uint32_t frames = 0;
+
+    renderThread.start(
+        {
+            .init = {},
+            .frame = [&]
+            {
+                // Nothing else pushes while the render thread owns the producer side
+                if (++frames == 1)
+                {
+                    events.push({ .type = WindowEventType::Quit });
+                }
+
+                return true;
+            },
+            .resize = [&](int width, int height)
+            {
+                resizes.emplace_back(width, height);
+                return true;
+            },
+            .input = [&](const WindowEvent& event) { keys.push_back(event.code); },
+            .shutdown = {},
+            .exited = {},
+        });
+
+    CHECK(renderThread.join());
+
+    CHECK(resizes.size() == 1);
+    CHECK(!resizes.empty() && resizes.front() == std::make_pair(1024, 768));
+    CHECK(keys == std::vector<std::uint32_t>{ 7 });
+
+    const auto& stats = renderThread.stats();
+    CHECK(stats.resizes == 1);
+    CHECK(stats.coalescedResizes == 1);
+}
+
+TEST_CASE(RenderThreadQuitStopsBeforeAnotherFrame)
+{
+    WindowEventQueue events;
+    RenderThread renderThread(events, 640, 480);
+
+    std::uint32_t frames = 0;
+    bool shutdown = false;
+    bool exited = false;
+
+    renderThread.start(
+        {
+            .init = [] { return true; },
+            .frame = [&]
+            {
+                if (++frames == 3)
+                {
+                    events.push({ .type = WindowEventType::Quit });
+                }
+
+                return true;
+            },
+            .resize = {},
+            .input = {},
+            .shutdown = [&] { shutdown = true; },
+            .exited = [&] { exited = shutdown; },
+        });
+
+    CHECK(renderThread.join());
+
+    CHECK(frames == 3);
+    CHECK(renderThread.stats().frames == 3);
+    CHECK(shutdown && exited);
+}
+
+TEST_CASE(RenderThreadSleepsWhileMinimized)
+{
+    WindowEventQueue events;
+    RenderThread renderThread(events, 640, 480);
+
+    CHECK(events.push(Resize(0, 0)));
+
+    std::atomic<std::uint32_t> frames = 0;
+
+    std::mutex mutex;
+    std::vector<std::pair<int, int>> resizes;
+
+    renderThread.start(
+        {
+            .init = {},
+            .frame = [&]
+            {
+                ++frames;
+                return true;
+            },
+            .resize = [&](int width, int height)
+            {
+                std::lock_guard lock(mutex);
+                resizes.emplace_back(width, height);
+                return true;
+            },
+            .input = {},
+            .shutdown = {},
+            .exited = {},
+        });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    CHECK(frames == 0);
+
+    // Restoring wakes it with the new size
+    CHECK(events.push(Resize(320, 240)));
+    CHECK(WaitFor([&] { return 0 < frames; }));
+
+    CHECK(events.push({ .type = WindowEventType::Quit }));
+    CHECK(renderThread.join());
+
+    std::lock_guard lock(mutex);
+    CHECK(resizes.size() == 1);
+    CHECK(!resizes.empty() && resizes.front() == std::make_pair(320, 240));
+}
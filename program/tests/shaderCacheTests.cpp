@@ -0,0 +1,235 @@
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "shaderCache.hpp"
+#include "test.hpp"
+
+namespace
+{
+    // A fresh directory under the system temporary one, removed again at the end
+    class TemporaryDirectory
+    {
+    public:
+
+        TemporaryDirectory()
+        {
+            std::random_device random;
+
+            m_path = std::filesystem::temp_directory_path() / ("shader_cache_test_" + std::to_string(random()));
+            std::filesystem::create_directories(m_path);
+        }
+
+        ~TemporaryDirectory()
+        {
+            std::error_code error;
+            std::filesystem::remove_all(m_path, error);
+        }
+
+        const std::filesystem::path& path()const { return m_path; }
+
+    private:
+
+        std::filesystem::path m_path;
+    };
+
+    void WriteText(const std::filesystem::path& path, const std::string& text)
+    {
+        std::filesystem::create_directories(path.parent_path());
+
+        std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+        ofs << text;
+    }
+
+    std::vector<std::byte> Bytes(const std::string& text)
+    {
+        const auto bytes = std::as_bytes(std::span(text.data(), text.size()));
+        return std::vector<std::byte>(bytes.begin(), bytes.end());
+    }
+}
+
+TEST_CASE(ShaderKeyFollowsIncludes)
+{
+    TemporaryDirectory directory;
+    const auto root = directory.path();
+
+    WriteText(root / "mesh.hlsl", "#include \"common/lighting.hlsli\"\nfloat4 main() : SV_Target { return 0; }\n");
+    WriteText(root / "common/lighting.hlsli", "  #  include <math.hlsli>\nfloat Light();\n");
+    WriteText(root / "common/math.hlsli", "float Pi();\n");
+
+    const ShaderCompileDesc desc = { .sourcePath = root / "mesh.hlsl", .entryPoint = "main", .target = "ps_5_1", .defines = {} };
+
+    const auto key = ComputeShaderKey(desc);
+    CHECK(key.has_value());
+    CHECK(ComputeShaderKey(desc) == key);
+
+    const auto info = ScanShaderSource(desc.sourcePath);
+    CHECK(info && info->files.size() == 3);
+
+    // An include two levels down, relative to the file that includes it
+    WriteText(root / "common/math.hlsli", "float Pi();\nfloat Tau();\n");
+    const auto nestedChanged = ComputeShaderKey(desc);
+    CHECK(nestedChanged && nestedChanged != key);
+
+    WriteText(root / "common/lighting.hlsli", "#include \"math.hlsli\"\n#include \"shadows.hlsli\"\nfloat Light();\n");
+    const auto missingInclude = ComputeShaderKey(desc);
+    CHECK(missingInclude && missingInclude != nestedChanged);
+
+    // Creating the include that was missing changes the key again
+    WriteText(root / "common/shadows.hlsli", "float Shadow();\n");
+    const auto includeAdded = ComputeShaderKey(desc);
+    CHECK(includeAdded && includeAdded != missingInclude);
+
+    // Only content matters, not when the file was written
+    WriteText(root / "common/shadows.hlsli", "float Shadow();\n");
+    CHECK(ComputeShaderKey(desc) == includeAdded);
+
+    CHECK(!ComputeShaderKey({ .sourcePath = root / "missing.hlsl", .entryPoint = "main", .target = "ps_5_1", .defines = {} }));
+}
+
+TEST_CASE(ShaderKeyCoversCompileSettings)
+{
+    TemporaryDirectory directory;
+    WriteText(directory.path() / "mesh.hlsl", "float4 main() : SV_Target { return 0; }\n");
+
+    const ShaderCompileDesc base =
+    {
+        .sourcePath = directory.path() / "mesh.hlsl",
+        .entryPoint = "main",
+        .target = "ps_5_1",
+        .defines = { { "SHADOWS", "1" } },
+        .flags = 1,
+        .compilerVersion = 47,
+    };
+
+    const auto baseKey = ComputeShaderKey(base);
+    CHECK(baseKey.has_value());
+
+    std::vector<ShaderCompileDesc> variants(8, base);
+    variants[0].entryPoint = "mainPS";
+    variants[1].target = "ps_5_0";
+    variants[2].defines[0].value = "2";
+    variants[3].defines[0].name = "SHADOW";
+    variants[4].defines.push_back({ "FOG", "" });
+    variants[5].defines.clear();
+    variants[6].flags = 3;
+    variants[7].compilerVersion = 48;
+
+    std::vector<std::uint64_t> keys = { baseKey.value_or(0) };
+
+    for (const auto& variant : variants)
+    {
+        const auto key = ComputeShaderKey(variant);
+        CHECK(key.has_value());
+
+        for (const auto other : keys)
+        {
+            CHECK(key != other);
+        }
+
+        keys.push_back(key.value_or(0));
+    }
+
+    // A define split differently over name and value is another define
+    auto shifted = base;
+    shifted.defines = { { "SHADOWS1", "" } };
+    CHECK(ComputeShaderKey(shifted) != baseKey);
+}
+
+TEST_CASE(ShaderCacheRoundTrip)
+{
+    TemporaryDirectory directory;
+
+    ShaderCache cache;
+    CHECK(cache.init(directory.path() / "cache"));
+
+    const auto bytecode = Bytes("DXBC bytecode");
+
+    CHECK(!cache.loadBytecode(1));
+    CHECK(cache.storeBytecode(1, bytecode));
+    CHECK(cache.loadBytecode(1) == bytecode);
+
+    CHECK(cache.storeBlob("pipelines", Bytes("library")));
+    CHECK(cache.loadBlob("pipelines") == Bytes("library"));
+
+    // Storing again replaces the entry, and leaves no temporary files behind
+    CHECK(cache.storeBytecode(1, Bytes("newer")));
+    CHECK(cache.loadBytecode(1) == Bytes("newer"));
+
+    std::uint32_t files = 0;
+
+    for ([[maybe_unused]] const auto& entry : std::filesystem::directory_iterator(cache.directory()))
+    {
+        ++files;
+    }
+
+    CHECK(files == 2);
+
+    const auto stats = cache.stats();
+    CHECK(stats.hits == 3);
+    CHECK(stats.misses == 1);
+    CHECK(stats.writes == 3);
+    CHECK(stats.rejected == 0);
+}
+
+// Every way an entry can be damaged or outdated has to load as a miss
+TEST_CASE(ShaderCacheRejectsTornAndStaleEntries)
+{
+    TemporaryDirectory directory;
+
+    ShaderCache cache;
+    CHECK(cache.init(directory.path()));
+
+    const auto bytecode = Bytes("a shader long enough to tear in the middle");
+    const auto entryPath = directory.path() / "0000000000000007.cso";
+
+    const auto readEntry = [&]()
+    {
+        std::ifstream ifs(entryPath, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    };
+
+    CHECK(cache.storeBytecode(7, bytecode));
+    const auto intact = readEntry();
+    CHECK(intact.size() > bytecode.size());
+
+    // Torn at every length: inside the header and inside the bytecode
+    for (std::size_t length = 0; length < intact.size(); length += 5)
+    {
+        WriteText(entryPath, intact.substr(0, length));
+        CHECK(!cache.loadBytecode(7));
+    }
+
+    // A flipped bit in the bytecode fails the checksum
+    auto corrupted = intact;
+    corrupted.back() ^= 1;
+    WriteText(entryPath, corrupted);
+    CHECK(!cache.loadBytecode(7));
+
+    // Longer than its header says
+    WriteText(entryPath, intact + "xx");
+    CHECK(!cache.loadBytecode(7));
+
+    // An entry from an older cache version; the version follows the magic
+    auto stale = intact;
+    stale[4] = static_cast<char>(ShaderCacheVersion + 1);
+    WriteText(entryPath, stale);
+    CHECK(!cache.loadBytecode(7));
+
+    // The right file name with another key inside
+    CHECK(cache.storeBytecode(8, bytecode));
+    std::filesystem::copy_file(directory.path() / "0000000000000008.cso", entryPath, std::filesystem::copy_options::overwrite_existing);
+    CHECK(!cache.loadBytecode(7));
+
+    WriteText(entryPath, intact);
+    CHECK(cache.loadBytecode(7) == bytecode);
+
+    const auto stats = cache.stats();
+    CHECK(stats.hits == 1);
+    CHECK(stats.misses == 0);
+    CHECK(stats.rejected == (intact.size() + 4) / 5 + 4);
+}
@@ -0,0 +1,227 @@
+#include <cstdint>
+#include <vector>
+
+#include "commandStream.hpp"
+#include "softwareBackend.hpp"
+#include "test.hpp"
+
+namespace
+{
+    constexpr int Size = 16;
+
+    // Pixel coordinates to clip space on a Size x Size target
+    struct Point
+    {
+        float x = 0.f;
+
+        float y = 0.f;
+    };
+
+    struct Scene
+    {
+        SoftwareBackend backend{ 1 };
+
+        PipelineHandle pipeline;
+
+        std::vector<BufferHandle> buffers;
+
+        Scene()
+        {
+            backend.init({ .width = Size, .height = Size });
+
+            PipelineDesc desc;
+            desc.inputLayout.push_back({ .semanticName = "POSITION", .format = VertexFormat::Float3 });
+            pipeline = backend.createPipeline(desc).value_or(PipelineHandle{});
+        }
+
+        DrawIndexedDesc upload(const std::vector<Point>& points)
+        {
+            std::vector<float> vertices;
+            std::vector<std::uint32_t> indices;
+
+            for (const auto& point : points)
+            {
+                vertices.insert(vertices.end(), { point.x / Size * 2.f - 1.f, 1.f - point.y / Size * 2.f, 0.f });
+                indices.push_back(static_cast<std::uint32_t>(indices.size()));
+            }
+
+            const auto vertexBuffer = backend.createBuffer(BufferUsage::Vertex, vertices.data(), vertices.size() * sizeof(float));
+            const auto indexBuffer = backend.createBuffer(BufferUsage::Index, indices.data(), indices.size() * sizeof(std::uint32_t));
+
+            buffers.push_back(*vertexBuffer);
+            buffers.push_back(*indexBuffer);
+
+            return
+            {
+                .vertexBuffer = { .buffer = *vertexBuffer, .sizeInBytes = static_cast<std::uint32_t>(vertices.size() * sizeof(float)), .strideInBytes = 12 },
+                .indexBuffer = { .buffer = *indexBuffer, .sizeInBytes = static_cast<std::uint32_t>(indices.size() * 4), .format = IndexFormat::Uint32 },
+                .instanceBuffer = {},
+                .indexCount = static_cast<std::uint32_t>(indices.size()),
+            };
+        }
+
+        bool covered(int x, int y)const
+        {
+            return backend.pixels()[(y * Size + x) * 4] != 0;
+        }
+
+        int coveredCount()const
+        {
+            int count = 0;
+
+            for (int y = 0; y < Size; ++y)
+            {
+                for (int x = 0; x < Size; ++x)
+                {
+                    count += covered(x, y) ? 1 : 0;
+                }
+            }
+
+            return count;
+        }
+    };
+}
+
+// Rectangle with its corners on pixel centers, so every edge runs through a
+// row or column of them: top and left edges are drawn, bottom and right are not
+TEST_CASE(SoftwareRasterTopLeftRule)
+{
+    for (const bool clockwise : { false, true })
+    {
+        Scene scene;
+
+        const Point a = { 2.5f, 2.5f }, b = { 12.5f, 2.5f }, c = { 12.5f, 12.5f }, d = { 2.5f, 12.5f };
+        const auto draw = clockwise ? scene.upload({ a, b, c, a, c, d }) : scene.upload({ a, c, b, a, d, c });
+
+        scene.backend.frameBegin();
+        scene.backend.setPipeline(scene.pipeline);
+        scene.backend.draw(draw);
+        scene.backend.frameEnd();
+
+        CHECK(scene.covered(2, 2));
+        CHECK(scene.covered(11, 11));
+        CHECK(!scene.covered(12, 5));
+        CHECK(!scene.covered(5, 12));
+        CHECK(scene.coveredCount() == 100);
+
+        // The diagonal both triangles share is drawn once
+        CHECK(scene.backend.stats().pixels == 100);
+    }
+}
+
+// Every pixel covered exactly once by a fan around a center pixel, whatever the edge directions
+TEST_CASE(SoftwareRasterSharedEdgesCoverOnce)
+{
+    Scene scene;
+
+    const Point center = { 7.5f, 7.5f };
+    const Point ring[] = { { 0.f, 0.f }, { 7.5f, 0.f }, { 16.f, 0.f }, { 16.f, 7.5f }, { 16.f, 16.f }, { 7.5f, 16.f }, { 0.f, 16.f }, { 0.f, 7.5f } };
+
+    std::vector<Point> points;
+
+    for (int i = 0; i < 8; ++i)
+    {
+        points.insert(points.end(), { center, ring[i], ring[(i + 1) % 8] });
+    }
+
+    const auto draw = scene.upload(points);
+
+    scene.backend.frameBegin();
+    scene.backend.setPipeline(scene.pipeline);
+    scene.backend.draw(draw);
+    scene.backend.frameEnd();
+
+    CHECK(scene.coveredCount() == Size * Size);
+    CHECK(scene.backend.stats().pixels == Size * Size);
+}
+
+TEST_CASE(SoftwareRasterViewportAndScissor)
+{
+    Scene scene;
+
+    const auto draw = scene.upload({ { 0.f, 0.f }, { 16.f, 0.f }, { 16.f, 16.f }, { 0.f, 0.f }, { 16.f, 16.f }, { 0.f, 16.f } });
+
+    // The full-target quad squeezed into the right half, then cut to its top rows
+    scene.backend.frameBegin();
+    scene.backend.setPipeline(scene.pipeline);
+    scene.backend.setViewport({ .x = 8.f, .width = 8.f, .height = 16.f });
+    scene.backend.draw(draw);
+    scene.backend.frameEnd();
+
+    CHECK(!scene.covered(7, 0));
+    CHECK(scene.covered(8, 0));
+    CHECK(scene.coveredCount() == 8 * Size);
+
+    scene.backend.resetStats();
+    scene.backend.frameBegin();
+    scene.backend.setPipeline(scene.pipeline);
+    scene.backend.setViewport({ .x = 8.f, .width = 8.f, .height = 16.f });
+    scene.backend.setScissor({ .left = 0, .top = 0, .right = 16, .bottom = 4 });
+    scene.backend.draw(draw);
+    scene.backend.frameEnd();
+
+    CHECK(scene.coveredCount() == 8 * 4);
+
+    // frameBegin goes back to the whole target
+    scene.backend.frameBegin();
+    scene.backend.setPipeline(scene.pipeline);
+    scene.backend.draw(draw);
+    scene.backend.frameEnd();
+
+    CHECK(scene.coveredCount() == Size * Size);
+}
+
+// Dx records viewports into a CommandStream; the default execute must pass them on
+TEST_CASE(SoftwareRasterViewportThroughCommandStream)
+{
+    Scene scene;
+
+    const auto draw = scene.upload({ { 0.f, 0.f }, { 16.f, 0.f }, { 16.f, 16.f }, { 0.f, 0.f }, { 16.f, 16.f }, { 0.f, 16.f } });
+
+    CommandStream commands;
+    commands.setPipeline(scene.pipeline);
+    commands.setViewport({ .width = 4.f, .height = 4.f });
+    commands.setScissor({ .right = 16, .bottom = 16 });
+    commands.setVertexBuffer(0, draw.vertexBuffer);
+    commands.setIndexBuffer(draw.indexBuffer);
+    commands.drawIndexed({ .indexCount = draw.indexCount });
+
+    CommandStateTracker tracker;
+
+    scene.backend.frameBegin();
+    scene.backend.execute(commands, tracker);
+    scene.backend.frameEnd();
+
+    CHECK(scene.covered(3, 3));
+    CHECK(!scene.covered(4, 3));
+    CHECK(scene.coveredCount() == 16);
+}
+
+TEST_CASE(SoftwareBackendReusesBufferIds)
+{
+    SoftwareBackend backend(1);
+    backend.init({ .width = Size, .height = Size });
+
+    const std::uint32_t data = 0;
+
+    const auto first = backend.createBuffer(BufferUsage::Vertex, &data, sizeof(data));
+
+    for (int frame = 0; frame < 100; ++frame)
+    {
+        const auto buffer = backend.createBuffer(BufferUsage::Vertex, &data, sizeof(data));
+
+        CHECK(buffer && buffer->id == first->id + 1);
+
+        backend.releaseBuffer(*buffer);
+    }
+
+    // Releasing twice must not put the id on the free list twice
+    const auto buffer = backend.createBuffer(BufferUsage::Vertex, &data, sizeof(data));
+    backend.releaseBuffer(*buffer);
+    backend.releaseBuffer(*buffer);
+
+    const auto a = backend.createBuffer(BufferUsage::Vertex, &data, sizeof(data));
+    const auto b = backend.createBuffer(BufferUsage::Vertex, &data, sizeof(data));
+
+    CHECK(a && b && a->id != b->id);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+// Self-registering checks for the portable build. Every TEST_CASE runs in
+// registration order; a failed CHECK is reported and the case carries on.
+
+struct TestCase
+{
+    const char* name = nullptr;
+
+    void (*function)() = nullptr;
+};
+
+std::vector<TestCase>& TestRegistry();
+
+int& TestFailures();
+
+struct TestRegistrar
+{
+    TestRegistrar(const char* name, void (*function)())
+    {
+        TestRegistry().push_back({ name, function });
+    }
+};
+
+#define TEST_CASE(name) \
+    static void name(); \
+    static TestRegistrar name##Registrar(#name, name); \
+    static void name()
+
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            ++TestFailures(); \
+            std::fprintf(stderr, "%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+        } \
+    } while (false)
@@ -0,0 +1,44 @@
+#include <cstdio>
+#include <cstring>
+
+#include "test.hpp"
+
+std::vector<TestCase>& TestRegistry()
+{
+    static std::vector<TestCase> registry;
+    return registry;
+}
+
+int& TestFailures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+// tests [filter]: runs the cases whose name contains filter
+int main(int argc, char** argv)
+{
+    const char* filter = 1 < argc ? argv[1] : "";
+
+    int run = 0;
+
+    for (const auto& test : TestRegistry())
+    {
+        if (!std::strstr(test.name, filter))
+        {
+            continue;
+        }
+
+        const int failuresBefore = TestFailures();
+
+        test.function();
+
+        std::printf("%-48s %s\n", test.name, failuresBefore == TestFailures() ? "ok" : "FAILED");
+
+        ++run;
+    }
+
+    std::printf("%d cases, %d failed checks\n", run, TestFailures());
+
+    return TestFailures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "test.hpp"
+#include "tlsfAllocator.hpp"
+
+TEST_CASE(TlsfAllocationsNeverOverlap)
+{
+    constexpr std::uint64_t Capacity = 1024 * 1024;
+
+    TlsfAllocator allocator(Capacity);
+
+    std::mt19937 random(1);
+    std::vector<TlsfAllocation> live;
+
+    for (std::uint32_t step = 0; step < 4000; ++step)
+    {
+        if (!live.empty() && random() % 2 == 0)
+        {
+            const std::size_t index = random() % live.size();
+
+            allocator.free(live[index]);
+            live[index] = live.back();
+            live.pop_back();
+        }
+        else
+        {
+            const std::uint64_t alignment = std::uint64_t(16) << (random() % 5);
+
+            if (const auto allocation = allocator.allocate(1 + random() % 8192, alignment))
+            {
+                CHECK(allocation->offset % alignment == 0);
+                CHECK(allocation->offset + allocation->size <= Capacity);
+                live.push_back(allocation.value());
+            }
+        }
+
+        std::vector<TlsfAllocation> sorted = live;
+        std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.offset < b.offset; });
+
+        for (std::size_t i = 1; i < sorted.size(); ++i)
+        {
+            CHECK(sorted[i - 1].offset + sorted[i - 1].size <= sorted[i].offset);
+        }
+    }
+
+    for (const auto& allocation : live)
+    {
+        allocator.free(allocation);
+    }
+
+    // Everything merged back into the one block it started as
+    const auto stats = allocator.stats();
+
+    CHECK(allocator.empty());
+    CHECK(stats.freeBlockCount == 1);
+    CHECK(stats.largestFreeBlock == Capacity);
+}
+
+TEST_CASE(TlsfIgnoresDoubleFree)
+{
+    TlsfAllocator allocator(64 * 1024);
+
+    const auto a = allocator.allocate(1024);
+    const auto b = allocator.allocate(1024);
+    CHECK(a && b);
+
+    allocator.free(a.value());
+    CHECK(!allocator.owns(a.value()));
+
+    allocator.free(a.value());
+    CHECK(allocator.stats().allocationCount == 1);
+    CHECK(allocator.owns(b.value()));
+
+    // b merges with a's block and the tail, so its old index goes unused
+    allocator.free(b.value());
+    allocator.free(b.value());
+    CHECK(allocator.empty());
+    CHECK(allocator.stats().freeBlockCount == 1);
+}
+
+TEST_CASE(TlsfIgnoresForeignAllocations)
+{
+    TlsfAllocator allocator(64 * 1024);
+    TlsfAllocator other(64 * 1024);
+
+    const auto mine = allocator.allocate(1024);
+    const auto theirs = other.allocate(2048);
+    CHECK(mine && theirs);
+
+    // Same block index in another allocator, then a made-up offset
+    allocator.free(theirs.value());
+    allocator.free({ .offset = 512, .size = 1024, .block = mine->block });
+    allocator.free({ .offset = 0, .size = 1024, .block = 1000 });
+
+    CHECK(allocator.owns(mine.value()));
+    CHECK(allocator.stats().allocationCount == 1);
+}
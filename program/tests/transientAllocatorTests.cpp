@@ -0,0 +1,251 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <optional>
+#include <vector>
+
+#include "test.hpp"
+#include "transientAllocator.hpp"
+
+namespace
+{
+    // Host pages that count what is still alive
+    class CountingPageSource : public TransientPageSource
+    {
+    public:
+
+        std::optional<TransientPage> createPage(std::uint64_t size) override
+        {
+            ++created;
+            return m_host.createPage(size);
+        }
+
+        void releasePage(const TransientPage& page) override
+        {
+            ++released;
+            m_host.releasePage(page);
+        }
+
+        std::uint32_t live()const { return created - released; }
+
+        std::uint32_t created = 0;
+
+        std::uint32_t released = 0;
+
+    private:
+
+        HostTransientPageSource m_host;
+    };
+
+    struct Frame
+    {
+        std::uint64_t fenceValue = 0;
+
+        std::vector<TransientAllocation> allocations;
+    };
+
+    // Every allocation still in flight holds the byte pattern of its frame
+    bool Intact(const std::deque<Frame>& frames)
+    {
+        for (const auto& frame : frames)
+        {
+            for (const auto& allocation : frame.allocations)
+            {
+                for (std::uint64_t i = 0; i < allocation.sizeInBytes; ++i)
+                {
+                    if (allocation.cpuAddress[i] != static_cast<std::byte>(frame.fenceValue))
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+
+        return true;
+    }
+
+    // Runs frames that each allocate bytesPerFrame in chunks while the GPU completes
+    // each frame lag frames after it was closed
+    void RunFrames(TransientAllocator& transient, std::uint64_t frames, std::uint64_t lag, std::uint64_t bytesPerFrame, std::uint64_t chunk)
+    {
+        std::deque<Frame> inFlight;
+
+        for (std::uint64_t fenceValue = 1; fenceValue <= frames; ++fenceValue)
+        {
+            Frame frame = { .fenceValue = fenceValue, .allocations = {} };
+
+            for (std::uint64_t used = 0; used < bytesPerFrame; used += chunk)
+            {
+                const auto allocation = transient.allocate(chunk);
+
+                CHECK(allocation);
+
+                if (!allocation)
+                {
+                    return;
+                }
+
+                CHECK(allocation->cpuAddress != nullptr);
+                CHECK(allocation->gpuAddress % ConstantBufferAlignment == 0);
+
+                std::memset(allocation->cpuAddress, static_cast<int>(fenceValue & 0xff), chunk);
+                frame.allocations.push_back(allocation.value());
+            }
+
+            // Writing this frame left the frames the GPU still reads alone
+            CHECK(Intact(inFlight));
+
+            transient.endFrame(fenceValue);
+            inFlight.push_back(std::move(frame));
+
+            if (lag < fenceValue)
+            {
+                transient.reclaim(fenceValue - lag);
+            }
+
+            while (!inFlight.empty() && inFlight.front().fenceValue + lag <= fenceValue)
+            {
+                inFlight.pop_front();
+            }
+        }
+    }
+}
+
+TEST_CASE(TransientRingWrapsWithoutGrowing)
+{
+    constexpr std::uint64_t PageSize = 16 * 1024;
+
+    CountingPageSource pages;
+
+    TransientAllocator transient;
+    CHECK(transient.init(&pages, PageSize));
+
+    // Two frames in flight use two thirds of the page, so the ring has to wrap;
+    // 768 does not divide the page, so frames end at ragged offsets
+    std::uint8_t* previous = nullptr;
+    bool wrapped = false;
+
+    for (std::uint64_t fenceValue = 1; fenceValue <= 64; ++fenceValue)
+    {
+        for (std::uint32_t i = 0; i < 7; ++i)
+        {
+            const auto allocation = transient.allocate(768);
+            CHECK(allocation);
+
+            if (!allocation)
+            {
+                return;
+            }
+
+            const auto address = reinterpret_cast<std::uint8_t*>(allocation->cpuAddress);
+
+            wrapped = wrapped || (previous && address < previous);
+            previous = address;
+        }
+
+        transient.endFrame(fenceValue);
+        transient.reclaim(fenceValue - 1);
+    }
+
+    const auto stats = transient.stats();
+
+    CHECK(wrapped);
+    CHECK(stats.grows == 0);
+    CHECK(stats.pages == 1);
+    CHECK(stats.capacity == PageSize);
+    CHECK(stats.lastFrameBytes == 7 * 768);
+    CHECK(pages.created == 1);
+
+    // Nothing in flight is ever handed out again
+    TransientAllocator checked;
+    CHECK(checked.init(&pages, PageSize));
+    RunFrames(checked, 64, 1, 7 * 768, 768);
+    CHECK(checked.stats().grows == 0);
+}
+
+TEST_CASE(TransientAllocatorGrowsWhileFencesLag)
+{
+    constexpr std::uint64_t PageSize = 4 * 1024;
+    constexpr std::uint64_t Lag = 3;
+
+    CountingPageSource pages;
+
+    TransientAllocator transient;
+    CHECK(transient.init(&pages, PageSize));
+
+    // Four frames of 2 KB are live at once, twice what the first page holds
+    RunFrames(transient, 32, Lag, 2 * 1024, 256);
+
+    auto stats = transient.stats();
+
+    CHECK(0 < stats.grows);
+    CHECK((Lag + 1) * 2 * 1024 <= stats.capacity);
+    CHECK(stats.peakFrameBytes == 2 * 1024);
+
+    // Pages that were outgrown drained once their frames completed
+    CHECK(stats.pages == 1);
+    CHECK(pages.live() == 1);
+
+    // A single allocation larger than the page grows it as well
+    const auto capacity = stats.capacity;
+    const auto large = transient.allocate(capacity * 3);
+
+    CHECK(large && large->sizeInBytes == capacity * 3);
+
+    // The new page alone holds it
+    stats = transient.stats();
+    CHECK(capacity * 3 <= stats.capacity - capacity);
+    CHECK(stats.pages == 2);
+}
+
+TEST_CASE(TransientPagesAreReleasedOnceDrained)
+{
+    constexpr std::uint64_t PageSize = 1024;
+
+    CountingPageSource pages;
+
+    {
+        TransientAllocator transient;
+        CHECK(transient.init(&pages, PageSize));
+
+        // Frame 1 fills the first page, frame 2 forces a second one while frame 1 is in flight
+        for (std::uint32_t i = 0; i < 4; ++i)
+        {
+            CHECK(transient.allocate(256));
+        }
+
+        transient.endFrame(1);
+
+        CHECK(transient.allocate(256));
+        CHECK(transient.stats().pages == 2);
+        CHECK(pages.live() == 2);
+
+        transient.endFrame(2);
+
+        // The old page still holds frame 1
+        transient.reclaim(0);
+        CHECK(pages.live() == 2);
+
+        transient.reclaim(1);
+        CHECK(transient.stats().pages == 1);
+        CHECK(pages.live() == 1);
+
+        // The current page stays even when nothing uses it
+        transient.reclaim(2);
+        CHECK(transient.stats().usedBytes == 0);
+        CHECK(pages.live() == 1);
+
+        // release gives everything back, after which nothing can be allocated
+        transient.release();
+        CHECK(pages.live() == 0);
+        CHECK(!transient.allocate(256));
+
+        CHECK(transient.init(&pages, PageSize));
+        CHECK(pages.live() == 1);
+    }
+
+    // So does the destructor
+    CHECK(pages.live() == 0);
+    CHECK(pages.created == pages.released);
+}
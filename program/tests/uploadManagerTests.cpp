@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "test.hpp"
+#include "uploadManager.hpp"
+
+namespace
+{
+    // Copy queue that finishes a batch once latency more batches have been
+    // signaled after it, or when waited on. Copies read the staging memory
+    // only when their batch finishes, so a ring that reuses staging space too
+    // early leaves wrong bytes in the destination.
+    class FakeCopyQueue : public CopyQueue
+    {
+    public:
+
+        FakeCopyQueue(const std::uint8_t* staging, std::uint64_t latency) : m_staging(staging), m_latency(latency) {}
+
+        bool submitCopies(const std::vector<CopyRegion>& regions) override
+        {
+            m_submitted.insert(m_submitted.end(), regions.begin(), regions.end());
+            return true;
+        }
+
+        bool signal(std::uint64_t value) override
+        {
+            m_batches[value] = std::move(m_submitted);
+            m_submitted.clear();
+            m_signaled = value;
+
+            complete(m_latency < value ? value - m_latency : 0);
+            return true;
+        }
+
+        std::uint64_t completedValue() override { return m_completed; }
+
+        bool wait(std::uint64_t value) override
+        {
+            ++waits;
+
+            if (m_signaled < value)
+            {
+                return false;
+            }
+
+            complete(value);
+            return true;
+        }
+
+        std::vector<std::uint8_t>& destination(std::uint32_t id) { return m_destinations[id]; }
+
+        std::uint64_t waits = 0;
+
+    private:
+
+        void complete(std::uint64_t value)
+        {
+            for (; m_completed < value; ++m_completed)
+            {
+                for (const auto& region : m_batches[m_completed + 1])
+                {
+                    auto& destination = m_destinations[region.destination];
+                    destination.resize(std::max<std::size_t>(destination.size(), region.destinationOffset + region.size));
+
+                    std::copy_n(m_staging + region.stagingOffset, region.size, destination.begin() + region.destinationOffset);
+                }
+
+                m_batches.erase(m_completed + 1);
+            }
+        }
+
+        const std::uint8_t* m_staging = nullptr;
+
+        std::uint64_t m_latency = 0;
+
+        std::uint64_t m_signaled = 0;
+
+        std::uint64_t m_completed = 0;
+
+        std::vector<CopyRegion> m_submitted;
+
+        std::map<std::uint64_t, std::vector<CopyRegion>> m_batches;
+
+        std::map<std::uint32_t, std::vector<std::uint8_t>> m_destinations;
+    };
+
+    std::vector<std::uint8_t> Pattern(std::size_t size, std::uint8_t seed)
+    {
+        std::vector<std::uint8_t> bytes(size);
+
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            bytes[i] = static_cast<std::uint8_t>(seed + i * 7);
+        }
+
+        return bytes;
+    }
+}
+
+// Skipping the end of the ring is only possible once the tail has moved past
+// the request, and space comes back only as batches complete in order
+TEST_CASE(UploadRingWrapsAroundBehindTail)
+{
+    UploadRing ring(256);
+
+    CHECK(ring.allocate(100, 16) == 0u);
+    ring.close(1);
+    CHECK(ring.allocate(100, 16) == 112u);
+    ring.close(2);
+
+    CHECK(!ring.allocate(64, 16));
+
+    ring.reclaim(1);
+    CHECK(ring.usedBytes() == 112u);
+    CHECK(ring.oldestFenceValue() == 2u);
+
+    // Does not fit after 212, fits in front of the tail at 100
+    CHECK(ring.allocate(64, 16) == 0u);
+    CHECK(ring.usedBytes() == 112u + 44u + 64u);
+
+    // Between the new head and the tail is too small now
+    CHECK(!ring.allocate(64, 16));
+    ring.close(3);
+
+    ring.reclaim(2);
+    CHECK(ring.allocate(64, 16) == 64u);
+    ring.close(4);
+
+    ring.reclaim(4);
+    CHECK(ring.usedBytes() == 0u);
+    CHECK(!ring.hasPendingSubmissions());
+
+    // An empty ring starts over, whatever was there last
+    CHECK(ring.allocate(256, 16) == 0u);
+}
+
+TEST_CASE(UploadRingRejectsWrapLargerThanTail)
+{
+    UploadRing ring(256);
+
+    CHECK(ring.allocate(200, 16) == 0u);
+    ring.close(1);
+    CHECK(ring.allocate(16, 16) == 208u);
+    ring.close(2);
+
+    // The tail moves to 200, so 208 bytes cannot go in front of it
+    ring.reclaim(1);
+    CHECK(!ring.allocate(208, 16));
+    CHECK(ring.allocate(200, 16) == 0u);
+}
+
+TEST_CASE(UploadManagerStallsOnlyWhenRingIsFull)
+{
+    std::vector<std::uint8_t> staging(256);
+    FakeCopyQueue queue(staging.data(), 1000);
+    UploadManager uploads;
+    CHECK(uploads.init(&queue, staging.data(), staging.size()));
+
+    const auto first = Pattern(96, 1);
+    const auto second = Pattern(96, 2);
+    const auto third = Pattern(96, 3);
+
+    const auto firstTicket = uploads.enqueue(first.data(), first.size(), 1, 0);
+    CHECK(uploads.flush());
+    const auto secondTicket = uploads.enqueue(second.data(), second.size(), 2, 0);
+    CHECK(uploads.stats().stalls == 0u);
+
+    // Needs the space of the first batch, which only a wait frees
+    const auto thirdTicket = uploads.enqueue(third.data(), third.size(), 3, 0);
+    CHECK(uploads.stats().stalls == 1u);
+    CHECK(queue.waits == 1u);
+    CHECK(firstTicket && uploads.isComplete(*firstTicket));
+    CHECK(secondTicket && !uploads.isComplete(*secondTicket));
+
+    CHECK(thirdTicket && uploads.wait(*thirdTicket));
+    CHECK(queue.destination(1) == first);
+    CHECK(queue.destination(2) == second);
+    CHECK(queue.destination(3) == third);
+}
+
+TEST_CASE(UploadManagerSplitsLargeUploads)
+{
+    std::vector<std::uint8_t> staging(1024);
+    FakeCopyQueue queue(staging.data(), 1000);
+    UploadManager uploads;
+    CHECK(uploads.init(&queue, staging.data(), staging.size()));
+
+    // Half the ring per chunk: 4 chunks, each after the second waiting for
+    // the one two before it
+    const auto data = Pattern(2000, 5);
+    const auto ticket = uploads.enqueue(data.data(), data.size(), 7, 64);
+
+    CHECK(ticket && uploads.wait(*ticket));
+    CHECK(uploads.stats().copies == 4u);
+    CHECK(uploads.stats().bytesUploaded == data.size());
+    CHECK(2u <= uploads.stats().stalls);
+
+    const auto& destination = queue.destination(7);
+    CHECK(destination.size() == 64 + data.size());
+    CHECK(std::equal(data.begin(), data.end(), destination.begin() + 64));
+}
+
+// Random uploads with the copy queue a few batches behind: every destination
+// must end up with exactly what was enqueued for it
+TEST_CASE(UploadManagerKeepsStagingUntilCopied)
+{
+    for (std::uint64_t latency = 0; latency <= 3; ++latency)
+    {
+        std::vector<std::uint8_t> staging(4096);
+        FakeCopyQueue queue(staging.data(), latency);
+        UploadManager uploads;
+        CHECK(uploads.init(&queue, staging.data(), staging.size()));
+
+        std::mt19937 random(static_cast<std::uint32_t>(latency));
+        std::vector<std::vector<std::uint8_t>> expected;
+        UploadManager::Ticket last = 0;
+
+        for (std::uint32_t id = 0; id < 200; ++id)
+        {
+            expected.push_back(Pattern(1 + random() % 3000, static_cast<std::uint8_t>(id)));
+
+            const auto ticket = uploads.enqueue(expected.back().data(), expected.back().size(), id, 0);
+            CHECK(ticket.has_value());
+            last = std::max(last, ticket.value_or(0));
+
+            if (random() % 3 == 0)
+            {
+                CHECK(uploads.flush());
+            }
+        }
+
+        CHECK(uploads.wait(last));
+
+        for (std::uint32_t id = 0; id < expected.size(); ++id)
+        {
+            CHECK(queue.destination(id) == expected[id]);
+        }
+    }
+}
@@ -0,0 +1,236 @@
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "test.hpp"
+#include "vertexQuantization.hpp"
+
+namespace
+{
+    float FromBits(std::uint32_t bits)
+    {
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    // Values every encoder has to agree on: zeros, infinities, NaNs, float
+    // denormals, the half normal/denormal boundary and the half overflow edge
+    std::vector<float> SpecialValues()
+    {
+        const float infinity = std::numeric_limits<float>::infinity();
+
+        std::vector<float> values =
+        {
+            0.f, -0.f, infinity, -infinity, std::numeric_limits<float>::quiet_NaN(), -std::numeric_limits<float>::quiet_NaN(),
+            FromBits(0x7f800001u), FromBits(0x00000001u), FromBits(0x807fffffu), 1e-40f,
+            std::ldexp(1.f, -14), std::ldexp(1.f, -24), std::ldexp(1.f, -25), std::ldexp(3.f, -25),
+            65504.f, 65519.f, 65520.f, -65520.f, 1e10f, 0.5f, 1.f, 1.5f, -1.f, 2.f,
+        };
+
+        std::mt19937 random(1);
+
+        // Random bit patterns reach every exponent, with the same number of lanes as values
+        for (std::uint32_t i = 0; i < 4000; ++i)
+        {
+            values.push_back(FromBits(static_cast<std::uint32_t>(random())));
+        }
+
+        std::uniform_real_distribution<float> unit(-1.5f, 1.5f);
+
+        for (std::uint32_t i = 0; i < 4000; ++i)
+        {
+            values.push_back(unit(random));
+        }
+
+        return values;
+    }
+}
+
+TEST_CASE(HalfRoundsToNearestEven)
+{
+    // Exact ties between neighbouring halves go to the even one
+    CHECK(FloatToHalf(1.f + std::ldexp(1.f, -11)) == 0x3c00);
+    CHECK(FloatToHalf(1.f + std::ldexp(3.f, -11)) == 0x3c02);
+    CHECK(FloatToHalf(std::ldexp(1.f, -25)) == 0x0000);
+    CHECK(FloatToHalf(std::ldexp(3.f, -25)) == 0x0002);
+    CHECK(FloatToHalf(65519.f) == 0x7bff);
+    CHECK(FloatToHalf(65520.f) == 0x7c00);
+
+    // Every midpoint between two finite halves, normal and denormal
+    for (std::uint32_t h = 0; h < 0x7bff; ++h)
+    {
+        const double low = HalfToFloat(static_cast<std::uint16_t>(h));
+        const double high = HalfToFloat(static_cast<std::uint16_t>(h + 1));
+        const auto tie = static_cast<float>((low + high) / 2);
+        const auto even = static_cast<std::uint16_t>(h % 2 == 0 ? h : h + 1);
+
+        CHECK(FloatToHalf(tie) == even);
+        CHECK(FloatToHalf(-tie) == (even | 0x8000));
+    }
+}
+
+TEST_CASE(HalfSpecialValues)
+{
+    const float infinity = std::numeric_limits<float>::infinity();
+
+    CHECK(FloatToHalf(0.f) == 0x0000);
+    CHECK(FloatToHalf(-0.f) == 0x8000);
+    CHECK(FloatToHalf(infinity) == 0x7c00);
+    CHECK(FloatToHalf(-infinity) == 0xfc00);
+    CHECK(FloatToHalf(1e10f) == 0x7c00);
+    CHECK(FloatToHalf(std::numeric_limits<float>::quiet_NaN()) == 0x7e00);
+    CHECK(FloatToHalf(FromBits(0x7f800001u)) == 0x7e00);
+    CHECK(FloatToHalf(1e-40f) == 0x0000);
+    CHECK(FloatToHalf(std::ldexp(1.f, -24)) == 0x0001);
+    CHECK(FloatToHalf(std::ldexp(1.f, -14)) == 0x0400);
+
+    // Every half that is not a NaN survives a round trip
+    for (std::uint32_t h = 0; h < 0x10000; ++h)
+    {
+        if ((h & 0x7c00) == 0x7c00 && (h & 0x3ff) != 0)
+        {
+            continue;
+        }
+
+        CHECK(FloatToHalf(HalfToFloat(static_cast<std::uint16_t>(h))) == h);
+    }
+}
+
+// The batch encoders run four values at a time where SSE2 is available and
+// fall back to the scalar reference for the rest, so one value at a time is
+// the reference
+TEST_CASE(HalfBatchMatchesScalar)
+{
+    const auto values = SpecialValues();
+
+    std::vector<std::uint16_t> batch(values.size());
+    EncodeHalf(values.data(), batch.data(), values.size());
+
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        CHECK(batch[i] == FloatToHalf(values[i]));
+    }
+}
+
+TEST_CASE(Unorm16BatchMatchesScalar)
+{
+    const auto values = SpecialValues();
+
+    std::vector<std::uint16_t> batch(values.size());
+    EncodeUnorm16(values.data(), batch.data(), values.size());
+
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        std::uint16_t scalar = 0;
+        EncodeUnorm16(&values[i], &scalar, 1);
+
+        CHECK(batch[i] == scalar);
+    }
+
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float infinity = std::numeric_limits<float>::infinity();
+
+    // NaN and everything below 0 saturate to 0, everything above 1 to 1
+    const float specials[] = { nan, -infinity, infinity, 1e-40f, -0.5f, 2.f, 0.f, 1.f };
+    const std::uint16_t expected[] = { 0, 0, 65535, 0, 0, 65535, 0, 65535 };
+
+    std::uint16_t encoded[8] = {};
+    EncodeUnorm16(specials, encoded, 8);
+
+    for (std::size_t i = 0; i < 8; ++i)
+    {
+        CHECK(encoded[i] == expected[i]);
+    }
+}
+
+TEST_CASE(Unorm16RoundsToNearestEven)
+{
+    std::vector<float> ties;
+    std::vector<std::uint16_t> expected;
+
+    // Values whose scaled product lands exactly halfway between two steps
+    for (std::uint32_t k = 0; k < 65535; k += 7)
+    {
+        const float scaled = static_cast<float>(k) + 0.5f;
+        const float value = scaled / 65535.f;
+
+        if (value * 65535.f == scaled)
+        {
+            ties.push_back(value);
+            expected.push_back(static_cast<std::uint16_t>(k % 2 == 0 ? k : k + 1));
+        }
+    }
+
+    CHECK(100 < ties.size());
+
+    std::vector<std::uint16_t> batch(ties.size());
+    EncodeUnorm16(ties.data(), batch.data(), ties.size());
+
+    for (std::size_t i = 0; i < ties.size(); ++i)
+    {
+        std::uint16_t scalar = 0;
+        EncodeUnorm16(&ties[i], &scalar, 1);
+
+        CHECK(batch[i] == expected[i]);
+        CHECK(scalar == expected[i]);
+    }
+}
+
+TEST_CASE(OctahedralBatchMatchesScalar)
+{
+    const auto values = SpecialValues();
+
+    // Random vectors of every length and sign, plus the axes and degenerate ones
+    std::vector<float> normals(values.begin(), values.end() - values.size() % 3);
+
+    const float axes[] = { 1, 0, 0, -1, 0, 0, 0, 1, 0, 0, -1, 0, 0, 0, 1, 0, 0, -1, 0, 0, 0, 1e-40f, 0, -1e-40f };
+    normals.insert(normals.end(), std::begin(axes), std::end(axes));
+
+    const auto count = normals.size() / 3;
+
+    std::vector<std::int16_t> batch(count * 2);
+    EncodeOctahedralSnorm16(normals.data(), batch.data(), count);
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        std::int16_t scalar[2] = {};
+        EncodeOctahedralSnorm16(&normals[i * 3], scalar, 1);
+
+        CHECK(batch[i * 2] == scalar[0]);
+        CHECK(batch[i * 2 + 1] == scalar[1]);
+    }
+}
+
+TEST_CASE(OctahedralRoundTrip)
+{
+    std::mt19937 random(2);
+    std::normal_distribution<float> gaussian;
+
+    std::vector<float> normals;
+
+    for (std::uint32_t i = 0; i < 4096; ++i)
+    {
+        const float x = gaussian(random), y = gaussian(random), z = gaussian(random);
+        const float length = std::sqrt(x * x + y * y + z * z);
+
+        normals.insert(normals.end(), { x / length, y / length, z / length });
+    }
+
+    std::vector<std::int16_t> encoded(normals.size() / 3 * 2);
+    std::vector<float> decoded(normals.size());
+
+    EncodeOctahedralSnorm16(normals.data(), encoded.data(), normals.size() / 3);
+    DecodeOctahedralSnorm16(encoded.data(), decoded.data(), normals.size() / 3);
+
+    // 16 bit octahedral keeps directions to well under a hundredth of a degree
+    for (std::size_t i = 0; i < normals.size(); i += 3)
+    {
+        const float cosine = normals[i] * decoded[i] + normals[i + 1] * decoded[i + 1] + normals[i + 2] * decoded[i + 2];
+
+        CHECK(0.99999f < cosine);
+    }
+}
@@ -0,0 +1,24 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include "logger.hpp"
+
+// Prints a LogFormat::Binary log as text, or writes it to a file
+int main(int argc, char** argv)
+{
+    if (argc < 2 || 3 < argc)
+    {
+        std::fprintf(stderr, "usage: logDecoder <binary log> [text output]\n");
+        return 2;
+    }
+
+    if (argc == 3)
+    {
+        std::ofstream output(argv[2], std::ios::binary | std::ios::trunc);
+
+        return DecodeBinaryLog(argv[1], output) ? 0 : 1;
+    }
+
+    return DecodeBinaryLog(argv[1], std::cout) ? 0 : 1;
+}